@@ -0,0 +1,480 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+
+#include "flan/Audio/Audio.h"
+#include "flan/PV/PV.h"
+#include "flan/SPV/SPV.h"
+#include "flan/SQPV/SQPV.h"
+#include "flan/Spectrum/Spectrum.h"
+#include "flan/MRPV/MRPV.h"
+#include "flan/Wavetable.h"
+#include "flan/Utility/Trace.h"
+
+/*
+flan_bench runs the major algorithm families over synthetic inputs of several lengths and channel counts and reports
+throughput. Inputs are generated from a fixed seed, so every run processes identical data.
+
+	flan_bench [--quick | --full] [--filter text] [--jobs 1,2,4] [--reps n] [--csv out.csv]
+		[--baseline old.csv] [--tolerance 0.15] [--trace trace.json]
+
+Throughput is reported in samples/s (channels * frames of input) for Audio algorithms and cells/s (channels * frames * bins
+of input) for PV algorithms. The standard parallel algorithms flan uses don't expose a thread count, so scaling is measured
+by running the same call on 1, 2, 4 ... threads at once. The scaling column is aggregate throughput relative to a single job.
+A parallel algorithm that already saturates the machine will show scaling near 1, a sequential one will scale with jobs.
+
+With --baseline, any case whose throughput fell by more than the tolerance is listed and the exit code is 1.
+*/
+
+using namespace flan;
+
+//============================================================================================================================================================
+// Inputs
+//============================================================================================================================================================
+
+// A few inharmonic partials over quiet noise. mt19937 output is fixed by the standard, the distributions aren't, so noise
+// is scaled by hand.
+static Audio generate_input( Second length, Channel num_channels, FrameRate sample_rate = 48000 )
+	{
+	const Frame num_frames = Frame( length * sample_rate );
+	std::vector<float> buffer( size_t( num_frames ) * num_channels );
+	std::mt19937 rng( 1234 );
+	for( Channel channel = 0; channel < num_channels; ++channel )
+		{
+		const float base = 110.0f * ( 1.0f + 0.25f * channel );
+		for( Frame frame = 0; frame < num_frames; ++frame )
+			{
+			const float t = frame / sample_rate;
+			const float tone = 0.4f * std::sin( 2.0f * pi * base * t )
+				+ 0.2f * std::sin( 2.0f * pi * base * 2.01f * t )
+				+ 0.1f * std::sin( 2.0f * pi * base * 3.07f * t );
+			const float noise = ( rng() >> 8 ) * ( 2.0f / float( 1 << 24 ) ) - 1.0f;
+			buffer[size_t( channel ) * num_frames + frame] = tone + 0.05f * noise;
+			}
+		}
+	return Audio::create_from_buffer( std::move( buffer ), num_channels, sample_rate );
+	}
+
+struct Input
+	{
+	Second length;
+	Channel num_channels;
+	const Audio & audio;
+	const PV & pv; // Null when no PV case runs at this size
+	};
+
+//============================================================================================================================================================
+// Cases
+//============================================================================================================================================================
+
+enum class Unit { Samples, Cells };
+
+struct Case
+	{
+	std::string family;
+	std::string name;
+	Unit unit;
+	Second max_length; // Larger inputs are skipped, some algorithms produce outputs many times the input size
+	Channel max_channels;
+	std::function<bool ( const Input &, int job )> run; // Returns false if the algorithm produced a null output
+	};
+
+static std::filesystem::path temp_file( int job )
+	{
+	return std::filesystem::temp_directory_path() / ( "flan_bench_" + std::to_string( job ) + ".wav" );
+	}
+
+static std::vector<Case> get_cases()
+	{
+	std::vector<Case> cases;
+	auto add = [&]( std::string family, std::string name, Unit unit, Second max_length, Channel max_channels, std::function<bool ( const Input &, int )> run )
+		{
+		cases.push_back( { std::move( family ), std::move( name ), unit, max_length, max_channels, std::move( run ) } );
+		};
+
+	const Second inf = std::numeric_limits<Second>::infinity();
+
+	// Conversions
+	add( "conversion", "Audio::convert_to_PV", 		Unit::Samples, 60, 8, []( const Input & in, int ){ return !in.audio.convert_to_PV().is_null(); } );
+	add( "conversion", "PV::convert_to_audio", 		Unit::Cells,   60, 8, []( const Input & in, int ){ return !in.pv.convert_to_audio().is_null(); } );
+	add( "conversion", "PV round trip exact", 			Unit::Samples, 60, 8, []( const Input & in, int )
+		{
+		TaskContext context;
+		context.set_accuracy( TaskContext::Accuracy::Exact );
+		return !in.audio.convert_to_PV( 2048, 128, 4096, context ).convert_to_audio( context ).is_null();
+		} );
+	add( "conversion", "PV round trip fast", 			Unit::Samples, 60, 8, []( const Input & in, int )
+		{
+		TaskContext context;
+		context.set_accuracy( TaskContext::Accuracy::Fast );
+		return !in.audio.convert_to_PV( 2048, 128, 4096, context ).convert_to_audio( context ).is_null();
+		} );
+	add( "conversion", "Audio::convert_to_SPV", 		Unit::Samples, 1,  1, []( const Input & in, int ){ return !in.audio.convert_to_SPV().is_null(); } );
+	add( "conversion", "SPV round trip", 				Unit::Samples, 1,  1, []( const Input & in, int ){ return !in.audio.convert_to_SPV().convert_to_audio().is_null(); } );
+	add( "conversion", "SPV decimated round trip", 		Unit::Samples, 1,  1, []( const Input & in, int ){ return !in.audio.convert_to_SPV( 1024, 64 ).convert_to_audio().is_null(); } );
+	add( "conversion", "Audio::convert_to_SQPV", 		Unit::Samples, 60, 8, []( const Input & in, int ){ return !in.audio.convert_to_SQPV().is_null(); } );
+	add( "conversion", "SQPV round trip", 				Unit::Samples, 60, 8, []( const Input & in, int ){ return !in.audio.convert_to_SQPV().convert_to_audio().is_null(); } );
+	add( "conversion", "Audio::convert_to_MRPV", 		Unit::Samples, 60, 8, []( const Input & in, int ){ return !in.audio.convert_to_MRPV().is_null(); } );
+	add( "conversion", "MRPV round trip", 				Unit::Samples, 60, 8, []( const Input & in, int ){ return !in.audio.convert_to_MRPV().convert_to_audio().is_null(); } );
+	add( "conversion", "Audio::resample", 			Unit::Samples, inf, 8, []( const Input & in, int ){ return !in.audio.resample( 44100 ).is_null(); } );
+
+	// Filters
+	add( "filter", "Audio::filter_1pole_lowpass", 	Unit::Samples, inf, 8, []( const Input & in, int ){ return !in.audio.filter_1pole_lowpass( 1000 ).is_null(); } );
+	add( "filter", "Audio::filter_2pole_lowpass", 	Unit::Samples, inf, 8, []( const Input & in, int ){ return !in.audio.filter_2pole_lowpass( 1000, 1 ).is_null(); } );
+	add( "filter", "Audio::filter_2pole_bandpass", 	Unit::Samples, inf, 8, []( const Input & in, int ){ return !in.audio.filter_2pole_bandpass( 1000, 1 ).is_null(); } );
+	add( "filter", "Audio::filter_spectrum linear", 	Unit::Samples, inf, 8, []( const Input & in, int )
+		{ return !in.audio.filter_spectrum( Spectrum::create_butterworth_lowpass( 1000, 8 ) ).is_null(); } );
+	add( "filter", "Audio::filter_spectrum minimum", 	Unit::Samples, inf, 8, []( const Input & in, int )
+		{ return !in.audio.filter_spectrum( Spectrum::create_butterworth_lowpass( 1000, 8 ), Audio::FIRPhase::Minimum ).is_null(); } );
+	add( "filter", "Audio::filter_comb", 				Unit::Samples, inf, 8, []( const Input & in, int ){ return !in.audio.filter_comb( 200, .9f ).is_null(); } );
+	add( "filter", "Audio::delay", 					Unit::Samples, 600, 8, []( const Input & in, int ){ return !in.audio.delay( in.length, .25f, .5f ).is_null(); } );
+
+	// Convolution
+	add( "convolve", "Audio::convolve", 				Unit::Samples, 600, 8, []( const Input & in, int )
+		{
+		static const Audio ir = generate_input( .5f, 1 ).fade( .01f, .4f );
+		return !in.audio.convolve( ir ).is_null();
+		} );
+
+	// Grains
+	add( "grains", "Audio::texture", 					Unit::Samples, 60, 8, []( const Input & in, int )
+		{
+		const Audio grain = in.audio.cut( 0, .05f );
+		return !grain.texture( in.length, 200, 10 ).is_null();
+		} );
+	add( "grains", "Audio::granulate", 				Unit::Samples, 60, 8, []( const Input & in, int )
+		{
+		return !in.audio.granulate( in.length, 200, 10, []( Second t ){ return t; }, .05f, .005f ).is_null();
+		} );
+
+	// PV modify family
+	add( "pv", "PV::modify", 							Unit::Cells, 10, 2, []( const Input & in, int ){ return !in.pv.modify( []( TF tf ){ return TF{ tf.t * 1.1f, tf.f * 1.2f }; } ).is_null(); } );
+	add( "pv", "PV::modify_frequency", 				Unit::Cells, 10, 2, []( const Input & in, int ){ return !in.pv.modify_frequency( []( TF tf ){ return tf.f * 1.2f; } ).is_null(); } );
+	add( "pv", "PV::repitch", 						Unit::Cells, 10, 2, []( const Input & in, int ){ return !in.pv.repitch( 1.5f ).is_null(); } );
+	add( "pv", "PV::stretch", 						Unit::Cells, 10, 2, []( const Input & in, int ){ return !in.pv.stretch( 2.0f ).is_null(); } );
+	add( "pv", "PV::stretch_spline", 					Unit::Cells, 10, 2, []( const Input & in, int ){ return !in.pv.stretch_spline( 2.0f ).is_null(); } );
+	add( "pv", "PV::desample", 						Unit::Cells, 10, 2, []( const Input & in, int ){ return !in.pv.desample( .5f ).is_null(); } );
+	add( "pv", "PV::resample", 						Unit::Cells, 10, 2, []( const Input & in, int ){ return !in.pv.resample( in.pv.get_analysis_rate() * 0.75f, in.pv.get_num_bins() / 2 + 1 ).is_null(); } );
+	add( "pv", "PV::shape", 							Unit::Cells, 10, 2, []( const Input & in, int ){ return !in.pv.shape( []( MF mf ){ return MF{ mf.m * .5f, mf.f }; } ).is_null(); } );
+	add( "pv", "PV::retain_n_loudest_partials", 		Unit::Cells, 10, 2, []( const Input & in, int ){ return !in.pv.retain_n_loudest_partials( 16 ).is_null(); } );
+	add( "pv", "PV::resonate", 						Unit::Cells, 10, 2, []( const Input & in, int ){ return !in.pv.resonate( 0, .5f ).is_null(); } );
+	add( "pv", "PV::prism", 							Unit::Cells, 10, 2, []( const Input & in, int )
+		{
+		return !in.pv.prism( []( int, Second, Harmonic h, Frequency f, const std::vector<Magnitude> & ms ){ return MF{ ms[h-1], f * h }; } ).is_null();
+		} );
+
+	// Wavetables
+	add( "wavetable", "Wavetable::Wavetable", 		Unit::Samples, 60, 1, []( const Input & in, int ){ return Wavetable( in.audio ).get_num_waveforms( 0 ) > 0; } );
+	add( "wavetable", "Wavetable::synthesize", 		Unit::Samples, inf, 1, []( const Input & in, int )
+		{
+		static const Wavetable table( []( Second t ){ return std::sin( 2.0f * pi * t ) * ( 1.0f - t / 64.0f ); }, 64 );
+		return !table.synthesize( in.length, []( Second t ){ return 100.0f + 50.0f * t; }, []( Second t ){ return std::fmod( t, 1.0f ); } ).is_null();
+		} );
+
+	// File I/O
+	add( "io", "AudioBuffer::save", 					Unit::Samples, 600, 8, []( const Input & in, int job ){ return in.audio.save( temp_file( job ).string() ); } );
+	add( "io", "Audio::load_from_file", 				Unit::Samples, 600, 8, []( const Input & in, int job )
+		{
+		const std::string path = temp_file( job ).string();
+		if( !std::filesystem::exists( path ) && !in.audio.save( path ) ) return false;
+		return !Audio::load_from_file( path ).is_null();
+		} );
+
+	return cases;
+	}
+
+//============================================================================================================================================================
+// Running
+//============================================================================================================================================================
+
+struct Result
+	{
+	std::string family;
+	std::string name;
+	Second length;
+	Channel num_channels;
+	int jobs;
+	int reps;
+	double median_ms;
+	double min_ms;
+	double units;
+	double throughput;
+	std::string unit_name;
+	double scaling;
+	bool ok;
+	};
+
+struct Options
+	{
+	std::vector<Second> lengths = { 1, 10, 60 };
+	std::vector<Channel> channels = { 1, 2 };
+	std::vector<int> jobs;
+	int reps = 3;
+	std::string filter;
+	std::string csv_path;
+	std::string baseline_path;
+	std::string trace_path;
+	double tolerance = .15;
+	};
+
+// Runs every job once, concurrently. Returns wall time in ms.
+static double time_once( const Case & c, const Input & in, int jobs, bool & ok )
+	{
+	std::vector<char> job_ok( jobs, 0 );
+	const auto start = std::chrono::steady_clock::now();
+	if( jobs == 1 ) job_ok[0] = c.run( in, 0 );
+	else
+		{
+		std::vector<std::thread> threads;
+		for( int job = 0; job < jobs; ++job )
+			threads.emplace_back( [&, job](){ job_ok[job] = c.run( in, job ); } );
+		for( auto & t : threads ) t.join();
+		}
+	const auto end = std::chrono::steady_clock::now();
+	ok = std::all_of( job_ok.begin(), job_ok.end(), []( char x ){ return x != 0; } );
+	return std::chrono::duration<double, std::milli>( end - start ).count();
+	}
+
+static std::vector<Result> run_cases( const std::vector<Case> & cases, const Options & options )
+	{
+	std::vector<Result> results;
+
+	std::cout << std::left << std::setw( 36 ) << "case"
+		<< std::right << std::setw( 8 ) << "seconds" << std::setw( 6 ) << "chans" << std::setw( 6 ) << "jobs"
+		<< std::setw( 12 ) << "median ms" << std::setw( 16 ) << "throughput" << std::setw( 10 ) << "scaling" << "\n";
+
+	for( Second length : options.lengths )
+		for( Channel num_channels : options.channels )
+			{
+			auto active = [&]( const Case & c )
+				{
+				return length <= c.max_length && num_channels <= c.max_channels
+					&& ( options.filter.empty() || ( c.family + " " + c.name ).find( options.filter ) != std::string::npos );
+				};
+			if( std::none_of( cases.begin(), cases.end(), active ) ) continue;
+
+			const Audio audio = generate_input( length, num_channels );
+			const bool needs_pv = std::any_of( cases.begin(), cases.end(), [&]( const Case & c ){ return active( c ) && c.unit == Unit::Cells; } );
+			const PV pv = needs_pv ? audio.convert_to_PV() : PV();
+			const Input in{ length, num_channels, audio, pv };
+
+			for( const Case & c : cases )
+				{
+				if( !active( c ) ) continue;
+
+				const double units = c.unit == Unit::Samples
+					? double( audio.get_num_channels() ) * audio.get_num_frames()
+					: double( pv.get_num_channels() ) * pv.get_num_frames() * pv.get_num_bins();
+
+				double single_job_throughput = 0;
+				for( int jobs : options.jobs )
+					{
+					bool ok = true;
+					std::vector<double> times;
+					for( int rep = 0; rep < options.reps && ok; ++rep )
+						times.push_back( time_once( c, in, jobs, ok ) );
+					std::sort( times.begin(), times.end() );
+
+					Result r;
+					r.family 		= c.family;
+					r.name 			= c.name;
+					r.length 		= length;
+					r.num_channels 	= num_channels;
+					r.jobs 			= jobs;
+					r.reps 			= int( times.size() );
+					r.median_ms 	= times[times.size() / 2];
+					r.min_ms 		= times[0];
+					r.units 		= units;
+					r.throughput 	= ok && r.median_ms > 0 ? units * jobs / ( r.median_ms / 1000.0 ) : 0;
+					r.unit_name 	= c.unit == Unit::Samples ? "samples/s" : "cells/s";
+					if( jobs == options.jobs.front() ) single_job_throughput = r.throughput;
+					r.scaling 		= single_job_throughput > 0 ? r.throughput / single_job_throughput : 0;
+					r.ok 			= ok;
+					results.push_back( r );
+
+					std::cout << std::left << std::setw( 36 ) << c.name << std::right
+						<< std::setw( 8 ) << length << std::setw( 6 ) << num_channels << std::setw( 6 ) << jobs
+						<< std::fixed << std::setprecision( 1 ) << std::setw( 12 ) << r.median_ms
+						<< std::scientific << std::setprecision( 3 ) << std::setw( 16 ) << r.throughput
+						<< std::fixed << std::setprecision( 2 ) << std::setw( 10 ) << r.scaling
+						<< ( ok ? "" : "  FAILED" ) << "\n" << std::defaultfloat;
+
+					if( !ok ) break;
+					}
+				}
+			}
+
+	for( int job = 0; job < options.jobs.back(); ++job )
+		{
+		std::error_code e;
+		std::filesystem::remove( temp_file( job ), e );
+		}
+
+	return results;
+	}
+
+//============================================================================================================================================================
+// Output
+//============================================================================================================================================================
+
+static const char * csv_header = "family,case,seconds,channels,jobs,reps,median_ms,min_ms,units,throughput,unit,scaling,ok";
+
+static std::string result_key( const std::string & name, Second length, Channel num_channels, int jobs )
+	{
+	std::ostringstream s;
+	s << name << "|" << length << "|" << num_channels << "|" << jobs;
+	return s.str();
+	}
+
+static bool write_csv( const std::vector<Result> & results, const std::string & path )
+	{
+	std::ofstream file( path );
+	if( !file )
+		{
+		std::cout << "Couldn't open " << path << " for writing." << std::endl;
+		return false;
+		}
+	file << csv_header << "\n" << std::setprecision( 6 );
+	for( const Result & r : results )
+		file << r.family << ",\"" << r.name << "\"," << r.length << "," << r.num_channels << "," << r.jobs << "," << r.reps << ","
+			<< r.median_ms << "," << r.min_ms << "," << r.units << "," << r.throughput << "," << r.unit_name << "," << r.scaling << "," << r.ok << "\n";
+	return bool( file );
+	}
+
+// Maps case keys to throughput. Only files written by write_csv are understood.
+static std::map<std::string, double> read_csv( const std::string & path )
+	{
+	std::map<std::string, double> out;
+	std::ifstream file( path );
+	if( !file )
+		{
+		std::cout << "Couldn't open " << path << " for reading." << std::endl;
+		return out;
+		}
+	std::string line;
+	std::getline( file, line ); // Header
+	while( std::getline( file, line ) )
+		{
+		const size_t name_start = line.find( '"' );
+		const size_t name_end = line.find( '"', name_start + 1 );
+		if( name_start == std::string::npos || name_end == std::string::npos ) continue;
+		const std::string name = line.substr( name_start + 1, name_end - name_start - 1 );
+
+		std::vector<std::string> fields;
+		std::stringstream rest( line.substr( name_end + 2 ) );
+		for( std::string field; std::getline( rest, field, ',' ); ) fields.push_back( field );
+		if( fields.size() < 8 ) continue;
+
+		out[result_key( name, std::stof( fields[0] ), std::stoi( fields[1] ), std::stoi( fields[2] ) )] = std::stod( fields[7] );
+		}
+	return out;
+	}
+
+// Returns the number of regressions
+static int compare_to_baseline( const std::vector<Result> & results, const std::string & path, double tolerance )
+	{
+	const auto baseline = read_csv( path );
+	int regressions = 0;
+	for( const Result & r : results )
+		{
+		auto it = baseline.find( result_key( r.name, r.length, r.num_channels, r.jobs ) );
+		if( it == baseline.end() || it->second <= 0 ) continue;
+		const double ratio = r.throughput / it->second;
+		if( ratio < 1.0 - tolerance )
+			{
+			if( regressions++ == 0 ) std::cout << "\nRegressions against " << path << ":\n";
+			std::cout << "  " << r.name << " " << r.length << "s " << r.num_channels << "ch " << r.jobs << " jobs: "
+				<< std::fixed << std::setprecision( 1 ) << ( 1.0 - ratio ) * 100.0 << "% slower\n" << std::defaultfloat;
+			}
+		}
+	if( regressions == 0 ) std::cout << "\nNo regressions against " << path << "\n";
+	return regressions;
+	}
+
+//============================================================================================================================================================
+// Main
+//============================================================================================================================================================
+
+template<typename T>
+static std::vector<T> parse_list( const std::string & s )
+	{
+	std::vector<T> out;
+	std::stringstream ss( s );
+	for( std::string x; std::getline( ss, x, ',' ); ) out.push_back( T( std::stod( x ) ) );
+	return out;
+	}
+
+static void print_usage()
+	{
+	std::cout << "flan_bench [--quick | --full] [--lengths 1,10] [--channels 1,2] [--filter text] [--jobs 1,2,4] [--reps n]\n"
+		"           [--csv out.csv] [--baseline old.csv] [--tolerance 0.15] [--trace trace.json]\n";
+	}
+
+int main( int argc, char ** argv )
+	{
+	Options options;
+	for( int i = 1; i < argc; ++i )
+		{
+		const std::string arg = argv[i];
+		auto next = [&]() -> std::string
+			{
+			if( i + 1 >= argc ) { print_usage(); std::exit( 2 ); }
+			return argv[++i];
+			};
+
+		if( arg == "--quick" ) 			{ options.lengths = { 1 }; options.channels = { 1, 2 }; options.reps = 1; }
+		else if( arg == "--full" ) 		{ options.lengths = { 1, 60, 600, 1800 }; options.channels = { 1, 2, 8 }; }
+		else if( arg == "--lengths" ) 	options.lengths = parse_list<Second>( next() );
+		else if( arg == "--channels" ) 	options.channels = parse_list<Channel>( next() );
+		else if( arg == "--jobs" ) 		options.jobs = parse_list<int>( next() );
+		else if( arg == "--reps" ) 		options.reps = std::max( 1, std::stoi( next() ) );
+		else if( arg == "--filter" ) 	options.filter = next();
+		else if( arg == "--csv" ) 		options.csv_path = next();
+		else if( arg == "--baseline" ) 	options.baseline_path = next();
+		else if( arg == "--tolerance" ) options.tolerance = std::stod( next() );
+		else if( arg == "--trace" ) 	options.trace_path = next();
+		else { print_usage(); return arg == "--help" ? 0 : 2; }
+		}
+
+	if( options.jobs.empty() )
+		{
+		const int hardware = std::max( 1u, std::thread::hardware_concurrency() );
+		for( int jobs = 1; jobs < hardware; jobs *= 2 ) options.jobs.push_back( jobs );
+		options.jobs.push_back( hardware );
+		}
+
+	if( !options.trace_path.empty() ) trace::start();
+
+	const auto results = run_cases( get_cases(), options );
+
+	if( !options.trace_path.empty() )
+		{
+		trace::stop();
+		if( trace::get_spans().empty() )
+			std::cout << "\nNo spans were recorded, rebuild flan with LOG_FUNCTION_CALLS to trace.\n";
+		else
+			{
+			trace::write_chrome_trace( options.trace_path );
+			std::cout << "\n";
+			trace::write_summary( std::cout );
+			}
+		}
+
+	if( !options.csv_path.empty() && !write_csv( results, options.csv_path ) ) return 2;
+
+	int status = std::any_of( results.begin(), results.end(), []( const Result & r ){ return !r.ok; } ) ? 1 : 0;
+	if( !options.baseline_path.empty() && compare_to_baseline( results, options.baseline_path, options.tolerance ) > 0 ) status = 1;
+	return status;
+	}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <optional>
+
 #include "flan/Audio/AudioBuffer.h"
 #include "flan/Audio/AudioMod.h"
 #include "flan/Utility/Interpolator.h"
@@ -13,6 +15,7 @@ class Spectrum;
 class PV;
 class SPV;
 class SQPV;
+class MRPV;
 class Graph;
 class FIRFilter;
 
@@ -21,6 +24,8 @@ class FIRFilter;
  *	in flan for manipulating Audio buffers.
  *
  *	Nearly all Audio methods are const and have no side effects. Impure functions have an "_in_place" suffix.
+ *	Methods which don't change the buffer size also have an rvalue overload. Called on a temporary, these process its buffer
+ *	directly rather than allocating an output, so a chain of such methods on a temporary allocates once.
  */
 class Audio : public AudioBuffer
 {
@@ -146,6 +151,12 @@ public:
 		Frame smoothing_frames = 128
 		) const;
 
+	/** Transforms the whole Audio with a single fft, zero padded to a power of two. See Spectrum::convert_to_audio for the inverse.
+	 */
+	Spectrum convert_to_spectrum( 
+		flan_CANCEL_ARG 
+		) const;
+
 	/** Apply a short-time Forier transform to the Audio, and phase vocode the output. See phase_vocoder for details on phase vocoding.
 	 *
 	 *	\param window_size This is the number of Frames copied into each fft input. 
@@ -175,33 +186,74 @@ public:
 		flan_CANCEL_ARG 
 		) const;
 
+	/** Splits the Audio into frequency bands and phase vocodes each with its own window size, so low frequencies can be
+	 *	analyzed with long windows and high frequencies with short ones in a single pass. Lower bands are analyzed from
+	 *	decimated copies of the Audio, so a band with a long window costs about as much per second as the top band divided
+	 *	by its decimation. See MRPV.
+	 *
+	 *	\param crossovers The frequencies between bands. There is one more band than there are crossovers.
+	 *	\param window_sizes The window size of each band in Audio frames, highest band first. These are rounded up to powers
+	 *		of two. If there are fewer sizes than bands, the last size is used for the remaining bands.
+	 *	\param overlaps The number of frames per window in every band. The hop of each band is its window size over this.
+	 *		This is at least 4.
+	 */
+	MRPV convert_to_MRPV(
+		const std::vector<Frequency> & crossovers = { 1500, 375 },
+		const std::vector<Frame> & window_sizes = { 1024, 4096, 16384 },
+		Frame overlaps = 8,
+		flan_CANCEL_ARG
+		) const;
+
+	/** For stereo inputs this is identical to Audio::convert_to_MRPV, but converts the audio to mid-side first. 
+	 *	Non-stereo inputs will produce a null output. See MRPV::convert_to_lr_audio for the inverse transform.
+	 */
+	MRPV convert_to_ms_MRPV(
+		const std::vector<Frequency> & crossovers = { 1500, 375 },
+		const std::vector<Frame> & window_sizes = { 1024, 4096, 16384 },
+		Frame overlaps = 8,
+		flan_CANCEL_ARG
+		) const;
+
 	/** Apply a sliding DFT to the Audio, and phase vocode the output. See phase_vocoder for details on phase vocoding. Be aware that this process
-	 *	can return a very large output.
+	 *	can return a very large output, unless it is decimated.
 	 *
 	 *  \param dft_size The dft size. This determines the number of frequency bins in the output.
+	 *	\param decimation One frame is output for every this many samples. Every sample still updates the transform, so this only 
+	 *		trades time resolution for memory. Values above dft_size / 2 alias frequencies during phase vocoding.
 	 */
 	SPV convert_to_SPV( 
-		Frame dft_size = 1024 
+		Frame dft_size = 1024,
+		Frame decimation = 1,
+		flan_CANCEL_ARG 
 		) const;
 
 	SPV convert_to_ms_SPV( 
-		Frame dft_size = 1024 
+		Frame dft_size = 1024,
+		Frame decimation = 1,
+		flan_CANCEL_ARG 
 		) const;
 
-	/** Apply a sliding constant-q transform to the Audio, and phase vocode the output. See phase_vocoder for details on phase vocoding. Be aware 
-	 *	that this process can return a very large output.
+	/** Apply a constant-q transform to the Audio, and phase vocode the output. See phase_vocoder for details on phase vocoding. The 
+	 *	transform is computed octave by octave on successively decimated copies of the signal, so low octaves cost no more than
+	 *	high ones. See ConstantQ for details.
      *
-	 *  \param bandwidth The frequency range covered by the transform.
+	 *  \param bandwidth The frequency range covered by the transform. The top is limited to the Nyquist frequency.
 	 *	\param bins_per_octave The number of frequency bins per octave of bandwidth.
+	 *	\param hop_size The number of samples between frames. If this is 0, the largest hop that can be phase vocoded in every bin 
+	 *		is used, which is a quarter of the shortest analysis window.
 	 */
 	SQPV convert_to_SQPV( 
 		std::pair<Frequency, Frequency> bandwidth = std::make_pair( 16, 24000 ), 
-		Bin bins_per_octave = 24 
+		Bin bins_per_octave = 24,
+		Frame hop_size = 0,
+		flan_CANCEL_ARG
 		) const;
 
 	SQPV convert_to_ms_SQPV( 
 		std::pair<Frequency, Frequency> bandwidth = std::make_pair( 16, 24000 ), 
-		Bin bins_per_octave = 24 
+		Bin bins_per_octave = 24,
+		Frame hop_size = 0,
+		flan_CANCEL_ARG
 		) const;
 
 	/** AudioBuffer normally stores "Left" and "Right" data in channel 0 and 1 respectively.
@@ -466,12 +518,14 @@ public:
 		bool feedback = false 
 		) const;
 
-	/** Generates a volume-decaying iteration of the input. If a mod is supplied, it will 
-	 *	be fed the previous iteration's ouput, rather than the original Audio.
+	/** Generates a volume-decaying iteration of the input using a feedback delay line. The delay time is read with interpolation
+	 *	every frame, so it can be fractional and sweep smoothly. Runs in time linear in the output length, using memory proportional 
+	 *	to the longest delay. If a mod is supplied, it will be fed the previous iteration's ouput, rather than the original Audio.
 	 *	\param added_length How much additional time should be added to the input.
-	 *	\param delay_time The amount of time between delays.
-	 *	\param decay Each delay event will have its gain scaled by the decay at the event time.
-	 *	\param mod This allows user-defined processing of each delay. Delay line feedback will have this repeatedly applied.
+	 *	\param delay_time The amount of time between delays. This is at least three frames.
+	 *	\param decay The feedback gain at each frame.
+	 *	\param mod This allows user-defined processing of each delay. Delay line feedback will have this repeatedly applied. The feedback
+	 *		is passed to mod in blocks, each a little shorter than the shortest delay time within it, along with the block start time.
 	 */
 	Audio delay( 
 		Second added_length, 
@@ -480,6 +534,20 @@ public:
 		const AudioMod & mod = AudioMod() 
 		) const;
 
+	/** Multi-tap version of delay. Each tap reads the delay line at its own delay time and gain, and the sum of all taps is fed
+	 *	back into the line, passing through mod if one is supplied.
+	 *	\param added_length How much additional time should be added to the input.
+	 *	\param delay_times The delay time of each tap.
+	 *	\param decays The feedback gain of each tap. This must be the same size as delay_times.
+	 *	\param mod This allows user-defined processing of the summed feedback, in blocks shorter than the shortest tap delay.
+	 */
+	Audio delay( 
+		Second added_length, 
+		const std::vector<const Function<Second, Second> *> & delay_times, 
+		const std::vector<const Function<Second, float> *> & decays, 
+		const AudioMod & mod = AudioMod() 
+		) const;
+
 	// Audio stereo_delay(
 	// 	Second length,
 	// 	const Function<Second, Second> & l_time,
@@ -532,7 +600,11 @@ public:
 	 */
 	Audio modify_volume( 
 		const Function<Second, float> & gain 
-		) const;
+		) const &;
+
+	Audio modify_volume( 
+		const Function<Second, float> & gain 
+		) &&;
 
 	Audio ring_modulate( 
 		const Audio & other 
@@ -547,7 +619,11 @@ public:
 	 */
 	Audio set_volume( 
 		const Function<Second, Amplitude> & level 
-		) const;
+		) const &;
+
+	Audio set_volume( 
+		const Function<Second, Amplitude> & level 
+		) &&;
 
 	Audio& set_volume_in_place(
 		const Function<Second, Amplitude> & level
@@ -562,7 +638,13 @@ public:
 		Second start = 16.0f/48000.0f, 
 		Second end = 16.0f/48000.0f, 
 		const Interpolator & interp = Interpolator::sqrt()
-		) const;
+		) const &;
+
+	Audio fade( 
+		Second start = 16.0f/48000.0f, 
+		Second end = 16.0f/48000.0f, 
+		const Interpolator & interp = Interpolator::sqrt()
+		) &&;
 
 	Audio& fade_in_place(
 	 	Second start = 16.0f/48000.0f, 
@@ -579,7 +661,13 @@ public:
 		Frame start = 16, 
 		Frame end = 16, 
 		const Interpolator & interp = Interpolator::sqrt()
-		) const;
+		) const &;
+
+	Audio fade_frames( 
+		Frame start = 16, 
+		Frame end = 16, 
+		const Interpolator & interp = Interpolator::sqrt()
+		) &&;
 
 	Audio& fade_frames_in_place( 
 		Frame start = 16, 
@@ -590,16 +678,45 @@ public:
 	/** This phase inverts the input. Every output sample is assigned the negative of the input sample at that time.
 	 */
 	Audio invert_phase(
-		) const;
+		) const &;
+
+	Audio invert_phase(
+		) &&;
 
 	/** This applies the shaper as a function to each sample in the input.
 	 *	\param shaper Each sample in the input is passed through this. 
 	 *		Samples will be values on [-1,1] under normal circumstances.
 	 *		For example, the function y = x would have no effect as a shaper.
+	 *	\param oversample_factor The shaper is applied at this multiple of the sample rate to reduce aliasing. This is rounded up
+	 *		to a power of two, at most 16. See flan::Oversampler.
 	 */
 	Audio waveshape( 
 		const Function< std::pair<Second, Sample>, Sample > & shaper,
 		uint16_t oversample_factor = 4
+		) const &;
+
+	Audio waveshape( 
+		const Function< std::pair<Second, Sample>, Sample > & shaper,
+		uint16_t oversample_factor = 4
+		) &&;
+
+	/** Shapes a block of oversampled samples from one channel in place.
+	 *	\param samples The samples to shape.
+	 *	\param num_samples The number of samples.
+	 *	\param start_time The time of the first sample. Near the ends of the input this can fall a little outside of the input.
+	 *	\param sample_rate The oversampled sample rate.
+	 */
+	using BlockShaper = std::function<void ( Sample * samples, Frame num_samples, Second start_time, FrameRate sample_rate )>;
+
+	/** Batch version of waveshape. Rather than being called once per sample, shaper is handed consecutive blocks of each channel's
+	 *	oversampled signal. Blocks from a single channel arrive in order, but separate channels are processed in parallel.
+	 *	\param shaper See BlockShaper.
+	 *	\param oversample_factor The shaper is applied at this multiple of the sample rate to reduce aliasing. This is rounded up
+	 *		to a power of two, at most 16.
+	 */
+	Audio waveshape_blocks( 
+		const BlockShaper & shaper,
+		uint16_t oversample_factor = 4
 		) const;
 
 	/** This is meant to be a black box process for adding a moisture effect to bass signals.
@@ -623,7 +740,16 @@ public:
 		const Function<Second, Second> & release = 100.0f / 1000.0f, 
 		const Function<Second, Decibel> & knee_width = Decibel( 0 ), 
 		const Audio * sidechain_source = nullptr 
-		) const;
+		) const &;
+
+	Audio compress( 
+		const Function<Second, Decibel> & threshold, 
+		const Function<Second, float> & compression_ratio = 3.0f, 
+		const Function<Second, Second> & attack = 5.0f / 1000.0f, 
+		const Function<Second, Second> & release = 100.0f / 1000.0f, 
+		const Function<Second, Decibel> & knee_width = Decibel( 0 ), 
+		const Audio * sidechain_source = nullptr 
+		) &&;
 
 	Audio apply_adsr_envelope(
 		Second attack_time,
@@ -685,7 +811,11 @@ public:
 	 */
 	Audio pan( 
 		const Function<Second, float> & pan_position 
-		) const;
+		) const &;
+
+	Audio pan( 
+		const Function<Second, float> & pan_position 
+		) &&;
 
 	Audio& pan_in_place( 
 		const Function<Second, float> & pan_position 
@@ -721,12 +851,22 @@ public:
 	Audio filter_1pole_lowpass(
 		const Function<Second, Frequency> & cutoff,
 		uint16_t order = 1
-		) const;
+		) const &;
+
+	Audio filter_1pole_lowpass(
+		const Function<Second, Frequency> & cutoff,
+		uint16_t order = 1
+		) &&;
 
 	Audio filter_1pole_highpass(
 		const Function<Second, Frequency> & cutoff,
 		uint16_t order = 1
-		) const;
+		) const &;
+
+	Audio filter_1pole_highpass(
+		const Function<Second, Frequency> & cutoff,
+		uint16_t order = 1
+		) &&;
 
 	std::vector<Audio> filter_1pole_split(
 		const Function<Second, Frequency> & cutoff,
@@ -737,13 +877,25 @@ public:
 		const Function<Second, Frequency> & cutoff,
 		const Function<Second, Decibel> & gain,
 		uint16_t order = 1
-		) const;
+		) const &;
+
+	Audio filter_1pole_lowshelf(
+		const Function<Second, Frequency> & cutoff,
+		const Function<Second, Decibel> & gain,
+		uint16_t order = 1
+		) &&;
 
 	Audio filter_1pole_highshelf(
 		const Function<Second, Frequency> & cutoff,
 		const Function<Second, Decibel> & gain,
 		uint16_t order = 1
-		) const;
+		) const &;
+
+	Audio filter_1pole_highshelf(
+		const Function<Second, Frequency> & cutoff,
+		const Function<Second, Decibel> & gain,
+		uint16_t order = 1
+		) &&;
 
 	/** This applies the same 1-pole low pass filter to the input n times. 
 		It is mainly a tool used for modeling atmospheric scattering in spacialization methods.
@@ -751,12 +903,22 @@ public:
 	Audio filter_1pole_repeat_low(
 		const Function<Second, Frequency> & cutoff,
 		const uint16_t repeats
-		) const;
+		) const &;
+
+	Audio filter_1pole_repeat_low(
+		const Function<Second, Frequency> & cutoff,
+		const uint16_t repeats
+		) &&;
 
 	Audio filter_1pole_repeat_high(
 		const Function<Second, Frequency> & cutoff,
 		const uint16_t repeats
-		) const;
+		) const &;
+
+	Audio filter_1pole_repeat_high(
+		const Function<Second, Frequency> & cutoff,
+		const uint16_t repeats
+		) &&;
 
 	/* 2 Pole ============================ */
 
@@ -764,19 +926,37 @@ public:
 		const Function<Second, Frequency> & cutoff,
 		const Function<Second, float> & damping,
 		uint16_t order = 1
-		) const;
+		) const &;
+
+	Audio filter_2pole_lowpass(
+		const Function<Second, Frequency> & cutoff,
+		const Function<Second, float> & damping,
+		uint16_t order = 1
+		) &&;
 
 	Audio filter_2pole_bandpass(
 		const Function<Second, Frequency> & cutoff,
 		const Function<Second, float> & damping,
 		uint16_t order = 1
-		) const;
+		) const &;
+
+	Audio filter_2pole_bandpass(
+		const Function<Second, Frequency> & cutoff,
+		const Function<Second, float> & damping,
+		uint16_t order = 1
+		) &&;
 
 	Audio filter_2pole_highpass(
 		const Function<Second, Frequency> & cutoff,
 		const Function<Second, float> & damping,
 		uint16_t order = 1
-		) const;
+		) const &;
+
+	Audio filter_2pole_highpass(
+		const Function<Second, Frequency> & cutoff,
+		const Function<Second, float> & damping,
+		uint16_t order = 1
+		) &&;
 
 	std::vector<Audio> filter_2pole_split(
 		const Function<Second, Frequency> & cutoff,
@@ -788,28 +968,55 @@ public:
 		const Function<Second, Frequency> & cutoff,
 		const Function<Second, float> & damping,
 		uint16_t order = 1
-		) const;
+		) const &;
+
+	Audio filter_2pole_notch(
+		const Function<Second, Frequency> & cutoff,
+		const Function<Second, float> & damping,
+		uint16_t order = 1
+		) &&;
 
 	Audio filter_2pole_lowshelf(
 		const Function<Second, Frequency> & cutoff,
 		const Function<Second, float> & damping,
 		const Function<Second, Decibel> & gain,
 		uint16_t order = 1
-		) const;
+		) const &;
+
+	Audio filter_2pole_lowshelf(
+		const Function<Second, Frequency> & cutoff,
+		const Function<Second, float> & damping,
+		const Function<Second, Decibel> & gain,
+		uint16_t order = 1
+		) &&;
 
 	Audio filter_2pole_bandshelf(
 		const Function<Second, Frequency> & cutoff,
 		const Function<Second, float> & damping,
 		const Function<Second, Decibel> & gain,
 		uint16_t order = 1
-		) const;
+		) const &;
+
+	Audio filter_2pole_bandshelf(
+		const Function<Second, Frequency> & cutoff,
+		const Function<Second, float> & damping,
+		const Function<Second, Decibel> & gain,
+		uint16_t order = 1
+		) &&;
 
 	Audio filter_2pole_highshelf(
 		const Function<Second, Frequency> & cutoff,
 		const Function<Second, float> & damping,
 		const Function<Second, Decibel> & gain,
 		uint16_t order = 1
-		) const;
+		) const &;
+
+	Audio filter_2pole_highshelf(
+		const Function<Second, Frequency> & cutoff,
+		const Function<Second, float> & damping,
+		const Function<Second, Decibel> & gain,
+		uint16_t order = 1
+		) &&;
 
 	/* Other filters ==================== */
 
@@ -820,7 +1027,16 @@ public:
 		bool invert = false,
 		const Function<Second, float> & wet_dry = .5,
 		bool use_saturator = false
-		) const;
+		) const &;
+
+	Audio filter_1pole_multinotch(
+		uint16_t order,
+		const Function<Second, Frequency> & cutoff,
+		const Function<Second, float> & feedback = 0,
+		bool invert = false,
+		const Function<Second, float> & wet_dry = .5,
+		bool use_saturator = false
+		) &&;
 
 	Audio filter_2pole_multinotch(
 		uint16_t order,
@@ -830,13 +1046,51 @@ public:
 		bool invert = false,
 		const Function<Second, float> & wet_dry = .5,
 		bool use_saturator = false
-		) const;
+		) const &;
+
+	Audio filter_2pole_multinotch(
+		uint16_t order,
+		const Function<Second, Frequency> & cutoff,
+		const Function<Second, float> & damping,
+		const Function<Second, float> & feedback = 0,
+		bool invert = false,
+		const Function<Second, float> & wet_dry = .5,
+		bool use_saturator = false
+		) &&;
+
+	Audio filter_comb(
+		const Function<Second, Frequency> & cutoff,
+		const Function<Second, float> & feedback = 0,
+		const Function<Second, float> & wet_dry = .5,
+		bool invert = false
+		) const &;
 
 	Audio filter_comb(
 		const Function<Second, Frequency> & cutoff,
 		const Function<Second, float> & feedback = 0,
 		const Function<Second, float> & wet_dry = .5,
 		bool invert = false
+		) &&;
+
+	enum class FIRPhase
+		{
+		Linear = 0,
+		Minimum = 1,
+		};
+	/** This filters the Audio by the magnitude response of a Spectrum, using an FIR filter designed from it and applied through
+	 *	partitioned fft convolution. Any phase in the Spectrum is ignored. The filter is designed once per response and sample
+	 *	rate and then cached, so filtering many files with the same response only pays for the convolution.
+	 *	\param response The magnitude response to apply. This can be made with Spectrum::create_from_function, the Butterworth
+	 *		designs like Spectrum::create_butterworth_lowpass, or Audio::convert_to_spectrum. The filter length is set by its bin 
+	 *		spacing, so more bins give a sharper filter. Channels are reused cyclically if it has fewer than the Audio.
+	 *	\param phase Linear phase filters have no phase distortion, and their delay is compensated so the output lines up with
+	 *		the input, but they ring before transients. Minimum phase filters don't pre-ring, but delay frequencies unevenly, as
+	 *		analog and recursive filters do.
+	 */
+	Audio filter_spectrum(
+		const Spectrum & response,
+		FIRPhase phase = FIRPhase::Linear,
+		flan_CANCEL_ARG
 		) const;
 
 	/** This one is sort of hard to explain. A purely real signal contains mirrored positive and negative frequency components.
@@ -976,7 +1230,8 @@ public:
 	 */
 	Audio convolve( 
 		const Audio & ir,
-		bool normalize = true
+		bool normalize = true,
+		flan_CANCEL_ARG
 		) const;
 
 
@@ -991,7 +1246,8 @@ public:
 	*  \param freq The frequency of the output.
 	*  \param sample_rate The sample rate of the output.
 	*  \param oversample Synthesized audio must be generated at a sample rate higher than the desired sample rate to avoid aliasing.
-	*      This describes how many samples should be used in the synthesis per sample in the output.
+	*      This describes how many samples should be used in the synthesis per sample in the output. This is unused when waveform
+	*      is one of flan::waveforms, those are rendered band-limited at the output rate by a flan::Oscillator.
 	*/
 	static Audio synthesize_waveform(  
 		const Function<Second, Amplitude> & waveform, 
@@ -1001,16 +1257,57 @@ public:
 		int oversample = 16 
 		);
 
+	/** Generate uniform white noise on [-1,1]. Noise is generated in parallel, and the output only depends on the seed.
+	*  \param length The length of the output.
+	*  \param sample_rate The sample rate of the output.
+	*  \param oversample Unused, noise generated at the output rate is already band-limited.
+	*  \param seed The random seed. If this isn't provided, one is drawn from std::random_device.
+	*/
 	static Audio synthesize_white_noise(
 		Second length,
 		FrameRate sample_rate = 48000, 
-		int oversample = 16 
+		int oversample = 16,
+		std::optional<uint64_t> seed = std::nullopt
 		);
 
+	/** Generate pink noise using the Voss-McCartney algorithm, normalized to a peak of 1.
+	*  \param length The length of the output.
+	*  \param sample_rate The sample rate of the output.
+	*  \param num_rows Each row extends the pink spectrum down one octave from Nyquist, at most 63 are used.
+	*  \param seed The random seed. If this isn't provided, one is drawn from std::random_device.
+	*/
 	static Audio synthesize_pink_noise(
 		Second length,
 		FrameRate sample_rate = 48000,
-		int num_rows = 128
+		int num_rows = 128,
+		std::optional<uint64_t> seed = std::nullopt
+		);
+
+	/** Generate brown noise, which falls 6dB per octave, normalized to a peak of 1.
+	*  \param length The length of the output.
+	*  \param sample_rate The sample rate of the output.
+	*  \param cutoff Below this frequency the spectrum flattens out, which keeps the signal from wandering off.
+	*  \param seed The random seed. If this isn't provided, one is drawn from std::random_device.
+	*/
+	static Audio synthesize_brown_noise(
+		Second length,
+		FrameRate sample_rate = 48000,
+		Frequency cutoff = 20,
+		std::optional<uint64_t> seed = std::nullopt
+		);
+
+	/** Generate velvet noise, a sparse train of impulses of random sign at random positions. It sounds smoother than white noise 
+	*  at far lower densities, which makes it useful for cheap decorrelation and reverb.
+	*  \param length The length of the output.
+	*  \param sample_rate The sample rate of the output.
+	*  \param impulses_per_second The average impulse density. Each 1/impulses_per_second span holds exactly one impulse.
+	*  \param seed The random seed. If this isn't provided, one is drawn from std::random_device.
+	*/
+	static Audio synthesize_velvet_noise(
+		Second length,
+		FrameRate sample_rate = 48000,
+		float impulses_per_second = 2000,
+		std::optional<uint64_t> seed = std::nullopt
 		);
 
 	/** This process generates an Audio given information about the spectral dispersion and amplitude of each harmonic.
@@ -1038,6 +1335,13 @@ public:
         Second granularity = 0.001f
 		);
 
+	/** Generate a single band-limited impulse, one period of base_freq long, built from harmonics of base_freq.
+	*  Impulses are cached, so repeated requests with nearby parameters are cheap.
+	*  \param base_freq The frequency of the lowest harmonic.
+	*  \param num_harmonics The number of harmonics used. This is limited to those below Nyquist.
+	*  \param chroma A geometric scaling factor on the harmonics.
+	*  \param sample_rate The sample rate of the output.
+	*/
 	static Audio synthesize_impulse(
 		Frequency base_freq,
 		Harmonic num_harmonics = std::numeric_limits<Harmonic>::max(),
@@ -0,0 +1,89 @@
+#include "flan/Audio/AudioBatch.h"
+
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#include "flan/Audio/AudioIO.h"
+#include "flan/Utility/Trace.h"
+
+using namespace flan;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+Second seconds_since( Clock::time_point start )
+	{
+	return std::chrono::duration<Second>( Clock::now() - start ).count();
+	}
+
+}
+
+std::vector<BatchResult> flan::process_batch(
+	const std::vector<BatchJob> & jobs,
+	const Pipe<Audio> & pipe,
+	const BatchOptions & options
+	)
+	{
+	flan_TRACE_SPAN( "flan::process_batch" );
+
+	std::vector<BatchResult> results( jobs.size() );
+	if( jobs.empty() ) return results;
+
+	const size_t num_workers = std::min( jobs.size(), options.num_workers != 0
+		? options.num_workers
+		: std::max( size_t( std::thread::hardware_concurrency() ), size_t( 1 ) ) );
+
+	std::vector<std::string> inputs;
+	for( const BatchJob & job : jobs ) inputs.push_back( job.input );
+
+	// One file ahead per worker keeps every worker fed without letting loads race far ahead of processing
+	AudioPrefetcher prefetcher( std::move( inputs ), options.memory_budget, num_workers );
+
+	auto is_cancelled = [&](){ return options.cancel && options.cancel->load( std::memory_order_relaxed ); };
+
+	auto work = [&]()
+		{
+		while( !is_cancelled() )
+			{
+			const auto wait_start = Clock::now();
+			std::optional<AudioPrefetcher::Item> item = prefetcher.next();
+			if( !item ) return;
+
+			// Each job writes only its own result, so no locking is needed
+			BatchResult & result = results[item->index];
+			result.wait_time = seconds_since( wait_start );
+
+			if( item->audio.is_null() )
+				result.status = BatchResult::Status::LoadFailed;
+			else
+				{
+				const auto process_start = Clock::now();
+				Audio out = pipe( std::move( item->audio ) );
+				result.process_time = seconds_since( process_start );
+
+				if( out.is_null() )
+					result.status = BatchResult::Status::ProcessFailed;
+				else
+					{
+					const auto save_start = Clock::now();
+					const bool saved = out.save( jobs[item->index].output, options.format );
+					result.save_time = seconds_since( save_start );
+					result.status = saved ? BatchResult::Status::Success : BatchResult::Status::SaveFailed;
+					}
+				}
+
+			if( options.on_job_finished ) options.on_job_finished( item->index, result );
+			}
+		};
+
+	// Workers start once for the whole batch rather than once per file
+		{
+		std::vector<std::jthread> workers;
+		for( size_t i = 0; i < num_workers; ++i )
+			workers.emplace_back( work );
+		}
+
+	return results;
+	}
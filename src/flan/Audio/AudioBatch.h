@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+#include "flan/Audio/Audio.h"
+#include "flan/Pipe.h"
+
+namespace flan {
+
+/*
+Processing a catalogue one file at a time pays setup costs for every file: threads are started, fft plans are made, and the
+disk waits for the CPU and the CPU for the disk. process_batch runs a whole catalogue through a Pipe<Audio> instead. Files are
+loaded ahead of time by an AudioPrefetcher, and spread across a fixed set of worker threads which live for the whole batch. Fft
+plans are taken from the FFTHelper pool, so each size is planned once per batch rather than once per file, and r8brain keeps
+its own process wide cache of resampler filters.
+
+	std::vector<BatchJob> jobs;
+	for( auto & path : paths ) jobs.push_back( { path, "normalized/" + path } );
+	auto results = process_batch( jobs, []( Audio && a ){ return std::move( a ).set_volume( 0.9f ); } );
+
+The Pipe is called from every worker at once, so anything it captures must be safe to use from several threads.
+*/
+
+/** An input file and where to save its result.
+ */
+struct BatchJob
+	{
+	std::string input;
+	std::string output;
+	};
+
+/** The outcome of one BatchJob.
+ */
+struct BatchResult
+	{
+	enum class Status
+		{
+		Success,
+		LoadFailed,		/** The input couldn't be loaded. */
+		ProcessFailed,	/** The Pipe returned null Audio. */
+		SaveFailed,		/** The output couldn't be saved. */
+		NotRun,			/** The batch was cancelled first. */
+		};
+
+	Status status = Status::NotRun;
+	Second wait_time = 0;		// Time the worker waited for the input to load
+	Second process_time = 0;
+	Second save_time = 0;
+	};
+
+struct BatchOptions
+	{
+	size_t num_workers = 0;					// Zero uses one worker per hardware thread
+	int format = -1;						// The libsndfile format to save in, see AudioBuffer::save
+	uint64_t memory_budget = 1ull << 30;	// The loaded sample data which may wait for a worker, see AudioPrefetcher
+	const std::atomic<bool> * cancel = nullptr; // When set, workers finish their current file and stop
+	std::function<void ( size_t job_index, const BatchResult & )> on_job_finished; // Called from the worker which ran the job
+	};
+
+/** Loads, processes, and saves every job.
+ *	\param jobs The files to process.
+ *	\param pipe The processing applied to each file.
+ *	\param options See BatchOptions.
+ *	\return The result of each job, in the order of jobs.
+ */
+std::vector<BatchResult> process_batch(
+	const std::vector<BatchJob> & jobs,
+	const Pipe<Audio> & pipe,
+	const BatchOptions & options = BatchOptions()
+	);
+
+}
@@ -1,5 +1,7 @@
 #include "flan/Audio/AudioBuffer.h"
 
+#include "flan/Utility/Trace.h"
+
 #include <iostream>
 #include <algorithm>
 #include <fstream>
@@ -21,12 +23,15 @@ AudioBuffer::AudioBuffer( std::vector<float> && temp_buffer, Channel num_channel
 	format.num_channels = num_channels;
 	format.num_frames = temp_buffer.size() / num_channels;
 	format.sample_rate = sr;
+	flan_TRACE_ALLOCATION( buffer.size() * sizeof( Sample ) );
 	}
 
 AudioBuffer::AudioBuffer( const Format & other )
 	: format( other )
 	, buffer( get_num_channels() * get_num_frames() )
-	{}
+	{
+	flan_TRACE_ALLOCATION( buffer.size() * sizeof( Sample ) );
+	}
 
 AudioBuffer::AudioBuffer( const std::string & filename )
 	: format()
@@ -47,6 +52,7 @@ AudioBuffer AudioBuffer::copy() const
 	AudioBuffer out;
 	out.format = format;
 	out.buffer = buffer;
+	flan_TRACE_ALLOCATION( buffer.size() * sizeof( Sample ) );
 	return out;
 	}
 
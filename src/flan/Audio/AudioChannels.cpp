@@ -1,4 +1,5 @@
 #include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
  
 using namespace flan;
 
@@ -13,6 +14,7 @@ static std::vector<const T *> get_pointers( const std::vector<T> & ts )
 std::vector<Audio> Audio::split_channels(
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::split_channels", *this );
 	Audio::Format format;
 	format.num_channels = 1;
 	format.num_frames = get_num_frames();
@@ -32,6 +34,7 @@ Audio Audio::combine_channels(
 	const std::vector<const Audio *> & channels_unmatched 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::combine_channels" );
 	if( channels_unmatched.empty() ) return Audio::create_null();
 
 	const std::vector<Audio> channels_resampled_container = match_sample_rates_or_return_null( channels_unmatched );
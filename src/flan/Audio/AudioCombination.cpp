@@ -1,4 +1,5 @@
 #include "Audio.h"
+#include "flan/Utility/Trace.h"
 
 using namespace flan; 
 using namespace std::ranges;
@@ -81,6 +82,7 @@ Audio Audio::mix(
 	std::vector<Amplitude> amplitudes 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::mix" );
 	// Yes this is silly but it's fine
 	std::vector<Function<Second, Amplitude>> amp_funcs;
 	for( Amplitude a : amplitudes ) amp_funcs.push_back( a );
@@ -96,6 +98,7 @@ Audio Audio::mix(
 	std::vector<Amplitude> amplitudes
 	)
 	{
+	flan_TRACE_SPAN( "Audio::mix" );
 	return mix( get_pointers( ins ), start_times, amplitudes );
 	}
 
@@ -105,6 +108,7 @@ Audio Audio::mix(
 	const std::vector<const Function<Second, Amplitude> *> & amplitudes 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::mix" );
 	// Input validation
 	if( ins_unmatched.empty() ) return Audio::create_null();
 
@@ -175,6 +179,7 @@ Audio Audio::mix(
 	const std::vector<Function<Second, Amplitude>> & amplitudes 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::mix" );
 	return mix( get_pointers( ins ), start_times, get_pointers( amplitudes ) );
 	}
 
@@ -184,6 +189,7 @@ Audio& Audio::mix_in_place(
 	const Function<Second, Amplitude> & other_amplitude 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::mix_in_place", *this );
 	const Audio resampled =	get_sample_rate() == other.get_sample_rate() ? Audio() : other.resample( get_sample_rate() );
 	const Audio * sr_correct_source = get_sample_rate() == other.get_sample_rate() ? &other : &resampled;
 
@@ -207,6 +213,7 @@ Audio Audio::join(
 	const std::vector<Second> & offsets
 	)
 	{
+	flan_TRACE_SPAN( "Audio::join" );
 	if( ins.empty() || offsets.size() != ins.size() + 1 ) return Audio::create_null();
 
 	std::vector<Second> input_lengths;
@@ -225,6 +232,7 @@ Audio Audio::join(
 	Second offset 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::join" );
 	return Audio::join( ins, std::vector<Second>( ins.size() + 1, offset ) );
 	}
 
@@ -233,6 +241,7 @@ Audio Audio::join(
 	Second offset 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::join" );
 	return join( get_pointers( ins ), offset );
 	}
 
@@ -242,6 +251,7 @@ Audio Audio::select(
 	const std::vector<Second> & start_times 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::select" );
 	// Generate balances from selection
 	std::vector<Function<Second, Amplitude>> balances;
 	for( Index i = 0; i < ins.size(); ++i )
@@ -263,6 +273,7 @@ Audio Audio::select(
 	std::vector<Second> start_times 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::select" );
 	return select( get_pointers( ins ), selection, start_times );
 	}
 
@@ -298,9 +309,11 @@ Audio Audio::select(
 
 Audio Audio::convolve( 
 	const Audio & ir,
-	bool normalize
+	bool normalize,
+	flan_CANCEL_ARG_CPP
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::convolve", *this );
 	if( is_null() ) return Audio::create_null();
 	if( ir.is_null() ) return Audio::create_null();
 
@@ -311,14 +324,21 @@ Audio Audio::convolve(
 	format.num_channels = get_num_channels();
 	format.num_frames = get_num_frames() + sr_correct_ir->get_num_frames();
 	format.sample_rate = get_sample_rate();
-	Audio out( format );
 
 	const Frame dft_size = 2 * power_of_2_container( std::max( get_num_frames(), sr_correct_ir->get_num_frames() ) );
 
+	// Output, fft buffers, and the stored input spectrum
+	flan_RESERVE_POINT( ( uint64_t( format.num_channels ) * format.num_frames + uint64_t( dft_size ) * 3 ) * sizeof( Sample ), Audio::create_null() );
+	Audio out( format );
+
 	FFTHelper fft( dft_size, true, true, false );
 
+	TaskProgress progress( context, "Audio::convolve", uint64_t( get_num_channels() ) * 3 );
+
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
 		{
+		flan_CANCEL_POINT( Audio::create_null() );
+
 		// Get fft of this
 		std::fill( fft.real_begin(), fft.real_end(), 0 );
 		for( Frame frame = 0; frame < get_num_frames(); ++frame )
@@ -326,12 +346,16 @@ Audio Audio::convolve(
 		fft.r2c_execute();
 		std::vector<std::complex<float>> this_ffted( fft.complex_buffer_size() );
 		std::copy( fft.complex_begin(), fft.complex_end(), this_ffted.begin() );
+		progress.advance();
+		flan_CANCEL_POINT( Audio::create_null() );
 
 		// Get fft of ir, but leave it in the fft buffer
 		std::fill( fft.real_begin(), fft.real_end(), 0 );
 		for( Frame frame = 0; frame < sr_correct_ir->get_num_frames(); ++frame )
 			fft.get_real_buffer()[frame] = sr_correct_ir->get_sample( channel % sr_correct_ir->get_num_channels(), frame ) / std::sqrt( dft_size );
 		fft.r2c_execute();
+		progress.advance();
+		flan_CANCEL_POINT( Audio::create_null() );
 
 		// Multiply spectrums
 		for( Bin bin = 0; bin < fft.complex_buffer_size(); ++bin )
@@ -341,6 +365,7 @@ Audio Audio::convolve(
 		fft.c2r_execute();
 		for( Frame frame = 0; frame < out.get_num_frames(); ++frame )
 			out.get_sample( channel, frame ) = fft.get_real_buffer()[frame];
+		progress.advance();
 		}
 
 	if( normalize )
@@ -1,4 +1,5 @@
 #include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
 
 using namespace flan;
 
@@ -34,6 +35,7 @@ Audio Audio::create_from_format( const AudioBuffer::Format & other )
 
 Audio Audio::load_from_file( const std::string & filename ) 
 	{
+	flan_TRACE_SPAN( "Audio::load_from_file" );
 	return AudioBuffer( filename );
 	}
 
@@ -42,6 +44,7 @@ Audio Audio::load_from_file(
 	SndfileStrings & strings
 	)
 	{
+	flan_TRACE_SPAN( "Audio::load_from_file" );
 	return AudioBuffer( filename, strings );
 	}
 
@@ -51,6 +54,7 @@ Audio Audio::create_empty_with_length(
 	FrameRate sample_rate 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::create_empty_with_length" );
 	return create_empty_with_frames( length * sample_rate, num_channels, sample_rate );
 	}
 
@@ -60,6 +64,7 @@ Audio Audio::create_empty_with_frames(
 	FrameRate sample_rate 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::create_empty_with_frames" );
 	Audio::Format format;
 	format.num_channels = num_channels;
 	format.num_frames = num_frames;
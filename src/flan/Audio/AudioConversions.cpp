@@ -1,4 +1,5 @@
 #include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
 
 #include <iostream>
 #include <execution>
@@ -13,6 +14,7 @@ using namespace flan;
 
 Audio Audio::resample( FrameRate new_sample_rate ) const
 	{
+	flan_TRACE_SPAN( "Audio::resample", *this );
 	if( is_null() ) return Audio::create_null(); 
 
 	if( new_sample_rate == get_sample_rate() ) 
@@ -31,6 +33,7 @@ Audio Audio::resample( FrameRate new_sample_rate ) const
 
 Audio Audio::convert_to_mid_side() const
 	{
+	flan_TRACE_SPAN( "Audio::convert_to_mid_side", *this );
 	if( is_null() ) return Audio::create_null();
 
 	if( get_num_channels() != 2 )
@@ -52,11 +55,13 @@ Audio Audio::convert_to_mid_side() const
 
 Audio Audio::convert_to_left_right() const
 	{
+	flan_TRACE_SPAN( "Audio::convert_to_left_right", *this );
 	return convert_to_mid_side();
 	}
 
 Audio Audio::convert_to_stereo() const
 	{
+	flan_TRACE_SPAN( "Audio::convert_to_stereo", *this );
 	if( is_null() ) return Audio::create_null();
 
 	auto format = get_format();
@@ -86,6 +91,7 @@ Audio Audio::convert_to_stereo() const
 
 Audio Audio::convert_to_mono() const
 	{
+	flan_TRACE_SPAN( "Audio::convert_to_mono", *this );
 	if( is_null() ) return Audio::create_null();
 
 	auto format = get_format();
@@ -106,6 +112,7 @@ Audio Audio::convert_to_mono() const
 Function<Second, Amplitude> Audio::convert_to_function(
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::convert_to_function", *this );
 	if( is_null() ) return 0;
 
 	Audio out = convert_to_mono();
@@ -1,14 +1,20 @@
 #include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
+#include "flan/FilterCore.h"
 
-/*
-https://ia601900.us.archive.org/5/items/the-art-of-va-filter-design-rev.-2.1.2/VAFilterDesign_2.1.2.pdf#chapter.10
-*/
+#include <array>
+#include <bit>
+#include <limits>
+#include <tuple>
+
+#include "flan/Spectrum/Spectrum.h"
+#include "flan/Convolver.h"
+#include "flan/FFTHelper.h"
+#include "flan/Utility/LRUCache.h"
+#include "flan/Utility/execution.h"
 
 using namespace flan;
 
-using Pole = std::complex<float>;
-using Mix_1pole = std::array<float,2>;
-using Mix_2pole = std::array<float,3>;
 using Mix_Func_1pole = Function<Second, Mix_1pole>;
 using Mix_Func_2pole = Function<Second, Mix_2pole>;
 
@@ -16,20 +22,7 @@ using Mix_Func_2pole = Function<Second, Mix_2pole>;
 // Utility
 //===============================================================================================================================
 
-Frequency prewarp( Frequency w, float T_half ) 
-	{
-	/*
-	Filter digitization bends the frequency response near nyquist down slightly.
-	Rather than have this error present in full at nyquist and not at all near zero, we can increase the desired frequency
-	in such a way that after this "bending" occurs, the cutoff position of the filter is right on the money.
-	This does create additional response error around 0, but we can only minimize that error around a single frequency,
-	and the cutoff is the most audible.
-	*/
-
-	return std::tan( T_half*w ) / T_half;
-	}
-
-std::vector<Pole> generate_butterworth_type1_poles( uint16_t N )
+std::vector<Pole> flan::generate_butterworth_type1_poles( uint16_t N )
 	{
 	// Get type 1 roots with unit cutoff. 
 	// Note, we are only listing the roots above the x-axis. For each non-real root, there is an unlisted complex conjugate root.
@@ -49,40 +42,6 @@ std::vector<Pole> generate_butterworth_type1_poles( uint16_t N )
 // 1-pole base
 //===============================================================================================================================
 
-struct Filter_1Pole {
-	Filter_1Pole( FrameRate sr )
-		: s( 0 )
-		// Note the factor of 2pi. The reference book uses a non-standard Forier transform definition, much to my annoyance. This fixes that.
-		// Saving a few cycles, the factor of 1/2 is baked into T, taking the 2pi down to pi.
-		, T_half( pi / sr )
-		{
-		}
-
-	std::array<Sample, 2> process_sample( Sample x, Frequency cutoff_unwarped, bool use_prewarp = true )
-		{
-		// See section 3.10 for the details.
-		
-		const Frequency w = use_prewarp? prewarp( cutoff_unwarped, T_half ) : cutoff_unwarped;
-		
-		const float g = w * T_half; 
-		const float G = g / ( 1 + g );
-		const float v = G * ( x - s );
-		const Sample lp = v + s;
-		s = lp + v;
-
-		return { lp, x - lp };
-		}
-
-	Sample process_sample_and_mix( Sample x, Frequency cutoff_unwarped, Mix_1pole mix, bool use_prewarp = true )
-		{
-		const auto filtered = process_sample( x, cutoff_unwarped, use_prewarp );
-		return filtered[0]*mix[0] + filtered[1]*mix[1];
-		}
-
-	Sample s;
-	const float T_half;
-};
-
 // std::vector<Audio> base_filter_1pole_multimode( 
 // 	const Audio & me,
 // 	const Function<Second, Frequency> & cutoff,
@@ -151,46 +110,6 @@ Audio base_filter_1pole_highpass(
 // 2-pole base
 //===============================================================================================================================
 
-struct Filter_2Pole {
-	Filter_2Pole( FrameRate sr )
-		: s1( 0 )
-		, s2( 0 )
-		// Note the factor of 2pi. The reference book uses a non-standard Forier transform definition, much to my annoyance. This fixes that.
-		// Saving a few cycles, the factor of 1/2 is baked into T, taking the 2pi down to pi.
-		, T_half( pi / sr )
-		{
-		}
-
-	std::array<Sample, 3> process_sample( Sample x, Frequency cutoff_unwarped, float R, bool use_prewarp = true )
-		{
-		//See section 4.4 for the implementation.
-
-		const Frequency w = use_prewarp? prewarp( cutoff_unwarped, T_half ) : cutoff_unwarped;
-
-		const float g = w * T_half;
-		const float g1 = 2.0f*R + g;
-		const float d = 1.0f / ( 1.0f + 2.0f*R*g + g*g );
-		const float hp = ( x - g1*s1 - s2 ) * d;
-		const float v1 = g*hp;
-		const float bp = v1 + s1;
-		s1 = bp + v1;
-		const float v2 = g*bp;
-		const float lp = v2 + s2;
-		s2 = lp + v2;
-
-		return { lp, bp*2*R, hp };
-		}
-
-	Sample process_sample_and_mix( Sample x, Frequency cutoff_unwarped, float R, Mix_2pole mix, bool use_prewarp = true )
-		{
-		const auto filtered = process_sample( x, cutoff_unwarped, R, use_prewarp );
-		return filtered[0]*mix[0] + filtered[1]*mix[1] + filtered[2]*mix[2];
-		}
-
-	Sample s1, s2;
-	const float T_half;
-};
-
 // This base function is needed because R and w sometimes use one another
 // Having a single function return both would make a bad forward interface but saves several trig calls per frame sometimes
 Audio base_filter_2pole_selector_single_func(
@@ -277,17 +196,13 @@ Audio base_filter_2pole_highpass(
 // 1-pole butterworth
 //===============================================================================================================================
 
-Audio filter_1pole_repeat_base(
-	const Audio & me,
+Audio & filter_1pole_repeat_base(
+	Audio & me,
 	const Function<Second, Frequency> & cutoff,
 	const uint16_t repeats,
 	int index
 	)
 	{
-	if( me.is_null() ) return Audio::create_null();
-	
-	Audio out( me.get_format() );
-
 	auto cutoff_sampled = me.sample_function_over_domain( cutoff );
 	cutoff_sampled.for_each( [&]( auto & c ){ c = std::clamp( c, 1.0f, me.get_sample_rate()/2.0f ); } );
 
@@ -298,34 +213,60 @@ Audio filter_1pole_repeat_base(
 			{
 			for( Index i = 0; i < repeats; ++i )
 				{
-				const Audio & source = i == 0? me : out;
-				out.get_sample( channel, frame ) = filter_1poles[i].process_sample( source.get_sample( channel, frame ), cutoff_sampled[frame] )[index];
+				Sample & s = me.get_sample( channel, frame );
+				s = filter_1poles[i].process_sample( s, cutoff_sampled[frame] )[index];
 				}
 			}
 		} );
 
-	return out;
+	return me;
 	}
 
 Audio Audio::filter_1pole_repeat_low(
 	const Function<Second, Frequency> & cutoff,
 	const uint16_t repeats
-	) const
+	) const &
 	{
-	return filter_1pole_repeat_base( *this, cutoff, repeats, 0 );
+	flan_TRACE_SPAN( "Audio::filter_1pole_repeat_low", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_1pole_repeat_low( cutoff, repeats );
+	}
+
+Audio Audio::filter_1pole_repeat_low(
+	const Function<Second, Frequency> & cutoff,
+	const uint16_t repeats
+	) &&
+	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_repeat_low", *this );
+	if( is_null() ) return Audio::create_null();
+	filter_1pole_repeat_base( *this, cutoff, repeats, 0 );
+	return std::move( *this );
 	}
 
 Audio Audio::filter_1pole_repeat_high(
 	const Function<Second, Frequency> & cutoff,
 	const uint16_t repeats
-	) const
+	) const &
+	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_repeat_high", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_1pole_repeat_high( cutoff, repeats );
+	}
+
+Audio Audio::filter_1pole_repeat_high(
+	const Function<Second, Frequency> & cutoff,
+	const uint16_t repeats
+	) &&
 	{
-	return filter_1pole_repeat_base( *this, cutoff, repeats, 1 );
+	flan_TRACE_SPAN( "Audio::filter_1pole_repeat_high", *this );
+	if( is_null() ) return Audio::create_null();
+	filter_1pole_repeat_base( *this, cutoff, repeats, 1 );
+	return std::move( *this );
 	}
 	
 
-Audio base_filter_1pole_butterworth_selector(
-	const Audio & me,
+Audio & base_filter_1pole_butterworth_selector(
+	Audio & me,
 	uint16_t order,
 	const Function<Second, Frequency> & cutoff,
 	bool lowpass
@@ -334,56 +275,61 @@ Audio base_filter_1pole_butterworth_selector(
 	/*
 	See section 8.6 for details.
 	*/
-	if( order == 0 ) return me.copy();
-	const bool even_order = order % 2 == 0;
-
-	const std::vector<Pole> poles = generate_butterworth_type1_poles( order );
+	if( order == 0 ) return me;
 
 	auto cutoff_sampled = me.sample_function_over_domain( cutoff );
 	cutoff_sampled.for_each( [&]( auto & c ){ c = std::clamp( c, 1.0f, me.get_sample_rate()/2.0f ); } );
 
-	Audio out( me.get_format() );
-
 	for( Channel channel = 0; channel < me.get_num_channels(); ++channel )
 		{
-		Filter_1Pole filter_1pole( me.get_sample_rate() );
-		std::vector<Filter_2Pole> filter_2poles( poles.size(), me.get_sample_rate() ); 
+		Filter_1Pole_Butterworth filter( me.get_sample_rate(), order );
 		for( Frame frame = 0; frame < me.get_num_frames(); ++frame )
-			{
-			const Frequency w = cutoff_sampled[frame];
-
-			// For odd orders there is a pole at -1
-			if( !even_order ) 
-				out.get_sample( channel, frame ) = filter_1pole.process_sample( me.get_sample( channel, frame ), w )[ lowpass? 0:1];
-
-			for( Index pole_i = 0; pole_i < poles.size(); ++pole_i )
-				{
-				const float R = -poles[pole_i].real();
-				const Audio & source = even_order && pole_i == 0? me : out;
-				out.get_sample( channel, frame ) = filter_2poles[pole_i].process_sample( source.get_sample( channel, frame ), w, R )[ lowpass? 0:2];
-				}
-			}
+			me.get_sample( channel, frame ) = filter.process_sample( me.get_sample( channel, frame ), cutoff_sampled[frame], lowpass );
 		}
 
-	return out;	
+	return me;	
 	}
 
 Audio Audio::filter_1pole_lowpass(
 	const Function<Second, Frequency> & cutoff,
 	uint16_t order
-	) const
+	) const &
+	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_lowpass", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_1pole_lowpass( cutoff, order );
+	}
+
+Audio Audio::filter_1pole_lowpass(
+	const Function<Second, Frequency> & cutoff,
+	uint16_t order
+	) &&
 	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_lowpass", *this );
 	if( is_null() ) return Audio::create_null();
-	return base_filter_1pole_butterworth_selector( *this, order, cutoff, true );
+	base_filter_1pole_butterworth_selector( *this, order, cutoff, true );
+	return std::move( *this );
 	}
 
 Audio Audio::filter_1pole_highpass(
 	const Function<Second, Frequency> & cutoff,
 	uint16_t order
-	) const
+	) const &
+	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_highpass", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_1pole_highpass( cutoff, order );
+	}
+
+Audio Audio::filter_1pole_highpass(
+	const Function<Second, Frequency> & cutoff,
+	uint16_t order
+	) &&
 	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_highpass", *this );
 	if( is_null() ) return Audio::create_null();
-	return base_filter_1pole_butterworth_selector( *this, order, cutoff, false );
+	base_filter_1pole_butterworth_selector( *this, order, cutoff, false );
+	return std::move( *this );
 	}
 
 std::vector<Audio> Audio::filter_1pole_split(
@@ -391,6 +337,7 @@ std::vector<Audio> Audio::filter_1pole_split(
 	uint16_t order
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_split", *this );
 	/*
 	This may have you saying "that doesn't seem quite right".
 	I am tired of making filters and I'm choosing to not write a perfect L-R crossover filter.
@@ -428,8 +375,8 @@ std::vector<Audio> Audio::filter_1pole_split(
 // 1-pole butterworth shelving
 //===============================================================================================================================
 
-Audio base_filter_1pole_butterworth_tilt(
-	const Audio & me,
+Audio & base_filter_1pole_butterworth_tilt(
+	Audio & me,
 	uint16_t order,
 	const Function<Second, Frequency> & cutoff,
 	const Function<Second, Decibel> & gain
@@ -444,7 +391,7 @@ Audio base_filter_1pole_butterworth_tilt(
 	Section 10.4 covers 2-pole shelving. With both those in hand, arbitrary shelving filters can be constructed as cascades.
 	*/
 
-	if( order == 0 ) return me.copy();
+	if( order == 0 ) return me;
 	const bool even_order = order % 2 == 0;
 
 	const std::vector<Pole> poles = generate_butterworth_type1_poles( order );
@@ -453,8 +400,6 @@ Audio base_filter_1pole_butterworth_tilt(
 	cutoff_sampled.for_each( [&]( auto & c ){ c = std::clamp( c, 1.0f, me.get_sample_rate()/2.0f ); } );
 	const auto gain_sampled = me.sample_function_over_domain( gain );
 
-	Audio out( me.get_format() );
-
 	for( Channel channel = 0; channel < me.get_num_channels(); ++channel )
 		{
 		Filter_1Pole filter_1pole( me.get_sample_rate() );
@@ -471,44 +416,67 @@ Audio base_filter_1pole_butterworth_tilt(
 			if( !even_order ) 
 				{
 				const auto filtered = filter_1pole.process_sample( me.get_sample( channel, frame ), w );
-				out.get_sample( channel, frame ) = filtered[0] * M + filtered[1] / M;
+				me.get_sample( channel, frame ) = filtered[0] * M + filtered[1] / M;
 				}
 
 			for( Index pole_i = 0; pole_i < poles.size(); ++pole_i )
 				{
 				const float R = poles[pole_i].real() / w;
-				const Audio & source = even_order && pole_i == 0? me : out;
-				const auto filtered = filter_2poles[pole_i].process_sample( source.get_sample( channel, frame ), w, R );
-				out.get_sample( channel, frame ) = filtered[0] / M2 + filtered[1] + filtered[2] * M2;
+				const auto filtered = filter_2poles[pole_i].process_sample( me.get_sample( channel, frame ), w, R );
+				me.get_sample( channel, frame ) = filtered[0] / M2 + filtered[1] + filtered[2] * M2;
 				}
 			}
 		}
 
-	return out;
+	return me;
 	}
 
 Audio Audio::filter_1pole_lowshelf(
 	const Function<Second, Frequency> & cutoff,
 	const Function<Second, Decibel> & gain,
 	uint16_t order
-	) const
+	) const &
 	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_lowshelf", *this );
 	if( is_null() ) return Audio::create_null();
-	Audio tilt = base_filter_1pole_butterworth_tilt( *this, order, cutoff, gain );
-	tilt.modify_volume_in_place( Function<float, float>( [&]( Second t ){ return decibel_to_amplitude( gain( t ) / 2 ); }, gain.get_execution_policy() ) );
-	return tilt;
+	return copy().filter_1pole_lowshelf( cutoff, gain, order );
+	}
+
+Audio Audio::filter_1pole_lowshelf(
+	const Function<Second, Frequency> & cutoff,
+	const Function<Second, Decibel> & gain,
+	uint16_t order
+	) &&
+	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_lowshelf", *this );
+	if( is_null() ) return Audio::create_null();
+	base_filter_1pole_butterworth_tilt( *this, order, cutoff, gain );
+	modify_volume_in_place( Function<float, float>( [&]( Second t ){ return decibel_to_amplitude( gain( t ) / 2 ); }, gain.get_execution_policy() ) );
+	return std::move( *this );
 	}
 
 Audio Audio::filter_1pole_highshelf(
 	const Function<Second, Frequency> & cutoff,
 	const Function<Second, Decibel> & gain,
 	uint16_t order
-	) const
+	) const &
+	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_highshelf", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_1pole_highshelf( cutoff, gain, order );
+	}
+
+Audio Audio::filter_1pole_highshelf(
+	const Function<Second, Frequency> & cutoff,
+	const Function<Second, Decibel> & gain,
+	uint16_t order
+	) &&
 	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_highshelf", *this );
 	if( is_null() ) return Audio::create_null();
-	Audio tilt = base_filter_1pole_butterworth_tilt( *this, order, cutoff, Function<float, float>( [&]( Second t ){ return -gain( t ); }, gain.get_execution_policy() ) );
-	tilt.modify_volume_in_place( Function<float, float>( [&]( Second t ){ return decibel_to_amplitude( gain( t ) / 2 ); }, gain.get_execution_policy() ) );
-	return tilt;
+	base_filter_1pole_butterworth_tilt( *this, order, cutoff, Function<float, float>( [&]( Second t ){ return -gain( t ); }, gain.get_execution_policy() ) );
+	modify_volume_in_place( Function<float, float>( [&]( Second t ){ return decibel_to_amplitude( gain( t ) / 2 ); }, gain.get_execution_policy() ) );
+	return std::move( *this );
 	}
 
 
@@ -517,119 +485,132 @@ Audio Audio::filter_1pole_highshelf(
 // 2-pole butterworth
 //===============================================================================================================================
 
-Audio base_filter_2pole_butterworth_selector(
-	const Audio & me,
+Audio & base_filter_2pole_butterworth_selector(
+	Audio & me,
 	uint16_t order,
 	const Function<Second, Frequency> & cutoff,
 	const Function<Second, float> & damping, 
 	size_t i
 	)
 	{
-	if( order == 0 ) return me.copy();
-	const bool even_order = order % 2 == 0;
-
-	const std::vector<Pole> poles = generate_butterworth_type1_poles( order );
+	if( order == 0 ) return me;
 
 	auto cutoff_sampled = me.sample_function_over_domain( cutoff );
 	cutoff_sampled.for_each( [&]( auto & c ){ c = std::clamp( c, 1.0f, me.get_sample_rate()/2.0f ); } );
 	const auto damping_sampled = me.sample_function_over_domain( damping );
 
-	Audio out( me.get_format() );
-
 	for( Channel channel = 0; channel < me.get_num_channels(); ++channel )
 		{
-		Filter_2Pole filter_1pole( me.get_sample_rate() );
-		std::vector<std::array<Filter_2Pole, 2>> filter_2poles( poles.size(), { me.get_sample_rate(), me.get_sample_rate() } ); 
+		Filter_2Pole_Butterworth filter( me.get_sample_rate(), order );
 		for( Frame frame = 0; frame < me.get_num_frames(); ++frame )
-			{
-			const Frequency w = cutoff_sampled[frame];
-			const float R = damping_sampled[frame];
-			const Radian alpha = std::acos( R ) / order;
-			
-			// For odd orders there is a pole at -1 that will be split into two reciprocal poles around 0.
-			// These poles can be handled with a single svf.
-			if( !even_order ) 
-				{
-				const float real_pole_R = std::cos( alpha );
-				out.get_sample( channel, frame ) = filter_1pole.process_sample( me.get_sample( channel, frame ), w, real_pole_R )[i];
-				}
-
-			// Each complex pole generated thus far will be split into two poles, each of which is then representing also its conjugate.
-			// In total, each pole in runs two 2-pole applications
-			for( Index pole_i = 0; pole_i < poles.size(); ++pole_i )
-				{
-				const std::complex<float> pole_scaler = R > 1 ? 
-					std::pow( R + std::sqrt( R*R - 1.0f ), 1.0f / order ) : 
-					std::exp( std::complex<float>( 0, -alpha ) );
-
-				const Pole p_w = poles[pole_i] * w;
-				const Audio & source = even_order && pole_i == 0? me : out;
-
-				const Pole p1 = p_w * pole_scaler;
-				const Frequency p1_w = std::abs( p1 );
-				const float p1_R = -p1.real() / p1_w;
-				out.get_sample( channel, frame ) = filter_2poles[pole_i][0].process_sample( source.get_sample( channel, frame ), p1_w, p1_R )[i];
-
-				const Pole p2 = p_w / pole_scaler;
-				const Frequency p2_w = std::abs( p2 );
-				const float p2_R = -p2.real() / p2_w;
-				out.get_sample( channel, frame ) = filter_2poles[pole_i][1].process_sample( out   .get_sample( channel, frame ), p2_w, p2_R )[i];
-				}
-			}
+			me.get_sample( channel, frame ) = filter.process_sample( me.get_sample( channel, frame ), cutoff_sampled[frame], damping_sampled[frame], i );
 		}
 
-	return out;	
+	return me;	
 	}
 
 Audio Audio::filter_2pole_lowpass(
 	const Function<Second, Frequency> & w,
 	const Function<Second, float> & R,
 	uint16_t N
-	) const
+	) const &
+	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_lowpass", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_2pole_lowpass( w, R, N );
+	}
+
+Audio Audio::filter_2pole_lowpass(
+	const Function<Second, Frequency> & w,
+	const Function<Second, float> & R,
+	uint16_t N
+	) &&
 	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_lowpass", *this );
 	if( is_null() ) return Audio::create_null();
-	return base_filter_2pole_butterworth_selector( *this, N, w, R, 0 );
+	base_filter_2pole_butterworth_selector( *this, N, w, R, 0 );
+	return std::move( *this );
 	}
 
 Audio Audio::filter_2pole_bandpass(
 	const Function<Second, Frequency> & w,
 	const Function<Second, float> & R,
 	uint16_t N
-	) const
+	) const &
+	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_bandpass", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_2pole_bandpass( w, R, N );
+	}
+
+Audio Audio::filter_2pole_bandpass(
+	const Function<Second, Frequency> & w,
+	const Function<Second, float> & R,
+	uint16_t N
+	) &&
 	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_bandpass", *this );
 	if( is_null() ) return Audio::create_null();
-	return base_filter_2pole_butterworth_selector( *this, N, w, R, 1 );
+	base_filter_2pole_butterworth_selector( *this, N, w, R, 1 );
+	return std::move( *this );
 	}
 
 Audio Audio::filter_2pole_highpass(
 	const Function<Second, Frequency> & w,
 	const Function<Second, float> & R,
 	uint16_t N
-	) const
+	) const &
 	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_highpass", *this );
 	if( is_null() ) return Audio::create_null();
-	return base_filter_2pole_butterworth_selector( *this, N, w, R, 2 );
+	return copy().filter_2pole_highpass( w, R, N );
+	}
+
+Audio Audio::filter_2pole_highpass(
+	const Function<Second, Frequency> & w,
+	const Function<Second, float> & R,
+	uint16_t N
+	) &&
+	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_highpass", *this );
+	if( is_null() ) return Audio::create_null();
+	base_filter_2pole_butterworth_selector( *this, N, w, R, 2 );
+	return std::move( *this );
 	}
 
 Audio Audio::filter_2pole_notch(
 	const Function<Second, Frequency> & w,
 	const Function<Second, float> & R,
 	uint16_t N
-	) const
+	) const &
 	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_notch", *this );
 	if( is_null() ) return Audio::create_null();
 	Audio bp = filter_2pole_bandpass( w, R, N );
 	bp.modify_volume_in_place( -1 );
 	return Audio::mix( bp, *this );
 	}
 
+Audio Audio::filter_2pole_notch(
+	const Function<Second, Frequency> & w,
+	const Function<Second, float> & R,
+	uint16_t N
+	) &&
+	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_notch", *this );
+	if( is_null() ) return Audio::create_null();
+	const Audio bp = std::as_const( *this ).filter_2pole_bandpass( w, R, N );
+	mix_in_place( bp, 0, -1.0f );
+	return std::move( *this );
+	}
+
 
 //===============================================================================================================================
 // 2-pole butterworth shelving
 //===============================================================================================================================
 
-Audio base_filter_2pole_butterworth_tilt(
-	const Audio & me,
+Audio & base_filter_2pole_butterworth_tilt(
+	Audio & me,
 	uint16_t order,
 	const std::function<Frequency (Second, float)> & cutoff,
 	const std::function<float (Second, float)> & damping,
@@ -637,7 +618,7 @@ Audio base_filter_2pole_butterworth_tilt(
 	std::function<Sample ( Mix_2pole, float )> mix_filtered_sample
 	)
 	{
-	if( order == 0 ) return me.copy();
+	if( order == 0 ) return me;
 	const bool even_order = order % 2 == 0;
 
 	const std::vector<Pole> poles = generate_butterworth_type1_poles( order );
@@ -654,8 +635,6 @@ Audio base_filter_2pole_butterworth_tilt(
 		}
 	// Note, mix_filtered_sample doesn't need to be sampled as it's not a part of the public filter interface.
 
-	Audio out( me.get_format() );
-
 	for( Channel channel = 0; channel < me.get_num_channels(); ++channel )
 		{
 		Filter_2Pole filter_1pole( me.get_sample_rate() );
@@ -674,7 +653,7 @@ Audio base_filter_2pole_butterworth_tilt(
 				{
 				const float real_pole_R = std::cos( alpha );
 				const auto filtered = filter_1pole.process_sample( me.get_sample( channel, frame ), w, real_pole_R );
-				out.get_sample( channel, frame ) = mix_filtered_sample( filtered, M2 );
+				me.get_sample( channel, frame ) = mix_filtered_sample( filtered, M2 );
 				}
 
 			// Each complex pole generated thus far will be split into two poles, each of which is then representing also its conjugate.
@@ -686,24 +665,23 @@ Audio base_filter_2pole_butterworth_tilt(
 					std::exp( std::complex<float>( 0, -alpha ) );
 
 				const Pole p_w = poles[pole_i] * w;
-				const Audio & source = even_order && pole_i == 0? me : out;
 
 				const Pole p1 = p_w * pole_scaler;
 				const Frequency p1_w = std::abs( p1 );
 				const float p1_R = -p1.real() / p1_w;
-				const auto filtered_1 = filter_2poles[pole_i][0].process_sample( source.get_sample( channel, frame ), p1_w, p1_R );
-				out.get_sample( channel, frame ) = mix_filtered_sample( filtered_1, M2 );
+				const auto filtered_1 = filter_2poles[pole_i][0].process_sample( me.get_sample( channel, frame ), p1_w, p1_R );
+				me.get_sample( channel, frame ) = mix_filtered_sample( filtered_1, M2 );
 
 				const Pole p2 = p_w / pole_scaler;
 				const Frequency p2_w = std::abs( p2 );
 				const float p2_R = -p2.real() / p2_w;
-				const auto filtered_2 = filter_2poles[pole_i][1].process_sample( out   .get_sample( channel, frame ), p2_w, p2_R );
-				out.get_sample( channel, frame ) = mix_filtered_sample( filtered_2, M2 );
+				const auto filtered_2 = filter_2poles[pole_i][1].process_sample( me.get_sample( channel, frame ), p2_w, p2_R );
+				me.get_sample( channel, frame ) = mix_filtered_sample( filtered_2, M2 );
 				}
 			}
 		}
 
-	return out;	
+	return me;	
 	}
 
 Audio Audio::filter_2pole_lowshelf(
@@ -711,16 +689,28 @@ Audio Audio::filter_2pole_lowshelf(
 	const Function<Second, float> & damping,
 	const Function<Second, Decibel> & gain,
 	uint16_t order
-	) const
+	) const &
+	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_lowshelf", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_2pole_lowshelf( cutoff, damping, gain, order );
+	}
+
+Audio Audio::filter_2pole_lowshelf(
+	const Function<Second, Frequency> & cutoff,
+	const Function<Second, float> & damping,
+	const Function<Second, Decibel> & gain,
+	uint16_t order
+	) &&
 	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_lowshelf", *this );
 	if( is_null() ) return Audio::create_null();
-	Audio tilt = base_filter_2pole_butterworth_tilt( *this, order, 
+	base_filter_2pole_butterworth_tilt( *this, order, 
 		[&]( Second t, float M ){ return cutoff( t ) * M; }, 
 		[&]( Second t, float ){ return damping( t ); }, 
 		Function<float, float>( [&]( Second t ){ return gain( t ) / 2.0f; }, gain.get_execution_policy() ), 
 		[&]( Mix_2pole f, float M2 ){ return f[0] / (M2*M2) + f[1] / M2 + f[2]; } );
-	//tilt.modify_volume_in_place( [&]( Second t ){ return decibel_to_amplitude( -half_gain( t ) ); } );
-	return tilt;
+	return std::move( *this );
 	}
 
 Audio Audio::filter_2pole_bandshelf(
@@ -728,15 +718,28 @@ Audio Audio::filter_2pole_bandshelf(
 	const Function<Second, float> & damping,
 	const Function<Second, Decibel> & gain,
 	uint16_t order
-	) const
+	) const &
+	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_bandshelf", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_2pole_bandshelf( cutoff, damping, gain, order );
+	}
+
+Audio Audio::filter_2pole_bandshelf(
+	const Function<Second, Frequency> & cutoff,
+	const Function<Second, float> & damping,
+	const Function<Second, Decibel> & gain,
+	uint16_t order
+	) &&
 	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_bandshelf", *this );
 	if( is_null() ) return Audio::create_null();
-	Audio tilt = base_filter_2pole_butterworth_tilt( *this, order, 
+	base_filter_2pole_butterworth_tilt( *this, order, 
 		[&]( Second t, float ){ return cutoff( t ); }, 
 		[&]( Second t, float M ){ return damping( t ) * M; }, 
 		Function<float, float>( [&]( Second t ){ return -gain( t ); }, gain.get_execution_policy() ), 
 		[&]( Mix_2pole f, float M2 ){ return f[0] + f[1] / M2 + f[2]; } );
-	return tilt;
+	return std::move( *this );
 	}
 
 Audio Audio::filter_2pole_highshelf(
@@ -744,17 +747,28 @@ Audio Audio::filter_2pole_highshelf(
 	const Function<Second, float> & damping,
 	const Function<Second, Decibel> & gain,
 	uint16_t order
-	) const
+	) const &
+	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_highshelf", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_2pole_highshelf( cutoff, damping, gain, order );
+	}
+
+Audio Audio::filter_2pole_highshelf(
+	const Function<Second, Frequency> & cutoff,
+	const Function<Second, float> & damping,
+	const Function<Second, Decibel> & gain,
+	uint16_t order
+	) &&
 	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_highshelf", *this );
 	if( is_null() ) return Audio::create_null();
-	auto half_gain = [&]( Second t ){ return gain( t ) / 2.0f; };
-	Audio tilt = base_filter_2pole_butterworth_tilt( *this, order, 
+	base_filter_2pole_butterworth_tilt( *this, order, 
 		[&]( Second t, float M ){ return cutoff( t ) * M; }, 
 		[&]( Second t, float ){ return damping( t ); }, 
 		Function<float, float>( [&]( Second t ){ return gain( t ) / 2.0f; }, gain.get_execution_policy() ), 
 		[&]( Mix_2pole f, float M2 ){ return f[0] + f[1] * M2 + f[2] * M2*M2; } );
-	//tilt.modify_volume_in_place( [&]( Second t ){ return decibel_to_amplitude( half_gain( t ) ); } );
-	return tilt;
+	return std::move( *this );
 	}
 
 //===============================================================================================================================
@@ -806,8 +820,23 @@ Audio Audio::filter_1pole_multinotch(
 	bool invert,
 	const Function<Second, float> & wet_dry,
 	bool use_saturator
-	) const
+	) const &
 	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_multinotch", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_1pole_multinotch( order, cutoff, feedback, invert, wet_dry, use_saturator );
+	}
+
+Audio Audio::filter_1pole_multinotch(
+	uint16_t order,
+	const Function<Second, Frequency> & cutoff,
+	const Function<Second, float> & feedback,
+	bool invert,
+	const Function<Second, float> & wet_dry,
+	bool use_saturator
+	) &&
+	{
+	flan_TRACE_SPAN( "Audio::filter_1pole_multinotch", *this );
 	if( is_null() ) return Audio::create_null();
 
 	auto cutoff_sampled = sample_function_over_domain( cutoff );
@@ -817,8 +846,6 @@ Audio Audio::filter_1pole_multinotch(
 
 	const float T_half = pi / get_sample_rate();
 
-	Audio out = Audio::create_from_format( get_format() );
-
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
 		{
 		float previous_output = 0.0f;
@@ -876,12 +903,12 @@ Audio Audio::filter_1pole_multinotch(
 			y_bar *= inv;
 
 			const float y = mix * x_bar + ( 1.0f - mix ) * y_bar;
-			out.get_sample( channel, frame ) = y;
+			get_sample( channel, frame ) = y;
 			previous_output = y;
 			}
 		}
 
-	return out;
+	return std::move( *this );
 	}
 
 Audio Audio::filter_2pole_multinotch(
@@ -892,8 +919,24 @@ Audio Audio::filter_2pole_multinotch(
 	bool invert,
 	const Function<Second, float> & wet_dry,
 	bool use_saturator
-	) const
+	) const &
 	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_multinotch", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_2pole_multinotch( order, cutoff, damping, feedback, invert, wet_dry, use_saturator );
+	}
+
+Audio Audio::filter_2pole_multinotch(
+	uint16_t order,
+	const Function<Second, Frequency> & cutoff,
+	const Function<Second, float> & damping,
+	const Function<Second, float> & feedback,
+	bool invert,
+	const Function<Second, float> & wet_dry,
+	bool use_saturator
+	) &&
+	{
+	flan_TRACE_SPAN( "Audio::filter_2pole_multinotch", *this );
 	/* See sections 11.2/11.6
 	Logan, sorry if you need to modify this in the future. I hope not. If you do, first go to page 110.
 	Using Figure 4.15 and equation 4.14, you can get the high, band, and low pass signals without instant feedback,
@@ -917,8 +960,6 @@ Audio Audio::filter_2pole_multinotch(
 
 	const float T_half = pi / get_sample_rate();
 
-	Audio out = Audio::create_from_format( get_format() );
-
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
 		{
 		std::vector<Filter_2Pole> filters( order, get_sample_rate() );
@@ -977,12 +1018,12 @@ Audio Audio::filter_2pole_multinotch(
 
 			const float mix = wet_dry( frame_to_time( frame ) );
 			const float y = mix * x_bar + ( 1.0f - mix ) * y_bar;
-			out.get_sample( channel, frame ) = y;
+			get_sample( channel, frame ) = y;
 			previous_output = y;
 			}
 		}
 
-	return out;
+	return std::move( *this );
 	}
 
 Audio Audio::filter_comb(
@@ -990,8 +1031,21 @@ Audio Audio::filter_comb(
 	const Function<Second, float> & feedback,
 	const Function<Second, float> & wet_dry,
 	bool invert
-	) const
+	) const &
+	{
+	flan_TRACE_SPAN( "Audio::filter_comb", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().filter_comb( cutoff, feedback, wet_dry, invert );
+	}
+
+Audio Audio::filter_comb(
+	const Function<Second, Frequency> & cutoff,
+	const Function<Second, float> & feedback,
+	const Function<Second, float> & wet_dry,
+	bool invert
+	) &&
 	{
+	flan_TRACE_SPAN( "Audio::filter_comb", *this );
 	if( is_null() ) return Audio::create_null();
 	
 	// See sections 11.5 and 11.6
@@ -1010,12 +1064,10 @@ Audio Audio::filter_comb(
 	const auto wet_dry_sampled = sample_function_over_domain( wet_dry );
 	const auto feedback_sampled = sample_function_over_domain( feedback );
 
-	Audio out = Audio::create_from_format( get_format() );
-
-	std::vector<Sample> u( out.get_num_frames() );
+	std::vector<Sample> u( get_num_frames() );
 	auto safe_u_access = [&]( Frame frame ) -> Sample
 		{ 
-		if( frame < 0 || out.get_num_frames() <= frame ) return 0.0f; 
+		if( frame < 0 || get_num_frames() <= frame ) return 0.0f; 
 		return u[frame];
 		};
 
@@ -1035,11 +1087,11 @@ Audio Audio::filter_comb(
 			u[frame] = get_sample( channel, frame ) + k*f*u_nmt;
 
 			// (2) y_n = 1/2[ u_n + u_(n-t) ]
-			out.set_sample( channel, frame, a*u[frame] + (1.0f - a)*f*u_nmt );
+			set_sample( channel, frame, a*u[frame] + (1.0f - a)*f*u_nmt );
 			}
 		}
 
-	return out;
+	return std::move( *this );
 	}
 
 Audio filter_1pole_multi_allpass(
@@ -1106,7 +1158,7 @@ Audio filter_1pole_multi_allpass(
 // 	fftwf_free(out);
 // 	}
 
-static std::pair<std::vector<float>, std::vector<float>> phase_diff_network_pole_design( int num_poles, Frequency lower, Frequency upper )
+std::pair<std::vector<float>, std::vector<float>> flan::phase_diff_network_pole_design( int num_poles, Frequency lower, Frequency upper )
 	{
 	// See "THE DESIGN OF WIDEBAND ANALOG 90° PHASE DIFFERENCING NETWORKS WITHOUT A LARGE SPREAD OF CAPACITOR VALUES"
 	// http://electronotes.netfirms.com/EN168-90degreePDN.PDF
@@ -1163,6 +1215,7 @@ Audio Audio::halfband_modulate(
 	const Function<Second, std::complex<float>> & modulator
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::halfband_modulate", *this );
 	if( is_null() ) return Audio::create_null();
 
 	auto modulator_sampled = sample_function_over_domain( modulator );
@@ -1190,6 +1243,7 @@ Audio Audio::shift_frequency(
 	const Frequency low_cutoff
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::shift_frequency", *this );
 	if( is_null() ) return Audio::create_null();
 
 	const Frequency high_cutoff = get_sample_rate()/2 - 1000; // Using exactly nyquist causes feedback in high order filter.
@@ -1230,6 +1284,7 @@ Audio Audio::halfband_multiply(
 	const Audio & modulator
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::halfband_multiply", *this );
 	if( is_null() ) return Audio::create_null();
 
 	auto bandpass_antialias = []( const Audio & a )
@@ -1260,4 +1315,209 @@ Audio Audio::halfband_multiply(
 		}
 	
 	return out;
-	}
\ No newline at end of file
+	}
+//===============================================================================================================================
+// Spectrum
+//===============================================================================================================================
+
+// Longer designs than this are truncated, which keeps a Spectrum of a long file from producing an enormous filter
+static const Frame maxDesignSize = 1 << 20;
+
+// The largest block the convolution runs in. Longer filters are split into partitions of this size.
+static const Frame maxBlockSize = 4096;
+
+struct SpectrumFIR
+	{
+	Convolver::Kernel kernel;
+	Frame delay; // Output samples are this late relative to the input
+	};
+
+// Samples the magnitude response onto num_bins evenly spaced bins up to the Nyquist frequency of sample_rate
+static void sample_magnitudes( const Spectrum & response, Channel channel, FrameRate sample_rate, Bin num_bins, 
+	std::complex<float> * out )
+	{
+	for( Bin bin = 0; bin < num_bins; ++bin )
+		out[bin] = response.sample_magnitude( channel, bin * sample_rate / ( 2.0f * ( num_bins - 1 ) ) );
+	}
+
+/*
+Linear phase design by frequency sampling. The sampled magnitudes with zero phase give a symmetric impulse response centered
+on time 0. This is rotated to be causal, dropping the one unpaired tap so the filter is exactly symmetric, and blackman
+windowed to limit ripple between the sampled frequencies.
+*/
+static SpectrumFIR design_linear_phase( const Spectrum & response, Channel channel, FrameRate sample_rate, Frame N )
+	{
+	FFTHelper::Lease fft = FFTHelper::acquire( N, false, true );
+	sample_magnitudes( response, channel, sample_rate, N / 2 + 1, fft->get_complex_buffer() );
+	fft->c2r_execute();
+
+	const Frame length = N - 1;
+	const Frame center = N / 2 - 1;
+	std::vector<Sample> taps( length );
+	for( Frame i = 0; i < length; ++i )
+		{
+		const float x = float( i + 1 ) / N;
+		const float blackman = 0.42f - 0.5f * std::cos( pi2 * x ) + 0.08f * std::cos( 2.0f * pi2 * x );
+		taps[i] = fft->get_real_buffer()[( i - center + N ) % N] / N * blackman;
+		}
+
+	return { Convolver::Kernel( taps.data(), length, std::clamp( Frame( power_of_2_container( length ) ), Frame( 64 ), maxBlockSize ) ), 
+		center };
+	}
+
+/*
+Minimum phase design by the cepstral method. The log magnitude is inverse transformed into the real cepstrum, which is folded
+onto positive time to make it causal. Transforming back gives a log spectrum with the same magnitude and minimum phase, and
+its exponential is the filter. The design runs at four times the filter length to keep cepstral aliasing down, and the tail is
+faded out. Magnitudes are floored at -100dB since zeros have no logarithm.
+*/
+static SpectrumFIR design_minimum_phase( const Spectrum & response, Channel channel, FrameRate sample_rate, Frame N )
+	{
+	const Frame M = 4 * N;
+	FFTHelper::Lease fft = FFTHelper::acquire( M, true, true );
+	std::complex<float> * spectrum = fft->get_complex_buffer();
+	float * real = fft->get_real_buffer();
+	const Bin num_bins = M / 2 + 1;
+
+	sample_magnitudes( response, channel, sample_rate, num_bins, spectrum );
+	Magnitude max_magnitude = 0;
+	for( Bin bin = 0; bin < num_bins; ++bin )
+		max_magnitude = std::max( max_magnitude, spectrum[bin].real() );
+	const Magnitude floor = std::max( max_magnitude * 1e-5f, std::numeric_limits<float>::min() );
+	for( Bin bin = 0; bin < num_bins; ++bin )
+		spectrum[bin] = std::log( std::max( spectrum[bin].real(), floor ) );
+	fft->c2r_execute();
+
+	// Fold the cepstrum
+	for( Frame i = 1; i < M / 2; ++i )
+		real[i] *= 2.0f;
+	std::fill( real + M / 2 + 1, real + M, 0.0f );
+	std::transform( real, real + M, real, [&]( float x ){ return x / M; } );
+	fft->r2c_execute();
+
+	for( Bin bin = 0; bin < num_bins; ++bin )
+		spectrum[bin] = std::exp( spectrum[bin] );
+	fft->c2r_execute();
+
+	const Frame length = N;
+	const Frame fade = N / 8;
+	std::vector<Sample> taps( length );
+	for( Frame i = 0; i < length; ++i )
+		{
+		const Frame fade_i = i - ( length - fade );
+		const float window = fade_i < 0 ? 1.0f : 0.5f + 0.5f * std::cos( pi * float( fade_i + 1 ) / fade );
+		taps[i] = real[i] / M * window;
+		}
+
+	return { Convolver::Kernel( taps.data(), length, std::clamp( Frame( power_of_2_container( length ) ), Frame( 64 ), maxBlockSize ) ), 
+		0 };
+	}
+
+// Hashes one channel of a Spectrum, so a filter designed from it can be reused for an identical response. Eight independent 
+// lanes keep the multiplies from forming one long dependency chain.
+static uint64_t fingerprint( const Spectrum & response, Channel channel )
+	{
+	const std::complex<float> * data = response.get_bin_pointer( channel, 0 );
+	const size_t size = response.get_num_bins();
+
+	std::array<uint64_t, 8> lanes;
+	lanes.fill( 0xcbf29ce484222325ull );
+	const size_t num_blocks = size / 4;
+	for( size_t block = 0; block < num_blocks; ++block )
+		for( size_t k = 0; k < 4; ++k )
+			{
+			const std::complex<float> & x = data[block * 4 + k];
+			lanes[2*k  ] = ( lanes[2*k  ] ^ std::bit_cast<uint32_t>( x.real() ) ) * 0x100000001b3ull;
+			lanes[2*k+1] = ( lanes[2*k+1] ^ std::bit_cast<uint32_t>( x.imag() ) ) * 0x100000001b3ull;
+			}
+	for( size_t i = num_blocks * 4; i < size; ++i )
+		lanes[0] = ( ( lanes[0] ^ std::bit_cast<uint32_t>( data[i].real() ) ) ^ std::bit_cast<uint32_t>( data[i].imag() ) ) * 0x100000001b3ull;
+
+	uint64_t hash = 0;
+	for( const uint64_t lane : lanes )
+		hash = ( hash ^ lane ) * 0x100000001b3ull;
+	return hash;
+	}
+
+static std::shared_ptr<const SpectrumFIR> get_cached_fir( const Spectrum & response, Channel channel, FrameRate sample_rate, 
+	Audio::FIRPhase phase )
+	{
+	using FIRKey = std::tuple<uint64_t, Bin, FrameRate, FrameRate, Audio::FIRPhase>;
+	static LRUCache<FIRKey, SpectrumFIR> cache( 16 );
+
+	const FIRKey key( fingerprint( response, channel ), response.get_num_bins(), response.get_sample_rate(), sample_rate, phase );
+	return cache.get_or_create( key, [&]()
+		{
+		// The response's bin spacing, at the Audio sample rate, sets the design size
+		const Frame N = std::clamp( Frame( power_of_2_container( size_t( std::ceil( 
+			2.0f * ( response.get_num_bins() - 1 ) * sample_rate / response.get_sample_rate() ) ) ) ), Frame( 64 ), maxDesignSize );
+		return phase == Audio::FIRPhase::Minimum
+			? design_minimum_phase( response, channel, sample_rate, N )
+			: design_linear_phase( response, channel, sample_rate, N );
+		} );
+	}
+
+Audio Audio::filter_spectrum( 
+	const Spectrum & response, 
+	FIRPhase phase, 
+	flan_CANCEL_ARG_CPP 
+	) const
+	{
+	flan_TRACE_SPAN( "Audio::filter_spectrum", *this );
+	if( is_null() || response.is_null() ) return Audio::create_null();
+
+	// Every channel of the response has the same bins, so every kernel has the same partitioning and delay
+	const Channel num_kernels = std::min( get_num_channels(), response.get_num_channels() );
+	std::vector<std::shared_ptr<const SpectrumFIR>> firs( num_kernels );
+	flan::for_each_i( num_kernels, ExecutionPolicy::Parallel_Sequenced, [&]( Channel channel )
+		{
+		flan_CANCEL_POINT();
+		firs[channel] = get_cached_fir( response, channel, get_sample_rate(), phase );
+		} );
+	flan_CANCEL_POINT( Audio::create_null() );
+
+	const Frame block_size = firs[0]->kernel.block_size;
+	const Frame num_partitions = firs[0]->kernel.get_num_partitions();
+	const Frame delay = firs[0]->delay;
+
+	flan_RESERVE_POINT( uint64_t( get_num_channels() ) * get_num_frames() * sizeof( Sample ), Audio::create_null() );
+	Audio out( get_format() );
+
+	// Time is split into segments which are convolved independently. Each segment starts its own Convolver num_partitions
+	// blocks early, which fills the frequency domain delay line with exactly the history its first block needs.
+	const Frame num_blocks = ( get_num_frames() + delay + block_size - 1 ) / block_size;
+	const Frame segment_blocks = std::max( 4 * num_partitions, Frame( 64 ) );
+	const Frame num_segments = ( num_blocks + segment_blocks - 1 ) / segment_blocks;
+	TaskProgress progress( context, "Audio::filter_spectrum", uint64_t( get_num_channels() ) * num_segments );
+
+	flan::for_each_i( get_num_channels() * num_segments, ExecutionPolicy::Parallel_Sequenced, [&]( int task )
+		{
+		const Channel channel = task / num_segments;
+		const Frame first_block = ( task % num_segments ) * segment_blocks;
+		const Frame end_block = std::min( first_block + segment_blocks, num_blocks );
+		const std::shared_ptr<const SpectrumFIR> & fir = firs[channel % num_kernels];
+		Convolver convolver( std::shared_ptr<const Convolver::Kernel>( fir, &fir->kernel ) );
+
+		const Sample * in = get_sample_pointer( channel, 0 );
+		Sample * out_samples = out.get_sample_pointer( channel, 0 );
+		std::vector<Sample> block( block_size );
+		for( Frame b = std::max( first_block - num_partitions, Frame( 0 ) ); b < end_block; ++b )
+			{
+			flan_CANCEL_POINT();
+			const Frame start = b * block_size;
+			for( Frame i = 0; i < block_size; ++i )
+				block[i] = start + i < get_num_frames() ? in[start + i] : 0.0f;
+			convolver.process_block( block.data(), block.data() );
+			if( b < first_block ) continue;
+
+			const Frame first_out = std::max( delay - start, Frame( 0 ) );
+			const Frame end_out = std::min( block_size, get_num_frames() + delay - start );
+			for( Frame i = first_out; i < end_out; ++i )
+				out_samples[start + i - delay] = block[i];
+			}
+		progress.advance();
+		} );
+	flan_CANCEL_POINT( Audio::create_null() );
+
+	return out;
+	}
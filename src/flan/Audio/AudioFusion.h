@@ -0,0 +1,359 @@
+#pragma once
+
+#include <tuple>
+#include <memory>
+#include <concepts>
+#include <functional>
+#include <numbers>
+#include <cmath>
+
+#include "flan/Audio/Audio.h"
+#include "flan/Pipe.h"
+#include "flan/Utility/execution.h"
+
+namespace flan::fuse {
+
+/*
+Pipes remove the copy at the start of each stage, but every stage still walks the entire buffer. A chain like
+modify_volume >> waveshape >> invert_phase >> pan >> fade reads and writes every sample five times, and on long files
+that memory traffic costs far more than the arithmetic does.
+
+The stages in this namespace are point-wise: the output sample at (channel, frame) depends only on the input sample at
+(channel, frame). Composing them with >> does no work, it only records the stages in an Expression, whose type holds the
+full chain. When an Expression meets Audio, every stage is bound to that Audio (any Functions are sampled over its domain)
+and the whole chain runs in a single loop over the buffer. Because the chain is a type and not a std::function, the
+compiler sees every stage and can inline them into that loop.
+
+	Audio out = std::move( in ) >> fuse::modify_volume( .5f ) >> fuse::waveshape( shaper ) >> fuse::fade();
+
+Applying an Expression to Audio gives a Deferred, which keeps collecting stages until it is converted to Audio, passed
+to a non-fusable Pipe, or saved. Expressions can be used anywhere a Pipe<Audio> can.
+
+Stages are required to keep the buffer size, so none of them resample or change the channel count. In particular
+fuse::waveshape doesn't oversample, use Audio::waveshape when aliasing matters.
+*/
+
+/** A Stage is bound to an Audio before evaluation. The bound kernel maps ( channel, frame, sample ) to a new sample.
+ */
+template<typename S>
+concept Stage = requires( const S & s, const Audio & a )
+	{
+	{ s.bind( a )( Channel(), Frame(), Sample() ) } -> std::convertible_to<Sample>;
+	};
+
+template<Stage... Stages>
+class Expression;
+
+template<Stage... Stages>
+class Deferred;
+
+//============================================================================================================================================================
+// Stages
+//============================================================================================================================================================
+
+/** See Audio::modify_volume. */
+struct ModifyVolume
+	{
+	struct Kernel
+		{
+		Sample operator()( Channel, Frame frame, Sample x ) const { return x * gain[frame]; }
+		FunctionSample<Amplitude> gain;
+		};
+
+	Kernel bind( const Audio & a ) const { return { a.sample_function_over_domain( *gain ) }; }
+
+	std::shared_ptr<const Function<Second, Amplitude>> gain;
+	};
+
+/** See Audio::waveshape. No oversampling is done. */
+template<typename F>
+struct Waveshape
+	{
+	struct Kernel
+		{
+		Sample operator()( Channel, Frame frame, Sample x ) const { return shaper( std::pair<Second, Sample>( frame / sample_rate, x ) ); }
+		const F & shaper;
+		const FrameRate sample_rate;
+		};
+
+	Kernel bind( const Audio & a ) const { return { shaper, a.get_sample_rate() }; }
+
+	F shaper;
+	};
+
+/** See Audio::invert_phase. */
+struct InvertPhase
+	{
+	struct Kernel
+		{
+		Sample operator()( Channel, Frame, Sample x ) const { return -x; }
+		};
+
+	Kernel bind( const Audio & ) const { return {}; }
+	};
+
+/** See Audio::pan_in_place. Like pan_in_place, this leaves non-stereo input unchanged. */
+struct Pan
+	{
+	struct Kernel
+		{
+		Sample operator()( Channel channel, Frame frame, Sample x ) const
+			{
+			if( !is_stereo ) return x;
+			const float pan = pan_amount[frame] / 2.0f + 0.5f; // Convert [-1,1] to [0,1]
+			const float pan_func_input = channel == 0 ? pan : ( 1.0f - pan );
+			return x * std::sqrt( 2.0f ) * std::sin( std::numbers::pi_v<float> / 4.0f * pan_func_input ); // Interpolator::sine2
+			}
+		FunctionSample<float> pan_amount;
+		const bool is_stereo;
+		};
+
+	Kernel bind( const Audio & a ) const
+		{
+		if( a.get_num_channels() != 2 ) return { FunctionSample<float>( 0.0f, a.get_num_frames() ), false };
+		return { a.sample_function_over_domain( *pan_amount ), true };
+		}
+
+	std::shared_ptr<const Function<Second, float>> pan_amount;
+	};
+
+/** See Audio::fade_frames_in_place. The fade curves are evaluated once per frame in the fade region, not per sample. */
+struct Fade
+	{
+	struct Kernel
+		{
+		Sample operator()( Channel, Frame frame, Sample x ) const
+			{
+			if( frame < Frame( fade_in.size() ) ) return x * fade_in[frame];
+			const Frame frames_from_end = num_frames - 1 - frame;
+			if( frames_from_end < Frame( fade_out.size() ) ) return x * fade_out[frames_from_end];
+			return x;
+			}
+		std::vector<float> fade_in;
+		std::vector<float> fade_out;
+		const Frame num_frames;
+		};
+
+	Kernel bind( const Audio & a ) const
+		{
+		// Input validation, this matches fade_frames_in_place
+		Frame start = std::max( 0, Frame( a.time_to_frame( start_time ) ) );
+		Frame end   = std::max( 0, Frame( a.time_to_frame( end_time ) ) );
+		if( start + end > a.get_num_frames() )
+			{
+			const float scale = float( a.get_num_frames() ) / ( start + end );
+			start = std::floor( start * scale );
+			end	= std::floor( end * scale );
+			}
+
+		Kernel k{ std::vector<float>( start ), std::vector<float>( end ), a.get_num_frames() };
+		for( Frame frame = 0; frame < start; ++frame ) k.fade_in[frame]  = (*interp)( float( frame ) / start );
+		for( Frame frame = 0; frame < end;   ++frame ) k.fade_out[frame] = (*interp)( float( frame ) / end );
+		return k;
+		}
+
+	Second start_time;
+	Second end_time;
+	std::shared_ptr<const Interpolator> interp;
+	};
+
+//============================================================================================================================================================
+// Expression
+//============================================================================================================================================================
+
+/** A lazily evaluated chain of point-wise stages.
+ */
+template<Stage... Stages>
+class Expression
+{
+public:
+	explicit Expression( std::tuple<Stages...> && _stages )
+		: stages( std::move( _stages ) )
+		{
+		}
+
+	/** Appends the stages of another Expression. No work is done until the result is applied to Audio. */
+	template<Stage... Others>
+	Expression<Stages..., Others...> operator>>( const Expression<Others...> & other ) const
+		{
+		return Expression<Stages..., Others...>( std::tuple_cat( stages, other.stages ) );
+		}
+
+	/** Ends fusion. The result is a Pipe which evaluates this Expression in a single pass and then applies p. */
+	Pipe<Audio> operator>>( const Pipe<Audio> & p ) const
+		{
+		return [e = *this, p]( Audio && a ){ return p( e( std::move( a ) ) ); };
+		}
+
+	Audio operator()( Audio && a ) const
+		{
+		evaluate_in_place( a );
+		return std::move( a );
+		}
+
+	Audio operator()( const Audio & a ) const
+		{
+		return operator()( a.copy() );
+		}
+
+	/** Runs every stage over a in a single pass.
+	 *	\param a The Audio to process. Stages are bound to this Audio before the pass starts.
+	 */
+	Audio & evaluate_in_place( Audio & a ) const
+		{
+		if( a.is_null() ) return a;
+
+		const auto kernels = std::apply( [&]( const auto & ... s ){ return std::make_tuple( s.bind( a ) ... ); }, stages );
+
+		for( Channel channel = 0; channel < a.get_num_channels(); ++channel )
+			{
+			Sample * const samples = a.get_sample_pointer( channel, 0 );
+			flan::for_each_i( a.get_num_frames(), ExecutionPolicy::Parallel_Unsequenced, [&]( Frame frame )
+				{
+				samples[frame] = std::apply( [&]( const auto & ... k )
+					{
+					Sample x = samples[frame];
+					( ( x = k( channel, frame, x ) ), ... );
+					return x;
+					}, kernels );
+				} );
+			}
+
+		return a;
+		}
+
+private:
+	template<Stage... Others> friend class Expression;
+
+	std::tuple<Stages...> stages;
+};
+
+//============================================================================================================================================================
+// Deferred
+//============================================================================================================================================================
+
+/** Audio with a pending Expression. Further Expressions are appended without doing any work. The Expression is evaluated
+ *	once, when the Deferred is converted to Audio, sent through a Pipe, or saved.
+ */
+template<Stage... Stages>
+class Deferred
+{
+public:
+	Deferred( Audio && _source, const Expression<Stages...> & _expression )
+		: source( std::move( _source ) )
+		, expression( _expression )
+		{
+		}
+
+	template<Stage... Others>
+	Deferred<Stages..., Others...> operator>>( const Expression<Others...> & other ) &&
+		{
+		return Deferred<Stages..., Others...>( std::move( source ), expression >> other );
+		}
+
+	Audio operator>>( const Pipe<Audio> & p ) &&
+		{
+		return p( std::move( *this ).evaluate() );
+		}
+
+	Audio evaluate() &&
+		{
+		expression.evaluate_in_place( source );
+		return std::move( source );
+		}
+
+	operator Audio() &&
+		{
+		return std::move( *this ).evaluate();
+		}
+
+	/** Evaluates the pending Expression and saves the result. See AudioBuffer::save. */
+	bool save(
+		const std::string & filepath,
+		int format = -1
+		) &&
+		{
+		return std::move( *this ).evaluate().save( filepath, format );
+		}
+
+private:
+	Audio source;
+	Expression<Stages...> expression;
+};
+
+template<Stage... Stages>
+Deferred<Stages...> operator>>( Audio && a, const Expression<Stages...> & e ) { return Deferred<Stages...>( std::move( a ), e ); }
+
+template<Stage... Stages>
+Deferred<Stages...> operator>>( const Audio & a, const Expression<Stages...> & e ) { return Deferred<Stages...>( a.copy(), e ); }
+
+//============================================================================================================================================================
+// Stage Constructors
+//============================================================================================================================================================
+
+/** Fusable Audio::modify_volume.
+ *	\param gain Amount to scale each sample by.
+ */
+inline Expression<ModifyVolume> modify_volume(
+	const Function<Second, Amplitude> & gain
+	)
+	{
+	return Expression<ModifyVolume>( std::make_tuple( ModifyVolume{ std::make_shared<const Function<Second, Amplitude>>( gain.copy() ) } ) );
+	}
+
+/** Fusable Audio::waveshape, without oversampling. The shaper is stored by type, so lambdas are inlined into the fused loop.
+ *	\param shaper A function taking a time and sample, and returning a new sample.
+ */
+template<typename F>
+requires std::copy_constructible<F> && std::is_invocable_r_v<Sample, const F &, std::pair<Second, Sample>>
+Expression<Waveshape<F>> waveshape(
+	F shaper
+	)
+	{
+	return Expression<Waveshape<F>>( std::make_tuple( Waveshape<F>{ std::move( shaper ) } ) );
+	}
+
+/** Fusable Audio::waveshape, without oversampling. Prefer passing a lambda directly, this calls through a Function for each sample.
+ *	\param shaper A function taking a time and sample, and returning a new sample.
+ */
+inline auto waveshape(
+	const Function<std::pair<Second, Sample>, Sample> & shaper
+	)
+	{
+	auto p = std::make_shared<const Function<std::pair<Second, Sample>, Sample>>( shaper.copy() );
+	return waveshape( [p]( std::pair<Second, Sample> x ){ return (*p)( x ); } );
+	}
+
+/** Fusable Audio::invert_phase.
+ */
+inline Expression<InvertPhase> invert_phase(
+	)
+	{
+	return Expression<InvertPhase>( std::make_tuple( InvertPhase{} ) );
+	}
+
+/** Fusable Audio::pan_in_place. Non-stereo input is unchanged.
+ *	\param pan_amount Pan position over time, in [-1,1].
+ */
+inline Expression<Pan> pan(
+	const Function<Second, float> & pan_amount
+	)
+	{
+	return Expression<Pan>( std::make_tuple( Pan{ std::make_shared<const Function<Second, float>>( pan_amount.copy() ) } ) );
+	}
+
+/** Fusable Audio::fade.
+ *	\param start Length of the start fade.
+ *	\param end Length of the end fade.
+ *	\param interp The fading curve. Square root should be used for constant-power crossfading.
+ */
+inline Expression<Fade> fade(
+	Second start = 16.0f/48000.0f,
+	Second end = 16.0f/48000.0f,
+	Interpolator && interp = Interpolator::sqrt()
+	)
+	{
+	return Expression<Fade>( std::make_tuple( Fade{ start, end, std::make_shared<const Interpolator>( std::move( interp ) ) } ) );
+	}
+
+}
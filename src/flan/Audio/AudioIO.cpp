@@ -0,0 +1,167 @@
+#include "flan/Audio/AudioIO.h"
+
+#include <algorithm>
+
+#include "flan/Utility/Trace.h"
+
+using namespace flan;
+
+static uint64_t sample_bytes( const Audio & audio )
+	{
+	return audio.get_buffer().size() * sizeof( Sample );
+	}
+
+std::future<Audio> flan::load_async( const std::string & filepath )
+	{
+	return std::async( std::launch::async, [filepath](){ return Audio::load_from_file( filepath ); } );
+	}
+
+
+
+//============================================================================================================================================================
+// AudioPrefetcher
+//============================================================================================================================================================
+
+AudioPrefetcher::AudioPrefetcher( std::vector<std::string> _filepaths, uint64_t _memory_budget, size_t _max_files_ahead )
+	: filepaths( std::move( _filepaths ) )
+	, memory_budget( _memory_budget )
+	, max_files_ahead( std::max( _max_files_ahead, size_t( 1 ) ) )
+	, thread( [this](){ run(); } )
+	{
+	}
+
+AudioPrefetcher::~AudioPrefetcher()
+	{
+		{
+		std::lock_guard lock( mutex );
+		stopping = true;
+		}
+	consumed.notify_all();
+	thread.join();
+	}
+
+size_t AudioPrefetcher::get_num_files() const
+	{
+	return filepaths.size();
+	}
+
+std::optional<AudioPrefetcher::Item> AudioPrefetcher::next()
+	{
+	std::unique_lock lock( mutex );
+	if( num_claimed == filepaths.size() ) return std::nullopt;
+	++num_claimed;
+
+	loaded.wait( lock, [this](){ return !ready.empty(); } );
+	Item item = std::move( ready.front() );
+	ready.pop_front();
+	ready_bytes -= sample_bytes( item.audio );
+	lock.unlock();
+
+	consumed.notify_one();
+	return item;
+	}
+
+void AudioPrefetcher::run()
+	{
+	for( size_t index = 0; index < filepaths.size(); ++index )
+		{
+			{
+			// Wait for room, but never while the consumer is waiting on an empty queue
+			std::unique_lock lock( mutex );
+			consumed.wait( lock, [this](){ return stopping || ready.empty()
+				|| ( ready.size() < max_files_ahead && ready_bytes < memory_budget ); } );
+			if( stopping ) return;
+			}
+
+		flan_TRACE_SPAN( "AudioPrefetcher::load" );
+		Audio audio = Audio::load_from_file( filepaths[index] );
+		const uint64_t bytes = sample_bytes( audio );
+
+			{
+			std::lock_guard lock( mutex );
+			ready.push_back( Item{ index, filepaths[index], std::move( audio ) } );
+			ready_bytes += bytes;
+			}
+		loaded.notify_one();
+		}
+	}
+
+
+
+//============================================================================================================================================================
+// AudioWriter
+//============================================================================================================================================================
+
+AudioWriter::AudioWriter( uint64_t _memory_budget )
+	: memory_budget( _memory_budget )
+	, thread( [this](){ run(); } )
+	{
+	}
+
+AudioWriter::~AudioWriter()
+	{
+		{
+		std::lock_guard lock( mutex );
+		stopping = true;
+		}
+	queued.notify_all();
+	thread.join();
+	}
+
+std::future<bool> AudioWriter::write( Audio && audio, const std::string & filepath, int format )
+	{
+	const uint64_t bytes = sample_bytes( audio );
+	std::promise<bool> result;
+	std::future<bool> future = result.get_future();
+
+		{
+		std::unique_lock lock( mutex );
+		written.wait( lock, [&](){ return pending_bytes == 0 || pending_bytes + bytes <= memory_budget; } );
+		jobs.push_back( Job{ std::move( audio ), filepath, format, std::move( result ) } );
+		pending_bytes += bytes;
+		}
+	queued.notify_one();
+
+	return future;
+	}
+
+void AudioWriter::flush()
+	{
+	std::unique_lock lock( mutex );
+	written.wait( lock, [this](){ return jobs.empty() && num_writing == 0; } );
+	}
+
+uint64_t AudioWriter::get_bytes_pending() const
+	{
+	std::lock_guard lock( mutex );
+	return pending_bytes;
+	}
+
+void AudioWriter::run()
+	{
+	while( true )
+		{
+		Job job;
+			{
+			// Queued jobs are finished before stopping
+			std::unique_lock lock( mutex );
+			queued.wait( lock, [this](){ return stopping || !jobs.empty(); } );
+			if( jobs.empty() ) return;
+			job = std::move( jobs.front() );
+			jobs.pop_front();
+			++num_writing;
+			}
+
+		flan_TRACE_SPAN( "AudioWriter::save", job.audio );
+		const uint64_t bytes = sample_bytes( job.audio );
+		job.result.set_value( job.audio.save( job.filepath, job.format ) );
+		job.audio = Audio(); // Release the samples before making room for more
+
+			{
+			std::lock_guard lock( mutex );
+			pending_bytes -= bytes;
+			--num_writing;
+			}
+		written.notify_all();
+		}
+	}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <future>
+#include <optional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#include "flan/Audio/Audio.h"
+
+namespace flan {
+
+/*
+Audio::load_from_file and AudioBuffer::save block the calling thread, so a job which loads a file, processes it, and saves it
+leaves the disk idle during processing and the CPU idle during I/O. The tools here move I/O onto background threads so it
+overlaps with processing:
+
+	AudioPrefetcher prefetcher( filepaths );
+	AudioWriter writer;
+	while( auto file = prefetcher.next() )
+		writer.write( process( std::move( file->audio ) ), output_path( file->filepath ) );
+
+While one file is processed the prefetcher is already loading the next ones, and the writer is encoding and writing the last.
+Both hold decoded sample data in memory, so each is given a memory budget. Once it is spent the prefetcher stops reading ahead,
+and AudioWriter::write blocks, until the consumer or the disk catches up.
+*/
+
+/** Loads a file on a new thread. The returned future holds a null Audio if loading failed.
+ *	\param filepath File to load. See Audio::load_from_file.
+ */
+std::future<Audio> load_async(
+	const std::string & filepath
+	);
+
+/** Loads a list of files in order on a background thread, staying a bounded distance ahead of the consumer.
+ */
+class AudioPrefetcher
+{
+public:
+	/** A loaded file. audio is null if the file couldn't be loaded.
+	 */
+	struct Item
+		{
+		size_t index; // The position of filepath in the list given on construction
+		std::string filepath;
+		Audio audio;
+		};
+
+	/** Loading begins immediately.
+	 *	\param filepaths The files to load, in the order they will be returned.
+	 *	\param memory_budget The sample data, in bytes, which may be held ahead of the consumer. The size of a file isn't known until
+	 *		it is loaded, so the prefetcher waits once the budget is reached, and a single file is always allowed.
+	 *	\param max_files_ahead The most files which may be held ahead of the consumer.
+	 */
+	AudioPrefetcher(
+		std::vector<std::string> filepaths,
+		uint64_t memory_budget = 1ull << 30,
+		size_t max_files_ahead = 4
+		);
+
+	AudioPrefetcher( const AudioPrefetcher & ) = delete;
+	AudioPrefetcher & operator=( const AudioPrefetcher & ) = delete;
+
+	/** Stops loading and waits for the file being loaded, if any, to finish.
+	 */
+	~AudioPrefetcher();
+
+	/** Returns the next file, waiting if it hasn't loaded yet, or nothing once every file has been claimed. Several consumer
+	 *	threads may call this at once, each file goes to exactly one of them.
+	 */
+	std::optional<Item> next();
+
+	size_t get_num_files() const;
+
+private:
+	void run();
+
+	const std::vector<std::string> filepaths;
+	const uint64_t memory_budget;
+	const size_t max_files_ahead;
+
+	std::mutex mutex;
+	std::condition_variable loaded; // Signalled when a file is ready
+	std::condition_variable consumed; // Signalled when a file is taken, or on shutdown
+	std::deque<Item> ready;
+	uint64_t ready_bytes = 0;
+	size_t num_claimed = 0; // Files promised to a caller of next, returned or not
+	bool stopping = false;
+
+	std::thread thread;
+};
+
+/** Saves Audio on a background thread. Interleaving, encoding, and writing all happen there, so the caller only pays for moving
+ *	the Audio in.
+ */
+class AudioWriter
+{
+public:
+	/** \param memory_budget The sample data, in bytes, which may be queued for writing. write blocks while more is queued,
+	 *		though a single file is always accepted.
+	 */
+	AudioWriter(
+		uint64_t memory_budget = 1ull << 30
+		);
+
+	AudioWriter( const AudioWriter & ) = delete;
+	AudioWriter & operator=( const AudioWriter & ) = delete;
+
+	/** Finishes every queued write.
+	 */
+	~AudioWriter();
+
+	/** Queues audio to be saved at filepath.
+	 *	\param audio The Audio to save.
+	 *	\param filepath File path to save at.
+	 *	\param format The libsndfile format to save to. See AudioBuffer::save.
+	 *	\return A future holding the result of AudioBuffer::save.
+	 */
+	std::future<bool> write(
+		Audio && audio,
+		const std::string & filepath,
+		int format = -1
+		);
+
+	/** Waits until every queued write has finished.
+	 */
+	void flush();
+
+	/** Returns the sample data, in bytes, currently queued or being written.
+	 */
+	uint64_t get_bytes_pending() const;
+
+private:
+	struct Job
+		{
+		Audio audio;
+		std::string filepath;
+		int format;
+		std::promise<bool> result;
+		};
+
+	void run();
+
+	const uint64_t memory_budget;
+
+	mutable std::mutex mutex;
+	std::condition_variable queued; // Signalled when a job is queued, or on shutdown
+	std::condition_variable written; // Signalled when a job finishes
+	std::deque<Job> jobs;
+	uint64_t pending_bytes = 0;
+	size_t num_writing = 0;
+	bool stopping = false;
+
+	std::thread thread;
+};
+
+}
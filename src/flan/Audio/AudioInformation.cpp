@@ -1,4 +1,5 @@
 #include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
 
 #include <iostream>
 #include <set>
@@ -18,7 +19,7 @@ using namespace flan;
 static std::vector<float> compute_d( const float * in, Frame n )
 	{
     const size_t fft_size = n; //std::pow( 2, 1 + (int) std::ceil( std::log2( n ) ) );
-	auto fft = std::make_shared<FFTHelper>( fft_size, true, true, false );
+	auto fft = FFTHelper::acquire( fft_size, true, true );
 
     // Calculate power terms
 	std::vector<float> power_terms( n / 2 );
@@ -120,6 +121,7 @@ static std::vector<float> compute_d_prime( const float * in, Frame n )
 
 std::vector<float> Audio::get_total_energy() const
 	{
+	flan_TRACE_SPAN( "Audio::get_total_energy", *this );
 	std::vector<float> energies( get_num_channels() );
 	flan::for_each_i( get_num_channels(), ExecutionPolicy::Parallel_Unsequenced, [&]( Channel channel ) {
 		energies[channel] = std::accumulate( channel_begin( channel ), channel_end( channel ), 0.0f, 
@@ -130,6 +132,7 @@ std::vector<float> Audio::get_total_energy() const
 
 std::vector<float> Audio::get_energy_difference( const Audio & other ) const
 	{	
+	flan_TRACE_SPAN( "Audio::get_energy_difference", *this );
 	const Audio resampled =	get_sample_rate() == other.get_sample_rate() ? Audio::create_null() : other.resample( get_sample_rate() );
 	const Audio * sr_correct_source = get_sample_rate() == other.get_sample_rate() ? &other : &resampled;
 	return Audio::mix( std::vector<const Audio *>{ this, sr_correct_source }, {0, 0}, { 1, -1 } ).get_total_energy();
@@ -175,15 +178,18 @@ std::vector<fFrame> Audio::get_local_wavelengths(
 	Frame minimum_wavelength, 
 	flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "Audio::get_local_wavelengths", *this );
 	if( is_null() ) return std::vector<float>();
 
     if( end == -1 ) end = get_num_frames();
 
     std::vector<fFrame> out;
+	TaskProgress progress( context, "Audio::get_local_wavelengths", std::max( 0, end - window_size - start ) );
     for( Frame frame = start; frame + window_size < end; frame += hop )
 		{
 		flan_CANCEL_POINT( std::vector<float>() );
         out.push_back( get_local_wavelength( channel, frame, window_size, absolute_cutoff, minimum_wavelength ) );
+		progress.advance( hop );
 		}
 	if( out.empty() ) return std::vector<float>();
 
@@ -238,8 +244,9 @@ float Audio::get_average_wavelength(
 	Frame hop, 
 	flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "Audio::get_average_wavelength", *this );
 	if( is_null() ) return 0;
-	return get_average_wavelength( get_local_wavelengths( channel, start, end, window_size, hop, canceller ), min_active_ratio, max_length_sigma );
+	return get_average_wavelength( get_local_wavelengths( channel, start, end, window_size, hop, 0.2f, 10, context ), min_active_ratio, max_length_sigma );
 	}
 
 float Audio::get_average_wavelength( 
@@ -248,6 +255,7 @@ float Audio::get_average_wavelength(
 	float max_length_sigma 
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::get_average_wavelength", *this );
 	if( is_null() ) return 0;
 
 	// Copy valid wavelengths
@@ -295,7 +303,7 @@ Frequency Audio::get_local_frequency( Channel channel, Frame start, Frame window
 
 std::vector<Frequency> Audio::get_local_frequencies( Channel channel, Frame start, Frame end, Frame window_size, Frame hop, flan_CANCEL_ARG_CPP ) const
     {
-	std::vector<fFrame> wavelengths = get_local_wavelengths( channel, start, end, window_size, hop, 0.2f, 10, canceller );
+	std::vector<fFrame> wavelengths = get_local_wavelengths( channel, start, end, window_size, hop, 0.2f, 10, context );
 	flan::for_each_i( wavelengths.size(), ExecutionPolicy::Parallel_Unsequenced, [&]( int i )
 		{ 
 		if( wavelengths[i] != 0 )
@@ -311,7 +319,7 @@ std::vector<Frequency> Audio::get_local_frequencies( Channel channel, Frame star
 	// flan::for_each_i( out.size(), ExecutionPolicy::Parallel_Unsequenced, [&]( int i )
 	// 	{
 	// 	const Frame frame = start + i * hop;
-    //     out[i] = get_local_frequency( channel, frame, window_size, canceller );
+    //     out[i] = get_local_frequency( channel, frame, window_size, context );
 	// 	} );
         
     // return out;
@@ -321,6 +329,7 @@ Function<Second, Amplitude> Audio::get_amplitude_envelope(
 	Second window_width
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::get_amplitude_envelope", *this );
 	if( is_null() ) return 0;
 
 	if( window_width <= 0 ) return 0;
@@ -388,6 +397,7 @@ Function<Second, Amplitude> Audio::get_amplitude_envelope(
 Function<Second, Amplitude> Audio::get_frequency_envelope( 
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::get_frequency_envelope", *this );
 	const int hop_size = 128;
 	const std::vector<Frequency> frequencies = convert_to_mono().get_local_frequencies( 0, 0, -1, 2048, hop_size );
 
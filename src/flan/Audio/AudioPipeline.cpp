@@ -0,0 +1,255 @@
+#include "flan/Audio/AudioPipeline.h"
+
+#include <thread>
+#include <algorithm>
+
+#include "flan/Utility/SPSCQueue.h"
+#include "flan/Utility/Trace.h"
+
+using namespace flan;
+using namespace flan::pipeline;
+
+//============================================================================================================================================================
+// Chain
+//============================================================================================================================================================
+
+Chain::Chain( std::shared_ptr<Processor> processor )
+	: stages( { StageEntry{ std::move( processor ), std::make_shared<std::mutex>() } } )
+	{
+	}
+
+Chain Chain::operator>>( const Chain & other ) const
+	{
+	Chain out = *this;
+	out.stages.insert( out.stages.end(), other.stages.begin(), other.stages.end() );
+	return out;
+	}
+
+Pipe<Audio> Chain::operator>>( const Pipe<Audio> & p ) const
+	{
+	return [c = *this, p]( Audio && a ){ return p( c( std::move( a ) ) ); };
+	}
+
+Chain::operator Pipe<Audio>() const
+	{
+	return [c = *this]( Audio && a ){ return c( std::move( a ) ); };
+	}
+
+Chain & Chain::set_block_frames( Frame _block_frames )
+	{
+	block_frames = std::max( _block_frames, Frame( 1 ) );
+	return *this;
+	}
+
+Chain & Chain::set_queue_blocks( size_t _queue_blocks )
+	{
+	queue_blocks = std::max( _queue_blocks, size_t( 1 ) );
+	return *this;
+	}
+
+size_t Chain::get_num_stages() const
+	{
+	return stages.size();
+	}
+
+Audio Chain::operator()( const Audio & a ) const
+	{
+	return operator()( a.copy() );
+	}
+
+namespace {
+
+// A block of samples travelling down the pipeline. Channels are stored one after another.
+struct Block
+	{
+	std::vector<Sample> samples;
+	std::vector<const Sample *> in;
+	std::vector<Sample *> out;
+	Frame num_frames = 0;
+	};
+
+// Spinning keeps hand-offs fast when blocks are short, yielding stops an idle worker from starving a busy one
+template<typename T>
+void push_waiting( SPSCQueue<T> & queue, const T & value )
+	{
+	while( !queue.try_push( value ) ) std::this_thread::yield();
+	}
+
+template<typename T>
+T pop_waiting( SPSCQueue<T> & queue )
+	{
+	T value;
+	while( !queue.try_pop( value ) ) std::this_thread::yield();
+	return value;
+	}
+
+}
+
+Audio Chain::operator()( Audio && a ) const
+	{
+	flan_TRACE_SPAN( "pipeline::Chain", a );
+	if( a.is_null() ) return std::move( a );
+
+	// Stage locks are taken in address order, so Chains sharing stages in different orders can't deadlock
+	std::vector<std::mutex *> stage_mutexes;
+	for( auto & stage : stages ) stage_mutexes.push_back( stage.mutex.get() );
+	std::sort( stage_mutexes.begin(), stage_mutexes.end() );
+	stage_mutexes.erase( std::unique( stage_mutexes.begin(), stage_mutexes.end() ), stage_mutexes.end() );
+	std::vector<std::unique_lock<std::mutex>> locks;
+	for( std::mutex * m : stage_mutexes ) locks.emplace_back( *m );
+
+	const Channel num_channels = a.get_num_channels();
+	const Frame num_frames = a.get_num_frames();
+
+	Frame latency = 0;
+	for( auto & stage : stages )
+		{
+		stage.processor->prepare( a.get_sample_rate(), block_frames, num_channels );
+		latency += stage.processor->get_latency();
+		}
+
+	// Every block in flight fits in every queue, so a worker never waits to push, only to pop
+	const size_t num_blocks = queue_blocks * ( stages.size() + 1 );
+	std::vector<Block> blocks( num_blocks );
+	flan_TRACE_ALLOCATION( num_blocks * num_channels * block_frames * sizeof( Sample ) );
+	for( Block & block : blocks )
+		{
+		block.samples.resize( size_t( num_channels ) * block_frames );
+		block.in.resize( num_channels );
+		block.out.resize( num_channels );
+		for( Channel channel = 0; channel < num_channels; ++channel )
+			{
+			block.out[channel] = block.samples.data() + size_t( channel ) * block_frames;
+			block.in[channel] = block.out[channel];
+			}
+		}
+
+	// Queue i feeds stage i, and the last queue returns finished blocks. A null block marks the end of the stream.
+	std::vector<std::unique_ptr<SPSCQueue<Block *>>> queues;
+	for( size_t i = 0; i <= stages.size(); ++i )
+		queues.push_back( std::make_unique<SPSCQueue<Block *>>( num_blocks + 1 ) );
+
+	std::vector<std::jthread> workers;
+	for( size_t i = 0; i < stages.size(); ++i )
+		workers.emplace_back( [&, i]()
+			{
+			Processor & processor = *stages[i].processor;
+			while( true )
+				{
+				Block * block = pop_waiting( *queues[i] );
+				if( block ) processor.process( block->in.data(), block->out.data(), block->num_frames );
+				push_waiting( *queues[i + 1], block );
+				if( !block ) return;
+				}
+			} );
+
+	// This thread feeds input, including enough trailing silence to flush the stage latencies, and collects output
+	Audio out( a.get_format() );
+	std::vector<Block *> free_blocks;
+	for( Block & block : blocks ) free_blocks.push_back( &block );
+
+	const Frame total_frames = num_frames + latency;
+	Frame fed = 0;
+	Frame collected = 0;
+	bool ended = false;
+	while( true )
+		{
+		bool progressed = false;
+
+		while( fed < total_frames && !free_blocks.empty() )
+			{
+			Block * block = free_blocks.back();
+			free_blocks.pop_back();
+			block->num_frames = std::min( block_frames, total_frames - fed );
+			for( Channel channel = 0; channel < num_channels; ++channel )
+				{
+				Sample * dst = block->out[channel];
+				const Frame num_real = std::clamp( num_frames - fed, 0, block->num_frames );
+				if( num_real > 0 )
+					std::copy( a.get_sample_pointer( channel, fed ), a.get_sample_pointer( channel, fed ) + num_real, dst );
+				std::fill( dst + num_real, dst + block->num_frames, 0.0f );
+				}
+			push_waiting( *queues[0], block );
+			fed += block->num_frames;
+			progressed = true;
+			}
+
+		if( fed == total_frames && !ended )
+			{
+			push_waiting( *queues[0], (Block *) nullptr );
+			ended = true;
+			}
+
+		Block * block;
+		while( queues.back()->try_pop( block ) )
+			{
+			progressed = true;
+			if( !block )
+				{
+				workers.clear();
+				return out;
+				}
+
+			// Drop the first latency frames, they are from before the input started
+			const Frame start = std::max( latency - collected, 0 );
+			for( Frame f = start; f < block->num_frames; ++f )
+				{
+				const Frame out_frame = collected + f - latency;
+				if( out_frame >= num_frames ) break;
+				for( Channel channel = 0; channel < num_channels; ++channel )
+					out.get_sample( channel, out_frame ) = block->out[channel][f];
+				}
+			collected += block->num_frames;
+			free_blocks.push_back( block );
+			}
+
+		if( !progressed ) std::this_thread::yield();
+		}
+	}
+
+
+
+//============================================================================================================================================================
+// Pending
+//============================================================================================================================================================
+
+Pending::Pending( Audio && _source, const Chain & _chain )
+	: source( std::move( _source ) )
+	, chain( _chain )
+	{
+	}
+
+Pending Pending::operator>>( const Chain & other ) &&
+	{
+	return Pending( std::move( source ), chain >> other );
+	}
+
+Audio Pending::operator>>( const Pipe<Audio> & p ) &&
+	{
+	return p( std::move( *this ).evaluate() );
+	}
+
+Audio Pending::evaluate() &&
+	{
+	return chain( std::move( source ) );
+	}
+
+Pending::operator Audio() &&
+	{
+	return std::move( *this ).evaluate();
+	}
+
+bool Pending::save( const std::string & filepath, int format ) &&
+	{
+	return std::move( *this ).evaluate().save( filepath, format );
+	}
+
+Pending flan::pipeline::operator>>( Audio && a, const Chain & chain )
+	{
+	return Pending( std::move( a ), chain );
+	}
+
+Pending flan::pipeline::operator>>( const Audio & a, const Chain & chain )
+	{
+	return Pending( a.copy(), chain );
+	}
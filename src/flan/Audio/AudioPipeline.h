@@ -0,0 +1,118 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <mutex>
+
+#include "flan/Audio/Audio.h"
+#include "flan/Pipe.h"
+#include "flan/Processor.h"
+
+namespace flan::pipeline {
+
+/*
+A chain of Audio methods runs one stage at a time, and a sequential stage like a recursive filter or a compressor keeps a
+single core busy while the rest wait. Pipelining overlaps the stages instead: each stage is a Processor running on its own
+worker thread, and Audio streams through the chain in blocks, handed between workers over lock-free single producer single
+consumer queues. While stage B works on block N, stage A is already on block N+1, so a chain of S sequential stages runs up
+to S times faster given S free cores.
+
+Stages are composed with >>, which only records them. The chain runs when it meets Audio, or when it is used as a Pipe<Audio>.
+
+	Audio out = std::move( in )
+		>> pipeline::stage<Filter1PoleProcessor>( Filter1PoleProcessor::Type::Highpass, 40.0f, 4 )
+		>> pipeline::stage<CompressorProcessor>( -18.0f, 4.0f )
+		>> pipeline::stage<PVProcessor>( 2048, 128, 4096, PVProcessor::shape( shaper ) );
+
+Applying a Chain to Audio gives a Pending, which keeps collecting stages until it is converted to Audio, passed to a Pipe,
+or saved, so every stage in an expression like the one above shares one pipeline.
+
+The output has the length of the input, with stage latencies removed. Processors hold state, so a Chain runs on one input at
+a time; concurrent runs of Chains sharing a stage wait for each other. A Processor may appear only once in a Chain.
+*/
+
+/** A sequence of Processors to be pipelined.
+ */
+class Chain
+{
+public:
+	/** \param processor The first stage.
+	 */
+	explicit Chain( std::shared_ptr<Processor> processor );
+
+	/** Appends the stages of another Chain. No work is done until the result is applied to Audio. */
+	Chain operator>>( const Chain & other ) const;
+
+	/** Ends the Chain. The result is a Pipe which runs this Chain and then applies p. */
+	Pipe<Audio> operator>>( const Pipe<Audio> & p ) const;
+
+	operator Pipe<Audio>() const;
+
+	/** Streams a through every stage.
+	 */
+	Audio operator()( Audio && a ) const;
+
+	Audio operator()( const Audio & a ) const;
+
+	/** Sets the number of frames per block. Larger blocks cost less in hand-offs, smaller blocks fill the pipeline sooner.
+	 */
+	Chain & set_block_frames( Frame block_frames );
+
+	/** Sets the number of blocks each worker may have queued ahead of it. This bounds memory use.
+	 */
+	Chain & set_queue_blocks( size_t queue_blocks );
+
+	size_t get_num_stages() const;
+
+private:
+	struct StageEntry
+		{
+		std::shared_ptr<Processor> processor;
+		std::shared_ptr<std::mutex> mutex; // Held while running, as a stage is shared between every Chain it was added to
+		};
+
+	std::vector<StageEntry> stages;
+	Frame block_frames = 1024;
+	size_t queue_blocks = 4;
+};
+
+/** Constructs a Processor of type P from args and wraps it in a single stage Chain.
+ */
+template<typename P, typename... Args>
+Chain stage( Args && ... args )
+	{
+	return Chain( std::make_shared<P>( std::forward<Args>( args )... ) );
+	}
+
+/** Audio with a pending Chain. Further Chains are appended without doing any work. The Chain runs once, when the Pending is
+ *	converted to Audio, sent through a Pipe, or saved.
+ */
+class Pending
+{
+public:
+	Pending( Audio && source, const Chain & chain );
+
+	Pending operator>>( const Chain & other ) &&;
+
+	Audio operator>>( const Pipe<Audio> & p ) &&;
+
+	Audio evaluate() &&;
+
+	operator Audio() &&;
+
+	/** Runs the pending Chain and saves the result. See AudioBuffer::save. */
+	bool save(
+		const std::string & filepath,
+		int format = -1
+		) &&;
+
+private:
+	Audio source;
+	Chain chain;
+};
+
+Pending operator>>( Audio && a, const Chain & chain );
+
+Pending operator>>( const Audio & a, const Chain & chain );
+
+}
@@ -1,4 +1,5 @@
 #include "Audio.h"
+#include "flan/Utility/Trace.h"
 
 #include "WDL/resample.h"
 
@@ -6,8 +7,9 @@ using namespace flan;
 
 static const float sound_mps = 343; // Sound speed in air at 68 degrees F
 
-Audio Audio::pan( const Function<Second, float> & pan_amount ) const
+Audio Audio::pan( const Function<Second, float> & pan_amount ) const &
 	{
+	flan_TRACE_SPAN( "Audio::pan", *this );
 	if( is_null() ) return Audio::create_null();
 
 	if( get_num_channels() != 1 && get_num_channels() != 2 )
@@ -18,8 +20,19 @@ Audio Audio::pan( const Function<Second, float> & pan_amount ) const
 	return out;
 	}
 
+Audio Audio::pan( const Function<Second, float> & pan_amount ) &&
+	{
+	flan_TRACE_SPAN( "Audio::pan", *this );
+	// Mono input changes size, so it still needs a new buffer
+	if( get_num_channels() != 2 ) return std::as_const( *this ).pan( pan_amount );
+
+	pan_in_place( pan_amount );
+	return std::move( *this );
+	}
+
 Audio& Audio::pan_in_place( const Function<Second, float> & pan_amount )
 	{
+	flan_TRACE_SPAN( "Audio::pan_in_place", *this );
 	if( is_null() ) { std::cout << "Null input" << std::endl; return *this; }
 
 	if( get_num_channels() != 2 ) return *this; 
@@ -41,6 +54,7 @@ Audio& Audio::pan_in_place( const Function<Second, float> & pan_amount )
 
 Audio Audio::widen( const Function<Second, float> & widen_amount ) const
 	{
+	flan_TRACE_SPAN( "Audio::widen", *this );
 	return convert_to_mid_side().pan( widen_amount ).convert_to_left_right();
 	}
 
@@ -226,6 +240,7 @@ Audio Audio::stereo_spatialize(
 	const Function<Second, float> & speed_limit
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::stereo_spatialize", *this );
 	if( get_num_channels() != 1 )
 		{
 		std::cout << "Audio::spacialize only operates on mono inputs." << std::endl;
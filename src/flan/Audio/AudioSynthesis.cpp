@@ -1,4 +1,5 @@
 #include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
 
 #include <iostream>
 #include <random>
@@ -6,12 +7,19 @@
 #include <execution>
 #include <ranges>
 #include <algorithm>
+#include <complex>
+#include <numbers>
+#include <tuple>
+#include <optional>
 
 #include "r8brain/CDSPResampler.h"
 #include "WDL/resample.h"
 #include "flan/WindowFunctions.h"
 #include "flan/WindowFunctions.h"
 #include "flan/FFTHelper.h"
+#include "flan/Oscillator.h"
+#include "flan/Utility/LRUCache.h"
+#include "flan/Noise.h"
 
 #undef min
 #undef max
@@ -22,6 +30,18 @@ namespace flan {
 // Normal Synthesis
 //=====================================================================================================================================
 
+// Returns true and sets shape if wave is one of the waveforms an Oscillator can render without oversampling
+static bool get_oscillator_shape( const Function<Second, Amplitude> & wave, Oscillator::Shape & shape )
+	{
+	const std::type_info & type = wave.target_type();
+		 if( type == waveforms::sine.target_type() 		) shape = Oscillator::Shape::Sine;
+	else if( type == waveforms::square.target_type() 	) shape = Oscillator::Shape::Square;
+	else if( type == waveforms::saw.target_type() 		) shape = Oscillator::Shape::Saw;
+	else if( type == waveforms::triangle.target_type() 	) shape = Oscillator::Shape::Triangle;
+	else return false;
+	return true;
+	}
+
 Audio Audio::synthesize_waveform( 
 	const Function<Second, Amplitude> & wave, 
 	Second length, 
@@ -30,6 +50,7 @@ Audio Audio::synthesize_waveform(
 	int oversample 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::synthesize_waveform" );
 	if( oversample < 1 || length <= 0 || sample_rate <= 0 )
 		return Audio::create_null();
 
@@ -40,6 +61,19 @@ Audio Audio::synthesize_waveform(
 	format.sample_rate = sample_rate;
 	Audio out( format );
 
+	// Built in waveforms are rendered band-limited at the output rate
+	Oscillator::Shape shape;
+	if( get_oscillator_shape( wave, shape ) )
+		{
+		auto frequency_sampled = freq.sample( 0, out.get_num_frames(), 1.0f / sample_rate );
+		std::vector<float> frequencies( out.get_num_frames() );
+		for( Frame frame = 0; frame < out.get_num_frames(); ++frame )
+			frequencies[frame] = frequency_sampled[frame] / sample_rate;
+
+		Oscillator( shape ).render( frequencies.data(), out.get_sample_pointer( 0, 0 ), out.get_num_frames() );
+		return out;
+		}
+
 	const Frame num_in_frames = out.get_num_frames() * oversample;
 	const double in_sample_rate = sample_rate * oversample;
 
@@ -68,86 +102,142 @@ Audio Audio::synthesize_waveform(
 	return out;
 	}
 
+// Noise is generated in chunks of this many frames, in parallel. The output doesn't depend on it.
+static constexpr Frame noise_chunk_frames = 1 << 16;
+
+static uint64_t get_noise_seed( std::optional<uint64_t> seed )
+	{
+	if( seed ) return *seed;
+	std::random_device rd;
+	return ( uint64_t( rd() ) << 32 ) | rd();
+	}
+
+static int get_num_noise_chunks( const Audio & out )
+	{
+	return ( out.get_num_frames() + noise_chunk_frames - 1 ) / noise_chunk_frames;
+	}
+
+// Calls generate( start_frame, chunk_start_pointer, num_chunk_frames ) on each chunk of out's first channel, in parallel
+template<typename F>
+static void for_each_noise_chunk( Audio & out, F generate )
+	{
+	flan::for_each_i( get_num_noise_chunks( out ), ExecutionPolicy::Parallel_Unsequenced, [&]( int chunk )
+		{
+		const Frame start = chunk * noise_chunk_frames;
+		generate( start, out.get_sample_pointer( 0, start ), std::min( noise_chunk_frames, out.get_num_frames() - start ) );
+		} );
+	}
+
 Audio Audio::synthesize_white_noise(
 	Second length,
 	FrameRate sample_rate,
-	int oversample 
+	int oversample,
+	std::optional<uint64_t> seed
 	)
 	{
+	flan_TRACE_SPAN( "Audio::synthesize_white_noise" );
 	if( oversample < 1 || length <= 0 || sample_rate <= 0 )
 		return Audio::create_null();
-		
-	std::random_device rd;
-	std::mt19937 rng( rd() );
-	std::uniform_real_distribution<> dis( -1.0f, 1.0f );
 
-	Audio out = Audio::create_empty_with_length( length, 1, sample_rate * oversample );
-	for( Frame frame = 0; frame < out.get_num_frames(); ++frame )
-		out.get_sample( 0, frame ) = dis( rng );
+	// Independent samples at the output rate are already white up to Nyquist, so there is nothing for oversampling to remove
+	const uint64_t seed_c = get_noise_seed( seed );
+	Audio out = Audio::create_empty_with_length( length, 1, sample_rate );
+	for_each_noise_chunk( out, [&]( Frame start, Sample * samples, Frame num_frames )
+		{
+		noise::white( seed_c, start, samples, num_frames );
+		} );
 
-	return out.resample( sample_rate );
+	return out;
 	}
 
 // This is based on the work of Phil Burk, as seen here: https://www.firstpr.com.au/dsp/pink-noise/phil_burk_19990905_patest_pink.c
 Audio Audio::synthesize_pink_noise( 
 	Second length,
 	FrameRate sample_rate,
-	int num_rows )
+	int num_rows,
+	std::optional<uint64_t> seed 
+	)
 	{
+	flan_TRACE_SPAN( "Audio::synthesize_pink_noise" );
 	if( length <= 0 || sample_rate <= 0 || num_rows < 1 )
 		return Audio::create_null();
 
-	/* This converts a frame to a row in this pattern, with frame/row axes:
-                     x  	
-             x               x               
-         x       x       x       x       
-       x   x   x   x   x   x   x   x   
-      x x x x x x x x x x x x x x x x 
-	*/
-	auto get_row = []( Frame index )
+	const uint64_t seed_c = get_noise_seed( seed );
+	Audio out = Audio::create_empty_with_length( length, 1, sample_rate );
+	for_each_noise_chunk( out, [&]( Frame start, Sample * samples, Frame num_frames )
 		{
-		int num_zeros = 0;
-		int n = index;
-		while( (n & 1) == 0 )
-			{
-			n = n >> 1;
-			num_zeros++;
-			}
-		return num_zeros;
-		};
+		noise::pink( seed_c, num_rows, start, samples, num_frames );
+		} );
 
-	std::random_device rd;
-	std::mt19937 rng( rd() );
-	std::uniform_real_distribution<> dis( -1.0f, 1.0f );
+	out.set_volume_in_place( 1 );
 
-	Audio out = Audio::create_empty_with_length( length );
+	return out;
+	}
 
-	float running_sum = 0;
-	std::vector<float> rows( num_rows, 0 );
-	for( Frame frame = 0; frame < out.get_num_frames(); ++frame )
+Audio Audio::synthesize_brown_noise( 
+	Second length,
+	FrameRate sample_rate,
+	Frequency cutoff,
+	std::optional<uint64_t> seed 
+	)
+	{
+	flan_TRACE_SPAN( "Audio::synthesize_brown_noise" );
+	if( length <= 0 || sample_rate <= 0 || cutoff < 0 )
+		return Audio::create_null();
+
+	const uint64_t seed_c = get_noise_seed( seed );
+	const float coefficient = std::exp( -pi2 * cutoff / sample_rate );
+	Audio out = Audio::create_empty_with_length( length, 1, sample_rate );
+
+	// Integrate each chunk from silence, then carry each chunk's final value into the next. The integrator is linear, so a 
+	// chunk which started from a carry c is the chunk from silence plus c * coefficient^(i+1) at frame i.
+	std::vector<Sample> chunk_ends( get_num_noise_chunks( out ) );
+	for_each_noise_chunk( out, [&]( Frame start, Sample * samples, Frame num_frames )
 		{
-		const int index = frame % rows.size();
+		chunk_ends[start / noise_chunk_frames] = noise::brown( seed_c, coefficient, start, samples, num_frames );
+		} );
+
+	std::vector<Sample> carries( chunk_ends.size(), 0 );
+	for( size_t chunk = 1; chunk < carries.size(); ++chunk )
+		carries[chunk] = chunk_ends[chunk-1] + std::pow( coefficient, float( noise_chunk_frames ) ) * carries[chunk-1];
 
-		if( index != 0 )
+	for_each_noise_chunk( out, [&]( Frame start, Sample * samples, Frame num_frames )
+		{
+		float carry = carries[start / noise_chunk_frames];
+		for( Frame frame = 0; frame < num_frames && std::abs( carry ) > 1e-30f; ++frame )
 			{
-			const int row = get_row( index );
-			
-			const float new_random = dis( rng );
-			running_sum -= rows[row];
-			running_sum += new_random;
-			rows[row] = new_random;
+			carry *= coefficient;
+			samples[frame] += carry;
 			}
-		
-		const float sum = running_sum + dis( rng );
-
-		out.get_sample( 0, frame ) = sum;
-		}
+		} );
 
 	out.set_volume_in_place( 1 );
 
 	return out;
 	}
 
+Audio Audio::synthesize_velvet_noise( 
+	Second length,
+	FrameRate sample_rate,
+	float impulses_per_second,
+	std::optional<uint64_t> seed 
+	)
+	{
+	flan_TRACE_SPAN( "Audio::synthesize_velvet_noise" );
+	if( length <= 0 || sample_rate <= 0 || impulses_per_second <= 0 )
+		return Audio::create_null();
+
+	const uint64_t seed_c = get_noise_seed( seed );
+	const double frames_per_impulse = double( sample_rate ) / impulses_per_second;
+	Audio out = Audio::create_empty_with_length( length, 1, sample_rate );
+	for_each_noise_chunk( out, [&]( Frame start, Sample * samples, Frame num_frames )
+		{
+		noise::velvet( seed_c, frames_per_impulse, start, samples, num_frames );
+		} );
+
+	return out;
+	}
+
 Audio Audio::synthesize_spectrum(
 	Second length, 
 	const Function<Second, Frequency> & freq,
@@ -160,6 +250,7 @@ Audio Audio::synthesize_spectrum(
 	Second granularity_time
 	)
 	{
+	flan_TRACE_SPAN( "Audio::synthesize_spectrum" );
 	if( length <= 0 ||
 		fundamental_power <= 0 || 
 		spectrum_size_power <= 0 ||
@@ -267,41 +358,81 @@ Audio Audio::synthesize_spectrum(
 	return out;
 	}
 
-Audio Audio::synthesize_impulse(
-	Frequency base_freq,
-	Harmonic num_harmonics,
-	float chroma,
-	FrameRate sample_rate
+// Builds one period of the impulse, centered. The sum of chroma^h cos( h theta ) over h = 1..H is the real part of the geometric 
+// series z( 1 - z^H )/( 1 - z ) with z = chroma e^(i theta), so each frame costs the same however many harmonics there are.
+static std::vector<Sample> compute_impulse( 
+	double base_freq, 
+	Harmonic num_harmonics, 
+	double chroma, 
+	double sample_rate 
 	)
 	{
 	Frame num_frames = sample_rate / base_freq;
 	if( num_frames % 2 == 0 ) ++num_frames;
 	const Frame half_frames = (num_frames - 1) / 2; // Half, not including center
 
-	float chroma_power = chroma;
-	const float chroma_normalization = chroma == 1 ? 
-		1.0f / num_harmonics : 
-		( 1.0f - chroma ) / ( chroma - std::pow( chroma, num_harmonics + 1 ) );
+	const double chroma_normalization = chroma == 1 ? 
+		1.0 / num_harmonics : 
+		( 1.0 - chroma ) / ( chroma - std::pow( chroma, num_harmonics + 1 ) );
+	const double chroma_power_H = std::pow( chroma, num_harmonics );
 
-	Audio impulse = Audio::create_empty_with_frames( num_frames, 1, sample_rate ); 
-	for( Harmonic h = 1; h <= num_harmonics; ++h )
+	std::vector<Sample> impulse( num_frames );
+	for( Frame frame = 0; frame <= half_frames; ++frame )
 		{
-		const Frequency harmonic_freq = h * base_freq;
-		for( Frame frame = half_frames; frame < impulse.get_num_frames(); ++frame )
-			{
-			const Second time = impulse.frame_to_time( frame - half_frames );
-			impulse.get_sample( 0, frame ) += chroma_power * chroma_normalization * std::cos( pi2 * harmonic_freq * time );
-			}
-		chroma_power *= chroma;
+		const double theta = 2.0 * std::numbers::pi * base_freq * frame / sample_rate;
+		const std::complex<double> z = std::polar( chroma, theta );
+		const std::complex<double> one_minus_z = 1.0 - z;
+
+		// Only reachable with chroma of one, where every harmonic peaks at once
+		const double sum = std::abs( one_minus_z ) < 1e-9 ?
+			num_harmonics :
+			std::real( z * ( 1.0 - std::polar( chroma_power_H, num_harmonics * theta ) ) / one_minus_z );
+
+		impulse[half_frames + frame] = impulse[half_frames - frame] = Sample( chroma_normalization * sum );
 		}
-		
-	// Copy second half onto first half mirrored
-	for( Frame frame = 0; frame < half_frames; ++frame )
-		impulse.get_sample( 0, frame ) = impulse.get_sample( 0, num_frames - 1 - frame );
 
 	return impulse;
 	}
 
+Audio Audio::synthesize_impulse(
+	Frequency base_freq,
+	Harmonic num_harmonics,
+	float chroma,
+	FrameRate sample_rate
+	)
+	{
+	flan_TRACE_SPAN( "Audio::synthesize_impulse" );
+	if( base_freq <= 0 || num_harmonics < 1 || sample_rate <= 0 ) return Audio::create_null();
+
+	// A chroma of zero silences every harmonic past the first, which is what the normalization tends to
+	if( chroma == 0 )
+		{
+		chroma = 1;
+		num_harmonics = 1;
+		}
+
+	// Parameters are quantized so nearby requests, common in trainlet clouds, share a cache entry. Frequency is kept to a 
+	// thousandth of a semitone.
+	const int32_t freq_key = std::lround( std::log2( base_freq ) * 12000.0 );
+	const int32_t chroma_key = std::lround( chroma * 10000.0 );
+	const int32_t sample_rate_key = std::lround( sample_rate );
+	const double quantized_freq = std::exp2( freq_key / 12000.0 );
+
+	// Harmonics past Nyquist would alias, and the default asks for as many as there are
+	num_harmonics = std::min( num_harmonics, std::max( 1, Harmonic( sample_rate_key / 2 / quantized_freq ) ) );
+
+	using ImpulseKey = std::tuple<int32_t, Harmonic, int32_t, int32_t>;
+	static LRUCache<ImpulseKey, std::vector<Sample>> cache( 512 );
+	const auto impulse = cache.get_or_create( ImpulseKey( freq_key, num_harmonics, chroma_key, sample_rate_key ), [&]()
+		{
+		return compute_impulse( quantized_freq, num_harmonics, chroma_key / 10000.0, sample_rate_key );
+		} );
+
+	Audio out = Audio::create_empty_with_frames( impulse->size(), 1, sample_rate );
+	std::copy( impulse->begin(), impulse->end(), out.get_sample_pointer( 0, 0 ) );
+	return out;
+	}
+
 //=====================================================================================================================================
 // Granular Controllers
 //=====================================================================================================================================
@@ -381,6 +512,7 @@ Audio Audio::synthesize_grains(
 	FrameRate sample_rate
 	)
 	{
+	flan_TRACE_SPAN( "Audio::synthesize_grains" );
 	// Input validation
 	if( length <= 0 ) return Audio::create_null();
 	
@@ -428,6 +560,7 @@ Audio Audio::texture(
 	bool mod_feedback
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::texture", *this );
 	if( is_null() ) return Audio::create_null();
 
 	if( mod.is_null() )
@@ -481,6 +614,7 @@ Audio Audio::texture_effect(
 	Interpolator interp
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::texture_effect", *this );
 	if( is_null() || mod.is_null() ) return Audio::create_null();
 
 	const Frame fade_frames = std::max( 0.0f, time_to_frame( fade_time ) );
@@ -554,6 +688,7 @@ Audio Audio::synthesize_trainlets(
 	FrameRate sample_rate
 	)
 	{
+	flan_TRACE_SPAN( "Audio::synthesize_trainlets" );
 	const ExecutionPolicy ex_pol = lowest_execution( position, trainlet_gain_envelope, freq, trainlet_length, num_harmonics, chroma, impulse_harmonic_frequency );
 
 	return synthesize_grains( length, grains_per_second, time_scatter, Function<Second, Audio>( [&]( Second t )
@@ -579,6 +714,7 @@ Audio Audio::granulate(
 	const AudioMod & mod
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::granulate", *this );
 	if( is_null() ) return Audio::create_null();
 
 	const auto selection_sampled 	= time_selection.sample( 0, time_to_frame( length ), frame_to_time( 1 ) );
@@ -614,6 +750,7 @@ Audio Audio::psola(
 	const AudioMod & mod
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::psola", *this );
 	auto freq = get_frequency_envelope();
 
 	// A bit janky to sample here and wrap the samples in a lambda, but it's an easy way to protect from double calling
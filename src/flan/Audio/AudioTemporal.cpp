@@ -1,4 +1,6 @@
 #include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
+#include "flan/DelayLine.h"
 
 #include <ranges>
 
@@ -98,6 +100,7 @@ Audio Audio::modify_boundaries_frames(
 	Frame end_frame
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::modify_boundaries_frames", *this );
 	if( is_null() ) return Audio::create_null();
 
 	const Frame num_out_frames = -start_frame + get_num_frames() + end_frame;
@@ -118,6 +121,7 @@ Audio Audio::modify_boundaries(
 	Second end 
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::modify_boundaries", *this );
 	return modify_boundaries_frames( time_to_frame( start ), time_to_frame( end ) );
 	}
 
@@ -126,6 +130,7 @@ Audio Audio::remove_edge_silence(
 	Second fade_in_time
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::remove_edge_silence", *this );
 	Frame start_frame = 0;
 	for( Frame frame = 0; frame < get_num_frames(); ++frame )
 		{
@@ -158,6 +163,7 @@ std::vector<Audio> Audio::get_loud_chunks(
 	Second fade_in_time
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::get_loud_chunks", *this );
 	return get_loud_chunks_base( *this, non_silent_level, minimum_gap, fade_in_time ).first;
 	}
 
@@ -167,6 +173,7 @@ Audio Audio::remove_silence(
 	Second fade_in_time
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::remove_silence", *this );
 	auto v = get_loud_chunks_base( *this, non_silent_level, minimum_gap, fade_in_time );
 	return Audio::join( get_pointers( v.first ), v.second );
 	}
@@ -174,6 +181,7 @@ Audio Audio::remove_silence(
 Audio Audio::reverse(
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::reverse", *this );
 	if( is_null() ) return Audio::create_null();
 
 	Audio out( get_format() );
@@ -194,6 +202,7 @@ Audio Audio::cut(
 	Second end_fade 
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::cut", *this );
 	if( is_null() ) return Audio::create_null();
 
 	return cut_frames( 
@@ -211,6 +220,7 @@ Audio Audio::cut_frames(
 	Frame end_fade 
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::cut_frames", *this );
 	if( is_null() ) return Audio::create_null();
 
 	// Input validation
@@ -235,6 +245,7 @@ Audio Audio::cut_frames(
 
 Audio Audio::repitch( const Function<Second, float> & factor, Second granularity_in_seconds, WDLResampleType quality ) const
 	{
+	flan_TRACE_SPAN( "Audio::repitch", *this );
 	if( is_null() ) return Audio::create_null();
 
 	// Input validation
@@ -305,6 +316,7 @@ Audio Audio::iterate(
 	bool feedback 
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::iterate", *this );
 	if( is_null() ) return Audio::create_null();
 	if( n < 1 ) return Audio::create_null();
 
@@ -330,34 +342,120 @@ Audio Audio::delay(
 	const AudioMod & mod 
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::delay", *this );
+	return delay( added_length, { &delay_time }, { &decay }, mod );
+	}
+
+Audio Audio::delay( 
+	Second added_length, 
+	const std::vector<const Function<Second, Second> *> & delay_times, 
+	const std::vector<const Function<Second, float> *> & decays, 
+	const AudioMod & mod 
+	) const
+	{
+	flan_TRACE_SPAN( "Audio::delay", *this );
 	if( is_null() ) return Audio::create_null();
+	if( delay_times.empty() || delay_times.size() != decays.size() )
+		{
+		std::cout << "Audio::delay requires the same, nonzero, number of delay times and decays.\n";
+		return Audio::create_null();
+		}
+	if( std::ranges::count( delay_times, nullptr ) > 0 || std::ranges::count( decays, nullptr ) > 0 ) return Audio::create_null();
 
-	added_length = std::max( 0.0f, added_length );
-	const Second length = get_length() + added_length;
+	const int num_taps = delay_times.size();
+	const Frame num_out_frames = get_num_frames() + Frame( time_to_frame( std::max( 0.0f, added_length ) ) );
+	Audio out = Audio::create_empty_with_frames( num_out_frames, get_num_channels(), get_sample_rate() );
 
-	auto delay_time_sampled = delay_time.sample( 0, time_to_frame( length ), frame_to_time( 1 ) );
-	auto decay_sampled = decay.sample( 0, time_to_frame( length ), frame_to_time( 1 ) );
+	// Tap functions are sampled a block at a time, so the only memory that scales with the delay time is the lines themselves
+	const Frame max_block_frames = 4096;
+	std::vector<std::vector<fFrame>> tap_delays( num_taps, std::vector<fFrame>( max_block_frames ) );
+	std::vector<std::vector<float>> tap_gains( num_taps, std::vector<float>( max_block_frames ) );
+	std::vector<DelayLine> lines( get_num_channels() );
 
-	auto events_per_second = [&]( float t )
-		{ 
-		const Second delay_time_c = delay_time_sampled[ time_to_frame( t ) ];
-		if( delay_time_c <= 0 ) return 1.0f / float( get_sample_rate() );
-		return 1.0f / delay_time_c;
-		};
+	// With a mod, each block of feedback must be computed in full before any of it is written back, so a block can't be longer 
+	// than the shortest delay read within it
+	Audio feedback = Audio::create_null();
 
-	const AudioMod delay_mod = [&]( Audio & in, Second t )
-		{ 
-		if( t == 0 ) return;
+	for( Frame block_start = 0; block_start < num_out_frames; )
+		{
+		Frame block_frames = std::min( max_block_frames, num_out_frames - block_start );
 
-		if( ! mod.is_null() )
-			mod( in, t );
+		fFrame longest_delay = 0;
+		for( int tap = 0; tap < num_taps; ++tap )
+			{
+			const auto delays_sampled = delay_times[tap]->sample( block_start, block_start + block_frames, frame_to_time( 1 ) );
+			const auto gains_sampled = decays[tap]->sample( block_start, block_start + block_frames, frame_to_time( 1 ) );
+			for( Frame frame = 0; frame < block_frames; ++frame )
+				{
+				tap_delays[tap][frame] = std::max( time_to_frame( delays_sampled[frame] ), DelayLine::min_delay );
+				tap_gains[tap][frame] = gains_sampled[frame];
+				longest_delay = std::max( longest_delay, tap_delays[tap][frame] );
+				}
+			}
+		for( DelayLine & line : lines ) line.reserve( longest_delay );
 
-		// Modify gain
-		const float decay_t = decay_sampled[ time_to_frame( t ) ];
-		std::for_each( in.get_buffer().begin(), in.get_buffer().end(), [decay_t]( Sample & s ){ s *= decay_t; } );
-		};
+		if( mod.is_null() )
+			{
+			flan::for_each_i( get_num_channels(), ExecutionPolicy::Parallel_Unsequenced, [&]( Channel channel )
+				{
+				DelayLine & line = lines[channel];
+				for( Frame frame = 0; frame < block_frames; ++frame )
+					{
+					const Frame out_frame = block_start + frame;
+					Sample w = out_frame < get_num_frames() ? get_sample( channel, out_frame ) : 0;
+					for( int tap = 0; tap < num_taps; ++tap )
+						w += tap_gains[tap][frame] * line.read( tap_delays[tap][frame] );
+					line.write( w );
+					out.get_sample( channel, out_frame ) = w;
+					}
+				} );
+			}
+		else
+			{
+			// Cut the block at the first frame whose taps would read inside the block
+			for( Frame frame = 1; frame < block_frames; ++frame )
+				if( std::ranges::any_of( tap_delays, [&]( const std::vector<fFrame> & d ){ return d[frame] < frame + DelayLine::min_delay; } ) )
+					{
+					block_frames = frame;
+					break;
+					}
+
+			if( feedback.get_num_frames() != block_frames || feedback.get_num_channels() != get_num_channels() )
+				feedback = Audio::create_empty_with_frames( block_frames, get_num_channels(), get_sample_rate() );
+
+			// Nothing is written during this pass, so every read is relative to the block start
+			flan::for_each_i( get_num_channels(), ExecutionPolicy::Parallel_Unsequenced, [&]( Channel channel )
+				{
+				for( Frame frame = 0; frame < block_frames; ++frame )
+					{
+					Sample fb = 0;
+					for( int tap = 0; tap < num_taps; ++tap )
+						fb += tap_gains[tap][frame] * lines[channel].read( tap_delays[tap][frame] - frame );
+					feedback.get_sample( channel, frame ) = fb;
+					}
+				} );
 
-	return texture( length, events_per_second, 0, delay_mod, true );
+			mod( feedback, frame_to_time( block_start ) );
+
+			// The mod may have changed the feedback size, missing samples are silent
+			flan::for_each_i( get_num_channels(), ExecutionPolicy::Parallel_Unsequenced, [&]( Channel channel )
+				{
+				const bool has_channel = channel < feedback.get_num_channels();
+				for( Frame frame = 0; frame < block_frames; ++frame )
+					{
+					const Frame out_frame = block_start + frame;
+					Sample w = out_frame < get_num_frames() ? get_sample( channel, out_frame ) : 0;
+					if( has_channel && frame < feedback.get_num_frames() ) w += feedback.get_sample( channel, frame );
+					lines[channel].write( w );
+					out.get_sample( channel, out_frame ) = w;
+					}
+				} );
+			}
+
+		block_start += block_frames;
+		}
+
+	return out;
 	}
 
 // Audio Audio::stereo_delay(
@@ -411,6 +509,7 @@ std::vector<Audio> Audio::split_at_times(
 	Second fade
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::split_at_times", *this );
 	if( is_null() ) return std::vector<Audio>();
 
 	const Frame fade_frames = time_to_frame( fade );
@@ -442,6 +541,7 @@ std::vector<Audio> Audio::split_with_lengths(
 	Second fade
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::split_with_lengths", *this );
 	for( Second & t : split_lengths ) if( t < 0 ) t = 0; 
 
 	// Create split times from split lengths
@@ -455,6 +555,7 @@ std::vector<Audio> Audio::split_with_equal_lengths(
 	Second fade 
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::split_with_equal_lengths", *this );
 	if( slice_length <= 0 ) return std::vector<Audio>();
 	std::vector<Second> slice_lengths( std::ceil( get_length() / slice_length ), slice_length );
 	return split_with_lengths( slice_lengths, fade );
@@ -465,6 +566,7 @@ Audio Audio::rearrange(
 	Second fade 
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::rearrange", *this );
 	if( is_null() ) return Audio::create_null();
 
 	// + fade here accounts for + fade / 2 at both ends
@@ -488,6 +590,7 @@ Audio Audio::random_chunks(
 	const AudioMod & mod
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::random_chunks", *this );
 	if( is_null() || length <= 0 ) return Audio::create_null();
 
 	// Integrate chunk length to find chunk frames
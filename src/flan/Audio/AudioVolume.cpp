@@ -1,21 +1,35 @@
 #include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
+#include "flan/Oversampler.h"
+
+#include <array>
 
 using namespace flan;
 
 Audio Audio::modify_volume( 
 	const Function<Second, float> & volume_level 
-	) const
+	) const &
 	{
+	flan_TRACE_SPAN( "Audio::modify_volume", *this );
 	if( is_null() ) return Audio::create_null();
-	Audio out = copy();
-	out.modify_volume_in_place( volume_level );
-	return out;
+	return copy().modify_volume( volume_level );
+	}
+
+Audio Audio::modify_volume( 
+	const Function<Second, float> & volume_level 
+	) &&
+	{
+	flan_TRACE_SPAN( "Audio::modify_volume", *this );
+	if( is_null() ) return Audio::create_null();
+	modify_volume_in_place( volume_level );
+	return std::move( *this );
 	}
 
 Audio Audio::ring_modulate( 
 	const Audio & other 
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::ring_modulate", *this );
 	if( is_null() || other.is_null() ) return Audio::create_null(); 
 	
 	Audio out = copy();
@@ -33,6 +47,7 @@ Audio& Audio::modify_volume_in_place(
 	const Function<Second, Amplitude> & gain 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::modify_volume_in_place", *this );
 	auto gain_sampled = sample_function_over_domain( gain );
 
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
@@ -45,18 +60,28 @@ Audio& Audio::modify_volume_in_place(
 
 Audio Audio::set_volume( 
 	const Function<Second, Amplitude> & level 
-	) const
+	) const &
 	{
+	flan_TRACE_SPAN( "Audio::set_volume", *this );
 	if( is_null() ) return Audio::create_null();
-	Audio out = copy();
-	out.set_volume_in_place( level );
-	return out;
+	return copy().set_volume( level );
+	}
+
+Audio Audio::set_volume( 
+	const Function<Second, Amplitude> & level 
+	) &&
+	{
+	flan_TRACE_SPAN( "Audio::set_volume", *this );
+	if( is_null() ) return Audio::create_null();
+	set_volume_in_place( level );
+	return std::move( *this );
 	}
 
 Audio& Audio::set_volume_in_place(
 	const Function<Second, Amplitude> & level
 	)
 	{
+	flan_TRACE_SPAN( "Audio::set_volume_in_place", *this );
 	if( is_null() ) return *this;
 
 	// Divide by get_max_sample_magnitude to normalize, multiply by level to set
@@ -70,18 +95,32 @@ Audio Audio::fade(
 	Second start, 
 	Second end, 
 	const Interpolator & interp 
-	) const
+	) const &
 	{
+	flan_TRACE_SPAN( "Audio::fade", *this );
 	if( is_null() ) return Audio::create_null();
 	return fade_frames( time_to_frame( start ), time_to_frame( end ), interp );
 	}
 
+Audio Audio::fade( 
+	Second start, 
+	Second end, 
+	const Interpolator & interp 
+	) &&
+	{
+	flan_TRACE_SPAN( "Audio::fade", *this );
+	if( is_null() ) return Audio::create_null();
+	fade_in_place( start, end, interp );
+	return std::move( *this );
+	}
+
 Audio& Audio::fade_in_place( 
 	Second start, 
 	Second end, 
 	const Interpolator & interp 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::fade_in_place", *this );
 	if( is_null() ) { std::cout << "Null input" << std::endl; return *this; }
 	fade_frames_in_place( time_to_frame( start ), time_to_frame( end ), interp );
 	return *this;
@@ -91,12 +130,23 @@ Audio Audio::fade_frames(
 	Frame start, 
 	Frame end, 
 	const Interpolator & interp 
-	) const
+	) const &
 	{
+	flan_TRACE_SPAN( "Audio::fade_frames", *this );
 	if( is_null() ) return Audio::create_null();
-	Audio out = copy();
-	out.fade_frames_in_place( start, end, interp );
-	return out;
+	return copy().fade_frames( start, end, interp );
+	}
+
+Audio Audio::fade_frames( 
+	Frame start, 
+	Frame end, 
+	const Interpolator & interp 
+	) &&
+	{
+	flan_TRACE_SPAN( "Audio::fade_frames", *this );
+	if( is_null() ) return Audio::create_null();
+	fade_frames_in_place( start, end, interp );
+	return std::move( *this );
 	}
 
 Audio& Audio::fade_frames_in_place( 
@@ -105,6 +155,7 @@ Audio& Audio::fade_frames_in_place(
 	const Interpolator & interp 
 	)
 	{
+	flan_TRACE_SPAN( "Audio::fade_frames_in_place", *this );
 	if( is_null() ) { std::cout << "Null input" << std::endl; return *this; }
 
 	// Input validation
@@ -135,34 +186,122 @@ Audio& Audio::fade_frames_in_place(
 	}
 
 Audio Audio::invert_phase(
-	) const
+	) const &
 	{
+	flan_TRACE_SPAN( "Audio::invert_phase", *this );
 	if( is_null() ) return Audio::create_null();
-	Audio out = copy();
-	std::for_each( FLAN_PAR_UNSEQ out.get_buffer().begin(), out.get_buffer().end(), []( Sample & s ){ s = -s; } );
+	return copy().invert_phase();
+	}
+
+Audio Audio::invert_phase(
+	) &&
+	{
+	flan_TRACE_SPAN( "Audio::invert_phase", *this );
+	if( is_null() ) return Audio::create_null();
+	std::for_each( FLAN_PAR_UNSEQ get_buffer().begin(), get_buffer().end(), []( Sample & s ){ s = -s; } );
+	return std::move( *this );
+	}
+
+// Streams each channel through its own oversampler in blocks. The output is shifted back by the oversampler latency, which
+// is flushed out with silence past the end of the input.
+static Audio waveshape_blocks_base( 
+	const Audio & me,
+	const Audio::BlockShaper & shaper,
+	uint16_t oversample_factor,
+	ExecutionPolicy policy
+	)
+	{
+	Audio out = Audio::create_empty_with_frames( me.get_num_frames(), me.get_num_channels(), me.get_sample_rate() );
+	const Frame num_frames = me.get_num_frames();
+	if( num_frames == 0 ) return out;
+
+	flan::for_each_i( me.get_num_channels(), policy, [&]( Channel channel )
+		{
+		Oversampler oversampler( oversample_factor );
+		const Frame latency = oversampler.get_latency();
+		const FrameRate oversampled_rate = me.get_sample_rate() * oversampler.get_factor();
+
+		// Oversampled index of the next sample sent to the shaper, relative to the start of the input
+		Frame shaped = -oversampler.get_oversampled_latency();
+		const Oversampler::Shaper oversampled_shaper = [&]( Sample * samples, Frame num_samples )
+			{
+			shaper( samples, num_samples, shaped / oversampled_rate, oversampled_rate );
+			shaped += num_samples;
+			};
+
+		const Sample * in = me.get_sample_pointer( channel, 0 );
+		Sample * o = out.get_sample_pointer( channel, 0 );
+		std::array<Sample, Oversampler::max_block_frames> block;
+		for( Frame start = 0; start < num_frames + latency; start += Oversampler::max_block_frames )
+			{
+			const Frame block_frames = std::min( Oversampler::max_block_frames, num_frames + latency - start );
+			for( Frame i = 0; i < block_frames; ++i )
+				block[i] = start + i < num_frames ? in[start + i] : 0;
+
+			oversampler.process( block.data(), block.data(), block_frames, oversampled_shaper );
+
+			for( Frame i = 0; i < block_frames; ++i )
+				{
+				const Frame out_frame = start + i - latency;
+				if( 0 <= out_frame && out_frame < num_frames ) o[out_frame] = block[i];
+				}
+			}
+		} );
+
 	return out;
 	}
 
 Audio Audio::waveshape( 
 	const Function< std::pair<Second, Sample>, Sample > & shaper,
 	uint16_t oversample_factor
-	) const
+	) const &
+	{
+	flan_TRACE_SPAN( "Audio::waveshape", *this );
+	if( is_null() ) return Audio::create_null();
+	if( oversample_factor <= 1 ) return copy().waveshape( shaper, oversample_factor );
+
+	// Channels run under the shaper's policy, so sequenced shapers still see one channel at a time, in order
+	const Second last_time = frame_to_time( get_num_frames() - 1 );
+	return waveshape_blocks_base( *this, [&]( Sample * samples, Frame num_samples, Second start_time, FrameRate rate )
+		{
+		for( Frame i = 0; i < num_samples; ++i )
+			samples[i] = shaper( std::pair( std::clamp( start_time + i / rate, 0.0f, last_time ), samples[i] ) );
+		}, oversample_factor, shaper.get_execution_policy() );
+	}
+
+Audio Audio::waveshape( 
+	const Function< std::pair<Second, Sample>, Sample > & shaper,
+	uint16_t oversample_factor
+	) &&
 	{
+	flan_TRACE_SPAN( "Audio::waveshape", *this );
 	if( is_null() ) return Audio::create_null();
 
-	Audio oversampled = resample( get_sample_rate() * oversample_factor );
+	// Oversampling needs a new buffer regardless, so only the non-oversampled case can work on this buffer
+	if( oversample_factor > 1 ) return std::as_const( *this ).waveshape( shaper, oversample_factor );
+
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
 		{
 		runtime_execution_policy_handler( shaper.get_execution_policy(), [&]( auto policy )
 			{
-			std::for_each( FLAN_POLICY iota_iter( 0 ), iota_iter( oversampled.get_num_frames() ), [&]( Frame frame )
+			std::for_each( FLAN_POLICY iota_iter( 0 ), iota_iter( get_num_frames() ), [&]( Frame frame )
 				{ 
-				Sample & s = oversampled.get_sample( channel, frame );
-				s = shaper( std::pair( oversampled.frame_to_time( frame ), s ) );
+				Sample & s = get_sample( channel, frame );
+				s = shaper( std::pair( frame_to_time( frame ), s ) );
 				} );
 			} );
 		}
-	return oversampled.resample( get_sample_rate() );
+	return std::move( *this );
+	}
+
+Audio Audio::waveshape_blocks( 
+	const BlockShaper & shaper,
+	uint16_t oversample_factor
+	) const
+	{
+	flan_TRACE_SPAN( "Audio::waveshape_blocks", *this );
+	if( is_null() ) return Audio::create_null();
+	return waveshape_blocks_base( *this, shaper, oversample_factor, ExecutionPolicy::Parallel_Unsequenced );
 	}
 
 Audio Audio::add_moisture(
@@ -172,18 +311,24 @@ Audio Audio::add_moisture(
 	const Function<Second, Amplitude> & waveform
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::add_moisture", *this );
 	auto amount_sampled = sample_function_over_domain( amount );
 	auto frequency_sampled = sample_function_over_domain( frequency );
 	auto skew_sampled = sample_function_over_domain( skew );
 
-	return waveshape( [&]( std::pair<Second, Sample> ts ) -> Sample
+	return waveshape_blocks( [&]( Sample * samples, Frame num_samples, Second start_time, FrameRate rate )
 		{ 
-		const float amount_c 	= amount_sampled	[time_to_frame(ts.first)];
-		const float frequency_c = frequency_sampled	[time_to_frame(ts.first)];
-		const float skew_c 		= skew_sampled		[time_to_frame(ts.first)];
-
-		const float power = ts.second >= 0 ? std::pow( ts.second, skew_c ) : -std::pow( -ts.second, skew_c );
-		return ts.second + amount_c * ts.second * waveform( pi2 * frequency_c * power ); 
+		for( Frame i = 0; i < num_samples; ++i )
+			{
+			const Frame frame = std::clamp( Frame( time_to_frame( start_time + i / rate ) ), 0, get_num_frames() - 1 );
+			const float amount_c 	= amount_sampled	[frame];
+			const float frequency_c = frequency_sampled	[frame];
+			const float skew_c 		= skew_sampled		[frame];
+
+			const Sample x = samples[i];
+			const float power = x >= 0 ? std::pow( x, skew_c ) : -std::pow( -x, skew_c );
+			samples[i] = x + amount_c * x * waveform( pi2 * frequency_c * power ); 
+			}
 		} );
 	}
 
@@ -194,8 +339,23 @@ Audio Audio::compress(
 	const Function<Second, Second> & release, 
 	const Function<Second, Decibel> & knee_width, 
 	const Audio * sidechain_source 
-	) const
+	) const &
 	{
+	flan_TRACE_SPAN( "Audio::compress", *this );
+	if( is_null() ) return Audio::create_null();
+	return copy().compress( threshold, ratio, attack, release, knee_width, sidechain_source == this ? nullptr : sidechain_source );
+	}
+
+Audio Audio::compress( 
+	const Function<Second, Decibel> & threshold, 
+	const Function<Second, float> & ratio, 
+	const Function<Second, Second> & attack, 
+	const Function<Second, Second> & release, 
+	const Function<Second, Decibel> & knee_width, 
+	const Audio * sidechain_source 
+	) &&
+	{
+	flan_TRACE_SPAN( "Audio::compress", *this );
 	/*
 	For details on compression, both in general and as referenced in this function:
 	"Digital Dynamic Range Compressor Design — A Tutorial and Analysis"
@@ -214,8 +374,6 @@ Audio Audio::compress(
 			if( channel_max[f] < sidechain_source->get_sample( c, f ) )
 				channel_max[f] = sidechain_source->get_sample( c, f );
 
-	Audio out = copy();
-
 	// Sample all inputs
 	auto threshold_sampled 	= threshold .sample( 0, get_num_frames(), frame_to_time( 1 ) );
 	auto ratio_sampled 		= ratio     .sample( 0, get_num_frames(), frame_to_time( 1 ) );
@@ -270,11 +428,11 @@ Audio Audio::compress(
 			const Decibel c_dB = -smooth_decouple_peak_detector( y_1, y_L, frame, x_L );
 
 			const Sample c = std::pow( 10.0f, c_dB / 20.0f );
-			out.get_sample( channel, frame ) *= c;
+			get_sample( channel, frame ) *= c;
 			}
 		} );
 
-	return out;
+	return std::move( *this );
 	}
 
 Audio Audio::apply_adsr_envelope(
@@ -288,6 +446,7 @@ Audio Audio::apply_adsr_envelope(
 	float release_exponent
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::apply_adsr_envelope", *this );
 	auto envelope = flan::ADSR( 
 		attack_time,
 		decay_time,
@@ -308,6 +467,7 @@ Audio Audio::apply_ar_envelope(
 	float release_exponent
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::apply_ar_envelope", *this );
 	auto envelope = flan::ADSR( 
 		attack_time,
 		0,
@@ -0,0 +1,334 @@
+#include "flan/ConstantQ.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "flan/FFTHelper.h"
+#include "flan/DSPUtility.h"
+
+using namespace flan;
+
+// Kernel values below this fraction of a row's peak are dropped
+static const float kernelThreshold = 1e-3f;
+
+// Nonzero half-band coefficients on one side of the center tap. Octaves only use the bottom half of a decimated level's
+// band, so the transition band is wide and a short filter is enough.
+static const int halfbandLength = 8;
+
+ConstantQ::ConstantQ( std::pair<Frequency, Frequency> bandwidth, Bin _bins_per_octave, FrameRate _sample_rate, Frame _hop_size )
+	: bins_per_octave( std::max( _bins_per_octave, Bin( 1 ) ) )
+	, sample_rate( _sample_rate )
+	, num_bins( 0 )
+	, min_frequency( bandwidth.first )
+	, Q( 1.0f / ( std::pow( 2.0f, 1.0f / bins_per_octave ) - 1.0f ) )
+	, hop_size( std::max( _hop_size, Frame( 1 ) ) )
+	, octaves()
+	, kernels()
+	, halfband( design_halfband( halfbandLength ) )
+	{
+	const Frequency max_frequency = std::min( bandwidth.second, sample_rate / 2 );
+	if( min_frequency <= 0 || max_frequency <= min_frequency || sample_rate <= 0 ) return;
+
+	// This matches SQPVBuffer's bin count
+	num_bins = std::ceil( ( std::log2( max_frequency ) - std::log2( min_frequency ) ) * bins_per_octave );
+	if( num_bins <= 0 ) return;
+
+	const double top_frequency = get_bin_frequency( num_bins - 1 );
+	if( _hop_size <= 0 )
+		hop_size = std::max( Frame( Q * sample_rate / top_frequency / 4 ), Frame( 1 ) );
+
+	// Each octave is analyzed at the lowest rate that puts its top bin at or below a quarter of that rate. Octave frequencies
+	// halve along with the rates, so this is the same shift for every octave, except that the top octave can't be upsampled.
+	const int shift = std::floor( std::log2( sample_rate / ( 4.0 * top_frequency ) ) );
+	const int num_octaves = ( num_bins + bins_per_octave - 1 ) / bins_per_octave;
+	std::vector<int> kernel_shifts;
+	for( int o = 0; o < num_octaves; ++o )
+		{
+		Octave octave;
+		octave.level = std::max( o + shift, 0 );
+		octave.end_bin = num_bins - o * bins_per_octave;
+		octave.first_bin = std::max( octave.end_bin - bins_per_octave, Bin( 0 ) );
+		octave.first_row = octave.first_bin - ( octave.end_bin - bins_per_octave );
+
+		const int kernel_shift = octave.level - o;
+		auto existing = std::find( kernel_shifts.begin(), kernel_shifts.end(), kernel_shift );
+		octave.kernel = existing - kernel_shifts.begin();
+		if( existing == kernel_shifts.end() )
+			{
+			kernel_shifts.push_back( kernel_shift );
+			kernels.push_back( make_kernel( top_frequency * std::pow( 2.0, kernel_shift ) / sample_rate ) );
+			}
+
+		octaves.push_back( octave );
+		}
+	}
+
+ConstantQ::Kernel ConstantQ::make_kernel( double top_frequency ) const
+	{
+	// Frequencies here are in cycles per sample of the octave's level
+	auto row_frequency = [&]( Bin row ){ return top_frequency * std::pow( 2.0, double( row - ( bins_per_octave - 1 ) ) / bins_per_octave ); };
+
+	Kernel kernel;
+	// Frame centers fall up to a sample past the middle of the fft, so the longest atom gets room for that on each side
+	kernel.fft_size = power_of_2_container( Frame( std::ceil( Q / row_frequency( 0 ) ) ) + 2 );
+	kernel.rows.resize( bins_per_octave );
+	kernel.first = kernel.fft_size;
+	kernel.end = 0;
+
+	const Frame M = kernel.fft_size;
+	auto fft = FFTHelper::acquire( M, true, false );
+	std::vector<std::complex<float>> spectrum( fft->complex_buffer_size() );
+
+	for( Bin row = 0; row < bins_per_octave; ++row )
+		{
+		const double frequency = row_frequency( row );
+		const double length = Q / frequency;
+
+		// Atom parts are transformed separately, since the fft is real to complex
+		double window_sum = 0;
+		for( Frame n = 0; n < M; ++n )
+			{
+			const double m = n - M / 2;
+			const double w = std::abs( m ) < length / 2 ? 0.5 + 0.5 * std::cos( pi2 * m / length ) : 0.0;
+			window_sum += w;
+			fft->get_real_buffer()[n] = float( w * std::cos( pi2 * frequency * m ) );
+			}
+		fft->r2c_execute();
+		std::copy( fft->complex_begin(), fft->complex_end(), spectrum.begin() );
+
+		for( Frame n = 0; n < M; ++n )
+			{
+			const double m = n - M / 2;
+			const double w = std::abs( m ) < length / 2 ? 0.5 + 0.5 * std::cos( pi2 * m / length ) : 0.0;
+			fft->get_real_buffer()[n] = float( w * std::sin( pi2 * frequency * m ) );
+			}
+		fft->r2c_execute();
+
+		// The analysis value of a sinusoid centered in a bin is its amplitude
+		const float scale = float( 2.0 / ( M * window_sum ) );
+		float peak = 0;
+		for( size_t j = 0; j < spectrum.size(); ++j )
+			{
+			const std::complex<float> atom = spectrum[j] + std::complex<float>( 0, 1 ) * fft->get_complex_buffer()[j];
+			spectrum[j] = std::conj( atom ) * scale;
+			peak = std::max( peak, std::abs( spectrum[j] ) );
+			}
+
+		Bin first = 0;
+		Bin last = spectrum.size() - 1;
+		while( first < last && std::abs( spectrum[first] ) < peak * kernelThreshold ) ++first;
+		while( last > first && std::abs( spectrum[last] ) < peak * kernelThreshold ) --last;
+
+		kernel.rows[row].first = first;
+		kernel.rows[row].values.assign( spectrum.begin() + first, spectrum.begin() + last + 1 );
+		kernel.first = std::min( kernel.first, first );
+		kernel.end = std::max( kernel.end, last + 1 );
+		}
+
+	return kernel;
+	}
+
+Bin ConstantQ::get_num_bins() const
+	{
+	return num_bins;
+	}
+
+Bin ConstantQ::get_bins_per_octave() const
+	{
+	return bins_per_octave;
+	}
+
+Frame ConstantQ::get_hop_size() const
+	{
+	return hop_size;
+	}
+
+Frequency ConstantQ::get_bin_frequency( Bin bin ) const
+	{
+	return min_frequency * std::pow( 2.0f, float( bin ) / bins_per_octave );
+	}
+
+Cycle ConstantQ::get_Q() const
+	{
+	return Q;
+	}
+
+Frame ConstantQ::get_num_frames( Frame num_samples ) const
+	{
+	return num_samples / hop_size + 1;
+	}
+
+int ConstantQ::get_num_octaves() const
+	{
+	return octaves.size();
+	}
+
+std::pair<Bin, Bin> ConstantQ::get_octave_bins( int octave ) const
+	{
+	return { octaves[octave].first_bin, octaves[octave].end_bin };
+	}
+
+double ConstantQ::frame_center( const Octave & octave, Frame frame ) const
+	{
+	return double( frame ) * hop_size / double( 1 << octave.level );
+	}
+
+Frame ConstantQ::level_length( int level, Frame num_samples ) const
+	{
+	for( int l = 0; l < level; ++l )
+		num_samples = ( num_samples + 1 ) / 2;
+	return num_samples;
+	}
+
+ConstantQ::Levels ConstantQ::decompose( const Sample * samples, Frame num_samples ) const
+	{
+	int num_levels = 0;
+	for( const Octave & octave : octaves )
+		num_levels = std::max( num_levels, octave.level + 1 );
+
+	Levels levels( num_levels );
+	if( num_levels == 0 ) return levels;
+	levels[0].assign( samples, samples + num_samples );
+	for( int level = 1; level < num_levels; ++level )
+		levels[level] = halfband_decimate( levels[level-1], halfband );
+	return levels;
+	}
+
+void ConstantQ::analyze( int octave_index, const Levels & levels, Frame first_frame, Frame num_frames, std::complex<float> * out ) const
+	{
+	const Octave & octave = octaves[octave_index];
+	const Kernel & kernel = kernels[octave.kernel];
+	const std::vector<Sample> & x = levels[octave.level];
+	const Frame M = kernel.fft_size;
+	const Bin octave_bins = octave.end_bin - octave.first_bin;
+
+	auto fft = FFTHelper::acquire( M, true, false );
+	std::vector<std::complex<float>> shifted( kernel.end - kernel.first );
+
+	for( Frame frame = first_frame; frame < first_frame + num_frames; ++frame )
+		{
+		const double center = frame_center( octave, frame );
+		const Frame whole = std::floor( center );
+		const double fraction = center - whole;
+		const Frame start = whole - M / 2;
+
+		float * real = fft->get_real_buffer();
+		for( Frame n = 0; n < M; ++n )
+			{
+			const Frame i = start + n;
+			real[n] = 0 <= i && i < Frame( x.size() ) ? x[i] : 0.0f;
+			}
+		fft->r2c_execute();
+
+		// Shift the frame back by the fraction so the atoms are centered on the frame time
+		const std::complex<float> * X = fft->get_complex_buffer() + kernel.first;
+		if( fraction == 0 )
+			std::copy( X, X + shifted.size(), shifted.begin() );
+		else
+			{
+			const std::complex<double> step = std::polar( 1.0, pi2 * fraction / M );
+			std::complex<double> rotation = std::polar( 1.0, pi2 * fraction * kernel.first / M );
+			for( size_t j = 0; j < shifted.size(); ++j )
+				{
+				shifted[j] = X[j] * std::complex<float>( rotation );
+				rotation *= step;
+				}
+			}
+
+		std::complex<float> * frame_out = out + size_t( frame - first_frame ) * octave_bins;
+		for( Bin bin = 0; bin < octave_bins; ++bin )
+			{
+			const Kernel::Row & row = kernel.rows[octave.first_row + bin];
+			const std::complex<float> * s = shifted.data() + row.first - kernel.first;
+			float re = 0, im = 0;
+			for( size_t j = 0; j < row.values.size(); ++j )
+				{
+				re += s[j].real() * row.values[j].real() - s[j].imag() * row.values[j].imag();
+				im += s[j].real() * row.values[j].imag() + s[j].imag() * row.values[j].real();
+				}
+			frame_out[bin] = { re, im };
+			}
+		}
+	}
+
+std::vector<Sample> ConstantQ::synthesize( int octave_index, const std::complex<float> * in, Frame num_frames, Frame num_samples ) const
+	{
+	const Octave & octave = octaves[octave_index];
+	const Kernel & kernel = kernels[octave.kernel];
+	const Frame M = kernel.fft_size;
+	const Bin octave_bins = octave.end_bin - octave.first_bin;
+
+	std::vector<Sample> out( level_length( octave.level, num_samples ), 0.0f );
+	auto fft = FFTHelper::acquire( M, false, true );
+
+	// Hann atoms spaced a bin apart have squared responses summing to 3/2, the 4 covers the kernel and fft scaling, and overlap
+	// adding windows normalized to unit sum gains one over the level hop.
+	const float scale = float( hop_size ) / ( 1 << octave.level ) / 6.0f;
+
+	for( Frame frame = 0; frame < num_frames; ++frame )
+		{
+		const double center = frame_center( octave, frame );
+		const Frame whole = std::floor( center );
+		const double fraction = center - whole;
+		const Frame start = whole - M / 2;
+
+		std::complex<float> * Y = fft->get_complex_buffer();
+		std::fill( fft->complex_begin(), fft->complex_end(), 0 );
+
+		const std::complex<float> * frame_in = in + size_t( frame ) * octave_bins;
+		for( Bin bin = 0; bin < octave_bins; ++bin )
+			{
+			const Kernel::Row & row = kernel.rows[octave.first_row + bin];
+			const std::complex<float> value = frame_in[bin];
+			std::complex<float> * y = Y + row.first;
+			for( size_t j = 0; j < row.values.size(); ++j )
+				y[j] += value * std::conj( row.values[j] );
+			}
+
+		if( fraction != 0 )
+			{
+			const std::complex<double> step = std::polar( 1.0, -pi2 * fraction / M );
+			std::complex<double> rotation = std::polar( 1.0, -pi2 * fraction * kernel.first / M );
+			for( Bin j = kernel.first; j < kernel.end; ++j )
+				{
+				Y[j] *= std::complex<float>( rotation );
+				rotation *= step;
+				}
+			}
+
+		fft->c2r_execute();
+
+		const Frame n_start = std::max( -start, Frame( 0 ) );
+		const Frame n_end = std::min( M, Frame( out.size() ) - start );
+		const float * real = fft->get_real_buffer();
+		for( Frame n = n_start; n < n_end; ++n )
+			out[start + n] += real[n] * scale;
+		}
+
+	return out;
+	}
+
+void ConstantQ::recompose( std::vector<std::vector<Sample>> && octave_signals, Sample * out, Frame num_samples ) const
+	{
+	int num_levels = 0;
+	for( const Octave & octave : octaves )
+		num_levels = std::max( num_levels, octave.level + 1 );
+
+	std::vector<Sample> lower;
+	for( int level = num_levels - 1; level >= 0; --level )
+		{
+		std::vector<Sample> sum( level_length( level, num_samples ), 0.0f );
+		if( !lower.empty() )
+			halfband_interpolate_add( lower, sum, halfband );
+		for( size_t o = 0; o < octaves.size(); ++o )
+			if( octaves[o].level == level )
+				{
+				std::transform( sum.begin(), sum.end(), octave_signals[o].begin(), sum.begin(), std::plus<Sample>() );
+				std::vector<Sample>().swap( octave_signals[o] );
+				}
+		lower = std::move( sum );
+		}
+
+	if( lower.empty() ) std::fill( out, out + num_samples, 0.0f );
+	else std::copy( lower.begin(), lower.end(), out );
+	}
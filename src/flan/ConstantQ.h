@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <utility>
+
+#include "flan/defines.h"
+
+namespace flan {
+
+/** A constant-Q transform computed one octave at a time.
+ *
+ *	Every octave of bins has the same shape relative to its frequency, so one spectral kernel serves all of them. The signal is
+ *	repeatedly lowpassed and decimated by half-band filters, and each octave is analyzed at the lowest sample rate that still
+ *	contains it. A frame of an octave is an fft of its decimated signal, multiplied against a sparse kernel which holds the
+ *	spectrum of each bin's hann windowed atom, trimmed to where it is non-negligible. Long low frequency atoms therefore cost
+ *	no more than short high frequency ones, and no fft is ever larger than the kernel of a single octave.
+ *
+ *	Frames are centered every hop_size samples of the original signal. Decimated octaves see frame centers between samples,
+ *	which are handled exactly by a phase shift in the frequency domain. Atoms are centered on the frame time, so a sinusoid
+ *	between bins has the same phase in each of them, which the phase vocoder relies on.
+ *
+ *	The inverse applies the transposed kernel to each frame and overlap-adds the results, then upsamples the octaves and sums
+ *	them. Octaves and channels are independent, so analyze and synthesize can be run in parallel over both.
+ *
+ *	See "Constructing an invertible constant-Q transform with non-stationary Gabor frames" - Schörkhuber & Klapuri, 2010 - for
+ *	the general approach.
+ */
+class ConstantQ
+{
+public:
+	// A signal at each decimation level, level 0 being the original rate
+	using Levels = std::vector<std::vector<Sample>>;
+
+	/** \param bandwidth The frequency range covered. The top is limited to the Nyquist frequency.
+	 *	\param bins_per_octave The number of bins per octave.
+	 *	\param sample_rate The sample rate of the signals being transformed.
+	 *	\param hop_size Samples between frames. If this is 0, a quarter of the shortest atom is used, which is the largest hop
+	 *		that can be phase vocoded in every bin.
+	 */
+	ConstantQ( std::pair<Frequency, Frequency> bandwidth, Bin bins_per_octave, FrameRate sample_rate, Frame hop_size = 0 );
+
+	Bin get_num_bins() const;
+	Bin get_bins_per_octave() const;
+	Frame get_hop_size() const;
+	Frequency get_bin_frequency( Bin ) const;
+	Cycle get_Q() const;
+
+	/** The number of frames needed to cover num_samples samples, starting with a frame centered on the first sample.
+	 */
+	Frame get_num_frames( Frame num_samples ) const;
+
+	/** Octaves are numbered from the top of the bandwidth down. The lowest octave may have fewer bins than the rest.
+	 */
+	int get_num_octaves() const;
+
+	/** The bins of an octave, as [first, end).
+	 */
+	std::pair<Bin, Bin> get_octave_bins( int octave ) const;
+
+	/** Lowpasses and decimates a signal into every level used by the octaves.
+	 */
+	Levels decompose( const Sample * samples, Frame num_samples ) const;
+
+	/** Transforms one octave.
+	 *	\param octave The octave to analyze.
+	 *	\param levels The output of decompose.
+	 *	\param first_frame The first frame to compute. Frames can be computed in any order, so long files can be split up.
+	 *	\param num_frames The number of frames to compute.
+	 *	\param out The output, num_frames frames of the octave's bins, lowest bin first.
+	 */
+	void analyze( int octave, const Levels & levels, Frame first_frame, Frame num_frames, std::complex<float> * out ) const;
+
+	/** Inverts one octave.
+	 *	\param octave The octave to synthesize.
+	 *	\param in num_frames frames of the octave's bins, lowest bin first, as produced by analyze.
+	 *	\param num_frames The number of frames in in.
+	 *	\param num_samples The length of the final output, at the original rate.
+	 *	\return The octave's signal at its decimation level. Pass this to recompose.
+	 */
+	std::vector<Sample> synthesize( int octave, const std::complex<float> * in, Frame num_frames, Frame num_samples ) const;
+
+	/** Upsamples and sums the output of synthesize for every octave.
+	 *	\param octave_signals The synthesized signal of each octave, indexed by octave.
+	 *	\param out The output, num_samples samples at the original rate.
+	 */
+	void recompose( std::vector<std::vector<Sample>> && octave_signals, Sample * out, Frame num_samples ) const;
+
+private:
+	struct Kernel
+		{
+		Frame fft_size;
+
+		// Each row is the conjugated spectrum of one bin's atom over the fft bins it is non-negligible in. Rows are lowest
+		// first and cover a full octave.
+		struct Row
+			{
+			Bin first;
+			std::vector<std::complex<float>> values;
+			};
+		std::vector<Row> rows;
+
+		// The union of all row supports
+		Bin first;
+		Bin end;
+		};
+
+	struct Octave
+		{
+		int level; // Decimation level the octave is analyzed at
+		int kernel; // Index into kernels
+		Bin first_bin;
+		Bin end_bin;
+		Bin first_row; // The kernel row of first_bin, nonzero only for a partial lowest octave
+		};
+
+	Kernel make_kernel( double top_frequency ) const;
+
+	// Level sample positions of frame centers
+	double frame_center( const Octave &, Frame ) const;
+
+	Frame level_length( int level, Frame num_samples ) const;
+
+	const Bin bins_per_octave;
+	const FrameRate sample_rate;
+	Bin num_bins;
+	Frequency min_frequency;
+	Cycle Q;
+	Frame hop_size;
+
+	std::vector<Octave> octaves;
+	std::vector<Kernel> kernels;
+	std::vector<float> halfband; // Decimation filter
+};
+
+}
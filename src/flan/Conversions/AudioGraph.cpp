@@ -1,4 +1,5 @@
 #include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
 
 #include <flan/FFTHelper.h>
 #include <algorithm>
@@ -20,6 +21,7 @@ Graph Audio::convert_to_graph(
 	float timeline_scale 
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::convert_to_graph", *this );
 	if( is_null() ) return Graph( width, height );
 
 	if( I.x2 == -1 ) I.x2 = get_length();
@@ -48,6 +50,7 @@ Graph Audio::convert_to_graph(
 
 void Audio::save_to_bmp( const std::string & filename, Interval I, int width, int height ) const
 	{
+	flan_TRACE_SPAN( "Audio::save_to_bmp", *this );
 		auto b = convert_to_graph( I, width, height );
 	b.save_image( filename );
 	}
@@ -58,6 +61,7 @@ Graph Audio::convert_to_spectrum_graph(
 	Frame smoothing_frames
 	) const
 	{
+	flan_TRACE_SPAN( "Audio::convert_to_spectrum_graph", *this );
 	// Graph grid
 	Graph g( width, height );
 	const float spectrum_length_log = std::log2( get_sample_rate() / 2.0f );
@@ -130,5 +134,6 @@ void Audio::save_spectrum_to_bmp(
 	Frame smoothing_frames
 	) const	
 	{
+	flan_TRACE_SPAN( "Audio::save_spectrum_to_bmp", *this );
 		convert_to_spectrum_graph( width, height, smoothing_frames ).save_image( filename );
 	}
@@ -0,0 +1,358 @@
+#include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
+#include "flan/MRPV/MRPV.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <complex>
+
+#include "flan/FFTHelper.h"
+#include "flan/DSPUtility.h"
+#include "flan/WindowFunctions.h"
+#include "flan/phase_vocoder.h"
+#include "flan/Utility/execution.h"
+
+using namespace flan;
+
+// Frames transformed by one task. Analysis tasks transform one extra frame before their first to seed phase differences.
+static const Frame chunkFrames = 256;
+
+// Windows are never decimated shorter than this
+static const Frame minLevelWindow = 64;
+
+// Nonzero half-band coefficients on one side of the center tap. Bands only use the bottom half of a decimated level's band,
+// so the transition band is wide and a short filter is enough.
+static const int halfbandLength = 8;
+
+static Frame level_length( Frame num_samples, int level )
+	{
+	for( int l = 0; l < level; ++l )
+		num_samples = ( num_samples + 1 ) / 2;
+	return num_samples;
+	}
+
+static int get_level( const MRPV::Band & band )
+	{
+	return std::countr_zero( uint32_t( band.decimation ) );
+	}
+
+static std::vector<float> sample_hann( Frame window_size, float scale = 1 )
+	{
+	std::vector<float> window( window_size );
+	for( Frame i = 0; i < window_size; ++i )
+		window[i] = Windows::hann( float( i ) / float( window_size - 1 ) ) * scale;
+	return window;
+	}
+
+MRPV Audio::convert_to_MRPV( const std::vector<Frequency> & crossovers, const std::vector<Frame> & window_sizes, Frame overlaps,
+	flan_CANCEL_ARG_CPP ) const
+	{
+	flan_TRACE_SPAN( "Audio::convert_to_MRPV", *this );
+	if( is_null() ) return MRPV();
+
+	overlaps = std::max( overlaps, Frame( 4 ) );
+
+	// Band edges, highest first
+	std::vector<Frequency> edges;
+	std::copy_if( crossovers.begin(), crossovers.end(), std::back_inserter( edges ), [&]( Frequency f ){ return 0 < f && f < get_sample_rate() / 2; } );
+	std::sort( edges.begin(), edges.end(), std::greater<Frequency>() );
+	edges.erase( std::unique( edges.begin(), edges.end() ), edges.end() );
+	const int num_bands = edges.size() + 1;
+
+	// Each band is analyzed at the lowest rate that keeps its top, crossfade included, in the bottom half of the rate's band
+	std::vector<MRPV::Band> bands;
+	uint64_t num_cells = 0;
+	for( int b = 0; b < num_bands; ++b )
+		{
+		const Frequency high = b == 0 ? get_sample_rate() / 2 : edges[b-1];
+		const Frequency low = b < int( edges.size() ) ? edges[b] : 0;
+		const Frame window_size = power_of_2_container( std::max( window_sizes.empty() ? 2048 : window_sizes[std::min( b, int( window_sizes.size() ) - 1 )],
+			minLevelWindow ) );
+
+		const Frequency top = high * std::exp2( MRPV::crossfade_octaves / 2 );
+		const int max_level = std::countr_zero( uint32_t( window_size / minLevelWindow ) );
+		const int level = b == 0 ? 0 : std::clamp( int( std::floor( std::log2( get_sample_rate() / ( 4 * top ) ) ) ), 0, max_level );
+		const Frame level_window = window_size >> level;
+		const Frame hop = std::max( level_window / overlaps, Frame( 1 ) );
+
+		PVBuffer::Format format;
+		format.num_channels = get_num_channels();
+		format.num_frames = level_length( get_num_frames(), level ) / hop + 1;
+		format.num_bins = level_window + 1;
+		format.sample_rate = get_sample_rate() / ( 1 << level );
+		format.analysis_rate = format.sample_rate / hop;
+		format.window_size = level_window;
+		bands.push_back( { PV::create_from_format( format ), Frame( 1 << level ), low, high } );
+		num_cells += uint64_t( format.num_channels ) * format.num_frames * format.num_bins;
+		}
+	flan_RESERVE_POINT( num_cells * sizeof( MF ), MRPV() );
+	MRPV out( std::move( bands ), get_num_frames(), get_sample_rate() );
+
+	int num_levels = 0;
+	for( int b = 0; b < num_bands; ++b )
+		num_levels = std::max( num_levels, get_level( out.get_band( b ) ) + 1 );
+
+	// Per band windows and crossfade weights
+	std::vector<std::vector<float>> windows( num_bands ), weights( num_bands );
+	for( int b = 0; b < num_bands; ++b )
+		{
+		const PV & pv = out.get_band( b ).pv;
+		windows[b] = sample_hann( pv.get_window_size() );
+		weights[b].resize( pv.get_num_bins() );
+		for( Bin bin = 0; bin < pv.get_num_bins(); ++bin )
+			weights[b][bin] = out.get_band_weight( b, pv.bin_to_frequency( bin ) );
+		}
+
+	// Tasks are a run of frames in one band of one channel
+	struct Task { Channel channel; int band; Frame first_frame; };
+	std::vector<Task> tasks;
+	for( Channel channel = 0; channel < get_num_channels(); ++channel )
+		for( int b = 0; b < num_bands; ++b )
+			for( Frame frame = 0; frame < out.get_band( b ).pv.get_num_frames(); frame += chunkFrames )
+				tasks.push_back( { channel, b, frame } );
+
+	TaskProgress progress( context, "Audio::convert_to_MRPV", uint64_t( get_num_channels() ) + tasks.size() );
+
+	// Split each channel into its decimated levels
+	const std::vector<float> halfband = design_halfband( halfbandLength );
+	std::vector<std::vector<std::vector<Sample>>> levels( get_num_channels() );
+	flan::for_each_i( get_num_channels(), ExecutionPolicy::Parallel_Sequenced, [&]( Channel channel )
+		{
+		flan_CANCEL_POINT();
+		levels[channel].resize( num_levels );
+		levels[channel][0].assign( get_sample_pointer( channel, 0 ), get_sample_pointer( channel, 0 ) + get_num_frames() );
+		for( int level = 1; level < num_levels; ++level )
+			levels[channel][level] = halfband_decimate( levels[channel][level-1], halfband );
+		progress.advance();
+		} );
+	flan_CANCEL_POINT( MRPV() );
+
+	flan::for_each_i( tasks.size(), ExecutionPolicy::Parallel_Sequenced, [&]( int task_index )
+		{
+		flan_CANCEL_POINT();
+		const Task & task = tasks[task_index];
+		MRPV::Band & band = out.get_band( task.band );
+		PV & pv = band.pv;
+		const std::vector<Sample> & x = levels[task.channel][get_level( band )];
+		const Frame window_size = pv.get_window_size();
+		const Frame dft_size = pv.get_dft_size();
+		const Frame hop = std::round( pv.get_sample_rate() / pv.get_analysis_rate() );
+		const std::vector<float> & window = windows[task.band];
+
+		// Windows are centered on index 0 of the transform, so bin phases are measured at the frame time
+		FFTHelper::Lease fft = FFTHelper::acquire( dft_size, true, false );
+		auto transform = [&]( Frame frame )
+			{
+			std::fill( fft->real_begin(), fft->real_end(), 0.0f );
+			const Frame center = frame * hop;
+			for( Frame i = 0; i < window_size; ++i )
+				{
+				const Frame m = i - window_size / 2;
+				if( 0 <= center + m && center + m < Frame( x.size() ) )
+					fft->get_real_buffer()[( m + dft_size ) % dft_size] = x[center + m] * window[i];
+				}
+			fft->r2c_execute();
+			};
+
+		const size_t num_bins = pv.get_num_bins();
+		std::vector<Frequency> bin_frequencies( num_bins );
+		for( Bin bin = 0; bin < pv.get_num_bins(); ++bin )
+			bin_frequencies[bin] = pv.bin_to_frequency( bin );
+
+		std::vector<double> phase_buffer( num_bins, 0 );
+		if( task.first_frame > 0 )
+			{
+			transform( task.first_frame - 1 );
+			for( Bin bin = 0; bin < pv.get_num_bins(); ++bin )
+				phase_buffer[bin] = std::arg( fft->get_complex_buffer()[bin] );
+			}
+
+		const Frame end_frame = std::min( task.first_frame + chunkFrames, pv.get_num_frames() );
+		for( Frame frame = task.first_frame; frame < end_frame; ++frame )
+			{
+			transform( frame );
+			MF * mfs = pv.get_MF_pointer( task.channel, frame, 0 );
+			phase_vocoder_frame( { fft->get_complex_buffer(), num_bins }, phase_buffer, { mfs, num_bins }, bin_frequencies,
+				pv.get_analysis_rate(), pv.get_sample_rate(), context.get_accuracy() );
+			for( Bin bin = 0; bin < pv.get_num_bins(); ++bin )
+				mfs[bin].m *= weights[task.band][bin];
+			}
+		progress.advance();
+		} );
+	flan_CANCEL_POINT( MRPV() );
+
+	return out;
+	}
+
+MRPV Audio::convert_to_ms_MRPV( const std::vector<Frequency> & crossovers, const std::vector<Frame> & window_sizes, Frame overlaps,
+	flan_CANCEL_ARG_CPP ) const
+	{
+	flan_TRACE_SPAN( "Audio::convert_to_ms_MRPV", *this );
+	if( get_num_channels() != 2 ) return MRPV();
+	return convert_to_mid_side().convert_to_MRPV( crossovers, window_sizes, overlaps, context );
+	}
+
+Audio MRPV::convert_to_audio( flan_CANCEL_ARG_CPP ) const
+	{
+	flan_TRACE_SPAN( "MRPV::convert_to_audio" );
+	if( is_null() ) return Audio::create_null();
+
+	Audio::Format format;
+	format.num_channels = get_num_channels();
+	format.num_frames = get_num_audio_frames();
+	format.sample_rate = get_sample_rate();
+	flan_RESERVE_POINT( uint64_t( format.num_channels ) * format.num_frames * sizeof( Sample ) * 3, Audio::create_null() );
+	Audio out( format );
+
+	const int num_bands = get_num_bands();
+	int num_levels = 0;
+	for( int b = 0; b < num_bands; ++b )
+		num_levels = std::max( num_levels, get_level( get_band( b ) ) + 1 );
+
+	/*
+	Hann windowing twice, at a hop of window_size / overlaps, sums to 3 / 8 * overlaps. FFTW doesn't normalize, so the inverse
+	is also dft_size times too large. The synthesis window undoes both.
+	*/
+	std::vector<std::vector<float>> windows( num_bands );
+	for( int b = 0; b < num_bands; ++b )
+		{
+		const PV & pv = get_band( b ).pv;
+		const float hop = std::round( pv.get_sample_rate() / pv.get_analysis_rate() );
+		windows[b] = sample_hann( pv.get_window_size(), 8.0f * hop / ( 3.0f * pv.get_window_size() * pv.get_dft_size() ) );
+		}
+
+	struct Task { Channel channel; int band; Frame first_frame; };
+	std::vector<Task> tasks;
+	std::vector<std::vector<int>> band_tasks( get_num_channels() * num_bands ); // Task indices of each channel and band
+	for( Channel channel = 0; channel < get_num_channels(); ++channel )
+		for( int b = 0; b < num_bands; ++b )
+			for( Frame frame = 0; frame < get_band( b ).pv.get_num_frames(); frame += chunkFrames )
+				{
+				band_tasks[channel * num_bands + b].push_back( tasks.size() );
+				tasks.push_back( { channel, b, frame } );
+				}
+
+	TaskProgress progress( context, "MRPV::convert_to_audio", uint64_t( get_num_channels() ) * num_bands * 2 + tasks.size() );
+
+	/*
+	Synthesis phase is accumulated from frame 0, where it is 0, so a stationary partial has the same phase at the same time in
+	every band, whatever their hops. That keeps partials coherent across crossfades. Accumulating is cheap next to the
+	transforms, so it is done for whole bands first, and each task starts from the phase recorded just before its first frame
+	advances it. Frame 0 doesn't advance, so its tasks start a frame's advance behind 0.
+	*/
+	std::vector<std::vector<double>> start_phases( tasks.size() );
+	flan::for_each_i( get_num_channels() * num_bands, ExecutionPolicy::Parallel_Sequenced, [&]( int index )
+		{
+		flan_CANCEL_POINT();
+		const Channel channel = index / num_bands;
+		const PV & pv = get_band( index % num_bands ).pv;
+		std::vector<double> phase_buffer( pv.get_num_bins(), 0 );
+		for( Frame frame = 0; frame < pv.get_num_frames(); ++frame )
+			{
+			const MF * mfs = pv.get_MF_pointer( channel, frame, 0 );
+			if( frame % chunkFrames == 0 )
+				{
+				std::vector<double> & start_phase = start_phases[band_tasks[index][frame / chunkFrames]];
+				start_phase = phase_buffer;
+				if( frame == 0 )
+					for( Bin bin = 0; bin < pv.get_num_bins(); ++bin )
+						start_phase[bin] = -double( mfs[bin].f ) / pv.get_analysis_rate() * pi2;
+				}
+			if( frame > 0 )
+				for( Bin bin = 0; bin < pv.get_num_bins(); ++bin )
+					{
+					phase_buffer[bin] += mfs[bin].f / pv.get_analysis_rate() * pi2;
+					if( phase_buffer[bin] > pi2 ) phase_buffer[bin] = std::fmod( phase_buffer[bin], pi2 );
+					}
+			}
+		progress.advance();
+		} );
+	flan_CANCEL_POINT( Audio::create_null() );
+
+	// Each task overlap-adds its frames into its own buffer, starting half a window before its first frame
+	std::vector<std::vector<Sample>> task_outputs( tasks.size() );
+	flan::for_each_i( tasks.size(), ExecutionPolicy::Parallel_Sequenced, [&]( int task_index )
+		{
+		flan_CANCEL_POINT();
+		const Task & task = tasks[task_index];
+		const PV & pv = get_band( task.band ).pv;
+		const Frame window_size = pv.get_window_size();
+		const Frame dft_size = pv.get_dft_size();
+		const Frame hop = std::round( pv.get_sample_rate() / pv.get_analysis_rate() );
+		const std::vector<float> & window = windows[task.band];
+		const Frame end_frame = std::min( task.first_frame + chunkFrames, pv.get_num_frames() );
+
+		std::vector<Sample> & task_out = task_outputs[task_index];
+		task_out.assign( size_t( end_frame - 1 - task.first_frame ) * hop + window_size, 0.0f );
+
+		std::vector<double> & phase_buffer = start_phases[task_index];
+		FFTHelper::Lease fft = FFTHelper::acquire( dft_size, false, true );
+		for( Frame frame = task.first_frame; frame < end_frame; ++frame )
+			{
+			inverse_phase_vocoder_frame( { pv.get_MF_pointer( task.channel, frame, 0 ), size_t( pv.get_num_bins() ) }, phase_buffer,
+				{ fft->get_complex_buffer(), size_t( pv.get_num_bins() ) }, pv.get_analysis_rate(), context.get_accuracy() );
+			fft->c2r_execute();
+
+			// The transform output is centered on index 0, as in analysis
+			Sample * dest = task_out.data() + ( frame - task.first_frame ) * hop;
+			for( Frame i = 0; i < window_size; ++i )
+				dest[i] += fft->get_real_buffer()[( i - window_size / 2 + dft_size ) % dft_size] * window[i];
+			}
+		std::vector<double>().swap( phase_buffer );
+		progress.advance();
+		} );
+	flan_CANCEL_POINT( Audio::create_null() );
+
+	// Sum tasks into band signals at their level
+	std::vector<std::vector<Sample>> band_signals( get_num_channels() * num_bands );
+	flan::for_each_i( get_num_channels() * num_bands, ExecutionPolicy::Parallel_Sequenced, [&]( int index )
+		{
+		const MRPV::Band & band = get_band( index % num_bands );
+		const Frame hop = std::round( band.pv.get_sample_rate() / band.pv.get_analysis_rate() );
+		std::vector<Sample> & signal = band_signals[index];
+		signal.assign( level_length( get_num_audio_frames(), get_level( band ) ), 0.0f );
+		for( const int task_index : band_tasks[index] )
+			{
+			const Frame start = tasks[task_index].first_frame * hop - band.pv.get_window_size() / 2;
+			const std::vector<Sample> & task_out = task_outputs[task_index];
+			const Frame first = std::max( -start, Frame( 0 ) );
+			const Frame end = std::min( Frame( task_out.size() ), Frame( signal.size() ) - start );
+			for( Frame i = first; i < end; ++i )
+				signal[start + i] += task_out[i];
+			std::vector<Sample>().swap( task_outputs[task_index] );
+			}
+		progress.advance();
+		} );
+
+	// Upsample and sum bands
+	const std::vector<float> halfband = design_halfband( halfbandLength );
+	flan::for_each_i( get_num_channels(), ExecutionPolicy::Parallel_Sequenced, [&]( Channel channel )
+		{
+		std::vector<Sample> lower;
+		for( int level = num_levels - 1; level >= 0; --level )
+			{
+			std::vector<Sample> sum( level_length( get_num_audio_frames(), level ), 0.0f );
+			if( !lower.empty() )
+				halfband_interpolate_add( lower, sum, halfband );
+			for( int b = 0; b < num_bands; ++b )
+				if( get_level( get_band( b ) ) == level )
+					{
+					std::vector<Sample> & signal = band_signals[channel * num_bands + b];
+					std::transform( sum.begin(), sum.end(), signal.begin(), sum.begin(), std::plus<Sample>() );
+					std::vector<Sample>().swap( signal );
+					}
+			lower = std::move( sum );
+			}
+		std::copy( lower.begin(), lower.end(), out.get_sample_pointer( channel, 0 ) );
+		} );
+
+	return out;
+	}
+
+Audio MRPV::convert_to_lr_audio( flan_CANCEL_ARG_CPP ) const
+	{
+	flan_TRACE_SPAN( "MRPV::convert_to_lr_audio" );
+	if( get_num_channels() != 2 ) return Audio::create_null();
+	return convert_to_audio( context ).convert_to_left_right();
+	}
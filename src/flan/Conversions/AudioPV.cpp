@@ -1,4 +1,5 @@
 #include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
 #include "flan/PV/PV.h"
 
 #include <iostream>
@@ -11,6 +12,7 @@ using namespace flan;
 
 PV Audio::convert_to_PV( Frame window_size, Frame hopSize, Frame dft_size, flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "Audio::convert_to_PV", *this );
 	
 	const Bin num_bins = dft_size / 2 + 1;
 	//+1 since we analyze at start and end times
@@ -24,6 +26,7 @@ PV Audio::convert_to_PV( Frame window_size, Frame hopSize, Frame dft_size, flan_
 	PVFormat.sample_rate = get_sample_rate();
 	PVFormat.analysis_rate = get_sample_rate() / hopSize;
 	PVFormat.window_size = window_size;
+	flan_RESERVE_POINT( uint64_t( PVFormat.num_channels ) * PVFormat.num_frames * PVFormat.num_bins * sizeof( MF ), PV() );
 	PV out( PVFormat );
 
 	// Sample hann window
@@ -35,7 +38,13 @@ PV Audio::convert_to_PV( Frame window_size, Frame hopSize, Frame dft_size, flan_
 
 	// Allocate fft buffers and phase buffer
 	std::vector<double> phase_buffer( num_bins );
-	FFTHelper fft( dft_size, true, false, false );
+	auto fft = FFTHelper::acquire( dft_size, true, false );
+
+	std::vector<Frequency> bin_frequencies( num_bins );
+	for( Bin bin = 0; bin < num_bins; ++bin )
+		bin_frequencies[bin] = out.bin_to_frequency( bin );
+
+	TaskProgress progress( context, "Audio::convert_to_PV", uint64_t( get_num_channels() ) * numHops );
 
 	// For each channel, do the whole thing
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
@@ -59,18 +68,18 @@ PV Audio::convert_to_PV( Frame window_size, Frame hopSize, Frame dft_size, flan_
 
 			// Copy windowed signal into start of fft buffer
 			for( Frame fftFrame = 0; fftFrame < window_size; ++fftFrame )
-				fft.get_real_buffer()[fftFrame] = safe_get_sample( in_frameStart + fftFrame ) * hann_window[fftFrame];
+				fft->get_real_buffer()[fftFrame] = safe_get_sample( in_frameStart + fftFrame ) * hann_window[fftFrame];
 
 			// Fill the rest of the buffer with 0
-			std::fill( fft.real_begin() + window_size, fft.real_end(), 0 );
+			std::fill( fft->real_begin() + window_size, fft->real_end(), 0 );
 	
-			fft.r2c_execute();
+			fft->r2c_execute();
+
+			phase_vocoder_frame( { fft->get_complex_buffer(), size_t( num_bins ) }, phase_buffer, 
+				{ out.get_MF_pointer( channel, pvFrame, 0 ), size_t( num_bins ) }, bin_frequencies, 
+				out.get_analysis_rate(), out.get_sample_rate(), context.get_accuracy() );
 
-			std::for_each( FLAN_PAR_UNSEQ iota_iter(0), iota_iter(num_bins), [&]( Bin bin )
-				{
-				out.get_MF( channel, pvFrame, bin ) = phase_vocoder( phase_buffer[bin], fft.get_complex_buffer()[bin], 
-					out.bin_to_frequency( bin ), out.get_analysis_rate(), out.get_sample_rate() );
-				} );
+			progress.advance();
 			}
 		}
 
@@ -79,12 +88,14 @@ PV Audio::convert_to_PV( Frame window_size, Frame hopSize, Frame dft_size, flan_
 
 PV Audio::convert_to_ms_PV( Frame window_size, Frame hop, Frame dft_size, flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "Audio::convert_to_ms_PV", *this );
 	if( get_num_channels() != 2 ) return PV();
-	return convert_to_mid_side().convert_to_PV( window_size, hop, dft_size, canceller );
+	return convert_to_mid_side().convert_to_PV( window_size, hop, dft_size, context );
 	}
 
 Audio PV::convert_to_audio( flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "PV::convert_to_audio", *this );
 	if( is_nan_or_inf() )
 		std::cout << "flan::convert_to_audio recieved a nan or infinite value. This often happens when dividing by zero in an earlier algorithm.";
 
@@ -92,6 +103,7 @@ Audio PV::convert_to_audio( flan_CANCEL_ARG_CPP ) const
 	audio_format.num_channels = get_num_channels();
 	audio_format.num_frames = get_num_frames() * get_hop_size();
 	audio_format.sample_rate = get_sample_rate();
+	flan_RESERVE_POINT( uint64_t( audio_format.num_channels ) * audio_format.num_frames * sizeof( Sample ), Audio::create_null() );
 	Audio out( audio_format );
 
 	// Sample hann window
@@ -103,7 +115,9 @@ Audio PV::convert_to_audio( flan_CANCEL_ARG_CPP ) const
 		} );
 
 	std::vector<double> phase_buffer( get_num_bins() );
-	FFTHelper fft( get_dft_size(), false, true, false );
+	auto fft = FFTHelper::acquire( get_dft_size(), false, true );
+
+	TaskProgress progress( context, "PV::convert_to_audio", uint64_t( get_num_channels() ) * get_num_frames() );
 
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
 		{
@@ -114,12 +128,10 @@ Audio PV::convert_to_audio( flan_CANCEL_ARG_CPP ) const
 			{
 			flan_CANCEL_POINT( Audio::create_null() );
 
-			std::for_each( FLAN_PAR_UNSEQ iota_iter(0), iota_iter( get_num_bins() ), [&]( Bin bin )
-				{
-				fft.get_complex_buffer()[bin] = inverse_phase_vocoder( phase_buffer[bin], get_MF( channel, pv_frame, bin ), get_analysis_rate() );
-				} );
+			inverse_phase_vocoder_frame( { get_MF_pointer( channel, pv_frame, 0 ), size_t( get_num_bins() ) }, phase_buffer, 
+				{ fft->get_complex_buffer(), size_t( get_num_bins() ) }, get_analysis_rate(), context.get_accuracy() );
 
-			fft.c2r_execute();
+			fft->c2r_execute();
 
 			// Accumulate ifft output into audio buffer
 			const Frame out_frameStart = get_hop_size() * pv_frame - get_window_size() / 2;
@@ -131,7 +143,9 @@ Audio PV::convert_to_audio( flan_CANCEL_ARG_CPP ) const
 			const Frame fftEnd = out_frameEnd_bounded - out_frameStart;
 
 			for( Frame fftFrame = fftStart; fftFrame < fftEnd; ++fftFrame )
-				out.get_sample( channel, out_frameStart + fftFrame ) += fft.get_real_buffer()[fftFrame] * hann_window[fftFrame];
+				out.get_sample( channel, out_frameStart + fftFrame ) += fft->get_real_buffer()[fftFrame] * hann_window[fftFrame];
+
+			progress.advance();
 			}
 		}
 
@@ -140,6 +154,7 @@ Audio PV::convert_to_audio( flan_CANCEL_ARG_CPP ) const
 	
 Audio PV::convert_to_lr_audio( flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "PV::convert_to_lr_audio", *this );
 	if( get_num_channels() != 2 ) return Audio::create_null();
-	return convert_to_audio( canceller ).convert_to_left_right();
+	return convert_to_audio( context ).convert_to_left_right();
 	}
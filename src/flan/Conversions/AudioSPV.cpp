@@ -1,150 +1,233 @@
 #include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
 #include "flan/SPV/SPV.h"
 
 #include <cmath>
+#include <array>
+#include <numeric>
 #include <execution>
 
 #include "flan/Utility/iota_iter.h"
 #include "flan/defines.h"
 #include "flan/phase_vocoder.h"
+#include "flan/SlidingDFT.h"
 
 using namespace flan;
 
-static std::vector<std::complex<float>> createTwiddles( size_t n, Magnitude magnitude )
+SPV Audio::convert_to_SPV( Bin num_bins, Frame decimation, flan_CANCEL_ARG_CPP ) const 
 	{
-	std::vector<std::complex<float>> twiddles( n );
-    const Radian omega = -pi2 / n;
-	flan::for_each_i( twiddles.size(), ExecutionPolicy::Parallel_Unsequenced, [&]( int i )
-		{
-      	twiddles[i] = std::polar( magnitude, omega * i);
-		} );
-	return twiddles;
-	}
+	flan_TRACE_SPAN( "Audio::convert_to_SPV", *this );
+	if( is_null() ) return SPV();
 
-SPV Audio::convert_to_SPV( Bin num_bins ) const 
-	{
+	num_bins = std::max( num_bins, Bin( 2 ) );
+	decimation = std::max( decimation, Frame( 1 ) );
 		
 	SPV::Format format;
 	format.num_channels = get_num_channels();
-	format.num_frames = get_num_frames();
+	format.num_frames = ( get_num_frames() + decimation - 1 ) / decimation;
 	format.num_bins = num_bins;
 	format.sample_rate = get_sample_rate();
+	format.decimation = decimation;
+	flan_RESERVE_POINT( uint64_t( format.num_channels ) * format.num_frames * format.num_bins * sizeof( MF ), SPV() );
 	SPV out( format );
 
-	auto buffer_access = [&]( Frame f, Bin b ){ return f * out.get_num_bins() + b; };
+	// Time is split into segments which are transformed independently. Each segment starts its own SlidingDFT a window early,
+	// so its first frame sees a full window of history. This also keeps running sum rounding error from building up over a file.
+	const Frame window_size = 2 * num_bins;
+	const Frame warmup = ( window_size + decimation - 1 ) / decimation * decimation;
+	const Frame segment_frames = std::max( 16 * window_size / decimation, Frame( 64 ) );
+	const int num_segments = ( out.get_num_frames() + segment_frames - 1 ) / segment_frames;
 
-	// nth roots of unity for n = 2 * dftsize, clockwise order
-	const auto twiddles = createTwiddles( 2 * num_bins, 1.0f );
-	auto getFiddle = [&]( Frame f, Bin b ) { return twiddles[ ( f * b ) % twiddles.size() ]; };
+	TaskProgress progress( context, "Audio::convert_to_SPV", uint64_t( get_num_channels() ) * ( num_segments + 1 ) );
 
-	for( Channel channel = 0; channel < get_num_channels(); ++channel )
-		{
-		// Dirty buffer reuse. MF and complex<float> have the same data layout so this works and avoids a massive alloc.
-		std::complex<float> * sdftBuffer = (std::complex<float> *)( out.get_buffer().data() + out.get_buffer_pos( channel, 0, 0 ) );
-
-		// Compute sample deltas
-		std::vector<Sample> deltas( get_num_frames() );
-		flan::for_each_i( deltas.size(), ExecutionPolicy::Parallel_Unsequenced, [&]( Frame frame )
-			{
-			auto samples_s = [&]( Channel c, Frame f ){ return f >= 0 ? get_sample( c, f ) : Sample( 0 ); };
-			deltas[frame] = get_sample( channel, frame ) - samples_s( channel, frame - 2 * out.get_num_bins() );
-			});
+	// Dirty buffer reuse. MF and complex<float> have the same data layout, so the transform is written straight into out and
+	// phase vocoded in place, which avoids a massive alloc.
+	auto sdft_frame = [&]( Channel channel, Frame frame )
+		{ 
+		return (std::complex<float> *)( out.get_buffer().data() + out.get_buffer_pos( channel, frame, 0 ) ); 
+		};
 
-		// Compute partial sums of fiddled deltas into out (out is being reused here to avoid a buffer alloc)
-		flan::for_each_i( out.get_num_bins(), ExecutionPolicy::Parallel_Unsequenced, [&]( Bin bin )
+	flan::for_each_i( get_num_channels() * num_segments, ExecutionPolicy::Parallel_Sequenced, [&]( int task )
+		{
+		flan_CANCEL_POINT();
+		const Channel channel = task / num_segments;
+		const Frame first_frame = ( task % num_segments ) * segment_frames;
+		const Frame end_frame = std::min( first_frame + segment_frames, out.get_num_frames() );
+		const Frame start_sample = first_frame * decimation;
+		const Frame end_sample = ( end_frame - 1 ) * decimation + 1;
+		const Frame segment_warmup = std::min( warmup, start_sample ); // Both are multiples of decimation, so frames stay aligned
+		const Sample * samples = get_sample_pointer( channel, 0 );
+
+		SlidingDFT sdft( num_bins, decimation );
+		sdft.process( samples + start_sample - segment_warmup, segment_warmup, []( const std::complex<float> * ){} );
+		Frame frame = first_frame;
+		sdft.process( samples + start_sample, end_sample - start_sample, [&]( const std::complex<float> * bins )
 			{
-			sdftBuffer[buffer_access( 0, bin )] = deltas[0];
-			for( Frame frame = 1; frame < get_num_frames(); ++frame )
-				sdftBuffer[buffer_access( frame, bin )] = sdftBuffer[buffer_access( frame - 1, bin )] + deltas[frame] * getFiddle( frame, bin );
+			std::copy( bins, bins + num_bins, sdft_frame( channel, frame++ ) );
 			} );
+		progress.advance();
+		} );
+	flan_CANCEL_POINT( SPV() );
 
-		// For each frame simultaneously, a circular buffer, fiddled, is allocated with three elements
-		// We then iterate through the bins of that frame computing the fiddled values into that buffer
-		// Each set of three values in then convolved into the output for that frame and bin
-		// The first and last bins are handled differently because there aren't three fiddled values to convolve there
-		flan::for_each_i( get_num_frames(), ExecutionPolicy::Parallel_Unsequenced, [&]( Frame frame )
-			{
-			std::complex<float> fiddled[3];
-			fiddled[1] = sdftBuffer[buffer_access( frame, 0 )] * std::conj(getFiddle( frame + 1, 0 ));
-			fiddled[2] = sdftBuffer[buffer_access( frame, 1 )] * std::conj(getFiddle( frame + 1, 1 ));
-
-			// Convolve for bin = 0
-			const std::complex<float> aStart = fiddled[1] + fiddled[1];
-			const std::complex<float> bStart = fiddled[2].real() * 2.0f;
-			const std::complex<float> convolvedStart = 0.25f * (aStart - bStart);
-			sdftBuffer[buffer_access( frame, 0 )] = convolvedStart / float( out.get_num_bins() * 2 );
-
-			for( Bin bin = 1; bin < out.get_num_bins() - 1; ++bin )
-				{
-				fiddled[(bin + 2) % 3] = sdftBuffer[buffer_access( frame, bin + 1 )] * std::conj(getFiddle( frame + 1, bin + 1 ));
-
-				const std::complex<float> a = fiddled[(bin + 1) % 3] + fiddled[(bin + 1) % 3];
-				const std::complex<float> b = fiddled[(bin + 0) % 3] + fiddled[(bin + 2) % 3];
-				const std::complex<float> convolved = 0.25f * (a - b);
-				sdftBuffer[buffer_access( frame, bin )] = convolved / float( out.get_num_bins() * 2 );
-				}
+	// Phase vocode sdft data. Bins are split into tiles, and each frame of a tile is one call to the frame kernel.
+	const Bin tile_bins = 256;
+	const Bin num_tiles = ( num_bins + tile_bins - 1 ) / tile_bins;
+	std::vector<Frequency> bin_frequencies( num_bins );
+	for( Bin bin = 0; bin < num_bins; ++bin )
+		bin_frequencies[bin] = out.bin_to_frequency( bin );
 
-			// Convolve for bin = dft_size - 1 (the last bin)
-			const std::complex<float> aEnd = fiddled[(out.get_num_bins()-1 + 1) % 3] + fiddled[(out.get_num_bins()-1 + 1) % 3];
-			const std::complex<float> bEnd = fiddled[(out.get_num_bins()-1 + 0) % 3].real() * 2.0f;
-			const std::complex<float> convolvedEnd = 0.25f * (aEnd - bEnd);
-			sdftBuffer[buffer_access( frame, out.get_num_bins()-1 )] = convolvedEnd / float( out.get_num_bins() * 2 );
-			} );	
-	
-		// Phase vocode sdft data
-		flan::for_each_i( out.get_num_bins(), ExecutionPolicy::Parallel_Unsequenced, [&]( Bin bin )		
+	for( Channel channel = 0; channel < get_num_channels(); ++channel )
+		{
+		flan::for_each_i( num_tiles, ExecutionPolicy::Parallel_Sequenced, [&]( int tile )
 			{
-			double phase_buffer = 0;
-			const Frequency binFrequency = out.bin_to_frequency( bin );
+			flan_CANCEL_POINT();
+			const Bin start_bin = tile * tile_bins;
+			const size_t width = std::min( tile_bins, num_bins - start_bin );
+			std::vector<double> phase_buffer( width, 0 );
+			std::vector<MF> mfs( width );
 			for( Frame frame = 0; frame < out.get_num_frames(); ++frame )
-				out.get_MF( channel, frame, bin ) = phase_vocoder( phase_buffer, sdftBuffer[ frame * num_bins + bin ], binFrequency, 
-					out.get_analysis_rate(), out.get_sample_rate() );
+				{
+				// The kernel writes to scratch, as writing over its own input would stop it vectorizing
+				phase_vocoder_frame( { sdft_frame( channel, frame ) + start_bin, width }, phase_buffer, mfs, 
+					{ bin_frequencies.data() + start_bin, width }, out.get_analysis_rate(), out.get_sample_rate(), context.get_accuracy() );
+				std::copy( mfs.begin(), mfs.end(), &out.get_MF( channel, frame, start_bin ) );
+				}
 			} );
+		flan_CANCEL_POINT( SPV() );
+		progress.advance();
 		}
 
 	return out;
 	}
 
-SPV Audio::convert_to_ms_SPV( Frame dft_size ) const
+SPV Audio::convert_to_ms_SPV( Frame dft_size, Frame decimation, flan_CANCEL_ARG_CPP ) const
 	{
-	return convert_to_mid_side().convert_to_SPV( dft_size );
+	flan_TRACE_SPAN( "Audio::convert_to_ms_SPV", *this );
+	return convert_to_mid_side().convert_to_SPV( dft_size, decimation, context );
 	}
 
-Audio SPV::convert_to_audio()
+Audio SPV::convert_to_audio( flan_CANCEL_ARG_CPP )
 	{
+	flan_TRACE_SPAN( "SPV::convert_to_audio", *this );
+	if( is_null() ) return Audio::create_null();
+
+	const Frame decimation = get_decimation();
+	const Bin num_bins = get_num_bins();
+
+	// Time is split into segments which are synthesized in parallel. Each needs the phase of every bin where it starts, which 
+	// comes from a cheap pass summing phase advances per segment.
+	const Frame segment_frames = std::max( ( 1 << 14 ) / decimation, Frame( 1 ) );
+	const int num_segments = ( get_num_frames() + segment_frames - 1 ) / segment_frames;
 	
 	Audio::Format format;
 	format.num_channels = get_num_channels();
-	format.num_frames = get_num_frames();
+	format.num_frames = get_num_frames() * decimation;
 	format.sample_rate = get_sample_rate();
+	flan_RESERVE_POINT( uint64_t( format.num_channels ) * format.num_frames * sizeof( Sample ) 
+		+ uint64_t( num_segments ) * num_bins * sizeof( double ), Audio::create_null() );
 	Audio out( format );
 
-	std::vector<std::complex<float>> isdftIn( get_num_frames() * get_num_bins(), 0 );
+	TaskProgress progress( context, "SPV::convert_to_audio", uint64_t( get_num_channels() ) * num_segments * 2 );
+
+	auto wrap = []( double phase ){ return std::abs( phase ) > pi2 ? std::fmod( phase, pi2 ) : phase; };
+	auto phase_advance = [&]( Frequency f ){ return double( f ) / get_sample_rate() * pi2; }; // Per sample
+
+	// Bins are summed in groups of this many, so the sum vectorizes
+	const int lanes = 16;
+	const Bin padded_bins = ( num_bins + lanes - 1 ) / lanes * lanes;
+
+	std::vector<double> segment_phases( size_t( num_segments ) * num_bins );
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
 		{
-		// Invert phase vocoding
-		flan::for_each_i( get_num_bins(), ExecutionPolicy::Parallel_Unsequenced, [&]( Bin bin )		
+		// Sum each segment's phase advance per bin, then turn the sums into the phase at each segment start
+		flan::for_each_i( num_segments, ExecutionPolicy::Parallel_Unsequenced, [&]( int segment )
 			{
-			double phase_buffer = 0;
-			for( Frame frame = 0; frame < get_num_frames(); ++frame )
-				isdftIn[get_buffer_pos( 0, frame, bin)] = inverse_phase_vocoder( phase_buffer, get_MF( channel, frame, bin ), get_analysis_rate() );
+			flan_CANCEL_POINT();
+			double * phases = segment_phases.data() + size_t( segment ) * num_bins;
+			std::fill( phases, phases + num_bins, 0.0 );
+			const Frame end_frame = std::min( ( segment + 1 ) * segment_frames, get_num_frames() );
+			for( Frame frame = segment * segment_frames; frame < end_frame; ++frame )
+				for( Bin bin = 0; bin < num_bins; ++bin )
+					phases[bin] = wrap( phases[bin] + phase_advance( get_MF( channel, frame, bin ).f ) * decimation );
+			progress.advance();
 			} );
-
-		// Invert sdft
-		flan::for_each_i( out.get_num_frames(), ExecutionPolicy::Parallel_Unsequenced, [&]( Frame frame )
+		flan_CANCEL_POINT( Audio::create_null() );
+		for( Bin bin = 0; bin < num_bins; ++bin )
 			{
-			float sample = 0.0f;
-			for( Bin bin = 0; bin < get_num_bins(); ++bin )
-				sample += isdftIn[get_buffer_pos( 0, frame, bin)].real() * ( bin % 2 == 0 ? 1 : -1 );
+			double phase = 0;
+			for( int segment = 0; segment < num_segments; ++segment )
+				{
+				double & segment_phase = segment_phases[size_t( segment ) * num_bins + bin];
+				const double advance = segment_phase;
+				segment_phase = phase;
+				phase = wrap( phase + advance );
+				}
+			}
 
-			out.get_sample( channel, frame ) = sample * 2.0f;
+		// Invert phase vocoding and sdft together. Each bin is an oscillator holding its frame's frequency, with magnitude 
+		// moving linearly to the next frame's, and every sample is the alternating sum of all oscillators.
+		flan::for_each_i( num_segments, ExecutionPolicy::Parallel_Sequenced, [&]( int segment )
+			{
+			flan_CANCEL_POINT();
+			std::vector<double> phases( segment_phases.begin() + size_t( segment ) * num_bins, 
+				segment_phases.begin() + size_t( segment + 1 ) * num_bins );
+			std::vector<float> amp( padded_bins, 0.0f ), slope( padded_bins, 0.0f );
+			std::vector<float> rot_re( padded_bins, 0.0f ), rot_im( padded_bins, 0.0f );
+			std::vector<float> step_re( padded_bins, 1.0f ), step_im( padded_bins, 0.0f );
+
+			const Frame end_frame = std::min( ( segment + 1 ) * segment_frames, get_num_frames() );
+			for( Frame frame = segment * segment_frames; frame < end_frame; ++frame )
+				{
+				Sample * samples = out.get_sample_pointer( channel, frame * decimation );
+				for( Bin bin = 0; bin < num_bins; ++bin )
+					{
+					const MF mf = get_MF( channel, frame, bin );
+					const Magnitude next_m = frame + 1 < get_num_frames() ? get_MF( channel, frame + 1, bin ).m : mf.m;
+					const float sign = bin % 2 == 0 ? 1.0f : -1.0f;
+					const double omega = phase_advance( mf.f );
+					amp[bin] = sign * mf.m;
+					slope[bin] = sign * ( next_m - mf.m ) / decimation;
+					if( decimation == 1 ) // Without decimation this is the oscillator's value after one sample, and the step is left as identity
+						{
+						phases[bin] = wrap( phases[bin] + omega );
+						rot_re[bin] = std::cos( float( phases[bin] ) );
+						}
+					else
+						{
+						rot_re[bin] = std::cos( phases[bin] );
+						rot_im[bin] = std::sin( phases[bin] );
+						step_re[bin] = std::cos( omega );
+						step_im[bin] = std::sin( omega );
+						phases[bin] = wrap( phases[bin] + omega * decimation );
+						}
+					}
+
+				for( Frame i = 0; i < decimation; ++i )
+					{
+					std::array<float, lanes> sums{};
+					for( Bin base = 0; base < padded_bins; base += lanes )
+						for( int lane = 0; lane < lanes; ++lane )
+							{
+							const Bin bin = base + lane;
+							const float re = rot_re[bin] * step_re[bin] - rot_im[bin] * step_im[bin];
+							const float im = rot_re[bin] * step_im[bin] + rot_im[bin] * step_re[bin];
+							rot_re[bin] = re;
+							rot_im[bin] = im;
+							sums[lane] += ( amp[bin] + slope[bin] * i ) * rot_re[bin];
+							}
+					samples[i] = std::accumulate( sums.begin(), sums.end(), 0.0f ) * 2.0f;
+					}
+				}
+			progress.advance();
 			} );
+		flan_CANCEL_POINT( Audio::create_null() );
 		}
 
 	return out;
 	}
 
-Audio SPV::convert_to_lr_audio()
+Audio SPV::convert_to_lr_audio( flan_CANCEL_ARG_CPP )
 	{
-	return convert_to_audio().convert_to_left_right();
+	flan_TRACE_SPAN( "SPV::convert_to_lr_audio", *this );
+	return convert_to_audio( context ).convert_to_left_right();
 	}
@@ -1,171 +1,150 @@
-// #include "flan/Audio/Audio.h"
-// #include "flan/SQPV/SQPV.h"
-
-// #include <algorithm>
-// #include <cassert>
-// #include <cmath>
-// #include <complex>
-// #include <cstdlib>
-// #include <deque>
-// #include <map>
-// #include <iostream>
-
-// #include "flan/phase_vocoder.h"
-
-// using namespace flan;
-
-// // Container for three complex numbers with component-wise arithmetic overloads
-// template<typename T>
-// struct Twiddle 
-// 	{
-// 	using cpx = std::complex<T>;
-// 	std::array<cpx, 3> data;
-// 	cpx & operator[]( size_t i ) { return data[i]; }
-// 	const cpx & operator[]( size_t i ) const { return data[i]; }
-
-// 	Twiddle operator+( const Twiddle & other ) const
-// 		{
-// 		return {
-// 			data[0] + other.data[0],
-// 			data[1] + other.data[1],
-// 			data[2] + other.data[2],
-// 			};
-// 		};
-	
-// 	Twiddle operator*( const Twiddle & other ) const
-// 		{
-// 		return {
-// 			data[0] * other.data[0],
-// 			data[1] * other.data[1],
-// 			data[2] * other.data[2],
-// 			};
-// 		};
-
-// 	Twiddle operator+( cpx x ) const
-// 		{
-// 		return {
-// 			data[0] + x,
-// 			data[1] + x,
-// 			data[2] + x,
-// 			};
-// 		}
-// 	};
-
-// template<typename T>
-// static inline Twiddle<T> make_twiddle( T quality, T period )
-// 	{
-// 	return {
-// 		std::polar( T( 1 ), pi2 * ( quality - 1 ) / period ),
-// 		std::polar( T( 1 ), pi2 * ( quality + 0 ) / period ),
-// 		std::polar( T( 1 ), pi2 * ( quality + 1 ) / period ),
-// 		};
-// 	}
-
-// SQPV Audio::convert_to_SQPV( std::pair<Frequency, Frequency> bandwidth, Bin bins_per_octave ) const
-// 	{
-// 	/*
-// 	See "Sliding With A Constant-Q" - https://www.dafx.de/paper-archive/2008/papers/dafx08_63.pdf - for details on this algorithm.
-// 	*/
-
-// 	
-// 	SQPV::Format format;
-// 	format.num_channels = get_num_channels();
-// 	format.num_frames = get_num_frames();
-// 	format.bins_per_octave = bins_per_octave;
-// 	format.bandwidth = bandwidth;
-// 	format.sample_rate = get_sample_rate();
-// 	SQPV out( format );
-
-// 	std::pair<double, double> window = std::make_pair( 0.5, -0.5 ); // hann window
-// 	const Frame N = out.getPeriod( 0 );	
-// 	const std::complex<double> fiddle = std::polar( 1.0, double( -pi2 * out.getQ() ) );
-
-// 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
-// 		{
-// 		std::for_each( std::execution::par_unseq, iota_iter( 0 ), iota_iter( out.get_num_bins() ), [&]( Bin bin )
-// 			{
-// 			const Frame N_k = out.getPeriod( bin );
-// 			const Twiddle twiddle = make_twiddle<double>( out.getQ(), N_k );
-
-// 			const Frequency binFrequency = out.getBinFrequency( bin );
-// 			Twiddle<double> F_tk = {0,0,0};
-// 			double phase_buffer = 0;
-// 			if( bin == out.get_num_bins() - 1 )
-// 				std::cout << "f";
-			
-// 			for( Frame frame = std::floor(-N_k/2-1); frame < out.get_num_frames(); ++frame )
-// 				{
-// 				auto get_sample_s = [&]( Frame frame ){ return frame < 0 || out.get_num_frames() <= frame ? 0.0f : get_sample( channel, frame ); };
-// 				const double new_sample = get_sample_s( frame + N_k/2.0f );
-// 				const double old_sample = get_sample_s( frame - N_k/2.0f );
-
-// 				const auto fiddled = ( fiddle * new_sample - old_sample )/ double( N_k );
-// 				F_tk = twiddle * ( F_tk + fiddled  ); // (6)
-
-// 				if( frame >= 0 )
-// 					{
-// 					// If you are reading the paper on this step note that a factor of j is missing for several steps of the derivation, but it is correct.
-// 					const std::complex<float> F_tk_windowed = static_cast<std::complex<float>>( 
-// 						window.first * F_tk[1] + window.second / 2.0 * ( F_tk[0] + F_tk[2] ) ); // (10)
-// 					const MF mf = phase_vocoder( phase_buffer, F_tk_windowed, binFrequency, out.get_analysis_rate(), out.get_sample_rate() );
-// 					out.getMP( channel, frame, bin ) = { mf.m, out.frequencyToPitch( mf.f ) };
-// 					}
-// 				}
-// 			} );
-// 		}
-
-// 	return out;
-// 	}
-
-// SQPV Audio::convert_to_ms_SQPV( std::pair<Frequency, Frequency> bandwidth, Bin bins_per_octave ) const
-// 	{
-// 	return convert_to_mid_side().convert_to_SQPV( bandwidth, bins_per_octave );
-// 	}
-
-// Audio SQPV::convert_to_audio() const
-// 	{
-// 	
-// 	// Compute twiddles
-// 	std::vector<std::complex<float>> twiddles( get_num_bins() );
-// 	for( Bin bin = 0; bin < get_num_bins(); ++bin )
-// 		twiddles[bin] = std::polar( 1.0f, pi2 * getQ() / getPeriod( bin ) ); // Rotation in (11)
-
-// 	// Setup done
-// 	Audio::Format format;
-// 	format.num_channels = get_num_channels();
-// 	format.num_frames = get_num_frames();
-// 	format.sample_rate = get_sample_rate();
-// 	Audio out( format );
-
-// 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
-// 		{
-// 		// Invert phase vocoding
-// 		std::vector<std::complex<float>> cpxBuffer( get_num_frames() * get_num_bins(), 0 );
-// 		std::for_each( std::execution::par_unseq, iota_iter( 0 ), iota_iter( get_num_bins() ), [&]( Bin bin )		
-// 			{
-// 			double phase_buffer = 0;
-// 			const Radian phase_diff_0 = pitchToFrequency( getMP( channel, 0, bin ).p ) / get_analysis_rate() * pi2;
-// 			for( Frame frame = 0; frame < get_num_frames(); ++frame )
-// 				{
-// 				const MP mp = getMP( channel, frame, bin );
-// 				cpxBuffer[get_buffer_pos( 0, frame, bin )] = inverse_phase_vocoder( phase_buffer, { mp.m, pitchToFrequency( mp.p ) }, get_analysis_rate() );
-// 				}
-// 			} );
-
-// 		// Invert scqt
-// 		std::for_each( std::execution::par_unseq, iota_iter( 0 ), iota_iter( get_num_frames() ), [&]( Frame frame )
-// 			{
-// 			Sample sample = 0;
-// 			for( Bin bin = 0; bin < get_num_bins(); ++bin )
-// 				sample += ( cpxBuffer[ get_buffer_pos( 0, frame, bin ) ] * twiddles[bin] ).real();
-// 			out.get_sample( channel, frame ) = sample;
-// 			} );
-// 		}
-
-// 	return out;
-// 	}
-
-// Audio SQPV::convert_to_lr_audio() const
-// 	{
-// 	return convert_to_audio().convert_to_left_right();
-// 	}
\ No newline at end of file
+#include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
+#include "flan/SQPV/SQPV.h"
+
+#include <complex>
+
+#include "flan/ConstantQ.h"
+#include "flan/phase_vocoder.h"
+#include "flan/Utility/execution.h"
+
+using namespace flan;
+
+// Frames transformed at a time within an octave, between cancellation checks
+static const Frame chunkFrames = 1024;
+
+SQPV Audio::convert_to_SQPV( std::pair<Frequency, Frequency> bandwidth, Bin bins_per_octave, Frame hop_size, flan_CANCEL_ARG_CPP ) const
+	{
+	flan_TRACE_SPAN( "Audio::convert_to_SQPV", *this );
+	if( is_null() ) return SQPV();
+
+	bandwidth.second = std::min( bandwidth.second, get_sample_rate() / 2 );
+	const ConstantQ cqt( bandwidth, bins_per_octave, get_sample_rate(), hop_size );
+	if( cqt.get_num_bins() <= 0 ) return SQPV();
+
+	SQPV::Format format;
+	format.num_channels = get_num_channels();
+	format.num_frames = cqt.get_num_frames( get_num_frames() );
+	format.bins_per_octave = cqt.get_bins_per_octave();
+	format.sample_rate = get_sample_rate();
+	format.bandwidth = bandwidth;
+	format.hop_size = cqt.get_hop_size();
+	flan_RESERVE_POINT( uint64_t( format.num_channels ) * format.num_frames * cqt.get_num_bins() * sizeof( MP ), SQPV() );
+	SQPV out( format );
+
+	const int num_octaves = cqt.get_num_octaves();
+	TaskProgress progress( context, "Audio::convert_to_SQPV", uint64_t( get_num_channels() ) * ( num_octaves + 1 ) );
+
+	// Split each channel into its decimated octave signals
+	std::vector<ConstantQ::Levels> levels( get_num_channels() );
+	flan::for_each_i( get_num_channels(), ExecutionPolicy::Parallel_Sequenced, [&]( Channel channel )
+		{
+		flan_CANCEL_POINT();
+		levels[channel] = cqt.decompose( get_sample_pointer( channel, 0 ), get_num_frames() );
+		progress.advance();
+		} );
+	flan_CANCEL_POINT( SQPV() );
+
+	// Transform and phase vocode every octave of every channel independently
+	flan::for_each_i( get_num_channels() * num_octaves, ExecutionPolicy::Parallel_Sequenced, [&]( int task )
+		{
+		const Channel channel = task / num_octaves;
+		const int octave = task % num_octaves;
+		const Bin first_bin = cqt.get_octave_bins( octave ).first;
+		const Bin octave_bins = cqt.get_octave_bins( octave ).second - first_bin;
+
+		std::vector<double> phase_buffer( octave_bins, 0 );
+		std::vector<std::complex<float>> cq( size_t( std::min( chunkFrames, out.get_num_frames() ) ) * octave_bins );
+		std::vector<MF> mfs( octave_bins );
+		std::vector<Frequency> bin_frequencies( octave_bins );
+		for( Bin bin = 0; bin < octave_bins; ++bin )
+			bin_frequencies[bin] = out.getBinFrequency( first_bin + bin );
+		for( Frame first_frame = 0; first_frame < out.get_num_frames(); first_frame += chunkFrames )
+			{
+			flan_CANCEL_POINT();
+			const Frame chunk = std::min( chunkFrames, out.get_num_frames() - first_frame );
+			cqt.analyze( octave, levels[channel], first_frame, chunk, cq.data() );
+			for( Frame frame = 0; frame < chunk; ++frame )
+				{
+				phase_vocoder_frame( { cq.data() + size_t( frame ) * octave_bins, size_t( octave_bins ) }, phase_buffer, mfs, bin_frequencies,
+					out.get_analysis_rate(), out.get_sample_rate(), context.get_accuracy() );
+				for( Bin bin = 0; bin < octave_bins; ++bin )
+					out.getMP( channel, first_frame + frame, first_bin + bin ) = { mfs[bin].m, out.frequencyToPitch( mfs[bin].f ) };
+				}
+			}
+		progress.advance();
+		} );
+	flan_CANCEL_POINT( SQPV() );
+
+	return out;
+	}
+
+SQPV Audio::convert_to_ms_SQPV( std::pair<Frequency, Frequency> bandwidth, Bin bins_per_octave, Frame hop_size, flan_CANCEL_ARG_CPP ) const
+	{
+	flan_TRACE_SPAN( "Audio::convert_to_ms_SQPV", *this );
+	if( get_num_channels() != 2 ) return SQPV();
+	return convert_to_mid_side().convert_to_SQPV( bandwidth, bins_per_octave, hop_size, context );
+	}
+
+Audio SQPV::convert_to_audio( flan_CANCEL_ARG_CPP ) const
+	{
+	flan_TRACE_SPAN( "SQPV::convert_to_audio", *this );
+	if( is_null() ) return Audio::create_null();
+
+	const ConstantQ cqt( getFrequencyBandwidth(), Bin( getBinsPerOctave() ), get_sample_rate(), get_hop_size() );
+	if( cqt.get_num_bins() != get_num_bins() ) return Audio::create_null();
+
+	Audio::Format format;
+	format.num_channels = get_num_channels();
+	format.num_frames = get_num_frames() * get_hop_size();
+	format.sample_rate = get_sample_rate();
+	flan_RESERVE_POINT( uint64_t( format.num_channels ) * format.num_frames * sizeof( Sample ), Audio::create_null() );
+	Audio out( format );
+
+	const int num_octaves = cqt.get_num_octaves();
+	TaskProgress progress( context, "SQPV::convert_to_audio", uint64_t( get_num_channels() ) * ( num_octaves + 1 ) );
+
+	// Invert phase vocoding and synthesize every octave of every channel independently
+	std::vector<std::vector<std::vector<Sample>>> octave_signals( get_num_channels(), std::vector<std::vector<Sample>>( num_octaves ) );
+	flan::for_each_i( get_num_channels() * num_octaves, ExecutionPolicy::Parallel_Sequenced, [&]( int task )
+		{
+		flan_CANCEL_POINT();
+		const Channel channel = task / num_octaves;
+		const int octave = task % num_octaves;
+		const Bin first_bin = cqt.get_octave_bins( octave ).first;
+		const Bin octave_bins = cqt.get_octave_bins( octave ).second - first_bin;
+
+		std::vector<std::complex<float>> cq( size_t( get_num_frames() ) * octave_bins );
+		std::vector<double> phase_buffer( octave_bins, 0 );
+		std::vector<MF> mfs( octave_bins );
+		for( Frame frame = 0; frame < get_num_frames(); ++frame )
+			{
+			for( Bin bin = 0; bin < octave_bins; ++bin )
+				{
+				const MP mp = getMP( channel, frame, first_bin + bin );
+				mfs[bin] = { mp.m, pitchToFrequency( mp.p ) };
+				}
+			inverse_phase_vocoder_frame( mfs, phase_buffer, { cq.data() + size_t( frame ) * octave_bins, size_t( octave_bins ) }, 
+				get_analysis_rate(), context.get_accuracy() );
+			}
+		octave_signals[channel][octave] = cqt.synthesize( octave, cq.data(), get_num_frames(), out.get_num_frames() );
+		progress.advance();
+		} );
+	flan_CANCEL_POINT( Audio::create_null() );
+
+	// Upsample and sum octaves
+	flan::for_each_i( get_num_channels(), ExecutionPolicy::Parallel_Sequenced, [&]( Channel channel )
+		{
+		cqt.recompose( std::move( octave_signals[channel] ), out.get_sample_pointer( channel, 0 ), out.get_num_frames() );
+		progress.advance();
+		} );
+
+	return out;
+	}
+
+Audio SQPV::convert_to_lr_audio( flan_CANCEL_ARG_CPP ) const
+	{
+	flan_TRACE_SPAN( "SQPV::convert_to_lr_audio", *this );
+	if( get_num_channels() != 2 ) return Audio::create_null();
+	return convert_to_audio( context ).convert_to_left_right();
+	}
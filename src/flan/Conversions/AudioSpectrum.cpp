@@ -0,0 +1,71 @@
+#include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
+#include "flan/Spectrum/Spectrum.h"
+
+#include <algorithm>
+
+#include "flan/FFTHelper.h"
+#include "flan/Utility/execution.h"
+
+using namespace flan;
+
+Spectrum Audio::convert_to_spectrum( flan_CANCEL_ARG_CPP ) const
+	{
+	flan_TRACE_SPAN( "Audio::convert_to_spectrum", *this );
+	if( is_null() ) return Spectrum();
+
+	const Frame dft_size = std::max( power_of_2_container( get_num_frames() ), size_t( 2 ) );
+
+	Spectrum::Format format;
+	format.num_channels = get_num_channels();
+	format.num_bins = dft_size / 2 + 1;
+	format.sample_rate = get_sample_rate();
+	flan_RESERVE_POINT( ( uint64_t( format.num_channels ) * format.num_bins * 2 + dft_size ) * sizeof( float ), Spectrum() );
+	Spectrum out( format );
+
+	TaskProgress progress( context, "Audio::convert_to_spectrum", get_num_channels() );
+
+	flan::for_each_i( get_num_channels(), ExecutionPolicy::Parallel_Sequenced, [&]( Channel channel )
+		{
+		flan_CANCEL_POINT();
+		FFTHelper::Lease fft = FFTHelper::acquire( dft_size, true, false );
+		std::copy( get_sample_pointer( channel, 0 ), get_sample_pointer( channel, 0 ) + get_num_frames(), fft->real_begin() );
+		std::fill( fft->real_begin() + get_num_frames(), fft->real_end(), 0.0f );
+		fft->r2c_execute();
+		std::copy( fft->complex_begin(), fft->complex_end(), out.get_bin_pointer( channel, 0 ) );
+		progress.advance();
+		} );
+	flan_CANCEL_POINT( Spectrum() );
+
+	return out;
+	}
+
+Audio Spectrum::convert_to_audio( flan_CANCEL_ARG_CPP ) const
+	{
+	flan_TRACE_SPAN( "Spectrum::convert_to_audio" );
+	if( is_null() ) return Audio::create_null();
+
+	const Frame dft_size = 2 * ( get_num_bins() - 1 );
+
+	Audio::Format format;
+	format.num_channels = get_num_channels();
+	format.num_frames = dft_size;
+	format.sample_rate = get_sample_rate();
+	flan_RESERVE_POINT( ( uint64_t( format.num_channels ) * format.num_frames + dft_size * 2 ) * sizeof( Sample ), Audio::create_null() );
+	Audio out( format );
+
+	TaskProgress progress( context, "Spectrum::convert_to_audio", get_num_channels() );
+
+	flan::for_each_i( get_num_channels(), ExecutionPolicy::Parallel_Sequenced, [&]( Channel channel )
+		{
+		flan_CANCEL_POINT();
+		FFTHelper::Lease fft = FFTHelper::acquire( dft_size, false, true );
+		std::copy( get_bin_pointer( channel, 0 ), get_bin_pointer( channel, 0 ) + get_num_bins(), fft->complex_begin() );
+		fft->c2r_execute();
+		std::transform( fft->real_begin(), fft->real_end(), out.get_sample_pointer( channel, 0 ), [&]( float x ){ return x / dft_size; } );
+		progress.advance();
+		} );
+	flan_CANCEL_POINT( Audio::create_null() );
+
+	return out;
+	}
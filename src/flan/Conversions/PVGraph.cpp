@@ -1,10 +1,12 @@
 #include "flan/PV/PV.h"
+#include "flan/Utility/Trace.h"
 #include "flan/Graph.h"
 
 using namespace flan;
 
 Graph PV::convert_to_graph( Rect D, Pixel width, Pixel height, float timeline_scale ) const
 	{
+	flan_TRACE_SPAN( "PV::convert_to_graph", *this );
 	if( is_null() ) return Graph( width, height );( Graph( width, height ) );
 
 	if( D.x2() == -1 ) D.d.x2 = get_length();
@@ -48,5 +50,6 @@ Graph PV::convert_to_graph( Rect D, Pixel width, Pixel height, float timeline_sc
 
 void PV::save_to_bmp( const std::string & fileName, Rect D, Pixel width, Pixel height ) const
 	{
+	flan_TRACE_SPAN( "PV::save_to_bmp", *this );
 	convert_to_graph( D, width, height ).save_image( fileName );
 	}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "flan/Convolver.h"
+
+#include <algorithm>
+
+using namespace flan;
+
+Convolver::Kernel::Kernel( const Sample * impulse_response, Frame _length, Frame _block_size )
+	: block_size( std::max( _block_size, Frame( 1 ) ) )
+	, length( std::max( _length, Frame( 0 ) ) )
+	{
+	const Frame num_partitions = std::max( ( length + block_size - 1 ) / block_size, Frame( 1 ) );
+	const Bin num_bins = block_size + 1;
+	partitions_re.resize( num_partitions, std::vector<float>( num_bins ) );
+	partitions_im.resize( num_partitions, std::vector<float>( num_bins ) );
+
+	// FFTW doesn't normalize, so the inverse transform of each output block is scaled up by the fft size. That is undone here.
+	FFTHelper::Lease fft = FFTHelper::acquire( 2 * block_size, true, false );
+	const float norm = 1.0f / ( 2 * block_size );
+	for( Frame p = 0; p < num_partitions; ++p )
+		{
+		std::fill( fft->real_begin(), fft->real_end(), 0.0f );
+		const Frame start = p * block_size;
+		const Frame end = std::min( start + block_size, length );
+		for( Frame i = start; i < end; ++i )
+			fft->get_real_buffer()[i - start] = impulse_response[i] * norm;
+		fft->r2c_execute();
+		for( Bin b = 0; b < num_bins; ++b )
+			{
+			partitions_re[p][b] = fft->get_complex_buffer()[b].real();
+			partitions_im[p][b] = fft->get_complex_buffer()[b].imag();
+			}
+		}
+	}
+
+Frame Convolver::Kernel::get_num_partitions() const
+	{
+	return Frame( partitions_re.size() );
+	}
+
+Convolver::Convolver( std::shared_ptr<const Kernel> _kernel )
+	: kernel( std::move( _kernel ) )
+	, fft( FFTHelper::acquire( 2 * kernel->block_size, true, true ) )
+	, delay_re( kernel->get_num_partitions(), std::vector<float>( kernel->block_size + 1 ) )
+	, delay_im( kernel->get_num_partitions(), std::vector<float>( kernel->block_size + 1 ) )
+	, previous( kernel->block_size )
+	, sum_re( kernel->block_size + 1 )
+	, sum_im( kernel->block_size + 1 )
+	{
+	}
+
+void Convolver::reset()
+	{
+	for( auto & d : delay_re ) std::fill( d.begin(), d.end(), 0.0f );
+	for( auto & d : delay_im ) std::fill( d.begin(), d.end(), 0.0f );
+	std::fill( previous.begin(), previous.end(), 0.0f );
+	delay_pos = 0;
+	}
+
+void Convolver::process_block( const Sample * in, Sample * out )
+	{
+	const Frame block_size = kernel->block_size;
+	const Frame num_partitions = kernel->get_num_partitions();
+	const Bin num_bins = block_size + 1;
+
+	// Transform the last two input blocks into the newest delay line slot
+	float * real = fft->get_real_buffer();
+	std::copy( previous.begin(), previous.end(), real );
+	std::copy( in, in + block_size, real + block_size );
+	std::copy( in, in + block_size, previous.begin() );
+	fft->r2c_execute();
+
+	delay_pos = delay_pos == 0 ? num_partitions - 1 : delay_pos - 1;
+	float * d_re = delay_re[delay_pos].data();
+	float * d_im = delay_im[delay_pos].data();
+	const std::complex<float> * spectrum = fft->get_complex_buffer();
+	for( Bin b = 0; b < num_bins; ++b )
+		{
+		d_re[b] = spectrum[b].real();
+		d_im[b] = spectrum[b].imag();
+		}
+
+	// Multiply-accumulate each partition against the input it lines up with. The delay line is newest first from delay_pos.
+	std::fill( sum_re.begin(), sum_re.end(), 0.0f );
+	std::fill( sum_im.begin(), sum_im.end(), 0.0f );
+	float * s_re = sum_re.data();
+	float * s_im = sum_im.data();
+	for( Frame p = 0; p < num_partitions; ++p )
+		{
+		const Frame slot = ( delay_pos + p ) % num_partitions;
+		const float * x_re = delay_re[slot].data();
+		const float * x_im = delay_im[slot].data();
+		const float * h_re = kernel->partitions_re[p].data();
+		const float * h_im = kernel->partitions_im[p].data();
+		for( Bin b = 0; b < num_bins; ++b )
+			{
+			s_re[b] += x_re[b] * h_re[b] - x_im[b] * h_im[b];
+			s_im[b] += x_re[b] * h_im[b] + x_im[b] * h_re[b];
+			}
+		}
+
+	// The first half of the inverse is circular wraparound, the second half is the output block
+	std::complex<float> * out_spectrum = fft->get_complex_buffer();
+	for( Bin b = 0; b < num_bins; ++b )
+		out_spectrum[b] = std::complex<float>( s_re[b], s_im[b] );
+	fft->c2r_execute();
+	std::copy( real + block_size, real + 2 * block_size, out );
+	}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "flan/defines.h"
+#include "flan/FFTHelper.h"
+
+namespace flan {
+
+/** Uniformly partitioned overlap-save convolution.
+ *
+ *	The impulse response is cut into partitions of block_size samples, and each partition is transformed once, ahead of time.
+ *	Every block of input is transformed once as well, and kept in a frequency domain delay line. A block of output is then
+ *	the sum over partitions of each partition's spectrum times the input spectrum that many blocks ago, followed by a single
+ *	inverse fft. Long impulse responses cost one complex multiply-add per bin per partition rather than one fft of their
+ *	full length, and the fft size stays at twice the block size no matter how long the response is.
+ *
+ *	A Convolver holds the history of one channel. Use one per channel, they can run in parallel and share a Kernel.
+ */
+class Convolver
+{
+public:
+	/** A transformed impulse response. These are immutable once built and can be shared, or cached, between Convolvers.
+	 */
+	struct Kernel
+		{
+		/** \param impulse_response The impulse response samples.
+		 *	\param length The number of samples in impulse_response.
+		 *	\param block_size The number of samples processed at a time. This should be a power of two.
+		 */
+		Kernel( const Sample * impulse_response, Frame length, Frame block_size );
+
+		Frame get_num_partitions() const;
+
+		Frame block_size;
+		Frame length;
+
+		// Each partition's spectrum, of block_size + 1 bins, scaled by the inverse fft normalization and split into real and
+		// imaginary parts
+		std::vector<std::vector<float>> partitions_re, partitions_im;
+		};
+
+	Convolver( std::shared_ptr<const Kernel> );
+
+	/** Clears all history.
+	 */
+	void reset();
+
+	/** Convolves one block with the kernel. Output is not delayed, the output block is the convolution at the same times as
+	 *	the input block.
+	 *	\param in block_size input samples.
+	 *	\param out block_size output samples. This may be the same as in.
+	 */
+	void process_block( const Sample * in, Sample * out );
+
+private:
+	std::shared_ptr<const Kernel> kernel;
+	FFTHelper::Lease fft;
+
+	// Input spectra of the last num_partitions blocks, circular, split into real and imaginary parts
+	std::vector<std::vector<float>> delay_re, delay_im;
+	Frame delay_pos = 0;
+
+	std::vector<Sample> previous; // The last input block, the first half of the next fft
+	std::vector<float> sum_re, sum_im;
+};
+
+}
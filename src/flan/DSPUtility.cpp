@@ -10,6 +10,66 @@
 
 namespace flan {
 
+std::vector<float> design_halfband( int half_length )
+	{
+	std::vector<float> coefficients( half_length );
+	double sum = 0;
+	for( int j = 1; j <= half_length; ++j )
+		{
+		const double n = 2 * j - 1;
+		const double sinc = std::sin( pi * n / 2.0 ) / ( pi * n );
+		const double window = 0.42 + 0.5 * std::cos( pi * n / ( 2 * half_length ) ) + 0.08 * std::cos( pi2 * n / ( 2 * half_length ) );
+		coefficients[j-1] = float( sinc * window );
+		sum += coefficients[j-1];
+		}
+
+	// Unity gain at DC
+	for( float & c : coefficients ) c *= float( 0.25 / sum );
+	return coefficients;
+	}
+
+std::vector<Sample> halfband_decimate( const std::vector<Sample> & x, const std::vector<float> & c )
+	{
+	const Frame n = x.size();
+	const int M = c.size();
+	auto x_s = [&]( Frame i ){ return 0 <= i && i < n ? x[i] : 0.0f; };
+
+	std::vector<Sample> out( ( n + 1 ) / 2 );
+	for( Frame m = 0; m < Frame( out.size() ); ++m )
+		{
+		float acc = 0.5f * x[2*m];
+		if( 2 * m >= 2 * M - 1 && 2 * m + 2 * M - 1 < n )
+			for( int j = 1; j <= M; ++j )
+				acc += c[j-1] * ( x[2*m - 2*j + 1] + x[2*m + 2*j - 1] );
+		else
+			for( int j = 1; j <= M; ++j )
+				acc += c[j-1] * ( x_s( 2*m - 2*j + 1 ) + x_s( 2*m + 2*j - 1 ) );
+		out[m] = acc;
+		}
+	return out;
+	}
+
+void halfband_interpolate_add( const std::vector<Sample> & x, std::vector<Sample> & out, const std::vector<float> & c )
+	{
+	const Frame n = x.size();
+	const int M = c.size();
+	auto x_s = [&]( Frame i ){ return 0 <= i && i < n ? x[i] : 0.0f; };
+
+	for( Frame i = 0; i < Frame( out.size() ); ++i )
+		{
+		const Frame m = i / 2;
+		if( i % 2 == 0 )
+			{
+			out[i] += x_s( m );
+			continue;
+			}
+		float acc = 0;
+		for( int j = 1; j <= M; ++j )
+			acc += c[j-1] * ( x_s( m - j + 1 ) + x_s( m + j ) );
+		out[i] += 2.0f * acc;
+		}
+	}
+
 // std::vector<float> autocorrelation( const float * signal, Frame n, std::shared_ptr<FFTHelper> fft ) 
 // 	{
 // 	// Forced power of 2 for faster fft, at least twice as big to avoid time-aliasing
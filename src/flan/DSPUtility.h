@@ -24,4 +24,14 @@ float mean( std::function< float ( int ) > data, int n );
 vec2 mean_and_sd( const std::vector<float> & data );
 vec2 mean_and_sd( std::function< float ( int ) > data, int n );
 
+// Blackman windowed half-band lowpass. Returns the nonzero coefficients on one side of the center tap, nearest first.
+// The center tap is 1/2 and every other even tap is zero.
+std::vector<float> design_halfband( int half_length );
+
+// Zero phase lowpass by the half-band filter c, from design_halfband, and decimate by two. The output has ( x.size() + 1 ) / 2 samples.
+std::vector<Sample> halfband_decimate( const std::vector<Sample> & x, const std::vector<float> & c );
+
+// Zero phase upsample by two through the half-band filter c, adding into out. Sample i of x lands on sample 2i of out.
+void halfband_interpolate_add( const std::vector<Sample> & x, std::vector<Sample> & out, const std::vector<float> & c );
+
 }
\ No newline at end of file
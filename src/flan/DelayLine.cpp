@@ -0,0 +1,37 @@
+#include "flan/DelayLine.h"
+
+#include "flan/FFTHelper.h"
+#include "flan/Utility/Trace.h"
+
+using namespace flan;
+
+DelayLine::DelayLine( fFrame max_delay )
+	: buffer()
+	, mask( 0 )
+	, write_index( 0 )
+	{
+	reserve( max_delay );
+	}
+
+void DelayLine::reserve( fFrame max_delay )
+	{
+	// The interpolator reads one frame past the integer delay, and we need one more so the oldest frame isn't overwritten
+	const size_t needed = power_of_2_container( size_t( std::ceil( std::max( max_delay, min_delay ) ) ) + 2 );
+	if( needed <= buffer.size() ) return;
+
+	std::vector<Sample> grown( needed, 0 );
+	const uint32_t grown_mask = uint32_t( needed - 1 );
+
+	// Unwrap the old history so each sample keeps its distance from the write head
+	for( uint32_t k = 1; k <= buffer.size(); ++k )
+		grown[( write_index - k ) & grown_mask] = buffer[( write_index - k ) & mask];
+
+	flan_TRACE_ALLOCATION( needed * sizeof( Sample ) );
+	buffer = std::move( grown );
+	mask = grown_mask;
+	}
+
+void DelayLine::clear()
+	{
+	std::fill( buffer.begin(), buffer.end(), 0 );
+	}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "flan/defines.h"
+
+namespace flan {
+
+/** A single channel circular buffer delay line with fractional read taps. Reads use four point cubic Hermite interpolation
+ *	between the stored samples, so a tap can be at most min_delay frames behind the write head. Any number of reads can
+ *	happen between writes, and the delay of each read can change every frame.
+ *
+ *	Memory use is the smallest power of two containing the largest delay requested, independent of the length of the signal.
+ */
+struct DelayLine
+	{
+	// The smallest delay, in frames, which can be read without reaching samples that haven't been written yet
+	static constexpr fFrame min_delay = 3;
+
+	/** \param max_delay The longest delay, in frames, expected to be read. The line grows if reserve is later called with a longer one.
+	 */
+	DelayLine( fFrame max_delay = 0 );
+
+	/** Grows the line to hold max_delay frames of history, keeping the samples already written.
+	 */
+	void reserve( fFrame max_delay );
+
+	/** Zeros the stored history.
+	 */
+	void clear();
+
+	/** The longest delay which can currently be read.
+	 */
+	fFrame get_max_delay() const { return fFrame( buffer.size() - 2 ); }
+
+	/** Reads the signal delay frames before the next write. The delay is clamped to [min_delay, get_max_delay()].
+	 */
+	Sample read( fFrame delay ) const
+		{
+		const fFrame d = std::clamp( delay, min_delay, get_max_delay() );
+		const uint32_t d_int = uint32_t( std::ceil( d ) );
+		const float t = float( d_int ) - d;
+
+		// The read position lies t past index i
+		const uint32_t i = write_index - d_int;
+		const Sample y0 = buffer[( i - 1 ) & mask];
+		const Sample y1 = buffer[( i     ) & mask];
+		const Sample y2 = buffer[( i + 1 ) & mask];
+		const Sample y3 = buffer[( i + 2 ) & mask];
+
+		const float c1 = 0.5f * ( y2 - y0 );
+		const float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+		const float c3 = 0.5f * ( y3 - y0 ) + 1.5f * ( y1 - y2 );
+		return ( ( c3 * t + c2 ) * t + c1 ) * t + y1;
+		}
+
+	/** Pushes a sample into the line, advancing the write head by one frame.
+	 */
+	void write( Sample x )
+		{
+		buffer[write_index & mask] = x;
+		++write_index;
+		}
+
+private:
+	std::vector<Sample> buffer;
+	uint32_t mask;
+	uint32_t write_index;
+	};
+
+}
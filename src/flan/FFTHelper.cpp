@@ -1,13 +1,42 @@
 #include "flan/FFTHelper.h"
 
 #include <cassert>
+#include <map>
+#include <vector>
+#include <thread>
+#include <algorithm>
 #include <fftw3.h>
+
+#include "flan/Utility/Trace.h"
 #include "FFTHelper.h"
 
 using namespace flan;
 
 std::recursive_mutex FFTHelper::mutex;
 
+namespace {
+
+struct PoolKey
+	{
+	size_t size;
+	bool r2c;
+	bool c2r;
+	bool measure;
+	auto operator<=>( const PoolKey & ) const = default;
+	};
+
+// Idle pooled helpers. This is defined after FFTHelper::mutex, so it is destroyed first.
+std::mutex pool_mutex;
+std::map<PoolKey, std::vector<std::unique_ptr<FFTHelper>>> pool;
+
+// Idle helpers of one configuration beyond what every thread could be using at once are freed instead of pooled
+size_t max_idle_per_key()
+	{
+	return std::max( 4u, 2 * std::thread::hardware_concurrency() );
+	}
+
+}
+
 size_t flan::power_of_2_container( size_t window_size )
 	{
 	return std::pow( 2, (int) std::ceil( std::log2( window_size ) ) );
@@ -23,6 +52,9 @@ FFTHelper::FFTHelper( uint32_t buffer_size, bool useR2C, bool useC2R, bool measu
 	r2c_plan = useR2C? fftwf_plan_dft_r2c_1d( buffer_size, real_buffer, (fftwf_complex*) complex_buffer, measure? FFTW_MEASURE : FFTW_ESTIMATE ) : nullptr;
 	c2r_plan = useC2R? fftwf_plan_dft_c2r_1d( buffer_size, (fftwf_complex*) complex_buffer, real_buffer, measure? FFTW_MEASURE : FFTW_ESTIMATE ) : nullptr;
 	_real_buffer_size = buffer_size;
+	_measured = measure;
+	if( r2c_plan ) flan_TRACE_FFT_PLAN();
+	if( c2r_plan ) flan_TRACE_FFT_PLAN();
 	}
 
 FFTHelper::~FFTHelper()
@@ -35,6 +67,39 @@ FFTHelper::~FFTHelper()
 	fftwf_free( complex_buffer );
 	}
 
+FFTHelper::Lease FFTHelper::acquire( uint32_t buffer_size, bool useR2C, bool useC2R, bool measure )
+	{
+		{
+		std::lock_guard lock( pool_mutex );
+		auto idle = pool.find( { buffer_size, useR2C, useC2R, measure } );
+		if( idle != pool.end() && !idle->second.empty() )
+			{
+			FFTHelper * helper = idle->second.back().release();
+			idle->second.pop_back();
+			return Lease( helper, &release );
+			}
+		}
+
+	return Lease( new FFTHelper( buffer_size, useR2C, useC2R, measure ), &release );
+	}
+
+void FFTHelper::release( FFTHelper * helper )
+	{
+	std::unique_ptr<FFTHelper> owned( helper );
+	if( !owned ) return;
+
+	std::lock_guard lock( pool_mutex );
+	auto & idle = pool[{ owned->_real_buffer_size, owned->r2c_plan != nullptr, owned->c2r_plan != nullptr, owned->_measured }];
+	if( idle.size() < max_idle_per_key() )
+		idle.push_back( std::move( owned ) );
+	}
+
+void FFTHelper::clear_pool()
+	{
+	std::lock_guard lock( pool_mutex );
+	pool.clear();
+	}
+
 void FFTHelper::r2c_execute() 
 	{ 
 	assert( r2c_plan );
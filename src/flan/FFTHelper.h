@@ -2,6 +2,7 @@
 
 #include <complex>
 #include <mutex>
+#include <memory>
 
 class fftwf_plan_s;
 
@@ -15,6 +16,23 @@ struct FFTHelper
 	FFTHelper( uint32_t window_size, bool useR2C, bool useC2R, bool measure );
 	~FFTHelper();
 
+	FFTHelper( const FFTHelper & ) = delete;
+	FFTHelper & operator=( const FFTHelper & ) = delete;
+
+	// Returns a helper to the pool, this is the deleter of Lease
+	static void release( FFTHelper * );
+	using Lease = std::unique_ptr<FFTHelper, decltype( &release )>;
+
+	/** Returns an idle helper with the given configuration from a process wide pool, or creates one if there are none. It goes
+	 *	back to the pool when the Lease is destroyed. Planning is far more expensive than a transform, so algorithms which are
+	 *	called repeatedly, as in batch processing, should prefer this to constructing a helper. Buffer contents are unspecified.
+	 */
+	static Lease acquire( uint32_t window_size, bool useR2C, bool useC2R, bool measure = false );
+
+	/** Destroys every idle pooled helper.
+	 */
+	static void clear_pool();
+
 	void r2c_execute();
 	void c2r_execute();
 
@@ -34,6 +52,7 @@ private:
 	fftwf_plan_s * r2c_plan;
 	fftwf_plan_s * c2r_plan;
 	size_t _real_buffer_size;
+	bool _measured;
 
 	// FFTW is only thread safe for plan execution, this keeps multiple objects from creating or destroying plans at a time
 	static std::recursive_mutex mutex;
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cstdint>
+
+#include "flan/defines.h"
+
+/*
+Per sample filter cores shared by the Audio filter methods and the real time Processors.
+See https://ia601900.us.archive.org/5/items/the-art-of-va-filter-design-rev.-2.1.2/VAFilterDesign_2.1.2.pdf#chapter.10
+*/
+
+namespace flan {
+
+using Pole = std::complex<float>;
+using Mix_1pole = std::array<float,2>;
+using Mix_2pole = std::array<float,3>;
+
+inline Frequency prewarp( Frequency w, float T_half )
+	{
+	/*
+	Filter digitization bends the frequency response near nyquist down slightly.
+	Rather than have this error present in full at nyquist and not at all near zero, we can increase the desired frequency
+	in such a way that after this "bending" occurs, the cutoff position of the filter is right on the money.
+	This does create additional response error around 0, but we can only minimize that error around a single frequency,
+	and the cutoff is the most audible.
+	*/
+
+	return std::tan( T_half*w ) / T_half;
+	}
+
+/** Butterworth type 1 poles with unit cutoff. Only the floor(N/2) poles above the real axis are listed, each standing in
+ *	for itself and its conjugate. Odd orders have an additional unlisted pole at -1.
+ */
+std::vector<Pole> generate_butterworth_type1_poles( uint16_t N );
+
+/** Allpass cutoffs for the two branches of a 90 degree phase difference network covering lower to upper.
+ */
+std::pair<std::vector<float>, std::vector<float>> phase_diff_network_pole_design( int num_poles, Frequency lower, Frequency upper );
+
+struct Filter_1Pole {
+	Filter_1Pole( FrameRate sr )
+		: s( 0 )
+		// Note the factor of 2pi. The reference book uses a non-standard Forier transform definition, much to my annoyance. This fixes that.
+		// Saving a few cycles, the factor of 1/2 is baked into T, taking the 2pi down to pi.
+		, T_half( pi / sr )
+		{
+		}
+
+	std::array<Sample, 2> process_sample( Sample x, Frequency cutoff_unwarped, bool use_prewarp = true )
+		{
+		// See section 3.10 for the details.
+
+		const Frequency w = use_prewarp? prewarp( cutoff_unwarped, T_half ) : cutoff_unwarped;
+
+		const float g = w * T_half;
+		const float G = g / ( 1 + g );
+		const float v = G * ( x - s );
+		const Sample lp = v + s;
+		s = lp + v;
+
+		return { lp, x - lp };
+		}
+
+	Sample process_sample_and_mix( Sample x, Frequency cutoff_unwarped, Mix_1pole mix, bool use_prewarp = true )
+		{
+		const auto filtered = process_sample( x, cutoff_unwarped, use_prewarp );
+		return filtered[0]*mix[0] + filtered[1]*mix[1];
+		}
+
+	void reset()
+		{
+		s = 0;
+		}
+
+	Sample s;
+	const float T_half;
+};
+
+struct Filter_2Pole {
+	Filter_2Pole( FrameRate sr )
+		: s1( 0 )
+		, s2( 0 )
+		// Note the factor of 2pi. The reference book uses a non-standard Forier transform definition, much to my annoyance. This fixes that.
+		// Saving a few cycles, the factor of 1/2 is baked into T, taking the 2pi down to pi.
+		, T_half( pi / sr )
+		{
+		}
+
+	std::array<Sample, 3> process_sample( Sample x, Frequency cutoff_unwarped, float R, bool use_prewarp = true )
+		{
+		//See section 4.4 for the implementation.
+
+		const Frequency w = use_prewarp? prewarp( cutoff_unwarped, T_half ) : cutoff_unwarped;
+
+		const float g = w * T_half;
+		const float g1 = 2.0f*R + g;
+		const float d = 1.0f / ( 1.0f + 2.0f*R*g + g*g );
+		const float hp = ( x - g1*s1 - s2 ) * d;
+		const float v1 = g*hp;
+		const float bp = v1 + s1;
+		s1 = bp + v1;
+		const float v2 = g*bp;
+		const float lp = v2 + s2;
+		s2 = lp + v2;
+
+		return { lp, bp*2*R, hp };
+		}
+
+	Sample process_sample_and_mix( Sample x, Frequency cutoff_unwarped, float R, Mix_2pole mix, bool use_prewarp = true )
+		{
+		const auto filtered = process_sample( x, cutoff_unwarped, R, use_prewarp );
+		return filtered[0]*mix[0] + filtered[1]*mix[1] + filtered[2]*mix[2];
+		}
+
+	void reset()
+		{
+		s1 = 0;
+		s2 = 0;
+		}
+
+	Sample s1, s2;
+	const float T_half;
+};
+
+/** One channel of an order N Butterworth lowpass or highpass, as a 1-pole stage for odd orders followed by a 2-pole stage
+ *	for each conjugate pole pair. See section 8.6 for details.
+ */
+struct Filter_1Pole_Butterworth {
+	Filter_1Pole_Butterworth( FrameRate sr, uint16_t order )
+		: even_order( order % 2 == 0 )
+		, poles( generate_butterworth_type1_poles( order ) )
+		, filter_1pole( sr )
+		, filter_2poles( poles.size(), sr )
+		{
+		}
+
+	/** \param cutoff The cutoff, already clamped to [1, nyquist].
+	 */
+	Sample process_sample( Sample x, Frequency cutoff, bool lowpass )
+		{
+		// For odd orders there is a pole at -1
+		if( !even_order )
+			x = filter_1pole.process_sample( x, cutoff )[ lowpass? 0:1];
+
+		for( Index pole_i = 0; pole_i < poles.size(); ++pole_i )
+			{
+			const float R = -poles[pole_i].real();
+			x = filter_2poles[pole_i].process_sample( x, cutoff, R )[ lowpass? 0:2];
+			}
+		return x;
+		}
+
+	void reset()
+		{
+		filter_1pole.reset();
+		for( auto & f : filter_2poles ) f.reset();
+		}
+
+	const bool even_order;
+	const std::vector<Pole> poles;
+	Filter_1Pole filter_1pole;
+	std::vector<Filter_2Pole> filter_2poles;
+};
+
+/** One channel of an order N cascade of 2-pole stages with adjustable resonance. Output 0 is lowpass, 1 bandpass, 2 highpass.
+ */
+struct Filter_2Pole_Butterworth {
+	Filter_2Pole_Butterworth( FrameRate sr, uint16_t _order )
+		: order( _order )
+		, even_order( order % 2 == 0 )
+		, poles( generate_butterworth_type1_poles( order ) )
+		, filter_1pole( sr )
+		, filter_2poles( poles.size(), { sr, sr } )
+		{
+		}
+
+	/** \param w The cutoff, already clamped to [1, nyquist].
+	 *	\param R The damping.
+	 *	\param i The output index.
+	 */
+	Sample process_sample( Sample x, Frequency w, float R, size_t i )
+		{
+		const Radian alpha = std::acos( R ) / order;
+
+		// For odd orders there is a pole at -1 that will be split into two reciprocal poles around 0.
+		// These poles can be handled with a single svf.
+		if( !even_order )
+			{
+			const float real_pole_R = std::cos( alpha );
+			x = filter_1pole.process_sample( x, w, real_pole_R )[i];
+			}
+
+		// Each complex pole generated thus far will be split into two poles, each of which is then representing also its conjugate.
+		// In total, each pole in runs two 2-pole applications
+		for( Index pole_i = 0; pole_i < poles.size(); ++pole_i )
+			{
+			const std::complex<float> pole_scaler = R > 1 ?
+				std::pow( R + std::sqrt( R*R - 1.0f ), 1.0f / order ) :
+				std::exp( std::complex<float>( 0, -alpha ) );
+
+			const Pole p_w = poles[pole_i] * w;
+
+			const Pole p1 = p_w * pole_scaler;
+			const Frequency p1_w = std::abs( p1 );
+			const float p1_R = -p1.real() / p1_w;
+			x = filter_2poles[pole_i][0].process_sample( x, p1_w, p1_R )[i];
+
+			const Pole p2 = p_w / pole_scaler;
+			const Frequency p2_w = std::abs( p2 );
+			const float p2_R = -p2.real() / p2_w;
+			x = filter_2poles[pole_i][1].process_sample( x, p2_w, p2_R )[i];
+			}
+		return x;
+		}
+
+	void reset()
+		{
+		filter_1pole.reset();
+		for( auto & fs : filter_2poles )
+			for( auto & f : fs )
+				f.reset();
+		}
+
+	const uint16_t order;
+	const bool even_order;
+	const std::vector<Pole> poles;
+	Filter_2Pole filter_1pole;
+	std::vector<std::array<Filter_2Pole, 2>> filter_2poles;
+};
+
+}
@@ -9,6 +9,7 @@
 #include <concepts>
 #include <ranges>
 #include <variant>
+#include <typeinfo>
 
 #include "flan/defines.h"
 #include "flan/Utility/vec2.h"
@@ -80,6 +81,15 @@ struct Function
 		return execution_policy; 
 		}
 
+	/** The type of the wrapped callable, or void for constants. Algorithms use this to recognize known functions, such as the 
+	 *	flan::waveforms, and switch to specialized implementations.
+	 */
+	const std::type_info & target_type() const
+		{
+		if( is_constant() ) return typeid( void );
+		return std::get<StdFuncType>( f ).target_type();
+		}
+
 	// Function() 
 	// 	: f( []( I ){ return O( 0 ); } ) 
 	// 	, execution_policy( ExecutionPolicy::Parallel_Unsequenced )
@@ -0,0 +1,114 @@
+#include "MRPV.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "flan/Audio/Audio.h"
+#include "flan/Utility/Trace.h"
+
+using namespace flan;
+
+MRPV::MRPV()
+	: bands()
+	, num_audio_frames( 0 )
+	, sample_rate( 48000 )
+	{}
+
+MRPV::MRPV( std::vector<Band> && _bands, Frame _num_audio_frames, FrameRate _sample_rate )
+	: bands( std::move( _bands ) )
+	, num_audio_frames( _num_audio_frames )
+	, sample_rate( _sample_rate )
+	{}
+
+MRPV MRPV::copy() const
+	{
+	std::vector<Band> out_bands;
+	for( const Band & band : bands )
+		out_bands.push_back( { band.pv.copy(), band.decimation, band.low, band.high } );
+	return MRPV( std::move( out_bands ), num_audio_frames, sample_rate );
+	}
+
+bool MRPV::is_null() const
+	{
+	return bands.empty()
+		|| sample_rate <= 0
+		|| std::any_of( bands.begin(), bands.end(), []( const Band & band ){ return band.pv.is_null(); } );
+	}
+
+Channel MRPV::get_num_channels() const
+	{
+	return bands.empty() ? 0 : bands[0].pv.get_num_channels();
+	}
+
+Frame MRPV::get_num_audio_frames() const
+	{
+	return num_audio_frames;
+	}
+
+FrameRate MRPV::get_sample_rate() const
+	{
+	return sample_rate;
+	}
+
+Second MRPV::get_length() const
+	{
+	return num_audio_frames / sample_rate;
+	}
+
+int MRPV::get_num_bands() const
+	{
+	return bands.size();
+	}
+
+const MRPV::Band & MRPV::get_band( int band ) const
+	{
+	return bands[band];
+	}
+
+MRPV::Band & MRPV::get_band( int band )
+	{
+	return bands[band];
+	}
+
+int MRPV::get_band_index( Frequency f ) const
+	{
+	for( int band = 0; band < get_num_bands(); ++band )
+		if( f >= bands[band].low )
+			return band;
+	return get_num_bands() - 1;
+	}
+
+Frame MRPV::get_hop_size( int band ) const
+	{
+	const PV & pv = bands[band].pv;
+	return std::round( pv.get_sample_rate() / pv.get_analysis_rate() ) * bands[band].decimation;
+	}
+
+std::pair<Bin, Bin> MRPV::get_band_bins( int band ) const
+	{
+	const Band & b = bands[band];
+	const float fade = std::exp2( crossfade_octaves / 2 );
+	const Bin first = std::clamp( Bin( std::ceil( b.pv.frequency_to_bin( b.low / fade ) ) ), 0, b.pv.get_num_bins() );
+	const Bin end = std::clamp( Bin( std::floor( b.pv.frequency_to_bin( b.high * fade ) ) ) + 1, first, b.pv.get_num_bins() );
+	return { first, end };
+	}
+
+// Rises from 0 to 1 over the crossfade centered on crossover, as a raised cosine in octaves. The rise of one band is the
+// fall of the next, so weights at any frequency sum to one.
+static float crossfade_rise( Frequency f, Frequency crossover )
+	{
+	if( crossover <= 0 ) return 1.0f;
+	if( f <= 0 ) return 0.0f;
+	const float x = std::log2( f / crossover ) / MRPV::crossfade_octaves;
+	if( x <= -0.5f ) return 0.0f;
+	if( x >= 0.5f ) return 1.0f;
+	return 0.5f + 0.5f * std::sin( pi * x );
+	}
+
+float MRPV::get_band_weight( int band, Frequency f ) const
+	{
+	const Band & b = bands[band];
+	const float rise = crossfade_rise( f, b.low );
+	const float fall = band == 0 ? 0.0f : crossfade_rise( f, b.high );
+	return rise * ( 1.0f - fall );
+	}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+
+#include "flan/PV/PV.h"
+
+namespace flan {
+
+class Audio;
+
+//! Multi-Resolution Phase Vocoder (MRPV) Data
+/** A phase vocoder analysis split into frequency bands, each with its own window size. Low bands use long windows, so their
+ *	partials are resolved in frequency, and high bands use short windows, so their transients stay sharp.
+ *
+ *	Each band is a PV of its own, analyzed from the input lowpassed and decimated as far as the band's frequencies allow. A band
+ *	with a window sixteen times longer than the top band is often analyzed at a sixteenth of the sample rate, so it costs no
+ *	more per frame, and has a sixteenth of the frames. The band PVs use their decimated sample rate, and their own hop and
+ *	bins, but their times and frequencies are the real ones, so any PV process can be run on a band directly.
+ *
+ *	Every band PV covers 0Hz to its own Nyquist frequency, but only holds energy in its band. Bands overlap by a short crossfade
+ *	around each crossover, and the band magnitudes there sum to the full magnitude.
+ */
+class MRPV
+{
+public:
+	struct Band
+		{
+		PV pv;
+		Frame decimation; // Audio frames per band PV sample, a power of two
+		Frequency low; // Crossover with the band below, 0 for the lowest band
+		Frequency high; // Crossover with the band above, Nyquist for the highest band
+		};
+
+	// The width of the crossfade centered on each crossover
+	static constexpr float crossfade_octaves = 1.0f / 3.0f;
+
+	MRPV( const MRPV & ) = delete;
+	MRPV( MRPV && ) = default;
+	MRPV& operator=( const MRPV & ) = delete;
+	MRPV& operator=( MRPV && ) = default;
+	~MRPV() = default;
+
+	MRPV();
+
+	/** \param bands The bands, highest first.
+	 *	\param num_audio_frames The length of the Audio the bands were analyzed from.
+	 *	\param sample_rate The sample rate of the Audio the bands were analyzed from.
+	 */
+	MRPV( std::vector<Band> && bands, Frame num_audio_frames, FrameRate sample_rate );
+
+	MRPV copy() const;
+	bool is_null() const;
+
+	Channel get_num_channels() const;
+	Frame get_num_audio_frames() const;
+	FrameRate get_sample_rate() const;
+	Second get_length() const;
+
+	/** Bands are numbered from the top down.
+	 */
+	int get_num_bands() const;
+	const Band & get_band( int band ) const;
+
+	/** Bands can be modified in place, so long as their PV keeps its format.
+	 */
+	Band & get_band( int band );
+
+	/** Returns the band containing a frequency, outside of crossfades.
+	 */
+	int get_band_index( Frequency ) const;
+
+	/** Returns the Audio frames between frames of a band.
+	 */
+	Frame get_hop_size( int band ) const;
+
+	/** Returns the bins of a band's PV which hold any of the band, as [first, end).
+	 */
+	std::pair<Bin, Bin> get_band_bins( int band ) const;
+
+	/** Returns the fraction of a frequency's magnitude held by a band.
+	 */
+	float get_band_weight( int band, Frequency ) const;
+
+	/** Resynthesizes each band and sums them.
+	 */
+	Audio convert_to_audio( flan_CANCEL_ARG ) const;
+
+	/** For stereo inputs this is identical to MRPV::convert_to_audio, but converts the output from mid-side to left-right.
+	 */
+	Audio convert_to_lr_audio( flan_CANCEL_ARG ) const;
+
+private:
+	std::vector<Band> bands;
+	Frame num_audio_frames;
+	FrameRate sample_rate;
+};
+
+}
@@ -0,0 +1,89 @@
+#include "flan/Noise.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+
+namespace flan::noise {
+
+void white( uint64_t seed, uint64_t start_frame, Sample * out, Frame num_frames )
+	{
+	for( Frame frame = 0; frame < num_frames; ++frame )
+		out[frame] = uniform( seed, start_frame + frame );
+	}
+
+// A uniform integer on [-2^23, 2^23). Pink noise sums these so its running sum is exact, and doesn't depend on where a chunk starts.
+static int32_t uniform_int( uint64_t seed, uint64_t counter )
+	{
+	return int32_t( random_bits( seed, counter ) >> 40 ) - ( 1 << 23 );
+	}
+
+void pink( uint64_t seed, int num_rows, uint64_t start_frame, Sample * out, Frame num_frames )
+	{
+	// Row r is replaced at frames (2k+1)2^r, so rows past 63 are never touched
+	num_rows = std::clamp( num_rows, 0, 63 );
+	const uint64_t white_seed = substream( seed, num_rows );
+	const float scale = 1.0f / float( 1 << 23 );
+
+	// Row r's value before start_frame comes from its most recent replacement, or is zero if it hasn't been replaced yet
+	std::array<int32_t, 63> rows;
+	int64_t running_sum = 0;
+	for( int row = 0; row < num_rows; ++row )
+		{
+		const uint64_t first = uint64_t( 1 ) << row;
+		rows[row] = start_frame > first ? uniform_int( substream( seed, row ), ( start_frame - 1 - first ) >> ( row + 1 ) ) : 0;
+		running_sum += rows[row];
+		}
+
+	for( Frame i = 0; i < num_frames; ++i )
+		{
+		const uint64_t frame = start_frame + i;
+		if( frame != 0 )
+			{
+			const int row = std::countr_zero( frame );
+			if( row < num_rows )
+				{
+				const int32_t new_random = uniform_int( substream( seed, row ), frame >> ( row + 1 ) );
+				running_sum += new_random - rows[row];
+				rows[row] = new_random;
+				}
+			}
+		out[i] = float( running_sum + uniform_int( white_seed, frame ) ) * scale;
+		}
+	}
+
+Sample brown( uint64_t seed, float coefficient, uint64_t start_frame, Sample * out, Frame num_frames, Sample initial )
+	{
+	white( seed, start_frame, out, num_frames );
+	Sample y = initial;
+	for( Frame frame = 0; frame < num_frames; ++frame )
+		{
+		y = coefficient * y + out[frame];
+		out[frame] = y;
+		}
+	return y;
+	}
+
+void velvet( uint64_t seed, double frames_per_impulse, uint64_t start_frame, Sample * out, Frame num_frames )
+	{
+	std::fill( out, out + num_frames, 0.0f );
+	frames_per_impulse = std::max( frames_per_impulse, 1.0 );
+
+	const uint64_t end_frame = start_frame + num_frames;
+	const uint64_t first_cell = uint64_t( start_frame / frames_per_impulse );
+	const uint64_t last_cell = uint64_t( end_frame / frames_per_impulse );
+	for( uint64_t cell = first_cell; cell <= last_cell; ++cell )
+		{
+		const uint64_t bits = random_bits( seed, cell );
+		const double cell_start = cell * frames_per_impulse;
+
+		// The top bits place the impulse, the lowest bit picks its sign
+		const double offset = double( bits >> 11 ) / double( uint64_t( 1 ) << 53 ) * frames_per_impulse;
+		const uint64_t frame = std::min( uint64_t( cell_start + offset ), uint64_t( std::ceil( cell_start + frames_per_impulse ) ) - 1 );
+		if( start_frame <= frame && frame < end_frame )
+			out[frame - start_frame] = ( bits & 1 ) ? 1.0f : -1.0f;
+		}
+	}
+
+}
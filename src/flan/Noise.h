@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+
+#include "flan/defines.h"
+
+/*
+Counter based noise. Every random value is a hash of a seed and the index of the value, rather than the next output of a
+stateful generator, so any stretch of a noise signal can be generated on its own, starting from any frame. Long outputs are
+split into chunks generated in parallel, and the result only depends on the seed, never on how the work was split or how
+many threads did it. The inner loops are branch free hashes, which compilers vectorize.
+
+Each generator writes num_frames samples of the signal starting at start_frame.
+*/
+
+namespace flan::noise {
+
+/** 64 random bits for the given seed and counter. This is the SplitMix64 output function applied to the counter'th state.
+ */
+inline uint64_t random_bits( uint64_t seed, uint64_t counter )
+	{
+	uint64_t z = seed + ( counter + 1 ) * 0x9E3779B97F4A7C15ull;
+	z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+	z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+	return z ^ ( z >> 31 );
+	}
+
+/** A uniform random value on [-1,1) for the given seed and counter.
+ */
+inline float uniform( uint64_t seed, uint64_t counter )
+	{
+	return float( random_bits( seed, counter ) >> 40 ) * ( 2.0f / float( 1 << 24 ) ) - 1.0f;
+	}
+
+/** A seed for an independent stream derived from seed. Generators using several streams take them from here.
+ */
+inline uint64_t substream( uint64_t seed, uint64_t stream )
+	{
+	return random_bits( seed ^ 0x6A09E667F3BCC909ull, stream );
+	}
+
+/** Uniform white noise on [-1,1).
+ */
+void white( uint64_t seed, uint64_t start_frame, Sample * out, Frame num_frames );
+
+/** Voss-McCartney pink noise. Row r holds a random value replaced every 2^(r+1) frames, and each frame is the sum of all rows
+ *	plus a white sample, so the output lies on [-(num_rows+1), num_rows+1). Rows are updated as a serial running sum inside
+ *	each call, but their starting values are computed directly from start_frame.
+ *	\param num_rows The number of rows. Each row extends the pink spectrum down by an octave.
+ */
+void pink( uint64_t seed, int num_rows, uint64_t start_frame, Sample * out, Frame num_frames );
+
+/** Brown noise, white noise through the leaky integrator y[n] = coefficient * y[n-1] + x[n].
+ *	\param coefficient The integrator feedback, just under one.
+ *	\param initial The output at the frame before start_frame.
+ *	\return The output at the last frame, to pass as initial to the following chunk.
+ */
+Sample brown( uint64_t seed, float coefficient, uint64_t start_frame, Sample * out, Frame num_frames, Sample initial = 0 );
+
+/** Velvet noise. Time is split into cells of frames_per_impulse frames, and each cell holds a single impulse of -1 or 1 at a
+ *	random position, with silence elsewhere.
+ *	\param frames_per_impulse The cell size, at least one frame.
+ */
+void velvet( uint64_t seed, double frames_per_impulse, uint64_t start_frame, Sample * out, Frame num_frames );
+
+}
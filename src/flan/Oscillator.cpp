@@ -0,0 +1,127 @@
+#include "flan/Oscillator.h"
+
+#include <array>
+#include <algorithm>
+
+using namespace flan;
+
+static constexpr Frame block_frames = 256;
+
+// Residual of a unit step, band limited with a two sample polynomial. Subtracting this from a signal at a downward jump of 2
+// removes most of the jump's aliasing.
+static float poly_blep( float t, float dt )
+	{
+	if( t < dt )
+		{
+		t /= dt;
+		return t + t - t * t - 1.0f;
+		}
+	else if( t > 1.0f - dt )
+		{
+		t = ( t - 1.0f ) / dt;
+		return t * t + t + t + 1.0f;
+		}
+	else return 0.0f;
+	}
+
+// Integrated poly_blep, used at changes in slope rather than jumps
+static float poly_blamp( float t, float dt )
+	{
+	if( t < dt )
+		{
+		t = t / dt - 1.0f;
+		return -1.0f / 3.0f * t * t * t;
+		}
+	else if( t > 1.0f - dt )
+		{
+		t = ( t - 1.0f ) / dt + 1.0f;
+		return 1.0f / 3.0f * t * t * t;
+		}
+	else return 0.0f;
+	}
+
+static float wrap( float t )
+	{
+	return t >= 1.0f ? t - 1.0f : t;
+	}
+
+Oscillator::Oscillator( Shape _shape, Cycle start_phase )
+	: shape( _shape )
+	, phase( start_phase - std::floor( start_phase ) )
+	{
+	}
+
+Cycle Oscillator::get_phase() const
+	{
+	return Cycle( phase );
+	}
+
+void Oscillator::render( const float * frequencies, Sample * out, Frame num_frames )
+	{
+	for( Frame start = 0; start < num_frames; start += block_frames )
+		render_block( frequencies + start, out + start, std::min( block_frames, num_frames - start ) );
+	}
+
+void Oscillator::render_block( const float * frequencies, Sample * out, Frame num_frames )
+	{
+	// Phase accumulation is the only serial dependency, so it gets its own loop and the shaping loops below vectorize
+	std::array<float, block_frames> phases;
+	for( Frame frame = 0; frame < num_frames; ++frame )
+		{
+		phases[frame] = float( phase );
+		phase += frequencies[frame];
+		phase -= std::floor( phase );
+		}
+
+	// Corrections assume at most one discontinuity per frame, which holds below Nyquist
+	auto get_dt = [&]( Frame frame ){ return std::min( std::abs( frequencies[frame] ), 0.5f ); };
+
+	switch( shape )
+		{
+		case Shape::Sine:
+			for( Frame frame = 0; frame < num_frames; ++frame )
+				out[frame] = std::sin( pi2 * phases[frame] );
+			break;
+
+		case Shape::Saw:
+			for( Frame frame = 0; frame < num_frames; ++frame )
+				{
+				const float t = phases[frame];
+				out[frame] = 2.0f * t - 1.0f - poly_blep( t, get_dt( frame ) );
+				}
+			break;
+
+		case Shape::Square:
+			for( Frame frame = 0; frame < num_frames; ++frame )
+				{
+				const float t = phases[frame];
+				const float dt = get_dt( frame );
+				const float naive = t < 0.5f ? -1.0f : 1.0f;
+				out[frame] = naive - poly_blep( t, dt ) + poly_blep( wrap( t + 0.5f ), dt );
+				}
+			break;
+
+		case Shape::Triangle:
+			for( Frame frame = 0; frame < num_frames; ++frame )
+				{
+				const float t = phases[frame];
+				const float dt = get_dt( frame );
+				const float naive = t < 0.5f ? -1.0f + 4.0f * t : 3.0f - 4.0f * t;
+				out[frame] = naive + 4.0f * dt * ( poly_blamp( t, dt ) - poly_blamp( wrap( t + 0.5f ), dt ) );
+				}
+			break;
+
+		case Shape::Pulse:
+			for( Frame frame = 0; frame < num_frames; ++frame )
+				{
+				const float t = phases[frame];
+				const float dt = std::abs( frequencies[frame] );
+
+				// The largest odd number of harmonics, counting the negative ones and DC, which fits below Nyquist
+				const float num_harmonics = dt > 0 ? 2.0f * std::floor( 0.5f / dt ) + 1.0f : 1.0f;
+				const float denominator = num_harmonics * std::sin( pi * t );
+				out[frame] = std::abs( denominator ) < 1e-6f ? 1.0f : std::sin( pi * num_harmonics * t ) / denominator;
+				}
+			break;
+		}
+	}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "flan/defines.h"
+
+namespace flan {
+
+/** A band-limited oscillator which renders classic waveforms directly at the output rate, with a new frequency every frame.
+ *	Saw and square cancel the aliasing of their jumps with PolyBLEP residuals, and triangle rounds its corners with the
+ *	integrated residual, PolyBLAMP. Pulse is a band-limited impulse train (BLIT) from the closed form Dirichlet kernel, holding
+ *	every harmonic below Nyquist at equal amplitude, with peaks of one. Sine needs no correction.
+ *
+ *	Sine, square, saw, and triangle match the flan::waveforms of the same name, with a period and amplitude of one.
+ */
+struct Oscillator
+	{
+	enum class Shape
+		{
+		Sine,
+		Square,
+		Saw,
+		Triangle,
+		Pulse,
+		};
+
+	/** \param shape The waveform to render.
+	 *	\param start_phase The phase of the first frame, in cycles.
+	 */
+	Oscillator( Shape shape, Cycle start_phase = 0 );
+
+	/** Renders the next num_frames frames.
+	 *	\param frequencies The frequency at each frame, in cycles per frame. This is frequency in Hertz divided by the sample rate.
+	 *	\param out Output buffer with room for num_frames samples.
+	 *	\param num_frames The number of frames to render.
+	 */
+	void render( const float * frequencies, Sample * out, Frame num_frames );
+
+	/** The phase of the next frame to be rendered, in cycles on [0,1).
+	 */
+	Cycle get_phase() const;
+
+private:
+	void render_block( const float * frequencies, Sample * out, Frame num_frames );
+
+	Shape shape;
+	double phase;
+	};
+
+}
@@ -0,0 +1,169 @@
+#include "flan/Oversampler.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "flan/DSPUtility.h"
+#include "flan/Utility/Trace.h"
+
+using namespace flan;
+
+static constexpr int max_stages = 4;
+
+// Nonzero coefficients on one side of each stage's center tap. Later stages have wider transition bands to work with.
+static int get_stage_half_length( int stage )
+	{
+	return stage == 0 ? 16 : stage == 1 ? 8 : 4;
+	}
+
+// Designs are built on first use and kept for the life of the program
+static const std::vector<std::vector<float>> & get_design( int num_stages )
+	{
+	static std::mutex mutex;
+	static std::map<int, std::unique_ptr<const std::vector<std::vector<float>>>> designs;
+
+	std::lock_guard<std::mutex> lock( mutex );
+	auto & design = designs[num_stages];
+	if( !design )
+		{
+		auto stages = std::make_unique<std::vector<std::vector<float>>>();
+		for( int stage = 0; stage < num_stages; ++stage )
+			stages->push_back( design_halfband( get_stage_half_length( stage ) ) );
+		design = std::move( stages );
+		}
+	return *design;
+	}
+
+Oversampler::Oversampler( uint16_t factor )
+	: stages()
+	, latency( 0 )
+	, oversampled_latency( 0 )
+	{
+	int num_stages = 0;
+	while( num_stages < max_stages && ( 1 << num_stages ) < factor ) ++num_stages;
+
+	const auto & design = get_design( num_stages );
+	stages.resize( num_stages );
+	for( int i = 0; i < num_stages; ++i )
+		{
+		Stage & stage = stages[i];
+		stage.coefficients = &design[i];
+		const int half_length = stage.coefficients->size();
+
+		// A stage delays by 2M-1 samples at its low rate, which is 2^i times the original rate
+		const int stage_delay = 2 * half_length - 1;
+		const int stage_rate = 1 << i;
+		stage.extra_delay = ( stage_rate - stage_delay % stage_rate ) % stage_rate;
+		latency += ( stage_delay + stage.extra_delay ) / stage_rate;
+		oversampled_latency += half_length << ( num_stages - i );
+
+		stage.up.resize( 2 * half_length, 0 );
+		stage.down.resize( 4 * half_length - 2 + 2 * stage.extra_delay, 0 );
+
+		// Reserve for the largest block up front, so process never allocates
+		const Frame max_stage_frames = max_block_frames << i;
+		stage.up.reserve( stage.up.size() + max_stage_frames );
+		stage.high.reserve( 2 * max_stage_frames );
+		stage.down.reserve( stage.down.size() + 2 * max_stage_frames );
+		stage.low.reserve( max_stage_frames );
+		}
+	}
+
+uint16_t Oversampler::get_factor() const
+	{
+	return uint16_t( 1 << stages.size() );
+	}
+
+Frame Oversampler::get_latency() const
+	{
+	return latency;
+	}
+
+Frame Oversampler::get_oversampled_latency() const
+	{
+	return oversampled_latency;
+	}
+
+void Oversampler::reset()
+	{
+	for( Stage & stage : stages )
+		{
+		std::fill( stage.up.begin(), stage.up.end(), 0 );
+		std::fill( stage.down.begin(), stage.down.end(), 0 );
+		}
+	}
+
+void Oversampler::process( const Sample * in, Sample * out, Frame num_frames, const Shaper & shaper )
+	{
+	for( Frame start = 0; start < num_frames; start += max_block_frames )
+		process_block( in + start, out + start, std::min( max_block_frames, num_frames - start ), shaper );
+	}
+
+void Oversampler::process_block( const Sample * in, Sample * out, Frame num_frames, const Shaper & shaper )
+	{
+	if( stages.empty() )
+		{
+		std::copy( in, in + num_frames, out );
+		shaper( out, num_frames );
+		return;
+		}
+
+	const Sample * src = in;
+	Frame len = num_frames;
+
+	// Upsample. Even outputs are the input itself, odd outputs are the interpolating branch.
+	for( Stage & stage : stages )
+		{
+		const std::vector<float> & c = *stage.coefficients;
+		const int M = c.size();
+		const int history = 2 * M;
+
+		stage.up.resize( history + len );
+		std::copy( src, src + len, stage.up.begin() + history );
+		stage.high.resize( 2 * len );
+		for( Frame t = 0; t < len; ++t )
+			{
+			const Sample * x = stage.up.data() + history + t - M;
+			float acc = 0;
+			for( int j = 1; j <= M; ++j )
+				acc += c[j-1] * ( x[j] + x[1-j] );
+			stage.high[2*t] = x[0];
+			stage.high[2*t+1] = 2.0f * acc;
+			}
+		std::copy( stage.up.end() - history, stage.up.end(), stage.up.begin() );
+
+		src = stage.high.data();
+		len *= 2;
+		}
+
+	shaper( stages.back().high.data(), len );
+
+	// Downsample. Only the even outputs are computed, from the center tap and the odd branch.
+	for( int i = stages.size() - 1; i >= 0; --i )
+		{
+		Stage & stage = stages[i];
+		const std::vector<float> & c = *stage.coefficients;
+		const int M = c.size();
+		const int history = 4 * M - 2 + 2 * stage.extra_delay;
+
+		len /= 2;
+		stage.down.resize( history + 2 * len );
+		std::copy( src, src + 2 * len, stage.down.begin() + history );
+		stage.low.resize( len );
+		for( Frame t = 0; t < len; ++t )
+			{
+			const Sample * u = stage.down.data() + history + 2 * t + 2 - 2 * M - 2 * stage.extra_delay;
+			float acc = 0.5f * u[0];
+			for( int j = 1; j <= M; ++j )
+				acc += c[j-1] * ( u[2*j-1] + u[1-2*j] );
+			stage.low[t] = acc;
+			}
+		std::copy( stage.down.end() - history, stage.down.end(), stage.down.begin() );
+
+		src = stage.low.data();
+		}
+
+	std::copy( src, src + num_frames, out );
+	}
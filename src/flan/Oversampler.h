@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include "flan/defines.h"
+
+namespace flan {
+
+/** A streaming oversampler built from a cascade of polyphase half-band FIR stages, each doubling the sample rate. Signal is
+ *	pushed through in blocks: each block is upsampled, handed to a shaper at the oversampled rate, and downsampled again,
+ *	with every intermediate buffer sized to the block so the whole round trip stays in cache.
+ *
+ *	Half of a half-band filter's coefficients are zero, and the remaining ones are split into polyphase branches, so a stage
+ *	costs one multiply per nonzero coefficient per output sample. The first stage sees the most aliasing and uses the longest
+ *	filter; later stages work on signal which is already band limited and use shorter ones. Filter designs are computed once
+ *	per factor and shared between all oversamplers.
+ *
+ *	An Oversampler holds the filter history of one channel. Use one per channel, they can run in parallel.
+ */
+struct Oversampler
+	{
+	/** Shapes num_samples oversampled samples in place.
+	 */
+	using Shaper = std::function<void ( Sample * samples, Frame num_samples )>;
+
+	// The most frames at the original rate processed in one round trip
+	static constexpr Frame max_block_frames = 256;
+
+	/** \param factor The oversampling factor. This is rounded up to a power of two, and is at most 16.
+	 */
+	Oversampler( uint16_t factor );
+
+	uint16_t get_factor() const;
+
+	/** The delay from input to output, in frames at the original rate. This is a whole number of frames.
+	 */
+	Frame get_latency() const;
+
+	/** The delay from input to the samples passed to the shaper, in oversampled frames.
+	 */
+	Frame get_oversampled_latency() const;
+
+	/** Zeros all filter history.
+	 */
+	void reset();
+
+	/** Upsamples in, applies shaper to the oversampled signal, and downsamples into out. This never allocates.
+	 *	\param in Input samples at the original rate.
+	 *	\param out Output samples, delayed by get_latency() frames. This may be the same as in.
+	 *	\param num_frames The number of frames in in and out. Any number is allowed.
+	 *	\param shaper Called on consecutive blocks of at most max_block_frames * get_factor() oversampled samples.
+	 */
+	void process( const Sample * in, Sample * out, Frame num_frames, const Shaper & shaper );
+
+private:
+	struct Stage
+		{
+		const std::vector<float> * coefficients; // Nonzero coefficients on one side of the center tap, nearest first
+		int extra_delay; // Low rate samples added to the downsampler so the stage latency is whole at the original rate
+		std::vector<Sample> up; // Upsampler history followed by the current block
+		std::vector<Sample> high; // Upsampler output
+		std::vector<Sample> down; // Downsampler history followed by the current block
+		std::vector<Sample> low; // Downsampler output
+		};
+
+	void process_block( const Sample * in, Sample * out, Frame num_frames, const Shaper & shaper );
+
+	std::vector<Stage> stages;
+	Frame latency;
+	Frame oversampled_latency;
+	};
+
+}
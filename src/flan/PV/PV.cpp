@@ -1,4 +1,5 @@
 #include "flan/PV/PV.h"
+#include "flan/Utility/Trace.h"
 
 #include <iostream>
 #include <complex>
@@ -23,6 +24,7 @@ static std::vector<const T *> get_pointers( const std::vector<T> & ts )
 
 PV PV::get_frame( Second time ) const
 	{
+	flan_TRACE_SPAN( "PV::get_frame", *this );
 	if( is_null() ) return PV();
 
 	const float selectedFrame = std::clamp( time_to_frame( time ), 0.0f, float( get_num_frames() - 1 ) );
@@ -40,6 +42,7 @@ PV PV::get_frame( Second time ) const
 
 MF PV::getBinInterpolated( Channel channel, float frame, float bin, const Interpolator & i ) const
 	{
+	flan_TRACE_SPAN( "PV::getBinInterpolated", *this );
 	const std::array< MF, 4 > p = 
 		{
 		get_MF( channel, floor( frame ), floor( bin ) ),
@@ -61,6 +64,7 @@ MF PV::getBinInterpolated( Channel channel, float frame, float bin, const Interp
 
 MF PV::getBinInterpolated( Channel channel, float frame, Bin bin, const Interpolator & i ) const
 	{
+	flan_TRACE_SPAN( "PV::getBinInterpolated", *this );
 	const MF & l = get_MF( channel, floor( frame ), bin );
 	const MF & h = get_MF( channel, ceil ( frame ), bin );
 
@@ -74,6 +78,7 @@ MF PV::getBinInterpolated( Channel channel, float frame, Bin bin, const Interpol
 
 MF PV::getBinInterpolated( Channel channel, Frame frame, float bin, const Interpolator & i ) const
 	{
+	flan_TRACE_SPAN( "PV::getBinInterpolated", *this );
 	const auto l = get_MF( channel, frame, floor( bin ) );
 	const auto h = get_MF( channel, frame, ceil ( bin ) );
 
@@ -94,6 +99,7 @@ PV PV::select(
 	const Function<TF, TF> & selector
 	) const
 	{
+	flan_TRACE_SPAN( "PV::select", *this );
 	if( is_null() ) return PV();
 	if( length <= 0.0f ) return PV();
 
@@ -130,6 +136,7 @@ PV PV::freeze(
 	const std::vector<Second> & pause_times,
 	const std::vector<Second> & pause_lengths ) const
 	{
+	flan_TRACE_SPAN( "PV::freeze", *this );
 	if( is_null() ) return PV();
 
 	if( pause_lengths.size() != pause_times.size() ) 
@@ -202,8 +209,9 @@ PV PV::freeze(
 // Combinations
 //========================================================================
 
-PV PV::replace_amplitudes( const PV & amp_source, const Function<TF, float> & amount ) const
+PV PV::replace_amplitudes( const PV & amp_source, const Function<TF, float> & amount ) const &
 	{
+	flan_TRACE_SPAN( "PV::replace_amplitudes", *this );
 	if( is_null() ) return PV();
 
 	// Input validation
@@ -235,8 +243,42 @@ PV PV::replace_amplitudes( const PV & amp_source, const Function<TF, float> & am
 	return out;
 	}
 
+PV PV::replace_amplitudes( const PV & amp_source, const Function<TF, float> & amount ) &&
+	{
+	flan_TRACE_SPAN( "PV::replace_amplitudes", *this );
+	if( is_null() ) return PV();
+
+	// Input validation
+	if( amp_source.is_null() ) return PV();
+	auto amount_sampled = sample_function_over_domain( amount );
+	amount_sampled.for_each( []( float & amount ){ amount = std::clamp( amount, 0.0f, 1.0f ); } );
+
+	const uint32_t num_channels = std::min( amp_source.get_num_channels(), get_num_channels() );
+	const uint32_t num_frames   = std::min( amp_source.get_num_frames(),   get_num_frames()   );
+	const uint32_t num_bins     = std::min( amp_source.get_num_bins(),     get_num_bins()     );
+
+	// Anything outside of amp_source is zeroed to match the const version
+	for( Channel channel = 0; channel < get_num_channels(); ++channel )
+		std::for_each( FLAN_PAR_UNSEQ iota_iter( 0 ), iota_iter( get_num_frames() ), [&]( Frame frame )
+			{
+			for( Bin bin = 0; bin < get_num_bins(); ++bin )
+				{
+				MF & currentBin = get_MF( channel, frame, bin );
+				if( channel < num_channels && frame < num_frames && bin < num_bins )
+					{
+					const float amount_c = amount_sampled.at( frame, bin );
+					currentBin.m = amp_source.get_MF( channel, frame, bin ).m * amount_c + currentBin.m * ( 1.0f - amount_c );
+					}
+				else
+					currentBin = { 0, 0 };
+				}
+			} );
+	return std::move( *this );
+	}
+
 PV PV::subtract_amplitudes( const PV & amp_source, const Function<TF, float> & amount ) const
 	{
+	flan_TRACE_SPAN( "PV::subtract_amplitudes", *this );
 	if( is_null() ) return PV();
 
 	// Input validation
@@ -276,6 +318,7 @@ PV PV::synthesize(
 	const Function<TF, Frequency> & harmonic_frequency_std_dev
 	)
 	{
+	flan_TRACE_SPAN( "PV::synthesize" );
 	PV::Format format;
 	format.num_bins = 2049;
 	format.num_channels = 1;
@@ -408,18 +451,21 @@ static PV harmonic_scaler(
 
 PV PV::add_octaves( const Function<std::pair<Second, Harmonic>, float> & series ) const
 	{
+	flan_TRACE_SPAN( "PV::add_octaves", *this );
 	if( is_null() ) return PV();
 	return harmonic_scaler( *this, series, []( Frequency f, Harmonic h ){ return f * std::pow( 2, h ); }, std::ceil( std::log2( get_height() ) ) );
 	}
 
 PV PV::add_harmonics( const Function<std::pair<Second, Harmonic>, float> & series ) const
 	{
+	flan_TRACE_SPAN( "PV::add_harmonics", *this );
 	if( is_null() ) return PV();
 	return harmonic_scaler( *this, series, []( Frequency f, Harmonic h ){ return f * ( h + 1 ); }, get_num_bins() );
 	}
 
-PV PV::shape( const Function<MF,MF> & shaper, bool use_shift_alignment ) const
+PV PV::shape( const Function<MF,MF> & shaper, bool use_shift_alignment ) const &
 	{
+	flan_TRACE_SPAN( "PV::shape", *this );
 	if( is_null() ) return PV();
 
 	PV out( get_format() );
@@ -457,6 +503,50 @@ PV PV::shape( const Function<MF,MF> & shaper, bool use_shift_alignment ) const
 	return out;
 	}
 
+PV PV::shape( const Function<MF,MF> & shaper, bool use_shift_alignment ) &&
+	{
+	flan_TRACE_SPAN( "PV::shape", *this );
+	if( is_null() ) return PV();
+
+	for( Channel channel = 0; channel < get_num_channels(); ++channel )
+		{
+		runtime_execution_policy_handler( shaper.get_execution_policy(), [&]( auto policy ){
+		std::for_each( FLAN_POLICY iota_iter( 0 ), iota_iter( get_num_frames() ), [&]( Frame frame )
+			{
+			MF * const frame_start = &get_MF( channel, frame, 0 );
+
+			if( use_shift_alignment )
+				{
+				// Shaped MFs can land in any bin of the frame, so the input frame is read from a copy
+				const std::vector<MF> in_frame( frame_start, frame_start + get_num_bins() );
+				std::fill( frame_start, frame_start + get_num_bins(), MF{ 0, 0 } );
+
+				for( Bin bin = 0; bin < get_num_bins(); ++bin )
+					{
+					const MF inMF = in_frame[bin];
+					const MF shapedMF = shaper( inMF );
+
+					const Bin binShift = bin - frequency_to_bin( inMF.f );
+					const Bin shapedMFBin = frequency_to_bin( shapedMF.f ) + binShift;
+					if( shapedMFBin < 0 || get_num_bins() <= shapedMFBin ) 
+						continue;
+
+					MF & outMF = frame_start[shapedMFBin];
+					if( shapedMF.m > outMF.m )
+						outMF = shapedMF;
+					}
+				}
+			else 
+				{
+				for( Bin bin = 0; bin < get_num_bins(); ++bin )
+					frame_start[bin] = shaper( frame_start[bin] );
+				}
+			} ); } );
+		}
+			
+	return std::move( *this );
+	}
+
 // PV PV::perturb( 
 // 	const Function<TF, MF> & mf_std_dev,
 // 	float damping 
@@ -589,18 +679,21 @@ PV predicateNLoudestPartials( const PV & me, const Function<Second, Bin> & num_b
 
 PV PV::retain_n_loudest_partials( const Function<Second, Bin> & num_bins ) const
 	{
+	flan_TRACE_SPAN( "PV::retain_n_loudest_partials", *this );
 	if( is_null() ) return PV();
 	return predicateNLoudestPartials( *this, num_bins, []( Bin a, Bin b ){ return a < b; } );
 	}
 
 PV PV::remove_n_loudest_partials( const Function<Second, Bin> & num_bins ) const
 	{
+	flan_TRACE_SPAN( "PV::remove_n_loudest_partials", *this );
 	if( is_null() ) return PV();
 	return predicateNLoudestPartials( *this, num_bins, []( Bin a, Bin b ){ return a >= b; } );
 	}
 
-PV PV::resonate( Second length, const Function<TF, float> & decay ) const
+PV PV::resonate( Second length, const Function<TF, float> & decay ) const &
 	{
+	flan_TRACE_SPAN( "PV::resonate", *this );
 	if( is_null() ) return PV();
 
 	// Input validation
@@ -640,11 +733,44 @@ PV PV::resonate( Second length, const Function<TF, float> & decay ) const
 	return out;
 	}
 
+PV PV::resonate( Second length, const Function<TF, float> & decay ) &&
+	{
+	flan_TRACE_SPAN( "PV::resonate", *this );
+	if( is_null() ) return PV();
+
+	// Any added length needs a larger buffer, so only the same size case can work on this buffer
+	if( length > 0 )
+		return std::as_const( *this ).resonate( length, decay );
+
+	auto decay_sampled = sample_function_over_domain( decay );
+	decay_sampled.for_each( []( float & x ){ x = std::clamp( x, 0.0f, 1.0f ); } );
+	
+	const float secondsPerFrame_c = frame_to_time( 1 );
+
+	// The first frame is already in place, and each later frame only reads the input at that frame before writing it
+	for( Channel channel = 0; channel < get_num_channels(); ++channel )
+		std::for_each( FLAN_PAR_UNSEQ iota_iter( 0 ), iota_iter( get_num_bins() ), [&]( Bin bin )
+			{
+			for( Frame frame = 1; frame < get_num_frames(); ++frame )
+				{
+				const float decay_t = std::pow( decay_sampled.at( frame, bin ), secondsPerFrame_c );
+				const MF previous = get_MF( channel, frame - 1, bin );
+				const float decayed_amp = previous.m * decay_t;
+				MF & current = get_MF( channel, frame, bin );
+				if( current.m <= decayed_amp )
+					current = { decayed_amp, previous.f };
+				}
+			} );
+
+	return std::move( *this );
+	}
+
 PV PV::cut_frames( 
 	Frame start, 
 	Frame end
 	) const
 	{
+	flan_TRACE_SPAN( "PV::cut_frames", *this );
 	if( is_null() ) return PV::create_null();
 
 	// Input validation
@@ -671,6 +797,7 @@ std::vector<PV> PV::split_at_times(
 	std::vector<Second> split_times
 	) const
 	{
+	flan_TRACE_SPAN( "PV::split_at_times", *this );
 	if( is_null() ) return std::vector<PV>();
 
 	std::sort( split_times.begin(), split_times.end() );
@@ -699,6 +826,7 @@ PV PV::join(
 	const std::vector<const PV *> & ins
 	)
 	{
+	flan_TRACE_SPAN( "PV::join" );
 	if( ins.size() == 0 ) return PV::create_null();
 
 	Format format = ins[0]->get_format();
@@ -723,6 +851,7 @@ PV PV::join(
 	const std::vector<PV> & ins
 	)
 	{
+	flan_TRACE_SPAN( "PV::join" );
 	return PV::join( get_pointers( ins ) );
 	}
 
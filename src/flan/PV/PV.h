@@ -134,10 +134,13 @@ public:
 		Frame num_frames;
 		Bin num_bins;
 		std::vector<float> buffer;
+		Frame start_frame = 0; // The PV frame of the first buffer frame, nonzero when only some frames were analyzed
 		};
 
 	/** This attempts to find the percieved volume at every tenth of a note over time. Meant to be used by PV::get_contours.
 	 *    Note this doesn't use a percieved volume filter like it maybe should. I didn't want to deal with it.
+	 *	Results for the last few PVs analyzed are cached by content, so repeated analysis of the same data is free. 
+	 *	See SalienceWorkspace for analyzing part of a PV without allocating.
 	 *	\param channel The channel to analyze.
 	 *	\param min_frequency Frequency of the lowest pitch bin.
 	 *	\param max_frequency Frequency of the highest pitch bin.
@@ -266,7 +269,8 @@ public:
 	 */
 	PV modify( 
 		const Function<TF, TF> & mod, 
-		const Interpolator & interp = Interpolator::linear() 
+		const Interpolator & interp = Interpolator::linear(),
+		flan_CANCEL_ARG 
 		) const;
 
 	/** This is functionally equivalent to using PV::modify and only outputting the input time
@@ -275,7 +279,8 @@ public:
 	 */
 	PV modify_frequency( 
 		const Function<TF, Frequency> & mod, 
-		const Interpolator & = Interpolator::linear() 
+		const Interpolator & = Interpolator::linear(),
+		flan_CANCEL_ARG 
 		) const;
 
 	/** This is functionally equivalent to using PV::modify and only outputting the input frequency
@@ -284,7 +289,8 @@ public:
 	 */
 	PV modify_time( 
 		const Function<TF, Second> & mod, 
-		const Interpolator & = Interpolator::linear() 
+		const Interpolator & = Interpolator::linear(),
+		flan_CANCEL_ARG 
 		) const;
 
 	/** This is functionally equivalent to using PV::modify_frequency with the mod output multiplied by input frequency
@@ -293,7 +299,8 @@ public:
 	 */
 	PV repitch( 
 		const Function<TF, float> & factor, 
-		const Interpolator & = Interpolator::linear() 
+		const Interpolator & = Interpolator::linear(),
+		flan_CANCEL_ARG 
 		) const;
 
 	/** This is functionally equivalent to using PV::modifySecond with the mod output multiplied by input time
@@ -302,7 +309,8 @@ public:
 	 */
 	PV stretch( 
 		const Function<TF, float> & factor, 
-		const Interpolator & = Interpolator::linear() 
+		const Interpolator & = Interpolator::linear(),
+		flan_CANCEL_ARG 
 		) const;
 
 	/** This is close to PV::stretch, but can only expand the input by integer quantities at any given time.
@@ -312,7 +320,8 @@ public:
 	 *		Output will be rounded to the nearest integer and clamped to positive integers.
 	 */
 	PV stretch_spline( 
-		const Function<Second, float> & expansion 
+		const Function<Second, float> & expansion,
+		flan_CANCEL_ARG 
 		) const;
 
 	/** This is functionally equivalent to stretching the input down by factor, and then up.
@@ -322,7 +331,32 @@ public:
 	 */
 	PV desample( 
 		const Function<TF, float> & decimation_ratio, 
-		const Interpolator & interp = Interpolator::linear() 
+		const Interpolator & interp = Interpolator::linear(),
+		flan_CANCEL_ARG 
+		) const;
+
+	/** Changes the analysis rate and bin count without converting through Audio. Magnitudes are interpolated in time, and
+	 *	frequencies are averaged over each output hop, so the phase a bin advances over any stretch of time is kept. Adding bins
+	 *	interpolates between the input bins, and removing bins keeps the loudest input bin nearest each output bin. Frequencies
+	 *	always come from a single input bin rather than being averaged across bins, so partials stay in tune.
+	 *	The sample rate is kept. If the output has fewer bins than the input window size, the window is shortened to fit and
+	 *	magnitudes are scaled to match.
+	 *	\param analysis_rate The output analysis rate.
+	 *	\param num_bins The output bin count, or 0 to keep the input bin count.
+	 */
+	PV resample( 
+		FrameRate analysis_rate, 
+		Bin num_bins = 0,
+		flan_CANCEL_ARG 
+		) const;
+
+	/** Resamples to the analysis rate and bin count of another PV, so the two can be combined frame for frame and bin for bin,
+	 *	as in PV::replace_amplitudes. Both PVs must have the same sample rate.
+	 *	\param other The PV to match.
+	 */
+	PV resample_to_match( 
+		const PV & other,
+		flan_CANCEL_ARG 
 		) const;
 
 	/** This is desamples big brother. This process assigns to each output MF an average of the surrounding MFs in time.
@@ -336,7 +370,8 @@ public:
 		const Function<Second, float> & distribution = []( Second t )
 			{ 
 			return 0.5f * ( 1.0f + std::cos( std::_Pi * t ) );
-			}
+			},
+		flan_CANCEL_ARG 
 		) const;
 
 	/** Warning: this process can produce very loud outputs with unscrupulouss parameters.
@@ -404,7 +439,12 @@ public:
 	PV replace_amplitudes( 
 		const PV & amp_source, 
 		const Function<TF, float> & amount = 1 
-		) const;
+		) const &;
+
+	PV replace_amplitudes( 
+		const PV & amp_source, 
+		const Function<TF, float> & amount = 1 
+		) &&;
 
 	/** Subtracts the Amplitudes (Magnitudes) of bins in other with those in this
 	 *	\param amp_source Source PV from which to draw amplitudes to subtract.
@@ -426,7 +466,12 @@ public:
 	PV shape( 
 		const Function<MF,MF> & shaper, 
 		bool use_shift_alignment = false 
-		) const;
+		) const &;
+
+	PV shape( 
+		const Function<MF,MF> & shaper, 
+		bool use_shift_alignment = false 
+		) &&;
 
 	/** Modifies the input data in random ways using normal distributions.
 	 *	\param magnitude_std_dev Standard deviation for MF distribution.
@@ -466,7 +511,12 @@ public:
 	PV resonate( 
 		Second length, 
 		const Function<TF, float> & decay 
-		) const;
+		) const &;
+
+	PV resonate( 
+		Second length, 
+		const Function<TF, float> & decay 
+		) &&;
 
 
 	// These procs are here to get time splitting for PV so that falter can do "apply_to_section" on a PV
@@ -8,6 +8,7 @@
 #include <execution>
 
 #include "flan/Utility/Bytes.h"
+#include "flan/Utility/Trace.h"
 
 namespace flan {
 
@@ -19,7 +20,9 @@ PVBuffer::PVBuffer()
 PVBuffer::PVBuffer( const Format & other )
 	: format( other )
 	, buffer( get_num_channels() * get_num_frames() * get_num_bins() )
-	{}
+	{
+	flan_TRACE_ALLOCATION( buffer.size() * sizeof( MF ) );
+	}
 
 PVBuffer::PVBuffer( const std::string & filename )
 	: format()
@@ -33,6 +36,7 @@ PVBuffer PVBuffer::copy() const
 	PVBuffer out;
 	out.format = format;
 	out.buffer = buffer; // Deep copy
+	flan_TRACE_ALLOCATION( buffer.size() * sizeof( MF ) );
 	return out;
 	}
 
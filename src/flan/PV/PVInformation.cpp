@@ -1,13 +1,20 @@
 #include "flan/PV/PV.h"
+#include "flan/Utility/Trace.h"
 
 #include <iostream>
 #include <numeric>
+#include <queue>
+#include <array>
+#include <bit>
+#include <tuple>
 
 #include "flan/DSPUtility.h"
 #include "flan/WindowFunctions.h"
 #include "flan/Utility/vv_iterator.h"
 #include "flan/Utility/iota_iter.h"
 #include "flan/Utility/execution.h"
+#include "flan/Utility/LRUCache.h"
+#include "flan/PV/SalienceWorkspace.h"
 
 static const float pi = std::acos( -1.0f );
 
@@ -24,100 +31,102 @@ static bool notesClose( Frequency a, Frequency b )
 	return lo < r && r < hi; 
 	}
 
-// Returns normalized pitch salience
-PV::Salience PV::get_salience( Channel channel, Frequency min_frequency, Frequency max_frequency ) const
+namespace {
+
+// A frame's contour peaks. Peaks are tombstoned rather than erased, so taking one is constant time and the order of the rest is kept.
+struct PeakList
 	{
-	auto hann_dft2 = []( float f ) -> float
-		{
-		if( f == 0 ) return 1.0f;
-		if( std::abs( f ) == 1.0f ) return 0.5f;
-		return std::sin( pi * f ) / ( pi * f * ( 1.0f - f * f ) );
-		};
+	std::vector<vec2> peaks;
+	std::vector<uint8_t> alive;
+	size_t head = 0; // The first live peak, which is also the loudest in SPlus as it is sorted by magnitude
 
-	if( is_null() )
-		return Salience();
+	PeakList( std::vector<vec2> && p ) : peaks( std::move( p ) ), alive( peaks.size(), 1 ) {}
 
-	// Suggested optimal parameters from Salamon & Gomez
-	const int binEffectDist = 10;
-	const int Nh = 2 * 10;
-	const float alpha = 0.8f;
-	//const float beta = 1.0f; - Unimplemented in code
-	const float gamma = 40.0f;
-	const float eTestFactor = std::pow( 10, gamma / 20.0f );
-
-	// Precomute powers of alpha
-	std::array<float,Nh> alphaPowers{};
-	alphaPowers[0] = 1.0f;
-	for( int i = 1; i < Nh; ++i ) alphaPowers[i] = alphaPowers[i-1] * alpha;
-
-	// Precompute cosine outputs
-	std::array<float, 2 * binEffectDist + 1> gOutputs;
-	std::for_each( FLAN_PAR_UNSEQ iota_iter(0), iota_iter( binEffectDist+1 ), [&]( int i )
-		{ gOutputs[i] = .5f * ( 1.0f + std::cos( float( i ) / binEffectDist * pi / 2.0f ) ); } );
-
-	auto B = [log2MinFreq = std::log2( min_frequency )]( Frequency f ) -> Bin
+	template<typename P>
+	int find_live( P predicate ) const
 		{
-		return std::round( 10.0f * 12.0f * ( std::log2( f ) - log2MinFreq ) );
-		};
+		for( size_t i = head; i < peaks.size(); ++i )
+			if( alive[i] && predicate( peaks[i] ) ) 
+				return i;
+		return -1;
+		}
 
-	Salience salience;
-	salience.num_bins = B( max_frequency );
-	salience.num_frames = get_num_frames();
-	salience.buffer.resize( salience.num_bins * salience.num_frames, 0 );
-		
-	std::for_each( FLAN_PAR_UNSEQ iota_iter(0), iota_iter(salience.num_frames), [&]( Frame frame )
+	void remove( size_t i )
 		{
-		const Magnitude a_M = get_max_partial_magnitude( frame, frame + 1 ); // Get mazimum magnitude for this frame
-		const float aiLimit = a_M / eTestFactor; // Checking a_i > limit is equivalent to checking 10log_20(aM/ai) < gamma
+		alive[i] = 0;
+		while( head < peaks.size() && !alive[head] ) ++head;
+		}
 
-		// Get frame-wise peaks
-		const MF * framePtr = get_MF_pointer( channel, frame, 0 );
-		auto magPeakFunc = [framePtr]( int i ) -> float { return framePtr[i].m; };
-		const std::vector<vec2> peaks = find_peaks( magPeakFunc, get_num_bins(), -1, false, false );
+	bool empty() const { return head == peaks.size(); }
+	};
 
-		for( const vec2 & i : peaks )
+}
+
+// Hashes every magnitude and frequency in pv, so cached analysis can be reused for an identical PV. Eight independent lanes
+// keep the multiplies from forming one long dependency chain.
+static uint64_t fingerprint( const PV & pv )
+	{
+	const MF * data = pv.get_MF_pointer( 0, 0, 0 );
+	const size_t size = size_t( pv.get_num_channels() ) * pv.get_num_frames() * pv.get_num_bins();
+
+	std::array<uint64_t, 8> lanes;
+	lanes.fill( 0xcbf29ce484222325ull );
+	const size_t num_blocks = size / 4;
+	for( size_t block = 0; block < num_blocks; ++block )
+		for( size_t k = 0; k < 4; ++k )
 			{
-			if( i.y() < aiLimit ) continue;
-
-			// Instantaneous amplitude correction
-			const Bin bin = i.x(); // PV bin
-			const float iF = framePtr[bin].f;
-			const float binOffset = frequency_to_bin( iF ) - i.x();
-			const float kernelFactor = hann_dft2( binOffset * get_window_size() / get_dft_size() );
-			const float iM = kernelFactor >= 0.5f? i.y() / kernelFactor : 0;
-				
-			for( int h = 0; h < Nh; ++h ) // For each subharmonic the current peak could be a harmonic of:
-				{
-				const Bin B_c = B( iF / ( h + 1 ) ); // Get subharmonic pitch bin
-				if( B_c < 0 ) break;
-
-				// Contribute to the salience of the subharmonic for all nearby bins
-				// Delta checking is handled in loop bounds
-				const Bin loopStart = std::max( 0, B_c - binEffectDist );
-				const Bin loopEnd = std::min( salience.num_bins - 1, B_c + binEffectDist );
-				for( Bin b = loopStart; b <= loopEnd; ++b )
-					salience.get( frame, b ) += gOutputs[std::abs(B_c - b)] * alphaPowers[h] * iM;
-				}
+			const MF & mf = data[block * 4 + k];
+			lanes[2*k  ] = ( lanes[2*k  ] ^ std::bit_cast<uint32_t>( mf.m ) ) * 0x100000001b3ull;
+			lanes[2*k+1] = ( lanes[2*k+1] ^ std::bit_cast<uint32_t>( mf.f ) ) * 0x100000001b3ull;
 			}
+	for( size_t i = num_blocks * 4; i < size; ++i )
+		lanes[0] = ( ( lanes[0] ^ std::bit_cast<uint32_t>( data[i].m ) ) ^ std::bit_cast<uint32_t>( data[i].f ) ) * 0x100000001b3ull;
+
+	uint64_t hash = 0;
+	for( const uint64_t lane : lanes )
+		hash = ( hash ^ lane ) * 0x100000001b3ull;
+	return hash;
+	}
+
+// Salience is reused when the same PV, or an identical one, is analyzed again. prism and repeated calls to get_contours
+// on one PV hit this.
+static std::shared_ptr<const PV::Salience> get_cached_salience( const PV & pv, Channel channel, Frequency min_frequency, Frequency max_frequency )
+	{
+	using SalienceKey = std::tuple<uint64_t, Channel, Channel, Frame, Bin, FrameRate, Frame, Frequency, Frequency>;
+	static LRUCache<SalienceKey, PV::Salience> cache( 8 );
+
+	const SalienceKey key( fingerprint( pv ), channel, pv.get_num_channels(), pv.get_num_frames(), pv.get_num_bins(), pv.get_sample_rate(), 
+		pv.get_window_size(), min_frequency, max_frequency );
+	return cache.get_or_create( key, [&]()
+		{
+		SalienceWorkspace workspace( min_frequency, max_frequency );
+		return workspace.compute( pv, channel );
 		} );
+	}
+
+// Returns normalized pitch salience
+PV::Salience PV::get_salience( Channel channel, Frequency min_frequency, Frequency max_frequency ) const
+	{
+	flan_TRACE_SPAN( "PV::get_salience", *this );
 
-	// Normalize
-	const float max = *std::max_element( salience.buffer.begin(), salience.buffer.end() );
-	std::for_each( salience.buffer.begin(), salience.buffer.end(), [max]( float & x ){ x /= max; } );
+	if( is_null() )
+		return Salience();
 
-	return salience;
+	return *get_cached_salience( *this, channel, min_frequency, max_frequency );
 	}
 	
 std::vector<PV::Contour> PV::get_contours( Channel channel, Frequency min_frequency, Frequency max_frequency, 
 	Frame filter_short, float filter_quiet, flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "PV::get_contours", *this );
 	const float TPlus = 0.9f;
 	const float TSigma = 0.9f;
 	const float pitchBinInCents = 10;
 	const float maxdeltaPitch = 80; // cents
 	const Frame maxGapLength = time_to_frame( .1f );
 
-	const Salience salience = get_salience( channel, min_frequency, max_frequency );
+	if( is_null() ) return std::vector<PV::Contour>();
+	const Salience & salience = *get_cached_salience( *this, channel, min_frequency, max_frequency );
 	if( salience.buffer.empty() ) return std::vector<PV::Contour>();
 
 	// Get S+ and S-. SPlus is first used to store all peaks, then peaks are moved to S- as needed.
@@ -126,9 +135,11 @@ std::vector<PV::Contour> PV::get_contours( Channel channel, Frequency min_freque
 	std::vector<std::vector<vec2>> SMinus( get_num_frames() );
 	
 	// Frame-wise peak finding and thresholding
+	TaskProgress progress( context, "PV::get_contours", salience.num_frames );
 	for( Frame frame = 0; frame < salience.num_frames; ++frame )
 		{
 		flan_CANCEL_POINT( std::vector<PV::Contour>() );
+		progress.advance();
 
 		const auto salienceBegin = salience.buffer.begin() + frame * salience.num_bins;
 		SPlus[frame] = find_peaks( [salienceBegin]( int i ){ return salienceBegin[i]; }, salience.num_bins, -1, true, true );
@@ -166,24 +177,57 @@ std::vector<PV::Contour> PV::get_contours( Channel channel, Frequency min_freque
 		}
 
 	// Countour generation
+	std::vector<PeakList> SPlusLists, SMinusLists;
+	for( Frame frame = 0; frame < get_num_frames(); ++frame )
+		{
+		SPlusLists.emplace_back( std::move( SPlus[frame] ) );
+		SMinusLists.emplace_back( std::move( SMinus[frame] ) );
+		}
+
+	// Seeds are the loudest remaining SPlus peak of each frame, in a max heap. Ties go to the earliest frame. When a frame's 
+	// loudest peak is taken its next is pushed, and entries for taken peaks are skipped when they reach the top.
+	struct Seed
+		{
+		float salience;
+		Frame frame;
+		size_t index;
+		bool operator<( const Seed & other ) const 
+			{ 
+			return salience < other.salience || ( salience == other.salience && frame > other.frame ); 
+			}
+		};
+	std::priority_queue<Seed> seeds;
+	auto push_seed = [&]( Frame frame )
+		{
+		const PeakList & list = SPlusLists[frame];
+		if( !list.empty() ) seeds.push( { list.peaks[list.head].y(), frame, list.head } );
+		};
+	for( Frame frame = 0; frame < get_num_frames(); ++frame )
+		push_seed( frame );
+
+	auto take_SPlus = [&]( Frame frame, size_t index )
+		{
+		PeakList & list = SPlusLists[frame];
+		const bool was_head = index == list.head;
+		list.remove( index );
+		if( was_head ) push_seed( frame );
+		};
+
 	std::vector<Contour> contours;
-	while( true )
+	while( !seeds.empty() )
 		{
 		flan_CANCEL_POINT( std::vector<PV::Contour>() );
 
-		// Find current SPlus max. We only need to check the first element of each frame, as each frame is sorted by magnitude.
-		const int maxSPlusFrame = std::distance( SPlus.begin(), std::max_element( SPlus.begin(), SPlus.end(), []( const std::vector<vec2> & v, const std::vector<vec2> & w )
-			{ 
-			return ( v.empty()? 0 : v[0].y() )
-				 < ( w.empty()? 0 : w[0].y() ); 
-			} ) );
-		if( maxSPlusFrame >= SPlus.size() || SPlus[maxSPlusFrame].empty() ) break;
+		const Seed seed = seeds.top();
+		seeds.pop();
+		if( !SPlusLists[seed.frame].alive[seed.index] ) continue;
+		const Frame maxSPlusFrame = seed.frame;
 
 		// Push back new contour
 		contours.emplace_back();
 		Contour & contour = contours.back();
-		contour.bins.push_back( SPlus[maxSPlusFrame][0] );
-		SPlus[maxSPlusFrame].erase( SPlus[maxSPlusFrame].begin() );
+		contour.bins.push_back( SPlusLists[maxSPlusFrame].peaks[seed.index] );
+		take_SPlus( maxSPlusFrame, seed.index );
 
 		auto continuityExtender = [&]( Frame start, Frame end )
 			{
@@ -199,22 +243,22 @@ std::vector<PV::Contour> PV::get_contours( Channel channel, Frequency min_freque
 			for( Frame frame = start; frame != end && currentGap < maxGapLength; forward? ++frame : --frame )
 				{
 				// Look for peak near current peak pitch on next frame in SPlus
-				const auto newSPlusPitchBin = std::find_if( SPlus[frame].begin(), SPlus[frame].end(), continuityFinder );
-				if( newSPlusPitchBin != SPlus[frame].end() ) // Found in SPlus, sweet. Update and continue.
+				const int newSPlusPitchBin = SPlusLists[frame].find_live( continuityFinder );
+				if( newSPlusPitchBin != -1 ) // Found in SPlus, sweet. Update and continue.
 					{
-					contour.bins.push_back( *newSPlusPitchBin );
+					contour.bins.push_back( SPlusLists[frame].peaks[newSPlusPitchBin] );
 					currentPitchBin = contour.bins.back().x();
-					SPlus[frame].erase( newSPlusPitchBin );
+					take_SPlus( frame, newSPlusPitchBin );
 					currentGap = 0;
 					}
 				else // None found! Search S-.
 					{
-					const auto newSMinusPitchBin = std::find_if( SMinus[frame].begin(), SMinus[frame].end(), continuityFinder );
-					if( newSMinusPitchBin != SMinus[frame].end() ) // Backup found, but update time limit until we find in SPlus.
+					const int newSMinusPitchBin = SMinusLists[frame].find_live( continuityFinder );
+					if( newSMinusPitchBin != -1 ) // Backup found, but update time limit until we find in SPlus.
 						{
-						contour.bins.push_back( *newSMinusPitchBin );
+						contour.bins.push_back( SMinusLists[frame].peaks[newSMinusPitchBin] );
 						currentPitchBin = contour.bins.back().x();
-						SMinus[frame].erase( newSMinusPitchBin );
+						SMinusLists[frame].remove( newSMinusPitchBin );
 						++currentGap;
 						}
 					else break; // Aint nothin here for us, bail.
@@ -232,11 +276,14 @@ std::vector<PV::Contour> PV::get_contours( Channel channel, Frequency min_freque
 		std::reverse( contour.bins.begin(), contour.bins.end() );
 
 		// Repeat search but left to right
-		continuityExtender( maxSPlusFrame + 1, SPlus.size() );
+		continuityExtender( maxSPlusFrame + 1, get_num_frames() );
 
 		// Filter by length
-		if( contours.back().bins.size() < filter_short )
+		if( contour.bins.size() < filter_short )
+			{
 			contours.pop_back();
+			continue;
+			}
 
 		// Contour info generation
 		auto gainAccess = [&contour]( int i ){ return contour.bins[i].y(); };
@@ -248,7 +295,8 @@ std::vector<PV::Contour> PV::get_contours( Channel channel, Frequency min_freque
 		const vec2 pitchMSD = mean_and_sd( pitchAccess, contour.bins.size() );
 		contour.pitch_mean = pitchMSD.x();
 		contour.pitch_std_dev = pitchMSD.y();
-		};
+		}
+	if( contours.empty() ) return contours;
 
 	// Filter by salience
 	std::vector<Contour> contoursFiltered;
@@ -264,158 +312,215 @@ std::vector<PV::Contour> PV::get_contours( Channel channel, Frequency min_freque
 
 PV PV::prism( const PrismFunc & prism_func, bool use_local_contour_time, flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "PV::prism", *this );
 	if( is_null() ) return PV();
 
 	const Frequency min_frequency = 55.0;
 	const Frequency max_frequency = 1760.0;
 
+	flan_RESERVE_POINT( get_buffer().size() * sizeof( MF ), PV() );
 	PV out = copy();
 
 	auto pitch_bin_to_freq = [min_frequency]( float bin ){ return min_frequency * std::pow( 2.0f, bin / 120.0f ); };
 
-	// The pitch bins from the contour aren't exact enough, so we need to more accurately estimate the base frequency with a weighted mean of nearby bins
-	auto get_accurate_freq = [this]( Channel channel, Frame frame, Frequency approx_freq )
+	// A contour active on a frame
+	struct ActiveContour
+		{
+		Index contour_index;
+		Frame contour_frame;
+		Frequency base_freq;
+		};
+
+	// Working space for one frame, reused by every contour on it
+	struct Scratch
+		{
+		std::vector<Bin> harmonic_bins; // Bins of each harmonic, harmonic h owns [harmonic_bin_offsets[h], harmonic_bin_offsets[h+1])
+		std::vector<size_t> harmonic_bin_offsets;
+		std::vector<Bin> harmonic_max_mag_bins;
+		std::vector<Magnitude> harmonic_max_mags;
+		};
+
+	// The pitch bins from the contours aren't exact enough, so the base frequencies are estimated more accurately with a weighted
+	// mean of the bins within a half note. Every contour on the frame is refined in one pass over its bins.
+	auto refine_base_freqs = [this]( Channel channel, Frame frame, std::vector<ActiveContour> & frame_contours )
 		{
-		float total_weighted_freq = 0;
-		float total_mag = 0;
-		for( Bin bin = 0; bin < get_num_bins(); ++bin )
+		const size_t n = frame_contours.size();
+		std::vector<float> total_weighted_freq( n, 0 );
+		std::vector<float> total_mag( n, 0 );
+		const MF * source_ptr = get_MF_pointer( channel, frame, 0 );
+		for( Bin bin = 0; bin < get_num_bins(); ++bin, ++source_ptr )
 			{
-			const MF & source_MF = get_MF( channel, frame, bin );
+			const MF & source_MF = *source_ptr;
 			if( source_MF.f <= 0 ) continue;
-			if( notesClose( source_MF.f, approx_freq ) ) // Assert the bin has a frequency within a half a note of the target harmonic
-				{
-				const Magnitude abs_mag = std::abs( source_MF.m );
-				total_weighted_freq += source_MF.f * abs_mag;
-				total_mag += abs_mag;
-				}
+			for( size_t i = 0; i < n; ++i )
+				if( notesClose( source_MF.f, frame_contours[i].base_freq ) )
+					{
+					const Magnitude abs_mag = std::abs( source_MF.m );
+					total_weighted_freq[i] += source_MF.f * abs_mag;
+					total_mag[i] += abs_mag;
+					}
 			}
-		if( total_mag == 0 ) return 0.0f;
-		return total_weighted_freq / total_mag;
+		for( size_t i = 0; i < n; ++i )
+			frame_contours[i].base_freq = total_mag[i] == 0 ? 0.0f : total_weighted_freq[i] / total_mag[i];
 		};
 
-	for( Channel channel = 0; channel < get_num_channels(); ++channel )
+	// Rewrites the harmonics of one contour on one frame, reading from this and writing to out
+	auto apply_contour = [&]( Channel channel, Frame frame, const ActiveContour & active, Scratch & scratch )
 		{
-		std::vector<Contour> contours = get_contours( channel, min_frequency, max_frequency, 60, 20, canceller );
-		if( contours.empty() ) return PV();
-		std::sort( FLAN_PAR_UNSEQ contours.begin(), contours.end(), []( const Contour & a, const Contour & b ){ return a.start_frame < b.start_frame; } );
-		for( Index contour_index = 0; contour_index < contours.size(); ++contour_index )
+		const MF * const source_frame_ptr = get_MF_pointer( channel, frame, 0 );
+		const Frequency base_freq = active.base_freq;
+		if( base_freq < 1.0f )
+			return;
+		const size_t max_num_harmonics = std::floor( get_height() / base_freq );
+
+		// First we will locate everything that needs to be changed and clear it from out
+		// We need to find all bins before changing them because we don't want to overwrite bins that need to be changed
+		scratch.harmonic_bins.clear();
+		scratch.harmonic_bin_offsets.assign( 1, 0 );
+		MF * const clear_frame_ptr = out.get_MF_pointer( channel, frame, 0 );
+		for( Harmonic harmonic = 0; harmonic < max_num_harmonics; ++harmonic ) // For each harmonic
 			{
-			const Contour & contour = contours[contour_index];
+			const Frequency freq = base_freq * ( harmonic + 1 );
+
+			// For bins near the harmonic, we find all bins with a freq close to the harmonic
+			const size_t harmonic_start = scratch.harmonic_bins.size();
+			const Bin start_bin = bound_bin( frequency_to_bin( freq ) - 10 );
+			const Bin end_bin   = bound_bin( frequency_to_bin( freq ) + 10 );
+			const MF * source_ptr = get_MF_pointer( channel, frame, start_bin );
+			for( Bin bin = start_bin; bin <= end_bin; ++bin, ++source_ptr )
+				{
+				const MF & source_MF = *source_ptr;
+				if( source_MF.f <= 0 ) continue;
+				// Assert the bin has a frequency within a half a note of the target harmonic
+				if( notesClose( source_MF.f, freq ) ) 
+					scratch.harmonic_bins.push_back( bin );
+				}
+			scratch.harmonic_bin_offsets.push_back( scratch.harmonic_bins.size() );
 
-			flan::for_each_i( contour.bins.size(), prism_func.get_execution_policy(), [&]( Frame contour_frame ) {
-				const Frame frame = contour_frame + contour.start_frame;
-				const MF * const source_frame_ptr = get_MF_pointer( channel, frame, 0 );
+			// Clear source bins from out
+			for( size_t i = harmonic_start; i < scratch.harmonic_bins.size(); ++i )
+				( clear_frame_ptr + scratch.harmonic_bins[i] )->m = 0;
+			}
 
-				// The pitch bin from the contour isn't exact enough, so we need to more accurately estimate the base frequency with a weighted mean of nearby bins
-				const Frequency approx_base_freq = pitch_bin_to_freq( contour.bins[contour_frame].x() );
-				const Frequency base_freq = get_accurate_freq( channel, frame, approx_base_freq );
-				if( base_freq < 1.0f )
-					return;
-				const size_t max_num_harmonics = std::floor( get_height() / base_freq );
+		auto bins_begin = [&]( Harmonic harmonic ){ return scratch.harmonic_bins.begin() + scratch.harmonic_bin_offsets[harmonic]; };
+		auto bins_end   = [&]( Harmonic harmonic ){ return scratch.harmonic_bins.begin() + scratch.harmonic_bin_offsets[harmonic + 1]; };
 
-				// First we will locate everything that needs to be changed and clear it from out
-				// We need to find all bins before changing them because we don't want to overwrite bins that need to be changed
-				std::vector<std::vector<Bin>> bins_to_change_vec( max_num_harmonics ); // Harmonic -> Bin vector
-				for( auto & v : bins_to_change_vec )
-					v.reserve( 20 );
+		// For each harmonic, find the dominant bin
+		std::vector<Bin> & harmonic_max_mag_bins = scratch.harmonic_max_mag_bins;
+		std::vector<Magnitude> & harmonic_max_mags = scratch.harmonic_max_mags;
+		harmonic_max_mag_bins.assign( max_num_harmonics, 0 );
+		harmonic_max_mags.assign( max_num_harmonics, 0 );
+		for( Harmonic harmonic = 0; harmonic < harmonic_max_mag_bins.size(); ++harmonic )
+			{
+			if( bins_begin( harmonic ) == bins_end( harmonic ) ) continue;
+			const Bin harmonic_max_mag_bin = *std::max_element( bins_begin( harmonic ), bins_end( harmonic ), [source_frame_ptr]( Bin a, Bin b )
+				{ return ( source_frame_ptr + a )->m < ( source_frame_ptr + b )->m; } );
+			harmonic_max_mag_bins[harmonic] = harmonic_max_mag_bin;
+			harmonic_max_mags[harmonic] = ( source_frame_ptr + harmonic_max_mag_bin )->m;
+			if( harmonic_max_mags[harmonic] < 0.01 ) // This is an arbitrary delta that needs improvement
+				{
+				harmonic_max_mags[harmonic] = 0;
+				}
+			}
 
-				for( Harmonic harmonic = 0; harmonic < bins_to_change_vec.size(); ++harmonic ) // For each harmonic
+		// Now we go back through everything in the frame that needs writing and write it
+		for( Harmonic harmonic = 0; harmonic < harmonic_max_mag_bins.size(); ++harmonic )
+			{
+			const Frequency freq = base_freq * ( harmonic + 1 );
+
+			const MF modified_harmonic = prism_func( 
+				active.contour_index, 
+				frame_to_time( use_local_contour_time ? active.contour_frame : frame ), 
+				harmonic + 1, 
+				base_freq, 
+				harmonic_max_mags );
+				
+			if( modified_harmonic.f < 0 ) 
+				continue;
+			
+			if( harmonic_max_mags[harmonic] != 0 )
+				{
+				const Bin new_max_mag_bin = modified_harmonic.f / freq * harmonic_max_mag_bins[harmonic];
+				const Bin bin_shift = new_max_mag_bin - harmonic_max_mag_bins[harmonic];
+				const Frequency f_scale = modified_harmonic.f / freq;
+				const Frequency m_scale = modified_harmonic.m / harmonic_max_mags[harmonic];
+				for( auto bin = bins_begin( harmonic ); bin != bins_end( harmonic ); ++bin )
 					{
-					const Frequency freq = base_freq * ( harmonic + 1 );
-
-					// For bins near the harmonic, we find all bins with a freq close to the harmonic
-					std::vector<Bin> & bins_to_change = bins_to_change_vec[harmonic];
-					const Bin start_bin = bound_bin( frequency_to_bin( freq ) - 10 );
-					const Bin end_bin   = bound_bin( frequency_to_bin( freq ) + 10 );
-					const MF * source_ptr = get_MF_pointer( channel, frame, start_bin );
-					for( Bin bin = start_bin; bin <= end_bin; ++bin, ++source_ptr )
-						{
-						const MF & source_MF = *source_ptr;
-						if( source_MF.f <= 0 ) continue;
-						// Assert the bin has a frequency within a half a note of the target harmonic
-						if( notesClose( source_MF.f, freq ) ) 
-							bins_to_change.push_back( bin );
-						}
+					const Bin new_bin = *bin + bin_shift;
+					if( new_bin < 0 || new_bin >= get_num_bins() )	
+						continue;
 
-					// Clear source bins from out
-					MF * const clear_frame_ptr = out.get_MF_pointer( channel, frame, 0 );
-					for( auto bin : bins_to_change )
-						( clear_frame_ptr + bin )->m = 0;
+					// Set new bin to updated value
+					const MF & source_MF = *( source_frame_ptr + *bin );
+					MF & dest_MF = out.get_MF( channel, frame, new_bin );
+					if( dest_MF.m < source_MF.m * m_scale )
+						dest_MF = { source_MF.m * m_scale, source_MF.f * f_scale };
 					}
+				}
+			else // There is no harmonic to scale, so create one
+				{
+				const Frequency frequency_bandwidth = 10;
+				const Frequency low_frequency = modified_harmonic.f - frequency_bandwidth / 2;
+				const Frequency high_frequency = modified_harmonic.f + frequency_bandwidth / 2;
+				const Bin low_bin  = std::max( 0, 						(Bin) std::ceil ( out.frequency_to_bin( low_frequency ) ) );
+				const Bin high_bin = std::min( out.get_num_bins() - 1, 	(Bin) std::floor( out.frequency_to_bin( high_frequency ) ) );
 
-				// For each harmonic, find the dominant bin
-				std::vector<Bin> harmonic_max_mag_bins( max_num_harmonics );
-				std::vector<Magnitude> harmonic_max_mags( max_num_harmonics, 0 );
-				for( Harmonic harmonic = 0; harmonic < harmonic_max_mag_bins.size(); ++harmonic )
+				for( Bin bin = low_bin; bin <= high_bin; ++bin )
 					{
-					const std::vector<Bin> & bins_to_change = bins_to_change_vec[harmonic];
-					if( bins_to_change.empty() ) continue;
-					const Bin harmonic_max_mag_bin = *std::max_element( bins_to_change.begin(), bins_to_change.end(), [source_frame_ptr]( Bin a, Bin b )
-						{ return ( source_frame_ptr + a )->m < ( source_frame_ptr + b )->m; } );
-					harmonic_max_mag_bins[harmonic] = harmonic_max_mag_bin;
-					harmonic_max_mags[harmonic] = ( source_frame_ptr + harmonic_max_mag_bin )->m;
-					if( harmonic_max_mags[harmonic] < 0.01 ) // This is an arbitrary delta that needs improvement
-						{
-						harmonic_max_mags[harmonic] = 0;
-						}
+					const float window_position = ( out.bin_to_frequency( bin ) - low_frequency ) / frequency_bandwidth;
+					const Magnitude bin_magnitude = modified_harmonic.m * Windows::hann( window_position );
+					out.get_MF( channel, frame, bin ) = { bin_magnitude, modified_harmonic.f };
 					}
+				}
+			}
+		};
 
-				// Now we go back through everything in the frame that needs writing and write it
-				for( Harmonic harmonic = 0; harmonic < harmonic_max_mag_bins.size(); ++harmonic )
-					{
-					const Frequency freq = base_freq * ( harmonic + 1 );                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                     
-
-					const MF modified_harmonic = prism_func( 
-						contour_index, 
-						frame_to_time( use_local_contour_time ? contour_frame : frame ), 
-						harmonic + 1, 
-						base_freq, 
-						harmonic_max_mags );
-						
-					if( modified_harmonic.f < 0 ) 
-						continue;
-					
-					if( harmonic_max_mags[harmonic] != 0 )
-						{
-						const std::vector<Bin> & bins_to_change = bins_to_change_vec[harmonic];
-
-						const Bin new_max_mag_bin = modified_harmonic.f / freq * harmonic_max_mag_bins[harmonic];
-						const Bin bin_shift = new_max_mag_bin - harmonic_max_mag_bins[harmonic];
-						const Frequency f_scale = modified_harmonic.f / freq;
-						const Frequency m_scale = modified_harmonic.m / harmonic_max_mags[harmonic];
-						for( auto bin : bins_to_change )
-							{
-							const Bin new_bin = bin + bin_shift;
-							if( new_bin < 0 || new_bin >= get_num_bins() )	
-								continue;
-
-							// Set new bin to updated value
-							//std::lock_guard<std::mutex> lock( mutexBuffer[frame] );
-							const MF & source_MF = *( source_frame_ptr + bin );
-							MF & dest_MF = out.get_MF( channel, frame, new_bin );
-							if( dest_MF.m < source_MF.m * m_scale )
-								dest_MF = { source_MF.m * m_scale, source_MF.f * f_scale };
-							}
-						}
-					else // There is no harmonic to scale, so create one
-						{
-						const Frequency frequency_bandwidth = 10;
-						const Frequency low_frequency = modified_harmonic.f - frequency_bandwidth / 2;
-						const Frequency high_frequency = modified_harmonic.f + frequency_bandwidth / 2;
-						const Bin low_bin  = std::max( 0, 						(Bin) std::ceil ( out.frequency_to_bin( low_frequency ) ) );
-						const Bin high_bin = std::min( out.get_num_bins() - 1, 	(Bin) std::floor( out.frequency_to_bin( high_frequency ) ) );
-
-						for( Bin bin = low_bin; bin <= high_bin; ++bin )
-							{
-							const float window_position = ( out.bin_to_frequency( bin ) - low_frequency ) / frequency_bandwidth;
-							const Magnitude bin_magnitude = modified_harmonic.m * Windows::hann( window_position );
-							out.get_MF( channel, frame, bin ) = { bin_magnitude, modified_harmonic.f };
-							}
-						}
-					}
-				});
+	// Contour tracking is sequential within a channel, so channels are tracked in parallel
+	std::vector<std::vector<Contour>> channel_contours( get_num_channels() );
+	flan::for_each_i( get_num_channels(), ExecutionPolicy::Parallel_Sequenced, [&]( Channel channel )
+		{
+		channel_contours[channel] = get_contours( channel, min_frequency, max_frequency, 60, 20, context );
+		} );
+	flan_CANCEL_POINT( PV() );
+
+	for( Channel channel = 0; channel < get_num_channels(); ++channel )
+		{
+		std::vector<Contour> & contours = channel_contours[channel];
+		if( contours.empty() ) return PV();
+
+		// Contours starting on the same frame keep their order, so the contour indices and the result are deterministic
+		std::stable_sort( contours.begin(), contours.end(), []( const Contour & a, const Contour & b ){ return a.start_frame < b.start_frame; } );
+
+		// Index the contours active on each frame. Each frame lists its contours in contour order.
+		std::vector<std::vector<ActiveContour>> frame_contours( get_num_frames() );
+		for( Index contour_index = 0; contour_index < contours.size(); ++contour_index )
+			{
+			const Contour & contour = contours[contour_index];
+			for( Frame contour_frame = 0; contour_frame < contour.bins.size(); ++contour_frame )
+				frame_contours[contour.start_frame + contour_frame].push_back( 
+					{ contour_index, contour_frame, pitch_bin_to_freq( contour.bins[contour_frame].x() ) } );
 			}
+
+		// Frames are independent, so they run in parallel. Contours overlapping on a frame are applied in contour order, as 
+		// each can overwrite bins written by the last.
+		TaskProgress progress( context, "PV::prism", get_num_frames() );
+		flan::for_each_i( get_num_frames(), prism_func.get_execution_policy(), [&]( Frame frame )
+			{
+			flan_CANCEL_POINT();
+			progress.advance();
+
+			std::vector<ActiveContour> & active = frame_contours[frame];
+			if( active.empty() ) return;
+
+			refine_base_freqs( channel, frame, active );
+
+			Scratch scratch;
+			for( const ActiveContour & a : active )
+				apply_contour( channel, frame, a, scratch );
+			} );
+		flan_CANCEL_POINT( PV() );
 		}
+	flan_CANCEL_POINT( PV() );
 
 	return out;
 	}
@@ -1,10 +1,11 @@
 #include "flan/PV/PV.h"
+#include "flan/Utility/Trace.h"
 
 #include <iostream>
 #include <algorithm>
 #include <ranges>
 
-#include "spline/spline.h"
+#include "flan/Utility/SharedKnotSpline.h"
 #include "flan/Utility/iota_iter.h"
 #include "flan/Utility/buffer_access.h"
 
@@ -12,8 +13,9 @@ using namespace std::ranges;
 
 namespace flan {
 
-PV PV::modify( const Function<TF, TF> & mod, const Interpolator & interp ) const
+PV PV::modify( const Function<TF, TF> & mod, const Interpolator & interp, flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "PV::modify", *this );
 	if( is_null() ) return PV();
 
 	const uint32_t in_channel_data_count = get_num_frames() * get_num_bins();
@@ -36,6 +38,7 @@ PV PV::modify( const Function<TF, TF> & mod, const Interpolator & interp ) const
 
 	auto format = get_format();
 	format.num_frames = ceil( last_output_frame );
+	flan_RESERVE_POINT( uint64_t( format.num_channels ) * format.num_frames * format.num_bins * sizeof( MF ), PV() );
 	PV out( format );
 	out.clear_buffer();
 
@@ -46,8 +49,12 @@ PV PV::modify( const Function<TF, TF> & mod, const Interpolator & interp ) const
 
 	std::vector<MF> in_modified( in_channel_data_count );
 
+	TaskProgress progress( context, "PV::modify", uint64_t( get_num_channels() ) * get_num_frames() );
+
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
 		{
+		flan_CANCEL_POINT( PV() );
+
 		// Calculate and copy mapped frequencies and input magnitudes
 		auto in_buffer_read_head = get_MF_pointer( 0, 0, 0 ) + channel * in_channel_data_count;
 		auto in_modified_write_head = in_modified.begin();
@@ -63,6 +70,9 @@ PV PV::modify( const Function<TF, TF> & mod, const Interpolator & interp ) const
 		
 		std::for_each( FLAN_PAR_SEQ iota_iter( 1 ), iota_iter( get_num_frames() ), [&]( Frame frame )
 			{
+			flan_CANCEL_POINT();
+			progress.advance();
+
 			//std::for_each( std::execution::par, iota_iter(1), iota_iter(get_num_bins()), [&]( Bin bin )
 			for( Bin bin = 1; bin < get_num_bins(); ++bin )
 				{
@@ -189,6 +199,7 @@ PV PV::modify( const Function<TF, TF> & mod, const Interpolator & interp ) const
 				}
 			} );
 		}
+	flan_CANCEL_POINT( PV() );
 
 	return out;
 	}
@@ -197,19 +208,26 @@ PV modify_frequency_base(
 	const PV & me, 
 	const FunctionSample2d<Frequency> & mod, 
 	const std::vector<Frequency> input_frequencies_modded, 
-	const Interpolator & interp )
+	const Interpolator & interp,
+	flan_CANCEL_ARG_CPP )
 	{
 	if( me.is_null() ) return PV();
 
+	flan_RESERVE_POINT( me.get_buffer().size() * sizeof( MF ), PV() );
 	PV out( me.get_format() );
 	out.clear_buffer();
 
+	TaskProgress progress( context, "PV::modify_frequency", uint64_t( me.get_num_channels() ) * me.get_num_frames() );
+
 	for( Channel channel = 0; channel < me.get_num_channels(); ++channel )
 		{
 		const auto in_modified = input_frequencies_modded.begin() + channel * me.get_num_frames() * me.get_num_bins();
 
 		std::for_each( FLAN_PAR_UNSEQ iota_iter( 0 ), iota_iter( me.get_num_frames() ), [&]( Frame frame )
 			{
+			flan_CANCEL_POINT();
+			progress.advance();
+
 			// For each adjacent pair of bins
 			for( Bin bin = 1; bin < me.get_num_bins(); ++bin )
 				{
@@ -252,26 +270,32 @@ PV modify_frequency_base(
 				}
 			} );
 		}
+	flan_CANCEL_POINT( PV() );
 
 	return out;
 	}
 
-PV PV::modify_frequency( const Function<TF, Frequency> & mod, const Interpolator & interp ) const
+PV PV::modify_frequency( const Function<TF, Frequency> & mod, const Interpolator & interp, flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "PV::modify_frequency", *this );
 	const auto mod_sampled = sample_function_over_domain( mod );
 
 	std::vector<Frequency> in_modified; // Buffer for sampling mod on input frequencies
 	in_modified.reserve( get_buffer().size() );
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
 		for( Frame frame = 0; frame < get_num_frames(); ++frame )
+			{
+			flan_CANCEL_POINT( PV() );
 			for( Bin bin = 0; bin < get_num_bins(); ++bin )
 				in_modified.push_back( mod( TF{ frame_to_time( frame ), get_MF( channel, frame, bin ).f } ) );
+			}
 
-	return modify_frequency_base( *this, mod_sampled, in_modified, interp );
+	return modify_frequency_base( *this, mod_sampled, in_modified, interp, context );
 	}
 
-PV PV::repitch( const Function<TF, float> & local_expansion_factor, const Interpolator & interp ) const
+PV PV::repitch( const Function<TF, float> & local_expansion_factor, const Interpolator & interp, flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "PV::repitch", *this );
 	auto factor_sampled = sample_function_over_domain( local_expansion_factor );
 
 	// Partial integral with respect to time. Factor_sampled becomes TF -> Frame.
@@ -288,6 +312,8 @@ PV PV::repitch( const Function<TF, float> & local_expansion_factor, const Interp
 	in_modified.reserve( get_buffer().size() );
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
 		for( Frame frame = 0; frame < get_num_frames(); ++frame )
+			{
+			flan_CANCEL_POINT( PV() );
 			for( Bin bin = 0; bin < get_num_bins(); ++bin )
 				{
 				const fBin fbin = std::clamp( frequency_to_bin( get_MF( channel, frame, bin ).f ), 0.0f, fBin( get_num_bins() - 1 ) - 0.0001f );
@@ -300,11 +326,12 @@ PV PV::repitch( const Function<TF, float> & local_expansion_factor, const Interp
 				
 				in_modified.push_back( lerp );
 				}
+			}
 
-	return modify_frequency_base( *this, factor_sampled, in_modified, interp );
+	return modify_frequency_base( *this, factor_sampled, in_modified, interp, context );
 	}
 
-PV modify_time_base( const PV & me, const FunctionSample2d<Second> & mod, const Interpolator & interp )
+PV modify_time_base( const PV & me, const FunctionSample2d<Second> & mod, const Interpolator & interp, flan_CANCEL_ARG_CPP )
 	{
 	if( me.is_null() ) return PV();
 
@@ -313,9 +340,12 @@ PV modify_time_base( const PV & me, const FunctionSample2d<Second> & mod, const
 
 	auto format = me.get_format();
 	format.num_frames = last_output_frame;
+	flan_RESERVE_POINT( uint64_t( format.num_channels ) * format.num_frames * format.num_bins * sizeof( MF ), PV() );
 	PV out( format );
 	out.clear_buffer();
 
+	TaskProgress progress( context, "PV::modify_time", uint64_t( me.get_num_channels() ) * me.get_num_bins() );
+
 	std::for_each( FLAN_PAR_UNSEQ iota_iter( 0 ), iota_iter( me.get_num_channels() ), [&]( Channel channel )
 		{
 		// Note the bin loop happens first here. There are a lot of considerations involved in the ordering, but
@@ -324,6 +354,9 @@ PV modify_time_base( const PV & me, const FunctionSample2d<Second> & mod, const
 		//  either way because we store PV data in frame-major order.
 		std::for_each( FLAN_PAR_UNSEQ iota_iter( 0 ), iota_iter( me.get_num_bins() ), [&]( Bin bin )
 			{
+			flan_CANCEL_POINT();
+			progress.advance();
+
 			// For each adjacent pair of frames
 			std::for_each( iota_iter( 1 ), iota_iter( me.get_num_frames() ), [&]( Frame frame )
 				{
@@ -357,19 +390,22 @@ PV modify_time_base( const PV & me, const FunctionSample2d<Second> & mod, const
 				} );
 			} );
 		} );
+	flan_CANCEL_POINT( PV() );
 
 	return out;
 	}
 
-PV PV::modify_time( const Function<TF, Second> & mod, const Interpolator & interp ) const
+PV PV::modify_time( const Function<TF, Second> & mod, const Interpolator & interp, flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "PV::modify_time", *this );
 	// Sample mod function and convert output to frame/bin
 	const auto mod_sampled = sample_function_over_domain( mod );
-	return modify_time_base( *this, mod_sampled, interp );
+	return modify_time_base( *this, mod_sampled, interp, context );
 	}
 
-PV PV::stretch( const Function<TF, float> & local_expansion_factor, const Interpolator & interp ) const
+PV PV::stretch( const Function<TF, float> & local_expansion_factor, const Interpolator & interp, flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "PV::stretch", *this );
 	auto factor_sampled = sample_function_over_domain( local_expansion_factor );
 
 	// Partial integral with respect to time. Factor_sampled becomes TF -> Frame.
@@ -381,12 +417,14 @@ PV PV::stretch( const Function<TF, float> & local_expansion_factor, const Interp
 	for( int i = 0; i < factor_sampled.size(); ++i )
 		factor_sampled[i] = frame_to_time( factor_sampled[i] );
 
-	return modify_time_base( *this, factor_sampled, interp );
+	return modify_time_base( *this, factor_sampled, interp, context );
 	}
 
-PV PV::stretch_spline( const Function<Second, float> & interpolation ) const
+PV PV::stretch_spline( const Function<Second, float> & interpolation, flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "PV::stretch_spline", *this );
 	if( is_null() ) return PV();
+	if( get_num_frames() < 2 ) return copy(); // A spline needs two knots
 
 	const auto safeInterpolation = [&interpolation, this]( Frame frame )
 		{
@@ -404,54 +442,73 @@ PV PV::stretch_spline( const Function<Second, float> & interpolation ) const
 		format.num_frames += safeInterpolation( frame );
 		}
 	Xs[get_num_frames()-1] = format.num_frames;
+	flan_RESERVE_POINT( uint64_t( format.num_channels ) * format.num_frames * format.num_bins * sizeof( MF ), PV() );
 	PV out( format );
 
-	//Allocate Y coordinate vectors
-	std::vector<double> magnitudeYs( Xs.size() );
-	std::vector<double> frequencyYs( Xs.size() );
+	// Every bin shares the same x coordinates, so the spline system is factored once and solved for a tile of bins at a time
+	const SharedKnotSpline spline( std::move( Xs ) );
+	const size_t num_knots = spline.get_num_knots();
+	const Bin tile_bins = 64;
+	const Bin num_tiles = ( get_num_bins() + tile_bins - 1 ) / tile_bins;
 
-	for( Channel channel = 0; channel < get_num_channels(); ++channel )
+	TaskProgress progress( context, "PV::stretch_spline", uint64_t( get_num_channels() ) * num_tiles );
+
+	std::for_each( FLAN_PAR_SEQ iota_iter( 0 ), iota_iter( get_num_channels() * num_tiles ), [&]( int tile )
 		{
-		//Channel -> bin is correct here, despite non-sequential access to flan buffer
-		for( Bin bin = 0; bin < get_num_bins(); ++bin )
+		flan_CANCEL_POINT();
+		progress.advance();
+
+		const Channel channel = tile / num_tiles;
+		const Bin start_bin = ( tile % num_tiles ) * tile_bins;
+		const Bin width = std::min( tile_bins, get_num_bins() - start_bin );
+
+		// Each knot row holds the tile's magnitudes followed by its frequencies
+		const size_t num_series = 2 * width;
+		std::vector<double> ys( num_knots * num_series );
+		std::vector<double> bs( num_knots * num_series );
+		for( Frame frame = 0; frame < get_num_frames(); ++frame )
 			{
-			//For each x coordinate get corresponding frequency and magnitude
-			for( Frame frame : iota_view( 0, get_num_frames() ) )
+			const MF * in_row = get_MF_pointer( channel, frame, start_bin );
+			double * y = ys.data() + frame * num_series;
+			for( Bin b = 0; b < width; ++b )
 				{
-				magnitudeYs[frame] = get_MF( channel, frame, bin ).m;
-				frequencyYs[frame] = get_MF( channel, frame, bin ).f;
+				y[b] = in_row[b].m;
+				y[width + b] = in_row[b].f;
 				}
+			}
 
-			//Do the splines
-			tk::spline magnitudeSpline, frequencySpline;
-			magnitudeSpline.set_points(Xs,magnitudeYs);
-			frequencySpline.set_points(Xs,frequencyYs);
+		spline.fit( ys.data(), bs.data(), num_series );
 
-			//Evaluate splines into out
-			for( Frame frame = 0; frame < out.get_num_frames(); ++frame )
+		SharedKnotSpline::Cursor cursor;
+		for( Frame frame = 0; frame < out.get_num_frames(); ++frame )
+			{
+			MF * out_row = out.get_MF_pointer( channel, frame, start_bin );
+			spline.evaluate( frame, cursor, ys.data(), bs.data(), num_series, [&]( size_t series, double value )
 				{
-				out.set_MF( channel, frame, bin, 
-					{ 
-					(float) magnitudeSpline(frame),
-					(float) frequencySpline(frame)
-					} );
-				}
+				if( series < size_t( width ) ) out_row[series].m = float( value );
+				else out_row[series - width].f = float( value );
+				} );
 			}
-		}
-			
+		} );
+	flan_CANCEL_POINT( PV() );
+
 	return out;
 	}
 
-PV PV::desample( const Function<TF, float> & decimation_ratio, const Interpolator & interp ) const
+PV PV::desample( const Function<TF, float> & decimation_ratio, const Interpolator & interp, flan_CANCEL_ARG_CPP ) const
 	{
+	flan_TRACE_SPAN( "PV::desample", *this );
 	if( is_null() ) return PV();
 
 	// Sample factor over frames and bins
 	auto decimation_ratio_samples = sample_function_over_domain( decimation_ratio );
 
+	flan_RESERVE_POINT( get_buffer().size() * sizeof( MF ), PV() );
 	PV out( get_format() );
 	out.clear_buffer();
 
+	TaskProgress progress( context, "PV::desample", uint64_t( get_num_channels() ) * get_num_bins() );
+
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
 		{
 		// This stores which frames should be interpolated between
@@ -461,6 +518,7 @@ PV PV::desample( const Function<TF, float> & decimation_ratio, const Interpolato
 		std::vector<float> accums( get_num_bins(), 1 ); // Start at one to trigger interp from starting frame
 		std::for_each( FLAN_PAR_UNSEQ iota_iter( 0 ), iota_iter( get_num_bins() ), [&]( Bin bin )
 			{
+			flan_CANCEL_POINT();
 			for( Frame frame = 0; frame < get_num_frames(); ++frame )
 				{
 				float & accum = accums[bin];
@@ -473,9 +531,13 @@ PV PV::desample( const Function<TF, float> & decimation_ratio, const Interpolato
 					}
 				}
 			} );
+		flan_CANCEL_POINT( PV() );
 
 		std::for_each( FLAN_PAR_UNSEQ iota_iter( 0 ), iota_iter( get_num_bins() ), [&]( Bin bin )
 			{
+			flan_CANCEL_POINT();
+			progress.advance();
+
 			// For each pair of selected interpolation endpoints in selectedFrames, intepolate the frames between them
 			std::vector<Frame> & selectedFrames_c = selectedFrames[bin];
 			if( selectedFrames_c.size() < 2 ) return;
@@ -506,16 +568,127 @@ PV PV::desample( const Function<TF, float> & decimation_ratio, const Interpolato
 				}
 			} );
 		}
+	flan_CANCEL_POINT( PV() );
 
 	return out;
 	}
 
+PV PV::resample( FrameRate analysis_rate, Bin num_bins, flan_CANCEL_ARG_CPP ) const
+	{
+	flan_TRACE_SPAN( "PV::resample", *this );
+	if( is_null() || analysis_rate <= 0 || num_bins < 0 || num_bins == 1 ) return PV();
+	if( num_bins == 0 ) num_bins = get_num_bins();
+
+	// Input frames per output frame, and input bins per output bin
+	const double frame_step = double( get_analysis_rate() ) / analysis_rate;
+	const double bin_step = double( get_num_bins() - 1 ) / ( num_bins - 1 );
+
+	auto format = get_format();
+	format.analysis_rate = analysis_rate;
+	format.num_bins = num_bins;
+	format.num_frames = Frame( std::floor( ( get_num_frames() - 1 ) / frame_step + 1e-6 ) ) + 1;
+	format.window_size = std::min( get_window_size(), ( num_bins - 1 ) * 2 );
+	flan_RESERVE_POINT( uint64_t( format.num_channels ) * format.num_frames * format.num_bins * sizeof( MF ), PV() );
+	PV out( format );
+
+	// Analysis magnitudes scale with the window size
+	const float magnitude_scale = float( format.window_size ) / get_window_size();
+
+	// The frequency in frame k is the mean frequency since frame k-1. Averaging that over ( a, b ], in input frames, gives the
+	// frequency carrying a bin's phase across the same time.
+	const auto mean_frequency = [this]( Channel channel, Bin bin, double a, double b )
+		{
+		if( b <= a ) return get_MF( channel, std::min( Frame( std::ceil( b ) ), get_num_frames() - 1 ), bin ).f;
+		double sum = 0;
+		for( Frame frame = Frame( std::floor( a ) ) + 1; frame < b + 1; ++frame )
+			{
+			const double overlap = std::min<double>( frame, b ) - std::max<double>( frame - 1, a );
+			sum += overlap * get_MF( channel, frame, bin ).f;
+			}
+		return Frequency( sum / ( b - a ) );
+		};
+
+	const Bin tile_bins = 64;
+	const Bin num_tiles = ( num_bins + tile_bins - 1 ) / tile_bins;
+
+	TaskProgress progress( context, "PV::resample", uint64_t( get_num_channels() ) * num_tiles );
+
+	std::for_each( FLAN_PAR_SEQ iota_iter( 0 ), iota_iter( get_num_channels() * num_tiles ), [&]( int tile )
+		{
+		flan_CANCEL_POINT();
+		progress.advance();
+
+		const Channel channel = tile / num_tiles;
+		const Bin start_bin = ( tile % num_tiles ) * tile_bins;
+		const Bin end_bin = std::min( start_bin + tile_bins, num_bins );
+
+		for( Frame frame = 0; frame < out.get_num_frames(); ++frame )
+			{
+			const double u = std::min<double>( frame * frame_step, get_num_frames() - 1 );
+			const Frame frame0 = std::min( Frame( u ), get_num_frames() - 1 );
+			const Frame frame1 = std::min( frame0 + 1, get_num_frames() - 1 );
+			const float t = u - frame0;
+			const auto magnitude_at = [&]( Bin bin )
+				{
+				return get_MF( channel, frame0, bin ).m * ( 1.0f - t ) + get_MF( channel, frame1, bin ).m * t;
+				};
+
+			for( Bin bin = start_bin; bin < end_bin; ++bin )
+				{
+				const double in_bin = std::min<double>( bin * bin_step, get_num_bins() - 1 );
+
+				Magnitude m;
+				Bin source;
+				if( bin_step <= 1 )
+					{
+					const Bin bin0 = std::min( Bin( in_bin ), get_num_bins() - 1 );
+					const Bin bin1 = std::min( bin0 + 1, get_num_bins() - 1 );
+					const float s = in_bin - bin0;
+					const Magnitude m0 = magnitude_at( bin0 );
+					const Magnitude m1 = magnitude_at( bin1 );
+					m = m0 * ( 1.0f - s ) + m1 * s;
+					source = m0 >= m1 ? bin0 : bin1;
+					}
+				else
+					{
+					// Each input bin belongs to the output bin nearest it
+					const Bin first = std::clamp( Bin( std::ceil( in_bin - bin_step / 2 ) ), 0, get_num_bins() - 1 );
+					const Bin end = std::clamp( Bin( std::ceil( in_bin + bin_step / 2 ) ), first + 1, get_num_bins() );
+					m = magnitude_at( first );
+					source = first;
+					for( Bin b = first + 1; b < end; ++b )
+						{
+						const Magnitude mb = magnitude_at( b );
+						if( mb > m ) { m = mb; source = b; }
+						}
+					}
+
+				const Frequency f = frame == 0 
+					? get_MF( channel, 0, source ).f 
+					: mean_frequency( channel, source, std::min<double>( ( frame - 1 ) * frame_step, u ), u );
+				out.set_MF( channel, frame, bin, { m * magnitude_scale, f } );
+				}
+			}
+		} );
+	flan_CANCEL_POINT( PV() );
+
+	return out;
+	}
+
+PV PV::resample_to_match( const PV & other, flan_CANCEL_ARG_CPP ) const
+	{
+	if( other.is_null() || other.get_sample_rate() != get_sample_rate() ) return PV();
+	return resample( other.get_analysis_rate(), other.get_num_bins(), context );
+	}
+
 PV PV::smear_time( 
 	const Function<TF, Second> & smear_size, 
 	const Function<TF, int> & granularity,
-	const Function<Second, float> & distribution
+	const Function<Second, float> & distribution,
+	flan_CANCEL_ARG_CPP
 	) const
 	{
+	flan_TRACE_SPAN( "PV::smear_time", *this );
 	if( is_null() ) return PV();
 
 	auto granularity_sampled = sample_function_over_domain( granularity );
@@ -558,11 +731,17 @@ PV PV::smear_time(
 
 	Format format = get_format();
 	format.num_frames = true_rightmost_frame - true_leftmost_frame;
+	flan_RESERVE_POINT( uint64_t( format.num_channels ) * format.num_frames * format.num_bins * sizeof( MF ), PV() );
 	PV out( format );
 
+	TaskProgress progress( context, "PV::smear_time", uint64_t( get_num_channels() ) * out.get_num_frames() );
+
 	for( Channel channel = 0; channel < get_num_channels(); ++channel )
 		flan::for_each_i( out.get_num_frames(), ExecutionPolicy::Parallel_Unsequenced, [&]( Frame out_frame )
 			{
+			flan_CANCEL_POINT();
+			progress.advance();
+
 			const Frame in_frame = std::clamp( out_frame + true_leftmost_frame, 0, get_num_frames() - 1 );
 
 			for( Bin bin = 0; bin < get_num_bins(); ++bin )
@@ -600,12 +779,14 @@ PV PV::smear_time(
 				out.get_MF( channel, out_frame, bin ) = MF( mag_sum, freq_sum );
 			 	}
 			} );
+	flan_CANCEL_POINT( PV() );
 
 	return out;
 	}
 
 PV PV::time_extrapolate( Second start_time, Second end_time, Second extrapolationTime, const Interpolator & interpolator ) const
 	{
+	flan_TRACE_SPAN( "PV::time_extrapolate", *this );
 	if( is_null() ) return PV();
 
 	// Input validation
@@ -0,0 +1,229 @@
+#include "flan/PV/PVProcessor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "flan/FFTHelper.h"
+#include "flan/WindowFunctions.h"
+#include "flan/phase_vocoder.h"
+
+using namespace flan;
+
+PVProcessor::PVProcessor( Frame _window_size, Frame _hop, Frame _dft_size, FrameOperator _frame_operator )
+	: window_size( std::max( _window_size, Frame( 2 ) ) )
+	, hop( std::max( _hop, Frame( 1 ) ) )
+	, dft_size( std::max( _dft_size, window_size ) )
+	, frame_operator( std::move( _frame_operator ) )
+	{
+	}
+
+PVProcessor::~PVProcessor() = default;
+
+void PVProcessor::set_frame_operator( FrameOperator _frame_operator )
+	{
+	frame_operator = std::move( _frame_operator );
+	}
+
+Frame PVProcessor::get_latency() const
+	{
+	return window_size;
+	}
+
+Bin PVProcessor::get_num_bins() const
+	{
+	return dft_size / 2 + 1;
+	}
+
+void PVProcessor::prepare_state()
+	{
+	const Bin num_bins = get_num_bins();
+
+	if( !fft ) fft = std::make_unique<FFTHelper>( dft_size, true, true, false );
+
+	// The same windows and scaling as the offline transforms
+	analysis_window.resize( window_size );
+	synthesis_window.resize( window_size );
+	const float window_scale = 2.67f / ( dft_size * window_size / hop );
+	for( Frame i = 0; i < window_size; ++i )
+		{
+		analysis_window[i] = Windows::hann( float( i ) / float( window_size - 1 ) );
+		synthesis_window[i] = analysis_window[i] * window_scale;
+		}
+
+	frame.resize( num_bins );
+	scratch.resize( num_bins );
+	bin_frequencies.resize( num_bins );
+	for( Bin bin = 0; bin < num_bins; ++bin )
+		bin_frequencies[bin] = bin * float( sample_rate ) / float( dft_size );
+
+	// Both rings hold the last window_size stream frames
+	const size_t ring_size = power_of_2_container( window_size );
+	ring_mask = ring_size - 1;
+	channels.resize( num_channels );
+	for( ChannelState & state : channels )
+		{
+		state.input.resize( ring_size );
+		state.output.resize( ring_size );
+		state.analysis_phase.resize( num_bins );
+		state.synthesis_phase.resize( num_bins );
+		}
+	}
+
+void PVProcessor::reset_state()
+	{
+	for( ChannelState & state : channels )
+		{
+		std::fill( state.input.begin(), state.input.end(), 0 );
+		std::fill( state.output.begin(), state.output.end(), 0 );
+		std::fill( state.analysis_phase.begin(), state.analysis_phase.end(), 0 );
+		std::fill( state.synthesis_phase.begin(), state.synthesis_phase.end(), 0 );
+		}
+
+	// The first window is centered on stream frame 0, so it completes half a window in
+	stream_frame = 0;
+	next_pv_frame_at = window_size / 2;
+	pv_frame = 0;
+	}
+
+void PVProcessor::process_block( const Sample * const * in, Sample * const * out, Frame num_frames )
+	{
+	Frame block_frame = 0;
+	while( block_frame < num_frames )
+		{
+		// Run up to the next window completion, or the end of the block
+		const Frame segment = Frame( std::min<uint64_t>( num_frames - block_frame, next_pv_frame_at - stream_frame ) );
+
+		for( Channel channel = 0; channel < num_channels; ++channel )
+			{
+			ChannelState & state = channels[channel];
+			for( Frame i = 0; i < segment; ++i )
+				{
+				const uint64_t position = stream_frame + i;
+				const size_t out_index = ( position - window_size ) & ring_mask;
+
+				// Output lags input by a window, and nothing is output before the stream start
+				const Sample y = position >= uint64_t( window_size ) ? state.output[out_index] : 0.0f;
+				state.output[out_index] = 0;
+				state.input[position & ring_mask] = in[channel][block_frame + i];
+				out[channel][block_frame + i] = y;
+				}
+			}
+
+		stream_frame += segment;
+		block_frame += segment;
+
+		if( stream_frame == next_pv_frame_at )
+			{
+			for( Channel channel = 0; channel < num_channels; ++channel )
+				process_frame( channel );
+			next_pv_frame_at += hop;
+			++pv_frame;
+			}
+		}
+	}
+
+void PVProcessor::process_frame( Channel channel )
+	{
+	ChannelState & state = channels[channel];
+	const Bin num_bins = get_num_bins();
+	const FrameRate analysis_rate = sample_rate / hop;
+	const uint64_t window_start = stream_frame - window_size;
+
+	// Analysis
+	float * real = fft->get_real_buffer();
+	for( Frame i = 0; i < window_size; ++i )
+		real[i] = state.input[( window_start + i ) & ring_mask] * analysis_window[i];
+	std::fill( fft->real_begin() + window_size, fft->real_end(), 0 );
+
+	fft->r2c_execute();
+
+	phase_vocoder_frame( { fft->get_complex_buffer(), size_t( num_bins ) }, state.analysis_phase, frame, bin_frequencies, 
+		analysis_rate, sample_rate );
+
+	if( frame_operator )
+		{
+		const FrameInfo info = {
+			channel,
+			Second( pv_frame ) * hop / sample_rate,
+			num_bins,
+			float( sample_rate ) / float( dft_size ),
+			scratch.data()
+			};
+		frame_operator( frame.data(), info );
+		}
+
+	// Synthesis
+	inverse_phase_vocoder_frame( frame, state.synthesis_phase, { fft->get_complex_buffer(), size_t( num_bins ) }, analysis_rate );
+
+	fft->c2r_execute();
+
+	for( Frame i = 0; i < window_size; ++i )
+		state.output[( window_start + i ) & ring_mask] += real[i] * synthesis_window[i];
+	}
+
+
+
+//============================================================================================================================================================
+// Frame operators
+//============================================================================================================================================================
+
+PVProcessor::FrameOperator PVProcessor::shape( const Function<MF,MF> & shaper, bool use_shift_alignment )
+	{
+	return [&shaper, use_shift_alignment]( MF * frame, const FrameInfo & info )
+		{
+		if( !use_shift_alignment )
+			{
+			for( Bin bin = 0; bin < info.num_bins; ++bin )
+				frame[bin] = shaper( frame[bin] );
+			return;
+			}
+
+		// Shaped MFs can land in any bin of the frame, so they are gathered in scratch, see PV::shape
+		std::fill( info.scratch, info.scratch + info.num_bins, MF{ 0, 0 } );
+		for( Bin bin = 0; bin < info.num_bins; ++bin )
+			{
+			const MF inMF = frame[bin];
+			const MF shapedMF = shaper( inMF );
+
+			const Bin binShift = bin - inMF.f / info.bin_width;
+			const Bin shapedMFBin = shapedMF.f / info.bin_width + binShift;
+			if( shapedMFBin < 0 || info.num_bins <= shapedMFBin )
+				continue;
+
+			MF & outMF = info.scratch[shapedMFBin];
+			if( shapedMF.m > outMF.m )
+				outMF = shapedMF;
+			}
+		std::copy( info.scratch, info.scratch + info.num_bins, frame );
+		};
+	}
+
+// Zeros the magnitudes of either the N loudest bins, or all but the N loudest, keeping their frequencies as the PV methods do
+static PVProcessor::FrameOperator n_loudest_partials( const Function<Second, Bin> & num_partials, bool retain )
+	{
+	return [&num_partials, retain]( MF * frame, const PVProcessor::FrameInfo & info )
+		{
+		const Bin n = std::clamp( num_partials( info.time ), 0, info.num_bins );
+
+		// Scratch holds each bin's magnitude with its index in place of frequency
+		for( Bin bin = 0; bin < info.num_bins; ++bin )
+			info.scratch[bin] = { std::abs( frame[bin].m ), float( bin ) };
+		std::nth_element( info.scratch, info.scratch + n, info.scratch + info.num_bins, []( const MF & a, const MF & b )
+			{ return a.m > b.m; } );
+
+		const MF * zero_begin = retain ? info.scratch + n : info.scratch;
+		const MF * zero_end = retain ? info.scratch + info.num_bins : info.scratch + n;
+		for( const MF * mf = zero_begin; mf != zero_end; ++mf )
+			frame[Bin( mf->f )].m = 0;
+		};
+	}
+
+PVProcessor::FrameOperator PVProcessor::retain_n_loudest_partials( const Function<Second, Bin> & num_partials )
+	{
+	return n_loudest_partials( num_partials, true );
+	}
+
+PVProcessor::FrameOperator PVProcessor::remove_n_loudest_partials( const Function<Second, Bin> & num_partials )
+	{
+	return n_loudest_partials( num_partials, false );
+	}
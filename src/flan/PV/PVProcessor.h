@@ -0,0 +1,121 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <functional>
+
+#include "flan/defines.h"
+#include "flan/Processor.h"
+#include "flan/Function.h"
+
+namespace flan {
+
+struct FFTHelper;
+
+/** A streaming phase vocoder. Audio is pushed through in blocks; each time a window of input completes it is analysed into a PV
+ *	frame, handed to a FrameOperator, and resynthesized and overlap-added back into the output. Only one window of history is
+ *	kept per channel, so arbitrarily long streams are processed in constant memory.
+ *
+ *	Analysis and synthesis match Audio::convert_to_PV and PV::convert_to_audio, including the phase state carried between
+ *	frames, so with no operator the output is the offline round trip delayed by get_latency() frames, which is the window size.
+ *
+ *	As with all Processors, process never allocates or locks after prepare, but the FrameOperator is called from process and
+ *	must keep to the same rules to remain real time safe.
+ */
+class PVProcessor : public Processor
+{
+public:
+	/** Information about the frame passed to a FrameOperator.
+	 */
+	struct FrameInfo
+		{
+		Channel channel;
+		Second time; // Stream time of the window center, matching PV::frame_to_time for the offline transform
+		Bin num_bins;
+		Frequency bin_width; // The frequency spacing between bins
+		MF * scratch; // num_bins MFs of scratch space the operator may use freely
+		};
+
+	/** Edits one channel of one PV frame in place. frame holds info.num_bins MFs.
+	 */
+	using FrameOperator = std::function<void ( MF * frame, const FrameInfo & info )>;
+
+	/** \param window_size The number of input frames analysed per PV frame. This is also the latency.
+	 *	\param hop The number of input frames between PV frames.
+	 *	\param dft_size The dft size, at least window_size.
+	 *	\param frame_operator The operator applied to each frame. An empty operator resynthesizes frames unchanged.
+	 */
+	PVProcessor(
+		Frame window_size = 2048,
+		Frame hop = 128,
+		Frame dft_size = 4096,
+		FrameOperator frame_operator = FrameOperator()
+		);
+
+	~PVProcessor();
+
+	/** Replaces the frame operator. Not real time safe, as the operator may be copied into new storage.
+	 */
+	void set_frame_operator( FrameOperator frame_operator );
+
+	/** The window size.
+	 */
+	Frame get_latency() const override;
+
+	Bin get_num_bins() const;
+
+	/** Streaming PV::shape. shaper is held by reference and must outlive its use.
+	 */
+	static FrameOperator shape(
+		const Function<MF,MF> & shaper,
+		bool use_shift_alignment = false
+		);
+
+	/** Streaming PV::retain_n_loudest_partials. num_partials is held by reference and must outlive its use.
+	 */
+	static FrameOperator retain_n_loudest_partials(
+		const Function<Second, Bin> & num_partials
+		);
+
+	/** Streaming PV::remove_n_loudest_partials. num_partials is held by reference and must outlive its use.
+	 */
+	static FrameOperator remove_n_loudest_partials(
+		const Function<Second, Bin> & num_partials
+		);
+
+protected:
+	void prepare_state() override;
+	void process_block( const Sample * const * in, Sample * const * out, Frame num_frames ) override;
+	void reset_state() override;
+
+private:
+	struct ChannelState
+		{
+		std::vector<Sample> input; // Circular, indexed by stream frame
+		std::vector<Sample> output; // Circular overlap-add accumulator, indexed by stream frame
+		std::vector<double> analysis_phase;
+		std::vector<double> synthesis_phase;
+		};
+
+	void process_frame( Channel channel );
+
+	const Frame window_size;
+	const Frame hop;
+	const Frame dft_size;
+	FrameOperator frame_operator;
+
+	std::unique_ptr<FFTHelper> fft;
+	std::vector<float> analysis_window;
+	std::vector<float> synthesis_window;
+	std::vector<MF> frame;
+	std::vector<MF> scratch;
+	std::vector<Frequency> bin_frequencies;
+	std::vector<ChannelState> channels;
+	size_t ring_mask = 0;
+
+	uint64_t stream_frame = 0; // Input frames consumed since reset
+	uint64_t next_pv_frame_at = 0; // Value of stream_frame at which the next window completes
+	uint64_t pv_frame = 0; // Index of the next PV frame
+};
+
+}
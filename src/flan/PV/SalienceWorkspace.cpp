@@ -0,0 +1,198 @@
+#include "flan/PV/SalienceWorkspace.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+
+#include "flan/Utility/iota_iter.h"
+#include "flan/Utility/execution.h"
+#include "flan/Utility/Trace.h"
+
+using namespace flan;
+
+// Suggested optimal parameters from Salamon & Gomez
+static const int binEffectDist = 10;
+static const int Nh = 2 * 10;
+static const float alpha = 0.8f;
+//static const float beta = 1.0f; - Unimplemented in code
+static const float gammaDb = 40.0f;
+
+static const int kernelWidth = 2 * binEffectDist + 1;
+
+// Frames handled by one task, which owns one Scratch
+static const Frame framesPerTask = 16;
+
+static float hann_dft2( float f )
+	{
+	if( f == 0 ) return 1.0f;
+	if( std::abs( f ) == 1.0f ) return 0.5f;
+	return std::sin( pi * f ) / ( pi * f * ( 1.0f - f * f ) );
+	}
+
+SalienceWorkspace::SalienceWorkspace( Frequency _min_frequency, Frequency _max_frequency )
+	: min_frequency( _min_frequency )
+	, max_frequency( _max_frequency )
+	, log2_min_frequency( std::log2( _min_frequency ) )
+	, weights( Nh * kernelWidth )
+	{
+	// Cosine falloff around each subharmonic, scaled by the subharmonic weight
+	std::array<float, binEffectDist + 1> gOutputs;
+	for( int i = 0; i <= binEffectDist; ++i )
+		gOutputs[i] = .5f * ( 1.0f + std::cos( float( i ) / binEffectDist * pi / 2.0f ) );
+
+	float alphaPower = 1.0f;
+	for( int h = 0; h < Nh; ++h )
+		{
+		for( int d = 0; d < kernelWidth; ++d )
+			weights[h * kernelWidth + d] = gOutputs[std::abs( d - binEffectDist )] * alphaPower;
+		alphaPower *= alpha;
+		}
+	}
+
+Bin SalienceWorkspace::pitch_bin( Frequency f ) const
+	{
+	return std::round( 10.0f * 12.0f * ( std::log2( f ) - log2_min_frequency ) );
+	}
+
+void SalienceWorkspace::compute( const PV & pv, const std::vector<Channel> & channels, Frame start_frame, Frame end_frame )
+	{
+	flan_TRACE_SPAN( "SalienceWorkspace::compute", pv );
+
+	num_saliences = 0;
+	if( pv.is_null() ) return;
+	for( const Channel channel : channels )
+		if( channel < 0 || pv.get_num_channels() <= channel )
+			{
+			std::cout << "SalienceWorkspace::compute: channel " << channel << " doesn't exist.\n";
+			return;
+			}
+
+	if( end_frame == 0 ) end_frame = pv.get_num_frames();
+	start_frame = std::clamp( start_frame, 0, pv.get_num_frames() );
+	end_frame = std::clamp( end_frame, start_frame, pv.get_num_frames() );
+
+	const Bin num_pitch_bins = std::max( pitch_bin( max_frequency ), 0 );
+	const Frame num_frames = end_frame - start_frame;
+
+	if( saliences.size() < channels.size() ) saliences.resize( channels.size() );
+	num_saliences = channels.size();
+	for( size_t i = 0; i < num_saliences; ++i )
+		{
+		PV::Salience & salience = saliences[i];
+		salience.num_bins = num_pitch_bins;
+		salience.num_frames = num_frames;
+		salience.start_frame = start_frame;
+		salience.buffer.assign( size_t( num_pitch_bins ) * num_frames, 0 );
+		}
+	if( num_pitch_bins == 0 || num_frames == 0 ) return;
+
+	const Bin num_bins = pv.get_num_bins();
+	const float eTestFactor = std::pow( 10, gammaDb / 20.0f );
+	const float windowSize = pv.get_window_size();
+	const float dftSize = pv.get_dft_size();
+
+	const int num_tasks = ( num_frames + framesPerTask - 1 ) / framesPerTask;
+	if( int( scratch.size() ) < num_tasks ) scratch.resize( num_tasks );
+
+	std::for_each( FLAN_PAR_UNSEQ iota_iter( 0 ), iota_iter( num_tasks ), [&]( int task )
+		{
+		Scratch & s = scratch[task];
+		s.magnitudes.resize( num_bins );
+		s.candidates.resize( num_bins );
+		float * mags = s.magnitudes.data();
+		uint8_t * candidates = s.candidates.data();
+
+		const Frame task_end = std::min( end_frame, start_frame + ( task + 1 ) * framesPerTask );
+		for( Frame frame = start_frame + task * framesPerTask; frame < task_end; ++frame )
+			{
+			// Get maximum magnitude for this frame, across every channel
+			Magnitude a_M = 0;
+			for( Channel c = 0; c < pv.get_num_channels(); ++c )
+				{
+				const MF * framePtr = pv.get_MF_pointer( c, frame, 0 );
+				for( Bin b = 0; b < num_bins; ++b )
+					a_M = std::max( a_M, std::abs( framePtr[b].m ) );
+				}
+			const float aiLimit = a_M / eTestFactor; // Checking a_i > limit is equivalent to checking 10log_20(aM/ai) < gamma
+
+			for( size_t i = 0; i < num_saliences; ++i )
+				{
+				const MF * framePtr = pv.get_MF_pointer( channels[i], frame, 0 );
+				float * row = &saliences[i].get( frame - start_frame, 0 );
+
+				for( Bin b = 0; b < num_bins; ++b )
+					mags[b] = framePtr[b].m;
+
+				// Mark audible rising edges which don't rise further. Strict peaks and the starts of plateaus are both marked.
+				for( Bin b = 1; b < num_bins - 1; ++b )
+					candidates[b] = uint8_t( mags[b] > mags[b-1] ) & uint8_t( mags[b] >= mags[b+1] ) & uint8_t( mags[b] >= aiLimit );
+
+				for( Bin b = 1; b < num_bins - 1; ++b )
+					{
+					if( !candidates[b] ) continue;
+
+					// A plateau is a peak only if it falls on the right, and it is then placed at its middle
+					Bin bin = b;
+					if( mags[b] == mags[b+1] )
+						{
+						Bin right = b + 1;
+						while( right < num_bins && mags[right] == mags[b] ) ++right;
+						if( right == num_bins || mags[right] > mags[b] ) continue;
+						bin = ( b - 1 + right ) / 2;
+						}
+
+					// Instantaneous amplitude correction
+					const float iF = framePtr[bin].f;
+					const float binOffset = pv.frequency_to_bin( iF ) - bin;
+					const float kernelFactor = hann_dft2( binOffset * windowSize / dftSize );
+					const float iM = kernelFactor >= 0.5f? mags[bin] / kernelFactor : 0;
+
+					for( int h = 0; h < Nh; ++h ) // For each subharmonic the current peak could be a harmonic of:
+						{
+						const Bin B_c = pitch_bin( iF / ( h + 1 ) ); // Get subharmonic pitch bin
+						if( B_c < 0 ) break;
+
+						// Scatter into all nearby pitch bins, delta checking is handled in loop bounds
+						const Bin loopStart = std::max( 0, B_c - binEffectDist );
+						const Bin loopEnd = std::min( num_pitch_bins - 1, B_c + binEffectDist );
+						const float * w = weights.data() + h * kernelWidth + ( loopStart - B_c + binEffectDist );
+						for( Bin p = 0; p <= loopEnd - loopStart; ++p )
+							row[loopStart + p] += w[p] * iM;
+						}
+					}
+				}
+			}
+		} );
+
+	// Normalize
+	for( size_t i = 0; i < num_saliences; ++i )
+		{
+		std::vector<float> & buffer = saliences[i].buffer;
+		const float max = *std::max_element( buffer.begin(), buffer.end() );
+		if( max > 0 )
+			std::for_each( buffer.begin(), buffer.end(), [max]( float & x ){ x /= max; } );
+		}
+	}
+
+const PV::Salience & SalienceWorkspace::compute( const PV & pv, Channel channel, Frame start_frame, Frame end_frame )
+	{
+	compute( pv, std::vector<Channel>{ channel }, start_frame, end_frame );
+	return get( 0 );
+	}
+
+const PV::Salience & SalienceWorkspace::get( size_t i ) const
+	{
+	static const PV::Salience empty{ 0, 0, {} };
+	return i < num_saliences ? saliences[i] : empty;
+	}
+
+Frequency SalienceWorkspace::get_min_frequency() const
+	{
+	return min_frequency;
+	}
+
+Frequency SalienceWorkspace::get_max_frequency() const
+	{
+	return max_frequency;
+	}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "flan/PV/PV.h"
+
+namespace flan {
+
+/** Computes the pitch salience used by PV::get_salience, keeping every buffer between calls.
+ *	Each frame's magnitudes are copied into contiguous scratch, where peaks are found by a branch free pass that marks rising
+ *	edges above the audibility threshold, so only those few candidates are examined one at a time. Every surviving peak is then
+ *	scattered into the pitch bins of its subharmonics as a short run of precomputed weights. Scratch and output buffers only
+ *	ever grow, so a workspace reused across calls or PVs of similar size stops allocating after the first call.
+ *
+ *	Results match PV::get_salience exactly, though here a subset of channels and frames can be requested. As with
+ *	PV::get_salience, the audibility threshold of each frame is taken across all channels, not only the requested ones.
+ *	A workspace isn't safe to use from several threads at once, but it parallelizes internally.
+ */
+class SalienceWorkspace
+{
+public:
+	/** \param min_frequency Frequency of the lowest pitch bin.
+	 *	\param max_frequency Frequency of the highest pitch bin.
+	 */
+	SalienceWorkspace(
+		Frequency min_frequency = 55,
+		Frequency max_frequency = 1760
+		);
+
+	/** Computes normalized salience for each of channels. Each channel is normalized by its own maximum over the computed frames.
+	 *	\param pv The PV to analyze.
+	 *	\param channels The channels to analyze.
+	 *	\param start_frame The first frame to analyze.
+	 *	\param end_frame One past the last frame to analyze. Zero analyzes to the end of pv.
+	 */
+	void compute(
+		const PV & pv,
+		const std::vector<Channel> & channels,
+		Frame start_frame = 0,
+		Frame end_frame = 0
+		);
+
+	/** Computes a single channel, see the overload above.
+	 *	\return The salience of channel, valid until the next call to compute.
+	 */
+	const PV::Salience & compute(
+		const PV & pv,
+		Channel channel,
+		Frame start_frame = 0,
+		Frame end_frame = 0
+		);
+
+	/** Returns the salience of the i-th channel given to the last call to compute. Its frames begin at PV::Salience::start_frame.
+	 */
+	const PV::Salience & get( size_t i ) const;
+
+	Frequency get_min_frequency() const;
+	Frequency get_max_frequency() const;
+
+private:
+	// Per task scratch, kept so repeated calls don't allocate
+	struct Scratch
+		{
+		std::vector<float> magnitudes;
+		std::vector<uint8_t> candidates;
+		};
+
+	Bin pitch_bin( Frequency ) const;
+
+	const Frequency min_frequency;
+	const Frequency max_frequency;
+	const float log2_min_frequency;
+	std::vector<float> weights; // Subharmonic major, the contribution of a peak to each pitch bin near each of its subharmonics
+
+	std::vector<PV::Salience> saliences; // Only grows, the first num_saliences are valid
+	size_t num_saliences = 0;
+	std::vector<Scratch> scratch;
+};
+
+}
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <functional>
+#include <concepts>
+
 namespace flan {
 
 /*
 While working on algorithms there were a lot of times I noticed that everything would be much faster if I could just modify the input sound.
-Methods don't allow you to check if the input object is a temporary.
+Methods don't allow you to check if the input object is a temporary, short of ref-qualifying every overload.
+The size preserving Audio and PV methods do have && overloads now, but anything else still allocates an output.
 I could use normal functions with an overload for rvalue refs, but then I can't use the much better method syntax.
 The solution to getting both behaviours is pipes. A pipe is an object that has some algorithm inputs bound to it.
 You can then pass a single type into the pipe and get a transformed object of the same type out.
@@ -29,7 +33,8 @@ public:
 
 	Pipe<T> operator()( const Pipe<T> & p ) const 
 		{
-		return [&]( T && a ){ return operator()( p( a ) ); };
+		// Both pipes are captured by value, so composing temporaries is safe
+		return [self = *this, p]( T && a ){ return self( p( std::move( a ) ) ); };
 		}
 
 	Pipe<T> operator>>( const Pipe<T> & p ) const { return operator()( p ); }
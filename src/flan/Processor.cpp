@@ -0,0 +1,423 @@
+#include "flan/Processor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+using namespace flan;
+
+//============================================================================================================================================================
+// Processor
+//============================================================================================================================================================
+
+void Processor::prepare( FrameRate _sample_rate, Frame _max_block_frames, Channel _num_channels )
+	{
+	sample_rate = _sample_rate;
+	max_block_frames = std::max( _max_block_frames, Frame( 1 ) );
+	num_channels = _num_channels;
+	in_offset.resize( num_channels );
+	out_offset.resize( num_channels );
+	prepare_state();
+	reset();
+	}
+
+void Processor::process( const Sample * const * in, Sample * const * out, Frame num_frames )
+	{
+	if( sample_rate <= 0 )
+		{
+		copy_through( in, out, num_frames );
+		return;
+		}
+
+	if( num_frames <= max_block_frames )
+		{
+		process_block( in, out, num_frames );
+		return;
+		}
+
+	for( Frame start = 0; start < num_frames; start += max_block_frames )
+		{
+		for( Channel channel = 0; channel < num_channels; ++channel )
+			{
+			in_offset[channel] = in[channel] + start;
+			out_offset[channel] = out[channel] + start;
+			}
+		process_block( in_offset.data(), out_offset.data(), std::min( max_block_frames, num_frames - start ) );
+		}
+	}
+
+void Processor::reset()
+	{
+	reset_state();
+	}
+
+void Processor::copy_through( const Sample * const * in, Sample * const * out, Frame num_frames ) const
+	{
+	for( Channel channel = 0; channel < num_channels; ++channel )
+		if( in[channel] != out[channel] )
+			std::copy( in[channel], in[channel] + num_frames, out[channel] );
+	}
+
+
+
+//============================================================================================================================================================
+// Filters
+//============================================================================================================================================================
+
+Filter1PoleProcessor::Filter1PoleProcessor( Type _type, Frequency _cutoff, uint16_t _order )
+	: cutoff( _cutoff )
+	, type( _type )
+	, order( _order )
+	{
+	}
+
+void Filter1PoleProcessor::prepare_state()
+	{
+	filters.clear();
+	filters.reserve( num_channels );
+	for( Channel channel = 0; channel < num_channels; ++channel )
+		filters.emplace_back( sample_rate, order );
+	}
+
+void Filter1PoleProcessor::process_block( const Sample * const * in, Sample * const * out, Frame num_frames )
+	{
+	cutoff.begin_block( num_frames );
+	const bool lowpass = type == Type::Lowpass;
+
+	if( order == 0 )
+		{
+		copy_through( in, out, num_frames );
+		return;
+		}
+
+	for( Channel channel = 0; channel < num_channels; ++channel )
+		for( Frame frame = 0; frame < num_frames; ++frame )
+			{
+			const Frequency c = std::clamp( cutoff[frame], 1.0f, sample_rate / 2.0f );
+			out[channel][frame] = filters[channel].process_sample( in[channel][frame], c, lowpass );
+			}
+	}
+
+void Filter1PoleProcessor::reset_state()
+	{
+	cutoff.snap();
+	for( auto & f : filters ) f.reset();
+	}
+
+Filter2PoleProcessor::Filter2PoleProcessor( Type _type, Frequency _cutoff, float _damping, uint16_t _order )
+	: cutoff( _cutoff )
+	, damping( _damping )
+	, type( _type )
+	, order( _order )
+	{
+	}
+
+void Filter2PoleProcessor::prepare_state()
+	{
+	filters.clear();
+	filters.reserve( num_channels );
+	for( Channel channel = 0; channel < num_channels; ++channel )
+		filters.emplace_back( sample_rate, order );
+	}
+
+void Filter2PoleProcessor::process_block( const Sample * const * in, Sample * const * out, Frame num_frames )
+	{
+	cutoff.begin_block( num_frames );
+	damping.begin_block( num_frames );
+	const size_t output = type == Type::Lowpass ? 0 : type == Type::Bandpass ? 1 : 2;
+
+	if( order == 0 )
+		{
+		copy_through( in, out, num_frames );
+		return;
+		}
+
+	for( Channel channel = 0; channel < num_channels; ++channel )
+		for( Frame frame = 0; frame < num_frames; ++frame )
+			{
+			const Frequency c = std::clamp( cutoff[frame], 1.0f, sample_rate / 2.0f );
+			out[channel][frame] = filters[channel].process_sample( in[channel][frame], c, damping[frame], output );
+			}
+	}
+
+void Filter2PoleProcessor::reset_state()
+	{
+	cutoff.snap();
+	damping.snap();
+	for( auto & f : filters ) f.reset();
+	}
+
+
+
+//============================================================================================================================================================
+// Volume
+//============================================================================================================================================================
+
+CompressorProcessor::CompressorProcessor(
+	Decibel _threshold,
+	float _compression_ratio,
+	Second _attack,
+	Second _release,
+	Decibel _knee_width
+	)
+	: threshold( _threshold )
+	, compression_ratio( _compression_ratio )
+	, attack( _attack )
+	, release( _release )
+	, knee_width( _knee_width )
+	{
+	}
+
+void CompressorProcessor::prepare_state()
+	{
+	}
+
+void CompressorProcessor::process_block( const Sample * const * in, Sample * const * out, Frame num_frames )
+	{
+	// See Audio::compress for the references
+	threshold.begin_block( num_frames );
+	compression_ratio.begin_block( num_frames );
+	attack.begin_block( num_frames );
+	release.begin_block( num_frames );
+	knee_width.begin_block( num_frames );
+
+	// (4)
+	auto gain_computer = [&]( Decibel x_G, Decibel threshold, Decibel knee_width, float ratio ) -> Decibel
+		{
+		const Decibel overshoot = x_G - threshold;
+		if( overshoot <= -knee_width/2.0f ) // Before knee
+			return x_G;
+		else if( overshoot >= knee_width / 2.0f ) // After knee
+			return x_G + overshoot * ( 1 / ratio - 1 );
+		else // In the knee
+			{
+			const Decibel z = overshoot + knee_width/2.0f;
+			return x_G + ( 1 / ratio - 1 ) * z*z / ( 2.0f * knee_width );
+			}
+		};
+
+	// (7)
+	auto time_to_alpha = [sr = sample_rate]( Second t ){ return std::exp( -1.0f / ( t * sr ) ); };
+
+	// Constant times are common, and save two exps per frame
+	const bool constant_times = attack.is_constant() && release.is_constant();
+	const float a_A_constant = time_to_alpha( attack[0] );
+	const float a_R_constant = time_to_alpha( release[0] );
+
+	for( Frame frame = 0; frame < num_frames; ++frame )
+		{
+		// All channels need to be compressed equally, so the volume control input signal used is the max signal over channels
+		Sample x = 0;
+		for( Channel channel = 0; channel < num_channels; ++channel )
+			x = std::max( x, in[channel][frame] );
+
+		// (23)
+		const Decibel x_G = 20.0f * std::log10( std::max( std::abs( x ), 1e-6f ) ); // Max is to avoid -inf from log
+		const Decibel y_G = gain_computer( x_G, threshold[frame], knee_width[frame], compression_ratio[frame] );
+		const Decibel x_L = x_G - y_G;
+
+		// (17)
+		const float a_A = constant_times ? a_A_constant : time_to_alpha( attack[frame] );
+		const float a_R = constant_times ? a_R_constant : time_to_alpha( release[frame] );
+		y_1 = std::max( x_L, a_R * y_1 + ( 1.0f - a_R ) * x_L );
+		y_L = a_A * y_L + ( 1.0f - a_A ) * y_1;
+
+		const Sample c = std::pow( 10.0f, -y_L / 20.0f );
+		for( Channel channel = 0; channel < num_channels; ++channel )
+			out[channel][frame] = in[channel][frame] * c;
+		}
+	}
+
+void CompressorProcessor::reset_state()
+	{
+	threshold.snap();
+	compression_ratio.snap();
+	attack.snap();
+	release.snap();
+	knee_width.snap();
+	y_1 = 0;
+	y_L = 0;
+	}
+
+WaveshapeProcessor::WaveshapeProcessor( Oversampler::Shaper _shaper, uint16_t _oversample_factor )
+	: shaper( std::move( _shaper ) )
+	, oversample_factor( _oversample_factor )
+	{
+	}
+
+Frame WaveshapeProcessor::get_latency() const
+	{
+	return oversamplers.empty() ? 0 : oversamplers[0].get_latency();
+	}
+
+void WaveshapeProcessor::prepare_state()
+	{
+	oversamplers.clear();
+	oversamplers.reserve( num_channels );
+	for( Channel channel = 0; channel < num_channels; ++channel )
+		oversamplers.emplace_back( oversample_factor );
+	}
+
+void WaveshapeProcessor::process_block( const Sample * const * in, Sample * const * out, Frame num_frames )
+	{
+	for( Channel channel = 0; channel < num_channels; ++channel )
+		oversamplers[channel].process( in[channel], out[channel], num_frames, shaper );
+	}
+
+void WaveshapeProcessor::reset_state()
+	{
+	for( auto & o : oversamplers ) o.reset();
+	}
+
+
+
+//============================================================================================================================================================
+// Spatial
+//============================================================================================================================================================
+
+// The stereo gains used by Audio::pan_in_place. This is Interpolator::sine2 written out, as Interpolators may allocate.
+static std::pair<float, float> get_pan_gains( float pan_position )
+	{
+	const float pan = pan_position / 2.0f + 0.5f; // Convert [-1,1] to [0,1]
+	const float sqrt2 = std::sqrt( 2.0f );
+	return { sqrt2 * std::sin( pi / 4.0f * pan ), sqrt2 * std::sin( pi / 4.0f * ( 1.0f - pan ) ) };
+	}
+
+PanProcessor::PanProcessor( float _pan_position )
+	: pan_position( _pan_position )
+	{
+	}
+
+void PanProcessor::process_block( const Sample * const * in, Sample * const * out, Frame num_frames )
+	{
+	pan_position.begin_block( num_frames );
+
+	if( num_channels != 2 )
+		{
+		copy_through( in, out, num_frames );
+		return;
+		}
+
+	for( Frame frame = 0; frame < num_frames; ++frame )
+		{
+		const auto gains = get_pan_gains( pan_position[frame] );
+		out[0][frame] = in[0][frame] * gains.first;
+		out[1][frame] = in[1][frame] * gains.second;
+		}
+	}
+
+void PanProcessor::reset_state()
+	{
+	pan_position.snap();
+	}
+
+WidenProcessor::WidenProcessor( float _widen_amount )
+	: widen_amount( _widen_amount )
+	{
+	}
+
+void WidenProcessor::process_block( const Sample * const * in, Sample * const * out, Frame num_frames )
+	{
+	widen_amount.begin_block( num_frames );
+
+	if( num_channels != 2 )
+		{
+		copy_through( in, out, num_frames );
+		return;
+		}
+
+	// Mid-side conversion, pan, and conversion back, as in Audio::widen. The two conversions' factors of 1/sqrt2 give 1/2.
+	for( Frame frame = 0; frame < num_frames; ++frame )
+		{
+		const auto gains = get_pan_gains( widen_amount[frame] );
+		const Sample mid  = ( in[0][frame] + in[1][frame] ) * gains.first;
+		const Sample side = ( in[0][frame] - in[1][frame] ) * gains.second;
+		out[0][frame] = ( mid + side ) / 2.0f;
+		out[1][frame] = ( mid - side ) / 2.0f;
+		}
+	}
+
+void WidenProcessor::reset_state()
+	{
+	widen_amount.snap();
+	}
+
+
+
+//============================================================================================================================================================
+// Modulation
+//============================================================================================================================================================
+
+FrequencyShiftProcessor::FrequencyShiftProcessor( Frequency _shift, Frequency _low_cutoff )
+	: shift( _shift )
+	, low_cutoff( _low_cutoff )
+	{
+	// The same phase difference network as Audio::halfband_modulate
+	const auto poles = phase_diff_network_pole_design( 20, 5, 22000 );
+	cutoffs_re = poles.first;
+	cutoffs_im = poles.second;
+	}
+
+void FrequencyShiftProcessor::prepare_state()
+	{
+	channels.clear();
+	channels.reserve( num_channels );
+	for( Channel channel = 0; channel < num_channels; ++channel )
+		channels.push_back( ChannelState{
+			Filter_1Pole_Butterworth( sample_rate, 8 ),
+			Filter_1Pole_Butterworth( sample_rate, 8 ),
+			std::vector<Filter_1Pole>( cutoffs_re.size(), sample_rate ),
+			std::vector<Filter_1Pole>( cutoffs_im.size(), sample_rate ) } );
+	}
+
+void FrequencyShiftProcessor::process_block( const Sample * const * in, Sample * const * out, Frame num_frames )
+	{
+	shift.begin_block( num_frames );
+
+	const Frequency high_cutoff = sample_rate/2 - 1000; // Using exactly nyquist causes feedback in high order filter.
+
+	auto allpass_chain = []( std::vector<Filter_1Pole> & filters, const std::vector<float> & cutoffs, Sample x )
+		{
+		for( Index filter_i = 0; filter_i < filters.size(); ++filter_i )
+			x = filters[filter_i].process_sample_and_mix( x, cutoffs[filter_i], { 1.0f, -1.0f }, false );
+		return x;
+		};
+
+	const double start_phase = phase;
+	for( Channel channel = 0; channel < num_channels; ++channel )
+		{
+		ChannelState & state = channels[channel];
+		phase = start_phase;
+		for( Frame frame = 0; frame < num_frames; ++frame )
+			{
+			const Frequency s = shift[frame];
+
+			// Frequencies may be moved supernyquist or sub-dc, which we would not like. This pre-filters those signals away.
+			const Frequency lowpass_cutoff = std::clamp( s > 0 ? high_cutoff - s : high_cutoff, 1.0f, sample_rate / 2.0f );
+			const Frequency highpass_cutoff = std::clamp( s < 0 ? low_cutoff - s : low_cutoff, 1.0f, sample_rate / 2.0f );
+			Sample x = state.lowpass.process_sample( in[channel][frame], lowpass_cutoff, true );
+			x = state.highpass.process_sample( x, highpass_cutoff, false );
+
+			const Sample re = allpass_chain( state.allpasses_re, cutoffs_re, x );
+			const Sample im = allpass_chain( state.allpasses_im, cutoffs_im, x );
+			out[channel][frame] = re * std::cos( float( phase ) ) - im * std::sin( float( phase ) );
+
+			phase += s * pi2 / sample_rate;
+			}
+		}
+
+	phase = std::fmod( phase, 2.0 * std::numbers::pi );
+	}
+
+void FrequencyShiftProcessor::reset_state()
+	{
+	shift.snap();
+	phase = 0;
+	for( auto & state : channels )
+		{
+		state.lowpass.reset();
+		state.highpass.reset();
+		for( auto & f : state.allpasses_re ) f.reset();
+		for( auto & f : state.allpasses_im ) f.reset();
+		}
+	}
@@ -0,0 +1,341 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+#include "flan/defines.h"
+#include "flan/FilterCore.h"
+#include "flan/Oversampler.h"
+
+/*
+Real time processors. The Audio methods process whole buffers at once, which suits rendering but not a plugin or live input
+callback, where audio arrives a block at a time and the callback may not allocate, lock, or wait. Each Processor here is a
+streaming counterpart of an Audio method, holding its state between blocks in members rather than locals.
+
+All allocation happens in prepare. After that, process and reset never allocate or lock, so they are safe to call from an
+audio callback. Parameters are ProcessorParameters, which can be set from any thread and take effect at the next block.
+Given the same constant parameters, a Processor's output matches the Audio method it mirrors.
+*/
+
+namespace flan {
+
+/** A Processor parameter. It can be set from any thread without locking, and is read once at the start of each block. Over
+ *	that block the value ramps linearly from its previous value to the new one, so stepped changes don't click.
+ */
+class ProcessorParameter
+{
+public:
+	ProcessorParameter( float value )
+		: target( value )
+		, start( value )
+		, step( 0 )
+		{}
+
+	/** Sets the value to be reached by the end of the next block.
+	 */
+	void set( float value ) { target.store( value, std::memory_order_relaxed ); }
+
+	/** The most recently set value.
+	 */
+	float get() const { return target.load( std::memory_order_relaxed ); }
+
+	/** Starts a block of num_frames frames. Called by the owning Processor.
+	 */
+	void begin_block( Frame num_frames )
+		{
+		start += step * ramp_frames;
+		const float end = get();
+		ramp_frames = num_frames;
+		step = num_frames > 0 ? ( end - start ) / num_frames : 0;
+		}
+
+	/** Jumps to the most recently set value with no ramp.
+	 */
+	void snap()
+		{
+		start = get();
+		step = 0;
+		}
+
+	/** The value at the given frame of the current block. The last frame of the block has the set value.
+	 */
+	float operator[]( Frame frame ) const { return start + step * ( frame + 1 ); }
+
+	/** Checks if the value is the same over the whole current block.
+	 */
+	bool is_constant() const { return step == 0; }
+
+private:
+	std::atomic<float> target;
+	float start;
+	float step;
+	Frame ramp_frames = 0;
+};
+
+/** Base class for real time processors. See the top of Processor.h.
+ *
+ *	Processors are used in three phases. prepare allocates for a stream format, process is called for each block, and reset
+ *	clears the signal history, for example when playback jumps.
+ */
+class Processor
+{
+public:
+	virtual ~Processor() = default;
+
+	/** Allocates everything needed to process the given stream format, and resets. This is not real time safe. Call it before
+	 *	the first block and again whenever the format changes.
+	 *	\param sample_rate The stream sample rate.
+	 *	\param max_block_frames The most frames that will be passed to process at once.
+	 *	\param num_channels The number of channels in each block.
+	 */
+	void prepare( FrameRate sample_rate, Frame max_block_frames, Channel num_channels );
+
+	/** Processes one block. in and out hold a pointer to each channel's samples, and may point to the same buffers. Blocks
+	 *	longer than max_block_frames are split, each part getting its own parameter ramp. Never allocates or locks. If prepare
+	 *	hasn't been called, in is copied to out.
+	 *	\param in The input channels.
+	 *	\param out The output channels.
+	 *	\param num_frames The number of frames in the block.
+	 */
+	void process( const Sample * const * in, Sample * const * out, Frame num_frames );
+
+	/** Clears all signal history, as if nothing had been processed since prepare. Parameters are moved to their set values
+	 *	with no ramp. Never allocates or locks.
+	 */
+	void reset();
+
+	/** The delay from input to output, in frames. This is valid after prepare.
+	 */
+	virtual Frame get_latency() const { return 0; }
+
+	FrameRate get_sample_rate() const { return sample_rate; }
+	Frame get_max_block_frames() const { return max_block_frames; }
+	Channel get_num_channels() const { return num_channels; }
+
+protected:
+	/** Allocates state for the format stored in sample_rate, max_block_frames, and num_channels.
+	 */
+	virtual void prepare_state() = 0;
+
+	/** Processes at most max_block_frames frames. Every ProcessorParameter should have begin_block called first.
+	 */
+	virtual void process_block( const Sample * const * in, Sample * const * out, Frame num_frames ) = 0;
+
+	/** Clears signal history and snaps parameters.
+	 */
+	virtual void reset_state() = 0;
+
+	/** Copies in to out unchanged, for processors with nothing to do.
+	 */
+	void copy_through( const Sample * const * in, Sample * const * out, Frame num_frames ) const;
+
+	FrameRate sample_rate = 0;
+	Frame max_block_frames = 0;
+	Channel num_channels = 0;
+
+private:
+	std::vector<const Sample *> in_offset;
+	std::vector<Sample *> out_offset;
+};
+
+
+
+//============================================================================================================================================================
+// Filters
+//============================================================================================================================================================
+
+/** Streaming Audio::filter_1pole_lowpass and Audio::filter_1pole_highpass.
+ */
+class Filter1PoleProcessor : public Processor
+{
+public:
+	enum class Type { Lowpass, Highpass };
+
+	/** \param type The filter response.
+	 *	\param cutoff The initial cutoff.
+	 *	\param order The Butterworth order. Each order adds 6dB per octave of rolloff.
+	 */
+	Filter1PoleProcessor( Type type, Frequency cutoff, uint16_t order = 1 );
+
+	ProcessorParameter cutoff;
+
+protected:
+	void prepare_state() override;
+	void process_block( const Sample * const * in, Sample * const * out, Frame num_frames ) override;
+	void reset_state() override;
+
+private:
+	const Type type;
+	const uint16_t order;
+	std::vector<Filter_1Pole_Butterworth> filters;
+};
+
+/** Streaming Audio::filter_2pole_lowpass, Audio::filter_2pole_bandpass, and Audio::filter_2pole_highpass.
+ */
+class Filter2PoleProcessor : public Processor
+{
+public:
+	enum class Type { Lowpass, Bandpass, Highpass };
+
+	/** \param type The filter response.
+	 *	\param cutoff The initial cutoff.
+	 *	\param damping The initial damping. Values below 1/sqrt(2) resonate, approaching self oscillation at 0.
+	 *	\param order The number of cascaded 2-pole stages. Each order adds 12dB per octave of rolloff.
+	 */
+	Filter2PoleProcessor( Type type, Frequency cutoff, float damping, uint16_t order = 1 );
+
+	ProcessorParameter cutoff;
+	ProcessorParameter damping;
+
+protected:
+	void prepare_state() override;
+	void process_block( const Sample * const * in, Sample * const * out, Frame num_frames ) override;
+	void reset_state() override;
+
+private:
+	const Type type;
+	const uint16_t order;
+	std::vector<Filter_2Pole_Butterworth> filters;
+};
+
+
+
+//============================================================================================================================================================
+// Volume
+//============================================================================================================================================================
+
+/** Streaming Audio::compress, keyed from the input. Every channel gets the same gain, computed from the largest sample over
+ *	channels.
+ */
+class CompressorProcessor : public Processor
+{
+public:
+	CompressorProcessor(
+		Decibel threshold,
+		float compression_ratio = 3.0f,
+		Second attack = 5.0f / 1000.0f,
+		Second release = 100.0f / 1000.0f,
+		Decibel knee_width = 0
+		);
+
+	ProcessorParameter threshold;
+	ProcessorParameter compression_ratio;
+	ProcessorParameter attack;
+	ProcessorParameter release;
+	ProcessorParameter knee_width;
+
+protected:
+	void prepare_state() override;
+	void process_block( const Sample * const * in, Sample * const * out, Frame num_frames ) override;
+	void reset_state() override;
+
+private:
+	// Peak detector state
+	float y_1 = 0;
+	float y_L = 0;
+};
+
+/** Streaming Audio::waveshape, oversampled to reduce aliasing. See Oversampler.
+ */
+class WaveshapeProcessor : public Processor
+{
+public:
+	/** \param shaper Shapes oversampled samples in place. It is called from process, so it also may not allocate or lock.
+	 *	\param oversample_factor The oversampling factor, rounded up to a power of two and at most 16. 1 disables oversampling.
+	 */
+	WaveshapeProcessor( Oversampler::Shaper shaper, uint16_t oversample_factor = 4 );
+
+	Frame get_latency() const override;
+
+protected:
+	void prepare_state() override;
+	void process_block( const Sample * const * in, Sample * const * out, Frame num_frames ) override;
+	void reset_state() override;
+
+private:
+	const Oversampler::Shaper shaper;
+	const uint16_t oversample_factor;
+	std::vector<Oversampler> oversamplers;
+};
+
+
+
+//============================================================================================================================================================
+// Spatial
+//============================================================================================================================================================
+
+/** Streaming Audio::pan_in_place. This needs two channels, other channel counts are passed through.
+ */
+class PanProcessor : public Processor
+{
+public:
+	/** \param pan_position The initial position, from -1 (left) to 1 (right).
+	 */
+	PanProcessor( float pan_position = 0 );
+
+	ProcessorParameter pan_position;
+
+protected:
+	void prepare_state() override {}
+	void process_block( const Sample * const * in, Sample * const * out, Frame num_frames ) override;
+	void reset_state() override;
+};
+
+/** Streaming Audio::widen. This needs two channels, other channel counts are passed through.
+ */
+class WidenProcessor : public Processor
+{
+public:
+	/** \param widen_amount The initial amount, on [-1,1], representing movement from mid to side.
+	 */
+	WidenProcessor( float widen_amount = 0 );
+
+	ProcessorParameter widen_amount;
+
+protected:
+	void prepare_state() override {}
+	void process_block( const Sample * const * in, Sample * const * out, Frame num_frames ) override;
+	void reset_state() override;
+};
+
+
+
+//============================================================================================================================================================
+// Modulation
+//============================================================================================================================================================
+
+/** Streaming Audio::shift_frequency.
+ */
+class FrequencyShiftProcessor : public Processor
+{
+public:
+	/** \param shift The initial shift.
+	 *	\param low_cutoff Input below this is removed before shifting down, so it isn't shifted below zero.
+	 */
+	FrequencyShiftProcessor( Frequency shift, Frequency low_cutoff = 30 );
+
+	ProcessorParameter shift;
+
+protected:
+	void prepare_state() override;
+	void process_block( const Sample * const * in, Sample * const * out, Frame num_frames ) override;
+	void reset_state() override;
+
+private:
+	struct ChannelState
+		{
+		Filter_1Pole_Butterworth lowpass;
+		Filter_1Pole_Butterworth highpass;
+		std::vector<Filter_1Pole> allpasses_re;
+		std::vector<Filter_1Pole> allpasses_im;
+		};
+
+	const Frequency low_cutoff;
+	std::vector<float> cutoffs_re;
+	std::vector<float> cutoffs_im;
+	std::vector<ChannelState> channels;
+	double phase = 0;
+};
+
+}
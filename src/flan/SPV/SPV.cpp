@@ -1,4 +1,5 @@
 #include "SPV.h"
+#include "flan/Utility/Trace.h"
 
 #include <iostream>
 
@@ -20,6 +21,7 @@ SPV::SPV( Format _format )
 
 SPV SPV::modify_frequency( const Function<TF, Second> & mod ) const
 	{
+	flan_TRACE_SPAN( "SPV::modify_frequency", *this );
 	if( is_null() ) return SPV();
 
 	SPV out = copy();
@@ -40,5 +42,6 @@ SPV SPV::modify_frequency( const Function<TF, Second> & mod ) const
 
 SPV SPV::repitch( const Function<TF, Frequency> & mod ) const
 	{
+	flan_TRACE_SPAN( "SPV::repitch", *this );
 	return modify_frequency( [&]( TF tf ){ return tf.f * mod( tf ); } );
 	}
\ No newline at end of file
@@ -14,8 +14,8 @@ public:
 	SPV( SPVBuffer && );
 	SPV( Format );
 
-	Audio convert_to_audio();
-	Audio convert_to_lr_audio();
+	Audio convert_to_audio( flan_CANCEL_ARG );
+	Audio convert_to_lr_audio( flan_CANCEL_ARG );
 
 	SPV modify_frequency( const Function<TF, Frequency> & mod ) const;
 	SPV repitch( const Function<TF, Frequency> & mod ) const;
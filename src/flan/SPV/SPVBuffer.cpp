@@ -1,6 +1,7 @@
 #include "SPVBuffer.h"
 
 #include "flan/Utility/execution.h"
+#include "flan/Utility/Trace.h"
 
 using namespace flan;
 
@@ -12,7 +13,9 @@ SPVBuffer::SPVBuffer()
 SPVBuffer::SPVBuffer( Format _format )
 	: format( _format )
 	, buffer( get_num_channels() * get_num_frames() * get_num_bins() )
-	{}
+	{
+	flan_TRACE_ALLOCATION( buffer.size() * sizeof( buffer[0] ) );
+	}
 
 const SPVBuffer::Format & SPVBuffer::get_format() const 
 	{
@@ -21,12 +24,12 @@ const SPVBuffer::Format & SPVBuffer::get_format() const
 
 fFrame SPVBuffer::time_to_frame( Second t ) const 
 	{
-	return t * get_sample_rate();
+	return t * get_analysis_rate();
 	}
 
 Second SPVBuffer::frame_to_time( fFrame f ) const 
 	{
-	return f / get_sample_rate();
+	return f / get_analysis_rate();
 	}
 
 fBin SPVBuffer::frequency_to_bin( Frequency f ) const 
@@ -61,7 +64,12 @@ FrameRate SPVBuffer::get_sample_rate() const
 
 FrameRate SPVBuffer::get_analysis_rate() const
 	{
-	return format.sample_rate;
+	return format.sample_rate / format.decimation;
+	}
+
+Frame SPVBuffer::get_decimation() const
+	{
+	return format.decimation;
 	}
 
 bool SPVBuffer::is_null() const 
@@ -90,6 +98,7 @@ SPVBuffer SPVBuffer::copy() const
 	SPVBuffer out;
 	out.format = format;
 	out.buffer = buffer; // Deep copy
+	flan_TRACE_ALLOCATION( buffer.size() * sizeof( buffer[0] ) );
 	return out;
 	}
 
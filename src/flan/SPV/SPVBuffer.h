@@ -17,6 +17,7 @@ public:
 		Frame num_frames = 0;
 		Bin num_bins = 0;
 		FrameRate sample_rate = 48000;
+		Frame decimation = 1; // Audio samples per frame
 		};
 
 	SPVBuffer( const SPVBuffer & ) = delete;
@@ -39,6 +40,7 @@ public:
 	Bin	get_num_bins() const;
 	FrameRate get_sample_rate() const;
 	FrameRate get_analysis_rate() const;
+	Frame get_decimation() const;
 
 	Second get_length() const { return frame_to_time( get_num_frames() ); }
 	Frequency get_height() const { return bin_to_frequency( get_num_bins() ); }
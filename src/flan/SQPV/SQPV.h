@@ -1,29 +1,40 @@
-// #pragma once
-
-// #include "SQPVBuffer.h"
-
-// #include "flan/Function.h"
-
-// namespace flan {
-
-// class Audio;
-// class Graph;
-
-// class SQPV : public SQPVBuffer
-// {
-// public:
-// 	SQPV();
-// 	SQPV( const Format & );
-// 	SQPV( SQPVBuffer && );
-
-// 	Audio convert_to_audio() const;
-// 	Audio convert_to_lr_audio() const;
-// 	Graph convert_to_graph() const;
-
-// 	SQPV modify_pitch( const Function<std::pair<Second, Pitch>, Pitch> & mod ) const;
-// 	SQPV repitch( const Function<std::pair<Second, Pitch>, float> & mod ) const;
-
-// 	SQPV select( Second length, const Function<std::pair<Second, Pitch>, std::pair<Second, Pitch>> & selector ) const;
-// };
-
-// }
\ No newline at end of file
+#pragma once
+
+#include "SQPVBuffer.h"
+
+#include "flan/Function.h"
+
+namespace flan {
+
+class Audio;
+
+/** Constant-Q phase vocoder data. Bins are spaced evenly in pitch rather than frequency, so low bins have the frequency
+ *	resolution of a very long linear transform while high bins keep the time resolution of a short one. Each bin holds a
+ *	magnitude and the pitch of the partial detected in it. See Audio::convert_to_SQPV.
+ */
+class SQPV : public SQPVBuffer
+{
+public:
+	SQPV();
+	SQPV( const Format & );
+	SQPV( SQPVBuffer && );
+
+	/** Resynthesize the SQPV through the inverse constant-q transform.
+	 */
+	Audio convert_to_audio( flan_CANCEL_ARG ) const;
+	Audio convert_to_lr_audio( flan_CANCEL_ARG ) const;
+
+	/** Replace the pitch in each bin. Pitch here is log2 of frequency.
+	 *
+	 *	\param mod Maps the time and pitch of each bin to a new pitch.
+	 */
+	SQPV modify_pitch( const Function<TP, UnsignedPitch> & mod ) const;
+
+	/** Scale the frequency in each bin.
+	 *
+	 *	\param mod Maps the time and pitch of each bin to a frequency scale factor.
+	 */
+	SQPV repitch( const Function<TP, float> & mod ) const;
+};
+
+}
@@ -47,12 +47,12 @@ const SQPVBuffer::Format & SQPVBuffer::get_format() const
 
 fFrame SQPVBuffer::time_to_frame( Second t ) const
 	{
-	return t * get_sample_rate();
+	return t * get_analysis_rate();
 	}
 
 Second SQPVBuffer::frame_to_time( fFrame f ) const
 	{
-	return f / get_sample_rate();
+	return f / get_analysis_rate();
 	}
 
 fBin SQPVBuffer::frequency_to_bin( Frequency f ) const
@@ -113,7 +113,12 @@ FrameRate SQPVBuffer::get_sample_rate() const
 
 FrameRate SQPVBuffer::get_analysis_rate() const
 	{
-	return format.sample_rate;
+	return format.sample_rate / format.hop_size;
+	}
+
+Frame SQPVBuffer::get_hop_size() const
+	{
+	return format.hop_size;
 	}
 
 std::pair<Frequency, Frequency> SQPVBuffer::getFrequencyBandwidth() const
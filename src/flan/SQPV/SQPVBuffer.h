@@ -19,6 +19,7 @@ public:
 		fBin bins_per_octave = 0;
 		FrameRate sample_rate = 48000; 
 		std::pair<Frequency, Frequency> bandwidth;
+		Frame hop_size = 1; // Audio samples per frame
 		};
 
 	SQPVBuffer( const SQPVBuffer & ) = delete;
@@ -49,6 +50,7 @@ public:
 	Bin	get_num_bins() const;
 	FrameRate get_sample_rate() const;
 	FrameRate get_analysis_rate() const;
+	Frame get_hop_size() const;
 	std::pair<Frequency, Frequency> getFrequencyBandwidth() const;
 	std::pair<UnsignedPitch, UnsignedPitch> getPitchBandwidth() const;
 	fBin getBinsPerOctave() const;
@@ -0,0 +1,124 @@
+#include "flan/SlidingDFT.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace flan;
+
+// Twiddles drift by about one rounding error per advance, so they are reset at least this often
+static const Frame maxResyncPeriod = 64;
+
+SlidingDFT::SlidingDFT( Bin _num_bins, Frame _decimation )
+	: num_bins( std::max( _num_bins, Bin( 2 ) ) )
+	, decimation( std::max( _decimation, Frame( 1 ) ) )
+	, window_size( 2 * num_bins )
+	, resync_period( 1 )
+	, table( window_size )
+	, step_re( num_bins ), step_im( num_bins )
+	, twiddle_re( num_bins ), twiddle_im( num_bins )
+	, sum_re( num_bins ), sum_im( num_bins )
+	, history( window_size )
+	, frame( num_bins )
+	, windowed( num_bins )
+	{
+	for( Frame p = maxResyncPeriod; p > 1; --p )
+		if( window_size % p == 0 )
+			{
+			resync_period = p;
+			break;
+			}
+
+	const double omega = -2.0 * std::acos( -1.0 ) / window_size;
+	for( Frame i = 0; i < window_size; ++i )
+		table[i] = std::complex<float>( std::polar( 1.0, omega * i ) );
+
+	for( Bin b = 0; b < num_bins; ++b )
+		{
+		step_re[b] = table[b].real();
+		step_im[b] = table[b].imag();
+		}
+
+	reset();
+	}
+
+Bin SlidingDFT::get_num_bins() const
+	{
+	return num_bins;
+	}
+
+Frame SlidingDFT::get_decimation() const
+	{
+	return decimation;
+	}
+
+Frame SlidingDFT::get_window_size() const
+	{
+	return window_size;
+	}
+
+void SlidingDFT::reset()
+	{
+	std::fill( sum_re.begin(), sum_re.end(), 0.0f );
+	std::fill( sum_im.begin(), sum_im.end(), 0.0f );
+	std::fill( history.begin(), history.end(), 0.0f );
+	history_pos = 0;
+	time = 0;
+	until_frame = 0;
+	}
+
+void SlidingDFT::resync_twiddles()
+	{
+	for( Bin b = 0; b < num_bins; ++b )
+		{
+		const std::complex<float> & twiddle = table[uint64_t( time ) * b % window_size];
+		twiddle_re[b] = twiddle.real();
+		twiddle_im[b] = twiddle.imag();
+		}
+	}
+
+bool SlidingDFT::push( Sample x )
+	{
+	if( time % resync_period == 0 ) resync_twiddles();
+
+	// The sample entering the window minus the one leaving it
+	const float delta = x - history[history_pos];
+	history[history_pos] = x;
+	if( ++history_pos == window_size ) history_pos = 0;
+
+	float * s_re = sum_re.data();
+	float * s_im = sum_im.data();
+	float * t_re = twiddle_re.data();
+	float * t_im = twiddle_im.data();
+	const float * w_re = step_re.data();
+	const float * w_im = step_im.data();
+	for( Bin b = 0; b < num_bins; ++b )
+		{
+		s_re[b] += delta * t_re[b];
+		s_im[b] += delta * t_im[b];
+		const float re = t_re[b] * w_re[b] - t_im[b] * w_im[b];
+		const float im = t_re[b] * w_im[b] + t_im[b] * w_re[b];
+		t_re[b] = re;
+		t_im[b] = im;
+		}
+	if( ++time == window_size ) time = 0;
+
+	if( until_frame != 0 )
+		{
+		--until_frame;
+		return false;
+		}
+	until_frame = decimation - 1;
+
+	// Undo the twiddle of the next sample time, which leaves the dft of the window with time zero at the window start
+	for( Bin b = 0; b < num_bins; ++b )
+		frame[b] = std::complex<float>( s_re[b] * t_re[b] + s_im[b] * t_im[b], s_im[b] * t_re[b] - s_re[b] * t_im[b] );
+
+	// Hann window by convolving with { -1/4, 1/2, -1/4 }. The edge bins reflect their one neighbour, which is conjugate symmetric.
+	const float norm = float( window_size );
+	windowed[0] = 0.25f * ( frame[0] + frame[0] - frame[1].real() * 2.0f ) / norm;
+	for( Bin b = 1; b < num_bins - 1; ++b )
+		windowed[b] = 0.25f * ( frame[b] + frame[b] - ( frame[b-1] + frame[b+1] ) ) / norm;
+	windowed[num_bins-1] = 0.25f * ( frame[num_bins-1] + frame[num_bins-1] - frame[num_bins-2].real() * 2.0f ) / norm;
+
+	return true;
+	}
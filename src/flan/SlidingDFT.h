@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <cstdint>
+
+#include "flan/defines.h"
+
+namespace flan {
+
+/** A streaming sliding DFT. Every input sample updates every bin, and a hann windowed frame is emitted every decimation samples,
+ *	so spectral data can be produced at any rate up to one frame per sample without changing the transform itself.
+ *
+ *	Each bin keeps a running sum of incoming minus outgoing samples, rotated by that bin's twiddle for the sample time. Twiddles
+ *	are advanced by one complex multiply per sample rather than looked up by index, and are reset from an exact table at a period
+ *	dividing the window, so a sample and its removal a window later always see identical twiddles and cancel exactly. Bin state
+ *	is stored as separate real and imaginary arrays, so the per sample update is a handful of multiply-adds across contiguous
+ *	memory which the compiler vectorizes.
+ *
+ *	A SlidingDFT holds the history of one channel. Use one per channel, they can run in parallel.
+ */
+class SlidingDFT
+{
+public:
+	/** \param num_bins The number of bins in each frame. The transform window is 2 * num_bins samples.
+	 *	\param decimation A frame is emitted once every this many samples. Phase vocoding the output needs this to be at most
+	 *		num_bins / 2, a quarter of the window.
+	 */
+	SlidingDFT( Bin num_bins, Frame decimation = 1 );
+
+	Bin get_num_bins() const;
+	Frame get_decimation() const;
+	Frame get_window_size() const;
+
+	/** Clears all history. The next sample processed emits a frame.
+	 */
+	void reset();
+
+	/** Feeds samples through the transform. A frame is emitted after the first sample following a reset, and after every
+	 *	decimation samples from then on.
+	 *	\param samples The input samples.
+	 *	\param num_samples The number of samples to process. Any number is allowed.
+	 *	\param on_frame Called as on_frame( const std::complex<float> * bins ) for each frame emitted. The bins are hann windowed
+	 *		and normalized by the window size, and are only valid during the call.
+	 */
+	template<typename F>
+	void process( const Sample * samples, Frame num_samples, F && on_frame )
+		{
+		for( Frame i = 0; i < num_samples; ++i )
+			if( push( samples[i] ) )
+				on_frame( const_cast<const std::complex<float> *>( windowed.data() ) );
+		}
+
+private:
+	// Updates every bin with one sample, returns true and fills windowed if a frame is due
+	bool push( Sample );
+
+	// Sets every twiddle to its exact value for the current time
+	void resync_twiddles();
+
+	const Bin num_bins;
+	const Frame decimation;
+	const Frame window_size;
+	Frame resync_period; // The largest divisor of window_size not above a fixed maximum
+
+	std::vector<std::complex<float>> table; // Window size roots of unity, clockwise
+	std::vector<float> step_re, step_im; // Each bin's twiddle advance per sample
+	std::vector<float> twiddle_re, twiddle_im; // Each bin's twiddle for the current time
+	std::vector<float> sum_re, sum_im; // Each bin's running sum
+	std::vector<Sample> history; // The last window_size samples, circular
+	std::vector<std::complex<float>> frame; // The current frame before windowing
+	std::vector<std::complex<float>> windowed;
+
+	Frame history_pos = 0;
+	Frame time = 0; // Samples since reset, modulo the window size
+	Frame until_frame = 0; // Samples until the next frame is emitted
+};
+
+}
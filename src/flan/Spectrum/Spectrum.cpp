@@ -1,47 +1,127 @@
-//#include "flan/Spectrum.h"
-
-//#include <fftw3.h>
-//
-//#include "flan/Audio/Audio.h"
-//
-//namespace flan {
-//
-//Audio Spectrum::convert_to_audio()
-//	{
-//	const size_t outNumSamples = ( get_num_bins() - 1 ) * 2;
-//
-//	Audio::Format format;
-//	format.num_channels = get_num_channels();
-//	format.num_frames = outNumSamples;
-//	format.sample_rate = get_sample_rate();
-//	Audio out( format );
-//
-//	//Allocate fftw buffers and plan
-//	std::complex<double> * fftIn = ( std::complex<double> * ) fftw_alloc_complex( get_num_bins() );
-//	double *fftOut = fftw_alloc_real( outNumSamples );
-//	fftw_plan plan = fftw_plan_dft_c2r_1d( int( outNumSamples ), (fftw_complex*) fftIn, fftOut, FFTW_ESTIMATE );
-//
-//	for( size_t channel = 0; channel < get_num_channels(); ++channel )
-//		{
-//		//Read buffer data into fftIn
-//		for( size_t bin = 0; bin < get_num_bins(); ++bin )
-//			fftIn[bin] = getSpectra( channel, bin );
-//
-//		//ifft
-//		fftw_execute( plan );
-//
-//		//Read fftOut into out audio
-//		for( size_t sample = 0; sample < outNumSamples; ++sample )
-//			out.set_sample( channel, sample, fftOut[sample] );
-//		}
-//
-//	fftw_destroy_plan( plan );
-//	fftw_free( fftOut );
-//	fftw_free( fftIn );
-//
-//	return out;
-//	}
-
-
-
-//}
+#include "Spectrum.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "flan/FilterCore.h"
+#include "flan/Utility/Trace.h"
+
+using namespace flan;
+
+Spectrum::Spectrum()
+	: SpectrumBuffer()
+	{}
+
+Spectrum::Spectrum( SpectrumBuffer && other )
+	: SpectrumBuffer( std::move( other ) )
+	{}
+
+Spectrum::Spectrum( Format format )
+	: SpectrumBuffer( format )
+	{}
+
+Spectrum Spectrum::create_from_function(
+	const Function<Frequency, Magnitude> & magnitude,
+	const Function<Frequency, Radian> & phase,
+	Bin num_bins,
+	FrameRate sample_rate
+	)
+	{
+	if( num_bins < 2 || sample_rate <= 0 ) return Spectrum();
+
+	Format format;
+	format.num_channels = 1;
+	format.num_bins = num_bins;
+	format.sample_rate = sample_rate;
+	Spectrum out( format );
+
+	for( Bin bin = 0; bin < num_bins; ++bin )
+		{
+		const Frequency f = out.bin_to_frequency( bin );
+		out.get_bin( 0, bin ) = std::polar( magnitude( f ), phase( f ) );
+		}
+
+	return out;
+	}
+
+// Evaluates the butterworth response at frequency f, digitized by the bilinear transform with the cutoff prewarped. The
+// highpass is the lowpass with s replaced by 1/s.
+static Spectrum create_butterworth( Frequency cutoff, uint16_t order, Bin num_bins, FrameRate sample_rate, bool highpass )
+	{
+	if( num_bins < 2 || sample_rate <= 0 ) return Spectrum();
+
+	Spectrum::Format format;
+	format.num_channels = 1;
+	format.num_bins = num_bins;
+	format.sample_rate = sample_rate;
+	Spectrum out( format );
+
+	const std::vector<Pole> poles = generate_butterworth_type1_poles( order );
+	const bool even_order = order % 2 == 0;
+	const double cutoff_warped = std::tan( pi * std::clamp( cutoff, 1.0f, sample_rate / 2.0f ) / sample_rate );
+
+	for( Bin bin = 0; bin < num_bins; ++bin )
+		{
+		// Nyquist maps to infinity and 0 maps to 0, where the lowpass response is 0 and 1 respectively
+		const bool at_nyquist = bin == num_bins - 1;
+		const bool at_zero = bin == 0;
+		if( at_nyquist || at_zero )
+			{
+			out.get_bin( 0, bin ) = ( at_zero != highpass || order == 0 ) ? 1.0f : 0.0f;
+			continue;
+			}
+
+		const double w = std::tan( pi * out.bin_to_frequency( bin ) / sample_rate ) / cutoff_warped;
+		const std::complex<double> s = highpass ? std::complex<double>( 0, -1.0 / w ) : std::complex<double>( 0, w );
+
+		std::complex<double> H = 1;
+		for( const Pole & p : poles )
+			H /= ( s - std::complex<double>( p ) ) * ( s - std::complex<double>( std::conj( p ) ) );
+		if( !even_order )
+			H /= s + 1.0;
+
+		out.get_bin( 0, bin ) = std::complex<float>( H );
+		}
+
+	return out;
+	}
+
+Spectrum Spectrum::create_butterworth_lowpass( Frequency cutoff, uint16_t order, Bin num_bins, FrameRate sample_rate )
+	{
+	flan_TRACE_SPAN( "Spectrum::create_butterworth_lowpass" );
+	return create_butterworth( cutoff, order, num_bins, sample_rate, false );
+	}
+
+Spectrum Spectrum::create_butterworth_highpass( Frequency cutoff, uint16_t order, Bin num_bins, FrameRate sample_rate )
+	{
+	flan_TRACE_SPAN( "Spectrum::create_butterworth_highpass" );
+	return create_butterworth( cutoff, order, num_bins, sample_rate, true );
+	}
+
+std::complex<float> Spectrum::sample( Channel channel, Frequency f ) const
+	{
+	const fBin bin = std::clamp( frequency_to_bin( f ), 0.0f, fBin( get_num_bins() - 1 ) );
+	const Bin low = std::min( Bin( bin ), get_num_bins() - 2 );
+	const float t = bin - low;
+	return get_bin( channel, low ) * ( 1.0f - t ) + get_bin( channel, low + 1 ) * t;
+	}
+
+Magnitude Spectrum::sample_magnitude( Channel channel, Frequency f ) const
+	{
+	const fBin bin = std::clamp( frequency_to_bin( f ), 0.0f, fBin( get_num_bins() - 1 ) );
+	const Bin low = std::min( Bin( bin ), get_num_bins() - 2 );
+	const float t = bin - low;
+	return std::abs( get_bin( channel, low ) ) * ( 1.0f - t ) + std::abs( get_bin( channel, low + 1 ) ) * t;
+	}
+
+Spectrum Spectrum::multiply( const Spectrum & other ) const
+	{
+	flan_TRACE_SPAN( "Spectrum::multiply" );
+	if( is_null() || other.is_null() ) return Spectrum();
+
+	Spectrum out = SpectrumBuffer::copy();
+	for( Channel channel = 0; channel < get_num_channels(); ++channel )
+		for( Bin bin = 0; bin < get_num_bins(); ++bin )
+			out.get_bin( channel, bin ) *= other.sample( channel % other.get_num_channels(), bin_to_frequency( bin ) );
+	return out;
+	}
@@ -1,21 +1,80 @@
-//#pragma once
-//
-//#include "SpectrumBuffer.h"
-//
-//namespace flan {
-//
-//class Audio;
-//
-//class Spectrum : public SpectrumBuffer
-//{
-//public:
-//	Spectrum( const Format f ) : SpectrumBuffer( f ) {}
-//
-//	Audio convert_to_audio();
-//
-//	//static Spectrum 
-//
-//	//Spectrum multiply( const Spectrum & filter );
-//};
-//
-//}
\ No newline at end of file
+#pragma once
+
+#include <cstdint>
+
+#include "SpectrumBuffer.h"
+
+#include "flan/Function.h"
+
+namespace flan {
+
+class Audio;
+
+/** A static spectrum. This is either the transform of an entire Audio, or a frequency response to filter Audio with, see
+ *	Audio::filter_spectrum.
+ */
+class Spectrum : public SpectrumBuffer
+{
+public:
+	Spectrum();
+	Spectrum( SpectrumBuffer && );
+	Spectrum( Format );
+
+	/** Builds a single channel Spectrum from a magnitude and phase response.
+	 *	\param magnitude The magnitude at each frequency.
+	 *	\param phase The phase at each frequency.
+	 *	\param num_bins The number of bins from 0 to the Nyquist frequency inclusive.
+	 *	\param sample_rate The sample rate the spectrum describes.
+	 */
+	static Spectrum create_from_function(
+		const Function<Frequency, Magnitude> & magnitude,
+		const Function<Frequency, Radian> & phase = 0,
+		Bin num_bins = 4097,
+		FrameRate sample_rate = 48000
+		);
+
+	/** The frequency response of Audio::filter_1pole_lowpass and the 2-pole cascades of the same order, that is, a bilinear
+	 *	transformed Butterworth lowpass with its cutoff prewarped. Applied with Audio::filter_spectrum this gives the Butterworth
+	 *	magnitude response with linear phase, or a close match of the recursive filter with minimum phase.
+	 *	\param cutoff The -3dB frequency.
+	 *	\param order The filter order.
+	 *	\param num_bins The number of bins from 0 to the Nyquist frequency inclusive.
+	 *	\param sample_rate The sample rate the filter is designed for.
+	 */
+	static Spectrum create_butterworth_lowpass(
+		Frequency cutoff,
+		uint16_t order = 4,
+		Bin num_bins = 4097,
+		FrameRate sample_rate = 48000
+		);
+
+	/** See Spectrum::create_butterworth_lowpass.
+	 */
+	static Spectrum create_butterworth_highpass(
+		Frequency cutoff,
+		uint16_t order = 4,
+		Bin num_bins = 4097,
+		FrameRate sample_rate = 48000
+		);
+
+	/** Inverse transforms each channel, giving 2 * ( num_bins - 1 ) frames. A Spectrum made by Audio::convert_to_spectrum
+	 *	gives back its Audio, zero padded to that length.
+	 */
+	Audio convert_to_audio( flan_CANCEL_ARG ) const;
+
+	/** Linearly interpolates the bins around a frequency. Frequencies above Nyquist get the last bin.
+	 */
+	std::complex<float> sample( Channel channel, Frequency ) const;
+
+	/** Linearly interpolates the bin magnitudes around a frequency. Frequencies above Nyquist get the last bin.
+	 */
+	Magnitude sample_magnitude( Channel channel, Frequency ) const;
+
+	/** Multiplies by another Spectrum, sampled at the frequencies of this one's bins. Multiplying frequency responses cascades
+	 *	the filters they describe.
+	 *	\param other The Spectrum to multiply by. Channels are reused cyclically if other has fewer than this.
+	 */
+	Spectrum multiply( const Spectrum & other ) const;
+};
+
+}
@@ -1,83 +1,104 @@
-//#include "flan/SpectrumBuffer.h"
-//
-//#include <algorithm>
-//
-//namespace flan {
-//
-//SpectrumBuffer::SpectrumBuffer()
-//	: format()
-//	, buffer()
-//	{}
-//
-//SpectrumBuffer::SpectrumBuffer( const Format & f )
-//	: format( f )
-//	, buffer( get_num_channels() * get_num_bins() )
-//	{}
-//
-////======================================================
-////	Getters
-////======================================================
-//
-//complex_f SpectrumBuffer::getSpectra( size_t channel, size_t bin ) const
-//	{
-//	return buffer[getPos( channel, bin )];
-//	}
-//SpectrumBuffer::Format SpectrumBuffer::get_format() const
-//	{
-//	return format;
-//	}
-//size_t SpectrumBuffer::get_num_channels() const
-//	{
-//	return format.num_channels;
-//	}
-//size_t SpectrumBuffer::get_num_bins() const
-//	{
-//	return format.num_bins;
-//	}
-//size_t SpectrumBuffer::get_sample_rate() const
-//	{
-//	return format.sample_rate;
-//	}
-//float SpectrumBuffer::bin_to_frequency() const
-//	{
-//	return 1.0f / frequency_to_bin();
-//	}
-//float SpectrumBuffer::frequency_to_bin() const
-//	{
-//	return float( get_num_bins() ) / float( format.sample_rate );
-//	}
-//float SpectrumBuffer::getMaxSpectraMagnitude() const
-//	{
-//	return std::abs(*std::max_element( buffer.begin(), buffer.end(), []( complex_f a, complex_f b )
-//		{
-//		return std::abs( a ) < std::abs( b );
-//		}));
-//	}
-//
-////======================================================
-////	Setters
-////======================================================
-//
-//void SpectrumBuffer::setSpectra( size_t channel, size_t bin, complex_f newValue )
-//	{
-//	buffer[getPos( channel, bin )] = newValue;
-//	}
-//complex_f & SpectrumBuffer::getSpectra( size_t channel, size_t bin )
-//	{
-//	return buffer[getPos( channel, bin )];
-//	}
-//void SpectrumBuffer::clear_buffer()
-//	{
-//	std::fill( buffer.begin(), buffer.end(), 0 );
-//	}
-//
-////======================================================
-////	Private
-////======================================================
-//
-//size_t SpectrumBuffer::getPos( size_t channel, size_t bin ) const
-//	{
-//	return channel * get_num_bins() + bin;
-//	}
-//
-//}
+#include "SpectrumBuffer.h"
+
+#include <algorithm>
+
+#include "flan/Utility/execution.h"
+#include "flan/Utility/Trace.h"
+
+using namespace flan;
+
+SpectrumBuffer::SpectrumBuffer()
+	: format()
+	, buffer()
+	{}
+
+SpectrumBuffer::SpectrumBuffer( Format _format )
+	: format( _format )
+	, buffer( size_t( get_num_channels() ) * get_num_bins() )
+	{
+	flan_TRACE_ALLOCATION( buffer.size() * sizeof( buffer[0] ) );
+	}
+
+const SpectrumBuffer::Format & SpectrumBuffer::get_format() const
+	{
+	return format;
+	}
+
+Channel SpectrumBuffer::get_num_channels() const
+	{
+	return format.num_channels;
+	}
+
+Bin SpectrumBuffer::get_num_bins() const
+	{
+	return format.num_bins;
+	}
+
+FrameRate SpectrumBuffer::get_sample_rate() const
+	{
+	return format.sample_rate;
+	}
+
+fBin SpectrumBuffer::frequency_to_bin( Frequency f ) const
+	{
+	return f * 2 * ( get_num_bins() - 1 ) / get_sample_rate();
+	}
+
+Frequency SpectrumBuffer::bin_to_frequency( fBin b ) const
+	{
+	return b * get_sample_rate() / ( 2 * ( get_num_bins() - 1 ) );
+	}
+
+bool SpectrumBuffer::is_null() const
+	{
+	return get_sample_rate() <= 0
+		|| get_num_bins() < 2
+		|| buffer.size() == 0;
+	}
+
+Magnitude SpectrumBuffer::get_max_magnitude() const
+	{
+	Magnitude max_magnitude = 0;
+	for( const std::complex<float> & x : buffer )
+		max_magnitude = std::max( max_magnitude, std::abs( x ) );
+	return max_magnitude;
+	}
+
+std::complex<float> SpectrumBuffer::get_bin( Channel channel, Bin bin ) const
+	{
+	return buffer[ get_buffer_pos( channel, bin ) ];
+	}
+
+std::complex<float> & SpectrumBuffer::get_bin( Channel channel, Bin bin )
+	{
+	return buffer[ get_buffer_pos( channel, bin ) ];
+	}
+
+const std::complex<float> * SpectrumBuffer::get_bin_pointer( Channel channel, Bin bin ) const
+	{
+	return buffer.data() + get_buffer_pos( channel, bin );
+	}
+
+std::complex<float> * SpectrumBuffer::get_bin_pointer( Channel channel, Bin bin )
+	{
+	return buffer.data() + get_buffer_pos( channel, bin );
+	}
+
+void SpectrumBuffer::clear_buffer()
+	{
+	std::fill( FLAN_PAR_UNSEQ buffer.begin(), buffer.end(), std::complex<float>( 0 ) );
+	}
+
+SpectrumBuffer SpectrumBuffer::copy() const
+	{
+	SpectrumBuffer out;
+	out.format = format;
+	out.buffer = buffer; // Deep copy
+	flan_TRACE_ALLOCATION( buffer.size() * sizeof( buffer[0] ) );
+	return out;
+	}
+
+size_t SpectrumBuffer::get_buffer_pos( Channel c, Bin b ) const
+	{
+	return size_t( c ) * get_num_bins() + b;
+	}
@@ -1,55 +1,57 @@
-//#pragma once
-//
-//#include <complex>
-//#include <vector>
-//
-//namespace flan {
-//
-//typedef std::complex<float> complex_f;
-//
-//class SpectrumBuffer
-//{
-//public:
-//	struct Format 
-//		{
-//		size_t num_channels = 0, num_bins = 0;
-//		size_t sample_rate = 48000;
-//		};
-//	
-//	SpectrumBuffer();
-//	SpectrumBuffer( const Format & ); 
-//
-//	//======================================================
-//	//	Getters
-//	//======================================================
-//
-//	complex_f getSpectra( size_t channel, size_t bin ) const;
-//	
-//	Format get_format() const;
-//	size_t get_num_channels() const;
-//	size_t get_num_bins() const;
-//	size_t get_sample_rate() const;
-//
-//	float bin_to_frequency() const;
-//	float frequency_to_bin() const;
-//
-//	float getMaxSpectraMagnitude() const;
-//
-//	//======================================================
-//	//	Setters
-//	//======================================================
-//
-//	void setSpectra( size_t channel, size_t bin, complex_f sample );
-//	complex_f & getSpectra( size_t channel, size_t bin );
-//	void clear_buffer();
-//
-//private://=================================================================================================
-//
-//	size_t getPos( size_t, size_t ) const;
-//
-//	Format format;
-//	std::vector< complex_f > buffer;
-//
-//};
-//
-//}
\ No newline at end of file
+#pragma once
+
+#include <complex>
+#include <vector>
+
+#include "flan/defines.h"
+
+namespace flan {
+
+/** A single spectrum per channel, with bins spread evenly from 0 to the Nyquist frequency inclusive. This is the layout of a
+ *	real fft of 2 * ( num_bins - 1 ) samples.
+ */
+class SpectrumBuffer
+{
+public:
+	struct Format
+		{
+		Channel num_channels = 0;
+		Bin num_bins = 0;
+		FrameRate sample_rate = 48000;
+		};
+
+	SpectrumBuffer( const SpectrumBuffer & ) = delete;
+	SpectrumBuffer( SpectrumBuffer && ) = default;
+	SpectrumBuffer& operator=( const SpectrumBuffer & ) = delete;
+	SpectrumBuffer& operator=( SpectrumBuffer && ) = default;
+	~SpectrumBuffer() = default;
+
+	SpectrumBuffer();
+	SpectrumBuffer( Format );
+
+	const Format & get_format() const;
+	Channel get_num_channels() const;
+	Bin get_num_bins() const;
+	FrameRate get_sample_rate() const;
+	fBin frequency_to_bin( Frequency ) const;
+	Frequency bin_to_frequency( fBin ) const;
+	bool is_null() const;
+
+	Magnitude get_max_magnitude() const;
+
+	std::complex<float> get_bin( Channel channel, Bin bin ) const;
+	std::complex<float> & get_bin( Channel channel, Bin bin );
+	const std::complex<float> * get_bin_pointer( Channel channel, Bin bin ) const;
+	std::complex<float> * get_bin_pointer( Channel channel, Bin bin );
+	void clear_buffer();
+	SpectrumBuffer copy() const;
+
+	size_t get_buffer_pos( Channel, Bin ) const;
+
+private:
+
+	Format format;
+	std::vector<std::complex<float>> buffer;
+};
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace flan {
+
+/** A thread safe, least recently used cache. Values are immutable and handed out as shared pointers, so an entry evicted
+ *	while another thread is still reading it stays alive until that thread is done with it.
+ */
+template<typename Key, typename Value>
+class LRUCache
+{
+public:
+	/** \param capacity The most entries kept before the least recently used is evicted.
+	 */
+	LRUCache( size_t _capacity )
+		: capacity( _capacity )
+		{}
+
+	/** Returns the value cached for key, or creates it with make and caches it. make is called without holding the lock, so
+	 *	threads missing different keys don't wait on each other, and threads missing the same key at once may each call make.
+	 *	\param key The cache key.
+	 *	\param make Callable returning the Value for key.
+	 */
+	template<typename F>
+	std::shared_ptr<const Value> get_or_create( const Key & key, F && make )
+		{
+			{
+			std::lock_guard<std::mutex> lock( mutex );
+			auto found = index.find( key );
+			if( found != index.end() )
+				{
+				entries.splice( entries.begin(), entries, found->second );
+				return found->second->second;
+				}
+			}
+
+		auto value = std::make_shared<const Value>( make() );
+
+		std::lock_guard<std::mutex> lock( mutex );
+		auto found = index.find( key );
+		if( found != index.end() ) return found->second->second;
+		entries.emplace_front( key, value );
+		index[key] = entries.begin();
+		if( entries.size() > capacity )
+			{
+			index.erase( entries.back().first );
+			entries.pop_back();
+			}
+		return value;
+		}
+
+	void clear()
+		{
+		std::lock_guard<std::mutex> lock( mutex );
+		entries.clear();
+		index.clear();
+		}
+
+	size_t size() const
+		{
+		std::lock_guard<std::mutex> lock( mutex );
+		return entries.size();
+		}
+
+private:
+	using Entry = std::pair<Key, std::shared_ptr<const Value>>;
+
+	mutable std::mutex mutex;
+	std::list<Entry> entries; // Most recently used first
+	std::map<Key, typename std::list<Entry>::iterator> index;
+	const size_t capacity;
+};
+
+}
@@ -32,4 +32,10 @@ struct MP
 	Pitch p;
 	};
 
+struct TP
+	{
+	Second t;
+	UnsignedPitch p;
+	};
+
 }
\ No newline at end of file
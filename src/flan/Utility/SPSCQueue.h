@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <bit>
+
+namespace flan {
+
+/** A bounded, lock-free, single producer single consumer queue. One thread may push and one other thread may pop, without
+ *	either ever blocking the other. Neither call allocates.
+ */
+template<typename T>
+class SPSCQueue
+{
+public:
+	/** \param capacity The most values held at once. This is rounded up to a power of two.
+	 */
+	SPSCQueue( size_t capacity )
+		: slots( std::bit_ceil( std::max( capacity, size_t( 1 ) ) ) )
+		, mask( slots.size() - 1 )
+		{}
+
+	/** Pushes value if there is room. Only call this from the producer thread.
+	 *	\return False if the queue was full.
+	 */
+	bool try_push( const T & value )
+		{
+		const size_t t = tail.load( std::memory_order_relaxed );
+		if( t - head.load( std::memory_order_acquire ) == slots.size() ) return false;
+		slots[t & mask] = value;
+		tail.store( t + 1, std::memory_order_release );
+		return true;
+		}
+
+	/** Pops into value if the queue isn't empty. Only call this from the consumer thread.
+	 *	\return False if the queue was empty.
+	 */
+	bool try_pop( T & value )
+		{
+		const size_t h = head.load( std::memory_order_relaxed );
+		if( h == tail.load( std::memory_order_acquire ) ) return false;
+		value = slots[h & mask];
+		head.store( h + 1, std::memory_order_release );
+		return true;
+		}
+
+	size_t capacity() const { return slots.size(); }
+
+private:
+	std::vector<T> slots;
+	const size_t mask;
+
+	// Producer and consumer indices live on separate cache lines so the two threads don't contend for one
+	alignas( 64 ) std::atomic<size_t> head = 0;
+	alignas( 64 ) std::atomic<size_t> tail = 0;
+};
+
+}
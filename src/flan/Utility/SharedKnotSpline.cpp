@@ -0,0 +1,73 @@
+#include "flan/Utility/SharedKnotSpline.h"
+
+#include <cassert>
+
+using namespace flan;
+
+SharedKnotSpline::SharedKnotSpline( std::vector<double> _knots )
+	: knots( std::move( _knots ) )
+	{
+	const size_t n = knots.size();
+	assert( n >= 2 );
+
+	// Row i constrains the quadratic coefficients b around knot i. The end rows fix b to zero, for zero curvature.
+	std::vector<double> diagonal( n, 2.0 );
+	lower.assign( n, 0.0 );
+	upper.assign( n, 0.0 );
+	for( size_t i = 1; i + 1 < n; ++i )
+		{
+		lower[i] = ( knots[i] - knots[i-1] ) / 3.0;
+		diagonal[i] = 2.0 * ( knots[i+1] - knots[i-1] ) / 3.0;
+		upper[i] = ( knots[i+1] - knots[i] ) / 3.0;
+		}
+
+	// Forward elimination. The system is diagonally dominant, so no pivoting is needed.
+	inv_pivot.resize( n );
+	inv_pivot[0] = 1.0 / diagonal[0];
+	upper[0] *= inv_pivot[0];
+	for( size_t i = 1; i < n; ++i )
+		{
+		inv_pivot[i] = 1.0 / ( diagonal[i] - lower[i] * upper[i-1] );
+		upper[i] *= inv_pivot[i];
+		}
+	}
+
+size_t SharedKnotSpline::get_num_knots() const
+	{
+	return knots.size();
+	}
+
+void SharedKnotSpline::fit( const double * ys, double * bs, size_t width ) const
+	{
+	const size_t n = knots.size();
+
+	// Forward sweep, bs holds the eliminated right hand sides
+	for( size_t s = 0; s < width; ++s )
+		bs[s] = 0;
+	for( size_t i = 1; i + 1 < n; ++i )
+		{
+		const double inv_dx_l = 1.0 / ( knots[i] - knots[i-1] );
+		const double inv_dx_r = 1.0 / ( knots[i+1] - knots[i] );
+		const double * y_l = ys + ( i - 1 ) * width;
+		const double * y_c = y_l + width;
+		const double * y_r = y_c + width;
+		const double * b_prev = bs + ( i - 1 ) * width;
+		double * b = bs + i * width;
+		for( size_t s = 0; s < width; ++s )
+			{
+			const double rhs = ( y_r[s] - y_c[s] ) * inv_dx_r - ( y_c[s] - y_l[s] ) * inv_dx_l;
+			b[s] = ( rhs - lower[i] * b_prev[s] ) * inv_pivot[i];
+			}
+		}
+	for( size_t s = 0; s < width; ++s )
+		bs[( n - 1 ) * width + s] = 0;
+
+	// Back substitution
+	for( size_t i = n - 1; i-- > 0; )
+		{
+		double * b = bs + i * width;
+		const double * b_next = b + width;
+		for( size_t s = 0; s < width; ++s )
+			b[s] -= upper[i] * b_next[s];
+		}
+	}
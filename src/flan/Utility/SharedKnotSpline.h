@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace flan {
+
+/** Natural cubic splines through many series sampled at the same knots, such as every bin of a PV column.
+ *	The tridiagonal system for a cubic spline depends only on the knots, so it is factored once on construction. Fitting then
+ *	costs one forward and one backward sweep per knot, each running across every series at once, and evaluation finds the
+ *	knot segment once per x for all series. Series are stored knot-major, so both inner loops run over contiguous memory.
+ *
+ *	Results match tk::spline with its default natural boundary conditions, up to rounding.
+ */
+class SharedKnotSpline
+{
+public:
+	/** Tracks the knot segment of the last evaluation, so increasing x costs no search.
+	 */
+	class Cursor
+		{
+		friend class SharedKnotSpline;
+		size_t segment = 0;
+		};
+
+	/** \param knots Strictly increasing x coordinates shared by every series. At least two are required.
+	 */
+	SharedKnotSpline( std::vector<double> knots );
+
+	size_t get_num_knots() const;
+
+	/** Fits width series at once.
+	 *	\param ys Knot values. Knot k of series s is ys[k * width + s].
+	 *	\param bs Receives the quadratic coefficient of each series at each knot, in the same layout as ys.
+	 *	\param width The number of series.
+	 */
+	void fit( const double * ys, double * bs, size_t width ) const;
+
+	/** Evaluates width series fit by SharedKnotSpline::fit at x.
+	 *	\param x A point between the first and last knots. Calls sharing a cursor must not decrease x.
+	 *	\param cursor The cursor for this sweep.
+	 *	\param ys As passed to SharedKnotSpline::fit.
+	 *	\param bs As output by SharedKnotSpline::fit.
+	 *	\param width The number of series.
+	 *	\param out Called as out( series, value ) for each series.
+	 */
+	template<typename Out>
+	void evaluate( double x, Cursor & cursor, const double * ys, const double * bs, size_t width, Out && out ) const
+		{
+		const size_t num_segments = knots.size() - 1;
+		size_t & k = cursor.segment;
+		while( k + 1 < num_segments && knots[k + 1] < x ) ++k;
+
+		const double h = x - knots[k];
+		const double dx = knots[k + 1] - knots[k];
+		const double inv_dx = 1.0 / dx;
+		const double * y0 = ys + k * width;
+		const double * y1 = y0 + width;
+		const double * b0 = bs + k * width;
+		const double * b1 = b0 + width;
+		for( size_t s = 0; s < width; ++s )
+			{
+			const double a = ( b1[s] - b0[s] ) * inv_dx / 3.0;
+			const double c = ( y1[s] - y0[s] ) * inv_dx - ( 2.0 * b0[s] + b1[s] ) * dx / 3.0;
+			out( s, ( ( a * h + b0[s] ) * h + c ) * h + y0[s] );
+			}
+		}
+
+private:
+	std::vector<double> knots;
+
+	// Thomas algorithm factors of the knot system
+	std::vector<double> lower; // Subdiagonal of each row
+	std::vector<double> upper; // Eliminated superdiagonal of each row
+	std::vector<double> inv_pivot; // Reciprocal of each row's pivot after elimination
+};
+
+}
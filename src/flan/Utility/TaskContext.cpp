@@ -0,0 +1,168 @@
+#include "flan/Utility/TaskContext.h"
+
+#include <algorithm>
+
+namespace flan {
+
+//============================================================================================================================================================
+// TaskContext
+//============================================================================================================================================================
+
+TaskContext::TaskContext()
+	: cancel_token( nullptr )
+	, deadline()
+	, has_deadline( false )
+	, progress_callback()
+	, memory_budget( 0 )
+	, accuracy( Accuracy::High )
+	, stop_reason( StopReason::None )
+	, memory_reserved( 0 )
+	{
+	}
+
+TaskContext::TaskContext( std::atomic<bool> & _cancel_token )
+	: TaskContext()
+	{
+	cancel_token = &_cancel_token;
+	}
+
+const TaskContext & TaskContext::none()
+	{
+	static const TaskContext context;
+	return context;
+	}
+
+TaskContext & TaskContext::set_cancel_token( std::atomic<bool> & _cancel_token )
+	{
+	cancel_token = &_cancel_token;
+	return *this;
+	}
+
+TaskContext & TaskContext::set_deadline( Clock::time_point _deadline )
+	{
+	deadline = _deadline;
+	has_deadline = true;
+	return *this;
+	}
+
+TaskContext & TaskContext::set_progress_callback( ProgressCallback callback )
+	{
+	progress_callback = std::move( callback );
+	return *this;
+	}
+
+TaskContext & TaskContext::set_memory_budget( uint64_t bytes )
+	{
+	memory_budget = bytes;
+	return *this;
+	}
+
+TaskContext & TaskContext::set_accuracy( Accuracy _accuracy )
+	{
+	accuracy = _accuracy;
+	return *this;
+	}
+
+TaskContext::Accuracy TaskContext::get_accuracy() const
+	{
+	return accuracy;
+	}
+
+bool TaskContext::is_cancelled() const
+	{
+	if( stop_reason.load( std::memory_order_relaxed ) != StopReason::None ) return true;
+
+	if( cancel_token && cancel_token->load( std::memory_order_relaxed ) )
+		{
+		stop( StopReason::Cancelled );
+		return true;
+		}
+
+	if( has_deadline && Clock::now() >= deadline )
+		{
+		stop( StopReason::Deadline );
+		return true;
+		}
+
+	return false;
+	}
+
+TaskContext::StopReason TaskContext::get_stop_reason() const
+	{
+	return stop_reason.load();
+	}
+
+bool TaskContext::reserve_memory( uint64_t bytes ) const
+	{
+	if( memory_budget == 0 ) return true;
+
+	uint64_t reserved = memory_reserved.load( std::memory_order_relaxed );
+	do
+		{
+		if( reserved + bytes > memory_budget )
+			{
+			stop( StopReason::MemoryBudget );
+			return false;
+			}
+		} while( !memory_reserved.compare_exchange_weak( reserved, reserved + bytes, std::memory_order_relaxed ) );
+
+	return true;
+	}
+
+uint64_t TaskContext::get_memory_reserved() const
+	{
+	return memory_reserved.load();
+	}
+
+bool TaskContext::has_progress_callback() const
+	{
+	return bool( progress_callback );
+	}
+
+void TaskContext::report_progress( float fraction, const char * stage ) const
+	{
+	if( !progress_callback ) return;
+	std::lock_guard<std::mutex> lock( progress_mutex );
+	progress_callback( fraction, stage );
+	}
+
+void TaskContext::stop( StopReason reason ) const
+	{
+	// Keep the first reason
+	StopReason expected = StopReason::None;
+	stop_reason.compare_exchange_strong( expected, reason );
+	}
+
+//============================================================================================================================================================
+// TaskProgress
+//============================================================================================================================================================
+
+TaskProgress::TaskProgress( const TaskContext & _context, const char * _stage, uint64_t _num_steps )
+	: context( _context )
+	, stage( _stage )
+	, num_steps( _num_steps )
+	, active( _context.has_progress_callback() && _num_steps > 0 )
+	, steps_done( 0 )
+	, last_percent( -1 )
+	{
+	if( active ) advance( 0 );
+	}
+
+void TaskProgress::advance( uint64_t steps ) const
+	{
+	if( !active ) return;
+
+	const uint64_t done = steps_done.fetch_add( steps, std::memory_order_relaxed ) + steps;
+	const int percent = int( std::min( done, num_steps ) * 100 / num_steps );
+
+	// Only the thread which moves last_percent forward reports
+	int last = last_percent.load( std::memory_order_relaxed );
+	while( percent > last )
+		if( last_percent.compare_exchange_weak( last, percent, std::memory_order_relaxed ) )
+			{
+			context.report_progress( percent / 100.0f, stage );
+			return;
+			}
+	}
+
+}
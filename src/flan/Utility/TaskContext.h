@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+
+namespace flan {
+
+/** A TaskContext lets another thread control a running algorithm. It carries a cancel token, a deadline, a progress callback,
+ *	a memory budget, and an accuracy setting. Algorithms which accept a context check it at cancellation points throughout their
+ *	long-running loops, including inside parallel regions, and return a null output as soon as any of the following holds:
+ *	- The cancel token was set.
+ *	- The deadline passed.
+ *	- Reserving an output buffer would put the task over its memory budget.
+ *	Once a context has stopped it stays stopped, so the same context can be passed to each stage of a render and the remaining
+ *	stages return immediately. get_stop_reason tells a scheduler why the task ended, so it can be re-queued or re-prioritised.
+ *
+ *	The accuracy setting lets algorithms with approximated inner loops, like the phase vocoder kernels, trade precision for
+ *	speed. It doesn't stop anything.
+ *
+ *	The progress callback receives the fraction of the current stage completed and the stage name, which is the name of the
+ *	algorithm reporting it. It is called from whichever thread made progress, but never from two threads at once.
+ *
+ *		std::atomic<bool> cancel = false;
+ *		TaskContext context;
+ *		context.set_cancel_token( cancel )
+ *			.set_deadline( TaskContext::Clock::now() + std::chrono::seconds( 30 ) )
+ *			.set_memory_budget( 2'000'000'000 )
+ *			.set_progress_callback( []( float fraction, const char * stage ){ std::cout << stage << " " << fraction << "\n"; } );
+ *		Audio out = in.convert_to_PV( 2048, 128, 4096, context ).stretch( 2, Interpolator::linear(), context ).convert_to_audio( context );
+ */
+class TaskContext
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using ProgressCallback = std::function<void ( float fraction, const char * stage )>;
+
+	enum class StopReason
+		{
+		None, 			/** The task is still running, or finished normally. */
+		Cancelled, 		/** The cancel token was set. */
+		Deadline, 		/** The deadline passed. */
+		MemoryBudget, 	/** An algorithm needed more memory than the budget allowed. */
+		};
+
+	enum class Accuracy
+		{
+		Exact, 			/** Use the standard library math functions. */
+		High, 			/** Use approximations with errors near float precision. */
+		Fast, 			/** Use approximations with errors around 1e-4, well below what is audible in most processes. */
+		};
+
+	/** Constructs a context with no cancel token, deadline, progress callback, or memory budget, and High accuracy.
+	 */
+	TaskContext();
+
+	/** Constructs a context using cancel_token as its cancel token. This exists so code passing a bare flag as the cancellation
+	 *	argument keeps working.
+	 */
+	TaskContext( std::atomic<bool> & cancel_token );
+
+	TaskContext( const TaskContext & ) = delete;
+	TaskContext & operator=( const TaskContext & ) = delete;
+	~TaskContext() = default;
+
+	/** The default context argument. It never stops and reports nothing. */
+	static const TaskContext & none();
+
+	TaskContext & set_cancel_token( std::atomic<bool> & cancel_token );
+	TaskContext & set_deadline( Clock::time_point deadline );
+	TaskContext & set_progress_callback( ProgressCallback callback );
+
+	/** \param bytes The total size of the sample data that algorithms using this context may allocate. Zero disables the budget.
+	 */
+	TaskContext & set_memory_budget( uint64_t bytes );
+
+	TaskContext & set_accuracy( Accuracy );
+	Accuracy get_accuracy() const;
+
+	/** Returns true if the task should stop. This is cheap enough to call once per frame inside parallel loops.
+	 */
+	bool is_cancelled() const;
+
+	StopReason get_stop_reason() const;
+
+	/** Counts bytes against the memory budget. If the budget would be exceeded nothing is counted, the context stops, and false
+	 *	is returned.
+	 */
+	bool reserve_memory( uint64_t bytes ) const;
+
+	uint64_t get_memory_reserved() const;
+
+	bool has_progress_callback() const;
+
+	/** Calls the progress callback, if there is one.
+	 */
+	void report_progress( float fraction, const char * stage ) const;
+
+private:
+	void stop( StopReason ) const;
+
+	std::atomic<bool> * cancel_token;
+	Clock::time_point deadline;
+	bool has_deadline;
+	ProgressCallback progress_callback;
+	uint64_t memory_budget;
+	Accuracy accuracy;
+
+	mutable std::atomic<StopReason> stop_reason;
+	mutable std::atomic<uint64_t> memory_reserved;
+	mutable std::mutex progress_mutex;
+};
+
+/** Progress through one stage of an algorithm, made of a known number of steps. advance can be called from parallel regions.
+ *	The callback is only called when the whole percentage changes, and advance does nothing if the context has no callback.
+ */
+class TaskProgress
+{
+public:
+	TaskProgress( const TaskContext & context, const char * stage, uint64_t num_steps );
+
+	void advance( uint64_t steps = 1 ) const;
+
+private:
+	const TaskContext & context;
+	const char * const stage;
+	const uint64_t num_steps;
+	const bool active;
+	mutable std::atomic<uint64_t> steps_done;
+	mutable std::atomic<int> last_percent;
+};
+
+}
@@ -0,0 +1,243 @@
+#include "flan/Utility/Trace.h"
+
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <ctime>
+#endif
+
+namespace flan::trace {
+
+static std::atomic<bool> recording = false;
+static std::atomic<uint64_t> bytes_allocated = 0;
+static std::atomic<uint64_t> fft_plans_created = 0;
+
+static std::mutex records_mutex;
+static std::vector<SpanRecord> records;
+static std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+// Innermost open span on this thread, used to merge overloads forwarding to themselves
+static thread_local const char * current_span_name = nullptr;
+
+static double wall_us()
+	{
+	return std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - epoch ).count();
+	}
+
+// Cpu time used by every thread in the process
+static double cpu_us()
+	{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if( !GetProcessTimes( GetCurrentProcess(), &creation, &exit, &kernel, &user ) ) return 0;
+	auto to_us = []( FILETIME t ){ return ( ( uint64_t( t.dwHighDateTime ) << 32 ) | t.dwLowDateTime ) / 10.0; }; // 100ns units
+	return to_us( kernel ) + to_us( user );
+#else
+	timespec t;
+	if( clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &t ) != 0 ) return 0;
+	return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+#endif
+	}
+
+//============================================================================================================================================================
+// Span
+//============================================================================================================================================================
+
+Span::Span( const char * _name )
+	: Span( _name, Dimensions() )
+	{
+	}
+
+Span::Span( const char * _name, Dimensions _dimensions )
+	: name( _name )
+	, parent_name( current_span_name )
+	, active( recording.load( std::memory_order_relaxed ) && ( current_span_name == nullptr || std::strcmp( current_span_name, _name ) != 0 ) )
+	, dimensions( _dimensions )
+	{
+	if( !active ) return;
+	current_span_name = name;
+	start_bytes = bytes_allocated.load( std::memory_order_relaxed );
+	start_plans = fft_plans_created.load( std::memory_order_relaxed );
+	start_cpu_us = cpu_us();
+	start_wall_us = wall_us();
+	}
+
+Span::~Span()
+	{
+	if( !active ) return;
+
+	SpanRecord record;
+	record.name = name;
+	record.dimensions = dimensions;
+	record.thread = std::hash<std::thread::id>()( std::this_thread::get_id() );
+	record.start_us = start_wall_us;
+	record.wall_us = wall_us() - start_wall_us;
+	record.cpu_us = cpu_us() - start_cpu_us;
+	record.bytes_allocated = bytes_allocated.load( std::memory_order_relaxed ) - start_bytes;
+	record.fft_plans_created = fft_plans_created.load( std::memory_order_relaxed ) - start_plans;
+	record.threads_available = std::thread::hardware_concurrency();
+
+	current_span_name = parent_name;
+
+	std::lock_guard<std::mutex> lock( records_mutex );
+	records.push_back( record );
+	}
+
+//============================================================================================================================================================
+// Control
+//============================================================================================================================================================
+
+void start()
+	{
+	std::lock_guard<std::mutex> lock( records_mutex );
+	if( records.empty() ) epoch = std::chrono::steady_clock::now();
+	recording = true;
+	}
+
+void stop()
+	{
+	recording = false;
+	}
+
+bool is_recording()
+	{
+	return recording;
+	}
+
+void clear()
+	{
+	std::lock_guard<std::mutex> lock( records_mutex );
+	records.clear();
+	}
+
+void record_allocation( uint64_t bytes )
+	{
+	if( recording.load( std::memory_order_relaxed ) )
+		bytes_allocated.fetch_add( bytes, std::memory_order_relaxed );
+	}
+
+void record_fft_plan()
+	{
+	if( recording.load( std::memory_order_relaxed ) )
+		fft_plans_created.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+//============================================================================================================================================================
+// Output
+//============================================================================================================================================================
+
+std::vector<SpanRecord> get_spans()
+	{
+	std::lock_guard<std::mutex> lock( records_mutex );
+	return records;
+	}
+
+std::vector<SummaryRow> get_summary()
+	{
+	std::map<std::string, SummaryRow> rows;
+	for( const SpanRecord & r : get_spans() )
+		{
+		SummaryRow & row = rows[r.name];
+		row.name = r.name;
+		++row.calls;
+		row.wall_us += r.wall_us;
+		row.cpu_us += r.cpu_us;
+		row.bytes_allocated += r.bytes_allocated;
+		row.fft_plans_created += r.fft_plans_created;
+		row.samples += uint64_t( r.dimensions.channels ) * r.dimensions.frames * std::max( r.dimensions.bins, 1 );
+		}
+
+	std::vector<SummaryRow> out;
+	for( auto & [name, row] : rows ) out.push_back( row );
+	std::sort( out.begin(), out.end(), []( const SummaryRow & a, const SummaryRow & b ){ return a.wall_us > b.wall_us; } );
+	return out;
+	}
+
+bool write_chrome_trace( const std::string & filepath )
+	{
+	std::ofstream file( filepath );
+	if( !file )
+		{
+		std::cout << "Couldn't open " << filepath << " for writing." << std::endl;
+		return false;
+		}
+
+	const auto spans = get_spans();
+
+	// Chrome wants small thread ids
+	std::map<uint64_t, int> thread_ids;
+	for( const SpanRecord & r : spans ) thread_ids.emplace( r.thread, int( thread_ids.size() ) );
+
+	file << std::fixed << std::setprecision( 3 );
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for( size_t i = 0; i < spans.size(); ++i )
+		{
+		const SpanRecord & r = spans[i];
+		file << ( i == 0 ? "\n" : ",\n" )
+			<< "{\"name\":\"" << r.name << "\",\"cat\":\"flan\",\"ph\":\"X\",\"pid\":1"
+			<< ",\"tid\":" << thread_ids[r.thread]
+			<< ",\"ts\":" << r.start_us
+			<< ",\"dur\":" << r.wall_us
+			<< ",\"args\":{"
+				<< "\"channels\":" << r.dimensions.channels
+				<< ",\"frames\":" << r.dimensions.frames
+				<< ",\"bins\":" << r.dimensions.bins
+				<< ",\"bytes_allocated\":" << r.bytes_allocated
+				<< ",\"fft_plans_created\":" << r.fft_plans_created
+				<< ",\"cpu_us\":" << r.cpu_us
+				<< ",\"threads_available\":" << r.threads_available
+			<< "}}";
+		}
+	file << "\n]}\n";
+
+	return bool( file );
+	}
+
+void write_summary( std::ostream & os )
+	{
+	const auto rows = get_summary();
+
+	const auto flags = os.flags();
+	os << std::left << std::setw( 40 ) << "algorithm"
+		<< std::right
+		<< std::setw( 8 ) << "calls"
+		<< std::setw( 14 ) << "wall ms"
+		<< std::setw( 14 ) << "cpu ms"
+		<< std::setw( 10 ) << "cpu/wall"
+		<< std::setw( 14 ) << "MB alloc"
+		<< std::setw( 8 ) << "plans"
+		<< std::setw( 16 ) << "Msamples/s"
+		<< "\n";
+
+	os << std::fixed << std::setprecision( 2 );
+	for( const SummaryRow & row : rows )
+		{
+		os << std::left << std::setw( 40 ) << row.name
+			<< std::right
+			<< std::setw( 8 ) << row.calls
+			<< std::setw( 14 ) << row.wall_us / 1e3
+			<< std::setw( 14 ) << row.cpu_us / 1e3
+			<< std::setw( 10 ) << ( row.wall_us > 0 ? row.cpu_us / row.wall_us : 0 )
+			<< std::setw( 14 ) << row.bytes_allocated / 1e6
+			<< std::setw( 8 ) << row.fft_plans_created
+			<< std::setw( 16 ) << ( row.wall_us > 0 ? row.samples / row.wall_us : 0 )
+			<< "\n";
+		}
+	os.flags( flags );
+	}
+
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iosfwd>
+
+/*
+Algorithm tracing. When flan is built with LOG_FUNCTION_CALLS, public Audio, PV, SPV, and Wavetable algorithms open a span
+for the duration of the call. Each span records input dimensions, bytes of sample data allocated, FFT plans created,
+wall time, process cpu time, and the number of hardware threads available. Nothing is recorded until flan::trace::start
+is called, and with tracing compiled out the macros below expand to nothing.
+
+Bytes and plans are counted globally and attributed to every span open while they occur, so a span includes the
+allocations of the algorithms it calls. When an overload forwards to another overload of the same algorithm (for example
+a const & method forwarding to its && counterpart), only the outermost span is recorded.
+
+	flan::trace::start();
+	Audio out = in.filter_1pole_lowpass( 1000 ).compress( -12 );
+	flan::trace::stop();
+	flan::trace::write_chrome_trace( "patch.json" ); // Open in chrome://tracing or https://ui.perfetto.dev
+	flan::trace::write_summary( std::cout );
+*/
+
+#ifdef flan_LOG_FUNCTIONS
+	#define flan_TRACE_SPAN( name, ... ) ::flan::trace::Span flan_trace_span_( name __VA_OPT__(,) __VA_ARGS__ )
+	#define flan_TRACE_ALLOCATION( bytes ) ::flan::trace::record_allocation( bytes )
+	#define flan_TRACE_FFT_PLAN() ::flan::trace::record_fft_plan()
+#else
+	#define flan_TRACE_SPAN( name, ... )
+	#define flan_TRACE_ALLOCATION( bytes )
+	#define flan_TRACE_FFT_PLAN()
+#endif
+
+namespace flan::trace {
+
+/** Input dimensions of a traced algorithm. Unused dimensions are 0.
+ */
+struct Dimensions
+	{
+	int channels = 0;
+	int frames = 0;
+	int bins = 0;
+	};
+
+/** Fills whichever dimensions the input type exposes.
+ */
+template<typename T>
+Dimensions get_dimensions( const T & x )
+	{
+	Dimensions d;
+	if constexpr( requires { x.get_num_channels(); } ) d.channels = x.get_num_channels();
+	if constexpr( requires { x.get_num_frames(); } ) 	d.frames = x.get_num_frames();
+	if constexpr( requires { x.get_num_bins(); } ) 	d.bins = x.get_num_bins();
+	return d;
+	}
+
+/** A finished span.
+ */
+struct SpanRecord
+	{
+	const char * name;
+	Dimensions dimensions;
+	uint64_t thread;
+	double start_us; // Microseconds since the first start call
+	double wall_us;
+	double cpu_us;
+	uint64_t bytes_allocated;
+	uint64_t fft_plans_created;
+	unsigned int threads_available;
+	};
+
+/** Per algorithm totals over all recorded spans.
+ */
+struct SummaryRow
+	{
+	std::string name;
+	uint64_t calls = 0;
+	double wall_us = 0;
+	double cpu_us = 0;
+	uint64_t bytes_allocated = 0;
+	uint64_t fft_plans_created = 0;
+	uint64_t samples = 0; // Sum of channels * frames * max( bins, 1 ) over calls
+	};
+
+/** Scoped span, use flan_TRACE_SPAN rather than constructing this directly.
+ */
+class Span
+{
+public:
+	Span( const char * name );
+	Span( const char * name, Dimensions dimensions );
+
+	template<typename T>
+	Span( const char * name, const T & input ) : Span( name, get_dimensions( input ) ) {}
+
+	Span( const Span & ) = delete;
+	Span & operator=( const Span & ) = delete;
+	~Span();
+
+private:
+	const char * name;
+	const char * parent_name;
+	bool active;
+	Dimensions dimensions;
+	double start_wall_us;
+	double start_cpu_us;
+	uint64_t start_bytes;
+	uint64_t start_plans;
+};
+
+/** Begins recording spans. Recorded spans are kept until clear is called. */
+void start();
+
+/** Stops recording spans. Spans open at this point are still recorded when they close. */
+void stop();
+
+bool is_recording();
+
+/** Discards all recorded spans. */
+void clear();
+
+std::vector<SpanRecord> get_spans();
+
+std::vector<SummaryRow> get_summary();
+
+/** Writes all recorded spans in the Chrome trace event format.
+ *	\param filepath File path to write to.
+ */
+bool write_chrome_trace( const std::string & filepath );
+
+/** Writes per algorithm totals, sorted by wall time.
+ *	\param os Stream to write to.
+ */
+void write_summary( std::ostream & os );
+
+void record_allocation( uint64_t bytes );
+
+void record_fft_plan();
+
+}
@@ -1,4 +1,5 @@
 #include "flan/Wavetable.h"
+#include "flan/Utility/Trace.h"
 
 #include <algorithm>
 #include <numeric>
@@ -66,6 +67,7 @@ static Frame snap_frame_to_sample( const Audio & me, Channel channel, Frame fram
 
 static Audio resample_waveforms( const Audio & source, const std::vector<std::vector<Frame>> & waveform_starts, Frame output_wavelength )
 	{
+	flan_TRACE_SPAN( "Wavetable::resample_waveforms", source );
 	// Input validation
 	if( source.is_null() ) return Audio::create_null();
 	if( waveform_starts.empty() ) return Audio::create_null();
@@ -140,6 +142,7 @@ static std::vector<std::vector<Frame>> get_waveform_starts(
 	Frame fixed_frame, 
 	flan_CANCEL_ARG_CPP )
 	{
+	flan_TRACE_SPAN( "Wavetable::get_waveform_starts", source );
 	// Input validation
 	if( source.is_null() ) return std::vector<std::vector<Frame>>();
 	if( fixed_frame < 1 )  return std::vector<std::vector<Frame>>();
@@ -148,6 +151,7 @@ static std::vector<std::vector<Frame>> get_waveform_starts(
 	const Audio lp_source = source.filter_1pole_lowpass( 4000, 2 );
 
 	std::vector<std::vector<Frame>> waveform_starts( source.get_num_channels() );
+	TaskProgress progress( context, "Wavetable::get_waveform_starts", source.get_num_channels() );
 
 	// Find expected waveform lengths via autocorrelation-based pitch detection
 	const Frame ac_granularity = 128;
@@ -158,7 +162,7 @@ static std::vector<std::vector<Frame>> get_waveform_starts(
 		Frame global_wavelength = 0;
 		if( pitch_mode != Wavetable::PitchMode::None )
 			{
-			local_wavelengths = lp_source.get_local_wavelengths( channel, 0, -1, wavelength, ac_granularity, 1, 32, canceller );
+			local_wavelengths = lp_source.get_local_wavelengths( channel, 0, -1, wavelength, ac_granularity, 1, 32, context );
 			global_wavelength = lp_source.get_average_wavelength( local_wavelengths, .2, 64 ); 
 			if( pitch_mode == Wavetable::PitchMode::Global && global_wavelength == -1 ) 
 				pitch_mode = Wavetable::PitchMode::None;
@@ -181,7 +185,7 @@ static std::vector<std::vector<Frame>> get_waveform_starts(
 		waveform_starts[channel].push_back( snap_handler( 0, 0, snap_ratio * global_wavelength ) );
 		while( true ) // Eat until we run out of buffer
 			{
-			if( canceller ) return std::vector<std::vector<Frame>>();
+			flan_CANCEL_POINT( std::vector<std::vector<Frame>>() );
 
 			// Guess how many frames the next wavelength will be
 			Frame expected_num_frames = 0;
@@ -212,6 +216,8 @@ static std::vector<std::vector<Frame>> get_waveform_starts(
 				waveform_starts[channel].back(), 
 				snap_ratio * expected_num_frames ) );
 			}
+
+		progress.advance();
 		}
 
     return waveform_starts;
@@ -227,7 +233,7 @@ Wavetable::Wavetable(
 	flan_CANCEL_ARG_CPP )
 	: wavelength( _wavelength )
 	, num_source_frames( source.get_num_frames() )
-	, waveform_starts( get_waveform_starts( source, snap_mode, pitch_mode, wavelength, snap_ratio, fixed, canceller ) )
+	, waveform_starts( get_waveform_starts( source, snap_mode, pitch_mode, wavelength, snap_ratio, fixed, context ) )
     , table( resample_waveforms( source, waveform_starts, wavelength ) )
 	{
 	}
@@ -238,6 +244,7 @@ Wavetable::Wavetable( const Function<Second, Amplitude> & f, int num_waves, Fram
 	, waveform_starts( 1, std::vector<Frame>( num_waves ) )
     , table( Audio::create_empty_with_frames( wavelength * num_waves, 1, 48000 ) )
 	{
+	flan_TRACE_SPAN( "Wavetable::Wavetable" );
 	for( int i = 0; i < num_waves; ++i )
 		waveform_starts[0][i] = i; 
 
@@ -252,7 +259,7 @@ Wavetable::Wavetable( const Function<Second, Amplitude> & f, int num_waves, Fram
 //     , table()
 // 	, table_info()
 // 	{
-// 	resample_waveforms( source, waveform_starts, wavelength, canceller );
+// 	resample_waveforms( source, waveform_starts, wavelength, context );
 // 	}
 
 Wavetable::Wavetable()
@@ -272,17 +279,21 @@ Audio Wavetable::synthesize(
 	flan_CANCEL_ARG_CPP 
 	) const
     {
+	flan_TRACE_SPAN( "Wavetable::synthesize", table );
 	if( is_null() ) return Audio::create_null();
 	
 	// Ouput setup
 	Audio::Format format = table.get_format();
     format.num_frames = table.time_to_frame( length );
+	flan_RESERVE_POINT( uint64_t( format.num_channels ) * format.num_frames * sizeof( Sample ), Audio::create_null() );
     Audio out( format );
 
 	const Frame granularity = out.time_to_frame( granularity_time );
 
 	const ExecutionPolicy lowest_policy = lowest_execution( freq, ratio );
 
+	TaskProgress progress( context, "Wavetable::synthesize", uint64_t( out.get_num_channels() ) * out.get_num_frames() );
+
 	//for( Channel channel = 0; channel < table.get_num_channels(); ++channel )
 	flan::for_each_i( table.get_num_channels(), lowest_policy, [&]( Channel channel )
 		{
@@ -294,7 +305,7 @@ Audio Wavetable::synthesize(
 		Frame phase_frame = 0;
 		while( out_frames_generated < out.get_num_frames() )
 			{
-			if( canceller ) return;
+			flan_CANCEL_POINT();
 
 			const double in_freq_c = double( table.get_sample_rate() ) / wavelength;
 			const double out_freq_c = freq( out.frame_to_time( out_frames_generated ) );
@@ -325,16 +336,20 @@ Audio Wavetable::synthesize(
 				}
 					
 			// Resample directly into output buffer and update frame indices.
-			out_frames_generated += rs.ResampleOut( out.get_sample_pointer( channel, out_frames_generated ), wdl_wanted, out.get_num_frames() - out_frames_generated, 1 );
+			const Frame frames_generated = rs.ResampleOut( out.get_sample_pointer( channel, out_frames_generated ), wdl_wanted, out.get_num_frames() - out_frames_generated, 1 );
+			out_frames_generated += frames_generated;
 			phase_frame = ( phase_frame + wdl_wanted ) % wavelength;
+			progress.advance( frames_generated );
 			}
 		} );
+	flan_CANCEL_POINT( Audio::create_null() );
 	
 	return out;
     }
 
 Graph Wavetable::graph_waveform_range( Channel channel, int start, int num ) const
 	{
+	flan_TRACE_SPAN( "Wavetable::graph_waveform_range", table );
 	if( is_null() ) return Graph();
 
 	Graph g( -1, -1 );
@@ -352,6 +367,7 @@ Graph Wavetable::graph_waveform_range( Channel channel, int start, int num ) con
 
 void Wavetable::save_waveform_range_to_bmp( const std::string & filename, Channel channel, int start, int end ) const
 	{
+	flan_TRACE_SPAN( "Wavetable::save_waveform_range_to_bmp", table );
 	const Graph g = graph_waveform_range( channel, start, end );
 	g.save_image( filename );
 	}
@@ -363,6 +379,7 @@ int Wavetable::get_num_waveforms( Channel c ) const
 
 void Wavetable::add_fades_in_place( Frame fade_frames )
 	{
+	flan_TRACE_SPAN( "Wavetable::add_fades_in_place", table );
 	if( is_null() ) return;
 
 	flan::for_each_i( waveform_starts.size(), ExecutionPolicy::Parallel_Unsequenced, [&]( Channel channel )
@@ -385,6 +402,7 @@ void Wavetable::add_fades_in_place( Frame fade_frames )
 
 void Wavetable::remove_jumps_in_place( Frame fade_frames )
 	{
+	flan_TRACE_SPAN( "Wavetable::remove_jumps_in_place", table );
 	if( is_null() ) return;
 
 	flan::for_each_i( waveform_starts.size(), ExecutionPolicy::Parallel_Unsequenced, [&]( Channel channel )
@@ -413,6 +431,7 @@ void Wavetable::remove_jumps_in_place( Frame fade_frames )
 
 void Wavetable::remove_dc_in_place()
 	{
+	flan_TRACE_SPAN( "Wavetable::remove_dc_in_place", table );
 	if( is_null() ) return;
 
 	flan::for_each_i( waveform_starts.size(), ExecutionPolicy::Parallel_Unsequenced, [&]( Channel channel )
@@ -428,6 +447,7 @@ void Wavetable::remove_dc_in_place()
 
 void Wavetable::normalize_in_place()
 	{
+	flan_TRACE_SPAN( "Wavetable::normalize_in_place", table );
 	if( is_null() ) return;
 
 	flan::for_each_i( waveform_starts.size(), ExecutionPolicy::Parallel_Unsequenced, [&]( Channel channel )
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <cmath>
 
+#include "flan/Utility/TaskContext.h"
+
 namespace flan 
 {
 
@@ -46,18 +48,20 @@ const Radian pi2 = pi * 2.0f;
 
 };
 
-/** These macros are used to inject voluntary cancellation points into flan algorithms
- *	Cancellation points can be used to halt algorithms from other threads.
+/** These macros are used to inject voluntary cancellation points into flan algorithms.
+ *	Algorithms taking flan_CANCEL_ARG can be cancelled, given a deadline, given a memory budget, and report progress through
+ *	the TaskContext passed there. See flan::TaskContext.
+ *	flan_CANCEL_POINT( T ) returns T if the task should stop. Inside a parallel region use flan_CANCEL_POINT() to skip the 
+ *	remaining iterations, and follow the region with a normal cancellation point.
+ *	flan_RESERVE_POINT( bytes, T ) counts an allocation against the memory budget, returning T if it doesn't fit.
  */
 #define flan_CANCELLABLE
 #ifdef flan_CANCELLABLE
-	static std::atomic<bool> default_canceller( false ); // Global flag used for default argument, doesn't change
-	#define flan_CANCEL_POINT( T ) { if( canceller ) return T; }
-	#define flan_CANCEL_ARG std::atomic<bool> & = default_canceller
-	#define flan_CANCEL_ARG_CPP std::atomic<bool> & canceller
+	#define flan_CANCEL_POINT( T ) { if( context.is_cancelled() ) return T; }
+	#define flan_RESERVE_POINT( bytes, T ) { if( !context.reserve_memory( bytes ) ) return T; }
 #else
 	#define flan_CANCEL_POINT( T )
-	#define flan_CANCEL_ARG void* = nullptr
-	#define flan_CANCEL_ARG_CPP void*
+	#define flan_RESERVE_POINT( bytes, T )
 #endif
-
+#define flan_CANCEL_ARG const flan::TaskContext & = flan::TaskContext::none()
+#define flan_CANCEL_ARG_CPP const flan::TaskContext & context
@@ -1,5 +1,7 @@
 #include "phase_vocoder.h"
 
+#include <algorithm>
+
 namespace flan {
 
 MF phase_vocoder( double & phase_buffer, std::complex<float> cpx, Frequency bin_frequency, FrameRate analysis_rate, FrameRate sample_rate )
@@ -59,5 +61,179 @@ std::complex<float> inverse_phase_vocoder( double & phase_buffer, MF mf, FrameRa
 	if( phase_buffer > pi2 ) phase_buffer = std::fmod( phase_buffer, pi2 );
 	return std::polar( mf.m, float( phase_buffer ) );
 	}
+
+//============================================================================================================================================================
+// Frame kernels
+//============================================================================================================================================================
+
+using Accuracy = TaskContext::Accuracy;
+
+// The approximations below only vectorize once inlined into the frame loops, which compilers don't always choose to do
+#if defined( _MSC_VER )
+	#define flan_PV_INLINE static __forceinline
+#else
+	#define flan_PV_INLINE [[gnu::always_inline]] static inline
+#endif
+
+static constexpr double pi2_d = 6.283185307179586;
+static constexpr float half_pi_f = 1.57079633f;
+static constexpr float quarter_pi_f = 0.785398163f;
+
+// std::round and std::floor don't vectorize on every target, but conversions to int do. x must fit in an int.
+flan_PV_INLINE double round_approx( double x )
+	{
+	return int( x + ( x < 0.0 ? -0.5 : 0.5 ) );
+	}
+
+// atan2 is folded into the octant [0,1] by symmetry, where atan is a minimax polynomial. The maximum errors before float rounding
+// are 2.5e-7 for High and 8.1e-5 for Fast.
+template<Accuracy accuracy>
+flan_PV_INLINE float atan2_approx( float y, float x )
+	{
+	const float ax = std::abs( x );
+	const float ay = std::abs( y );
+	const float a = std::min( ax, ay ) / ( std::max( ax, ay ) + 1e-30f );
+	const float s = a * a;
+
+	float r;
+	if constexpr( accuracy == Accuracy::High )
+		r = a * ( 0.9999961f + s * ( -0.3331737f + s * ( 0.1980782f + s * ( -0.1323334f 
+			+ s * ( 0.07962365f + s * ( -0.03360420f + s * 0.006811786f ) ) ) ) ) );
+	else
+		r = a * ( 0.9992138f + s * ( -0.3211749f + s * ( 0.1462644f + s * -0.03898647f ) ) );
+
+	// Unfold the octant. Each fold is a reflection written with copysign, which avoids branches.
+	r = quarter_pi_f + ( r - quarter_pi_f ) * std::copysign( 1.0f, ax - ay ); // Reflect about pi/4 if |y| > |x|
+	r = half_pi_f - std::copysign( half_pi_f - r, x ); // Reflect about pi/2 if x < 0
+	return std::copysign( r, y );
+	}
+
+// phase must be in [-pi2, pi2]. It is reduced to [-pi/4, pi/4] around the nearest quarter turn, where sin and cos are minimax
+// polynomials. The maximum errors are 1.2e-9 for High and 1e-5 for Fast, before float rounding.
+template<Accuracy accuracy>
+flan_PV_INLINE void polar_approx( float m, double phase, float & re, float & im )
+	{
+	const int quarter = round_approx( phase * ( 4.0 / pi2_d ) );
+	const float r = float( phase - quarter * ( pi2_d / 4.0 ) );
+	const float s = r * r;
+
+	float sin_r, cos_r;
+	if constexpr( accuracy == Accuracy::High )
+		{
+		sin_r = r * ( 1.0f + s * ( -0.1666664f + s * ( 0.008331585f + s * -0.0001946212f ) ) );
+		cos_r = 1.0f + s * ( -0.4999986f + s * ( 0.04165503f + s * -0.001358591f ) );
+		}
+	else
+		{
+		sin_r = r * ( 0.9999950f + s * ( -0.1666016f + s * 0.008121558f ) );
+		cos_r = 0.9999900f + s * ( -0.4997081f + s * 0.04039853f );
+		}
+
+	const int quadrant = quarter & 3;
+	const float sin_p = quadrant == 0 ? sin_r : quadrant == 1 ? cos_r : quadrant == 2 ? -sin_r : -cos_r;
+	const float cos_p = quadrant == 0 ? cos_r : quadrant == 1 ? -sin_r : quadrant == 2 ? -cos_r : sin_r;
+	re = m * cos_p;
+	im = m * sin_p;
+	}
+
+template<Accuracy accuracy, bool use_wrapping>
+static void phase_vocoder_frame_approx( 
+	const float * in, 
+	double * phase_buffer, 
+	MF * out, 
+	const Frequency * bin_frequencies, 
+	size_t num_bins,
+	FrameRate analysis_rate 
+	)
+	{
+	const double expected_scale = pi2_d / analysis_rate;
+	const double frequency_scale = analysis_rate / pi2_d;
+	for( size_t bin = 0; bin < num_bins; ++bin )
+		{
+		const float re = in[2 * bin];
+		const float im = in[2 * bin + 1];
+		const double phase = atan2_approx<accuracy>( im, re );
+		const double delta_phase = phase - phase_buffer[bin] - bin_frequencies[bin] * expected_scale;
+		phase_buffer[bin] = phase;
+		const double wrapped_delta_phase = use_wrapping ? delta_phase - pi2_d * round_approx( delta_phase / pi2_d ) : delta_phase;
+		out[bin] = { std::sqrt( re * re + im * im ), Frequency( bin_frequencies[bin] + wrapped_delta_phase * frequency_scale ) };
+		}
+	}
+
+template<Accuracy accuracy>
+static void inverse_phase_vocoder_frame_approx( 
+	const MF * in, 
+	double * phase_buffer, 
+	float * out, 
+	size_t num_bins,
+	FrameRate analysis_rate 
+	)
+	{
+	const double phase_scale = pi2_d / analysis_rate;
+	for( size_t bin = 0; bin < num_bins; ++bin )
+		{
+		double phase = phase_buffer[bin] + in[bin].f * phase_scale;
+		phase -= pi2_d * round_approx( phase / pi2_d );
+		phase_buffer[bin] = phase;
+		polar_approx<accuracy>( in[bin].m, phase, out[2 * bin], out[2 * bin + 1] );
+		}
+	}
+
+void phase_vocoder_frame( 
+	std::span<const std::complex<float>> in, 
+	std::span<double> phase_buffer, 
+	std::span<MF> out, 
+	std::span<const Frequency> bin_frequencies, 
+	FrameRate analysis_rate, 
+	FrameRate sample_rate, 
+	Accuracy accuracy 
+	)
+	{
+	const size_t num_bins = std::min( { in.size(), phase_buffer.size(), out.size(), bin_frequencies.size() } );
+	const bool use_wrapping = analysis_rate < sample_rate; // See phase_vocoder
+	const float * complex_in = reinterpret_cast<const float *>( in.data() ); // Complex numbers are arrays of two floats
+
+	switch( accuracy )
+		{
+		case Accuracy::Exact:
+			for( size_t bin = 0; bin < num_bins; ++bin )
+				out[bin] = phase_vocoder( phase_buffer[bin], in[bin], bin_frequencies[bin], analysis_rate, sample_rate );
+			break;
+		case Accuracy::High:
+			if( use_wrapping ) phase_vocoder_frame_approx<Accuracy::High, true >( complex_in, phase_buffer.data(), out.data(), bin_frequencies.data(), num_bins, analysis_rate );
+			else			   phase_vocoder_frame_approx<Accuracy::High, false>( complex_in, phase_buffer.data(), out.data(), bin_frequencies.data(), num_bins, analysis_rate );
+			break;
+		case Accuracy::Fast:
+			if( use_wrapping ) phase_vocoder_frame_approx<Accuracy::Fast, true >( complex_in, phase_buffer.data(), out.data(), bin_frequencies.data(), num_bins, analysis_rate );
+			else			   phase_vocoder_frame_approx<Accuracy::Fast, false>( complex_in, phase_buffer.data(), out.data(), bin_frequencies.data(), num_bins, analysis_rate );
+			break;
+		}
+	}
+
+void inverse_phase_vocoder_frame( 
+	std::span<const MF> in, 
+	std::span<double> phase_buffer, 
+	std::span<std::complex<float>> out, 
+	FrameRate analysis_rate, 
+	Accuracy accuracy 
+	)
+	{
+	const size_t num_bins = std::min( { in.size(), phase_buffer.size(), out.size() } );
+	float * complex_out = reinterpret_cast<float *>( out.data() );
+
+	switch( accuracy )
+		{
+		case Accuracy::Exact:
+			for( size_t bin = 0; bin < num_bins; ++bin )
+				out[bin] = inverse_phase_vocoder( phase_buffer[bin], in[bin], analysis_rate );
+			break;
+		case Accuracy::High:
+			inverse_phase_vocoder_frame_approx<Accuracy::High>( in.data(), phase_buffer.data(), complex_out, num_bins, analysis_rate );
+			break;
+		case Accuracy::Fast:
+			inverse_phase_vocoder_frame_approx<Accuracy::Fast>( in.data(), phase_buffer.data(), complex_out, num_bins, analysis_rate );
+			break;
+		}
+	}
 	
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <complex>
+#include <span>
 
 #include "defines.h"
 
@@ -11,4 +12,41 @@ namespace flan {
 MF phase_vocoder( double & phase_buffer, std::complex<float> cpx, Frequency bin_frequency, FrameRate analysis_rate, FrameRate sample_rate );
 std::complex<float> inverse_phase_vocoder( double & phase_buffer, MF mf, FrameRate analysis_rate );
 
-}
\ No newline at end of file
+/** Phase vocodes a whole frame of bins at once. This gives the same output as calling phase_vocoder on each bin, but the loops
+ *	vectorize, and at the approximate accuracies the transcendental functions are replaced by polynomials. At High accuracy the
+ *	phase error is below 5e-7 radians, and at Fast accuracy it is below 1e-4 radians. Magnitudes are exact to float rounding.
+ *	\param in The complex transform output of one frame.
+ *	\param phase_buffer The phase of each bin in the previous frame. This is updated to the phases of this frame.
+ *	\param out The output of each bin.
+ *	\param bin_frequencies The center frequency of each bin.
+ *	\param analysis_rate The frame rate.
+ *	\param sample_rate The sample rate of the analyzed Audio.
+ *	\param accuracy See TaskContext::Accuracy.
+ */
+void phase_vocoder_frame( 
+	std::span<const std::complex<float>> in, 
+	std::span<double> phase_buffer, 
+	std::span<MF> out, 
+	std::span<const Frequency> bin_frequencies, 
+	FrameRate analysis_rate, 
+	FrameRate sample_rate, 
+	TaskContext::Accuracy accuracy = TaskContext::Accuracy::High 
+	);
+
+/** Inverse phase vocodes a whole frame of bins at once, see phase_vocoder_frame. At High accuracy the output error is below
+ *	3e-7 relative to the magnitude, and at Fast accuracy it is below 2e-5.
+ *	\param in The MF of each bin.
+ *	\param phase_buffer The phase of each bin in the previous frame. This is advanced to the phases of this frame.
+ *	\param out The complex transform input of one frame.
+ *	\param analysis_rate The frame rate.
+ *	\param accuracy See TaskContext::Accuracy.
+ */
+void inverse_phase_vocoder_frame( 
+	std::span<const MF> in, 
+	std::span<double> phase_buffer, 
+	std::span<std::complex<float>> out, 
+	FrameRate analysis_rate, 
+	TaskContext::Accuracy accuracy = TaskContext::Accuracy::High 
+	);
+
+}